@@ -76,6 +76,35 @@ esp_err_t esp_event_post(esp_event_base_t event_base, int32_t event_id,
             event_data, event_data_size, ticks_to_wait);
 }
 
+esp_err_t esp_event_post_nocopy(esp_event_base_t event_base, int32_t event_id,
+        void* event_data, esp_event_data_release_t release, TickType_t ticks_to_wait)
+{
+    if (s_default_loop == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    return esp_event_post_to_nocopy(s_default_loop, event_base, event_id,
+            event_data, release, ticks_to_wait);
+}
+
+esp_err_t esp_event_loop_get_stats_default(esp_event_loop_stats_t* stats)
+{
+    if (s_default_loop == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    return esp_event_loop_get_stats(s_default_loop, stats);
+}
+
+esp_err_t esp_event_loop_get_handler_stats_default(size_t* num_stats, esp_event_handler_stats_t* stats)
+{
+    if (s_default_loop == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    return esp_event_loop_get_handler_stats(s_default_loop, num_stats, stats);
+}
+
 
 #if CONFIG_ESP_EVENT_POST_FROM_ISR
 esp_err_t esp_event_isr_post(esp_event_base_t event_base, int32_t event_id,
@@ -22,10 +22,15 @@
 /* ---------------------------- Definitions --------------------------------- */
 
 #ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
-// LOOP @<address, name> rx:<recieved events no.> dr:<dropped events no.>
-#define LOOP_DUMP_FORMAT              "LOOP @%p,%s rx:%" PRIu32 " dr:%" PRIu32 "\n"
- // handler @<address> ev:<base, id> inv:<times invoked> time:<runtime>
-#define HANDLER_DUMP_FORMAT           "  HANDLER @%p ev:%s,%s inv:%" PRIu32 " time:%lld us\n"
+// LOOP @<address, name> rx:<recieved events no.> dr:<dropped events no.> bt:<batches no.> avg:<average batch size> max:<largest batch size>
+#define LOOP_DUMP_FORMAT              "LOOP @%p,%s rx:%" PRIu32 " dr:%" PRIu32 " bt:%" PRIu32 " avg:%" PRIu32 " max:%" PRIu32 "\n"
+ // wait max:<longest queue wait> hist:<queue wait histogram>
+#define WAIT_DUMP_FORMAT              "  WAIT max:%lld us hist:%s\n"
+ // handler @<address> ev:<base, id> inv:<times invoked> time:<runtime> max:<longest runtime> hist:<runtime histogram>
+#define HANDLER_DUMP_FORMAT           "  HANDLER @%p ev:%s,%s inv:%" PRIu32 " time:%lld us max:%lld us hist:%s\n"
+
+// Histogram printed as comma separated counts
+#define HISTOGRAM_DUMP_SIZE           (ESP_EVENT_HISTOGRAM_BUCKETS * 11)
 
 #define PRINT_DUMP_INFO(dst, sz, ...)  do { \
                                             int cb = snprintf(dst, sz, __VA_ARGS__); \
@@ -46,10 +51,50 @@ static SLIST_HEAD(esp_event_loop_instance_list_t, esp_event_loop_instance) s_eve
 static portMUX_TYPE s_event_loops_spinlock = portMUX_INITIALIZER_UNLOCKED;
 #endif
 
+#if CONFIG_ESP_EVENT_DATA_POOL
+#define EVENT_DATA_POOL_BLOCK_SIZE    ((CONFIG_ESP_EVENT_DATA_POOL_BLOCK_SIZE + 7) & ~7)
+
+typedef union event_data_block {
+    union event_data_block* next;                                   /**< next free block */
+    uint64_t data[EVENT_DATA_POOL_BLOCK_SIZE / sizeof(uint64_t)];   /**< event data, aligned like malloc'ed memory */
+} event_data_block_t;
+
+// Blocks which have been released are kept in a free list. Blocks which have never been taken are
+// handed out in order, so that the pool does not need to be initialized.
+static event_data_block_t s_event_data_pool[CONFIG_ESP_EVENT_DATA_POOL_BLOCKS];
+static event_data_block_t* s_event_data_pool_free = NULL;
+static size_t s_event_data_pool_untouched = 0;
+
+static portMUX_TYPE s_event_data_pool_spinlock = portMUX_INITIALIZER_UNLOCKED;
+#endif
+
 
 /* ------------------------- Static Functions ------------------------------- */
 
 #ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
+static inline void histogram_add(esp_event_histogram_t* hist, int64_t us)
+{
+    uint32_t bucket = 0;
+
+    if (us >= (1LL << (ESP_EVENT_HISTOGRAM_BUCKETS - 2))) {
+        bucket = ESP_EVENT_HISTOGRAM_BUCKETS - 1;
+    } else if (us > 0) {
+        // Durations from 2^(i-1) up to 2^i - 1 go to bucket i
+        bucket = 32 - __builtin_clz((uint32_t) us);
+    }
+    hist->count[bucket]++;
+}
+
+static const char* histogram_print(char* buf, const esp_event_histogram_t* hist)
+{
+    int len = 0;
+
+    for (int i = 0; i < ESP_EVENT_HISTOGRAM_BUCKETS; i++) {
+        len += snprintf(buf + len, HISTOGRAM_DUMP_SIZE - len, i == 0 ? "%" PRIu32 : ",%" PRIu32, hist->count[i]);
+    }
+
+    return buf;
+}
 
 
 static int esp_event_dump_prepare(void)
@@ -89,8 +134,10 @@ static int esp_event_dump_prepare(void)
 
     // Reserve slightly more memory than computed
     int allowance = 3;
-    int size = (((loops + allowance) * (sizeof(LOOP_DUMP_FORMAT) + 10 + 20 + 2 * 11)) +
-                        ((handlers + allowance) * (sizeof(HANDLER_DUMP_FORMAT) + 10 + 2 * 20 + 11 + 20)));
+    int size = (((loops + allowance) * (sizeof(LOOP_DUMP_FORMAT) + 10 + 20 + 5 * 11 +
+                                        sizeof(WAIT_DUMP_FORMAT) + 20 + HISTOGRAM_DUMP_SIZE)) +
+                        ((handlers + allowance) * (sizeof(HANDLER_DUMP_FORMAT) + 10 + 2 * 20 + 11 + 2 * 20 +
+                                                   HISTOGRAM_DUMP_SIZE)));
 
     return size;
 }
@@ -114,9 +161,9 @@ static void esp_event_loop_run_task(void* args)
     vTaskSuspend(NULL);
 }
 
-static void handler_execute(esp_event_loop_instance_t* loop, esp_event_handler_node_t *handler, esp_event_post_instance_t post)
+static void handler_execute(esp_event_loop_instance_t* loop, esp_event_handler_node_t *handler, esp_event_post_instance_t* post)
 {
-    ESP_LOGD(TAG, "running post %s:%"PRIu32" with handler %p and context %p on loop %p", post.base, post.id, handler->handler_ctx->handler, &handler->handler_ctx, loop);
+    ESP_LOGD(TAG, "running post %s:%"PRIu32" with handler %p and context %p on loop %p", post->base, post->id, handler->handler_ctx->handler, &handler->handler_ctx, loop);
 
 #ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
     int64_t start, diff;
@@ -126,39 +173,30 @@ static void handler_execute(esp_event_loop_instance_t* loop, esp_event_handler_n
 #if CONFIG_ESP_EVENT_POST_FROM_ISR
     void* data_ptr = NULL;
 
-    if (post.data_set) {
-        if (post.data_allocated) {
-            data_ptr = post.data.ptr;
+    if (post->data_set) {
+        if (post->data_allocated) {
+            data_ptr = post->data.ptr;
         } else {
-            data_ptr = &post.data.val;
+            data_ptr = &post->data.val;
         }
     }
 
-    (*(handler->handler_ctx->handler))(handler->handler_ctx->arg, post.base, post.id, data_ptr);
+    (*(handler->handler_ctx->handler))(handler->handler_ctx->arg, post->base, post->id, data_ptr);
 #else
-    (*(handler->handler_ctx->handler))(handler->handler_ctx->arg, post.base, post.id, post.data);
+    (*(handler->handler_ctx->handler))(handler->handler_ctx->arg, post->base, post->id, post->data);
 #endif
 
 #ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
     diff = esp_timer_get_time() - start;
 
-    xSemaphoreTake(loop->profiling_mutex, portMAX_DELAY);
-
-    // At this point handler may be already unregistered.
-    // This happens in "handler instance can unregister itself" test case.
-    // To prevent memory corruption error it's necessary to check if pointer is still valid.
-    esp_event_loop_node_t* loop_node;
-    esp_event_handler_node_t* handler_node;
-    SLIST_FOREACH(loop_node, &(loop->loop_nodes), next) {
-        SLIST_FOREACH(handler_node, &(loop_node->handlers), next) {
-            if(handler_node == handler) {
-                handler->invoked++;
-                handler->time += diff;
-            }
-        }
+    // The handler may have unregistered itself, but unregistered handlers are only freed once no post is
+    // being dispatched, so the node is still valid. Statistics are only accessed with the loop mutex held.
+    handler->invoked++;
+    handler->time += diff;
+    if (diff > handler->time_max) {
+        handler->time_max = diff;
     }
-
-    xSemaphoreGive(loop->profiling_mutex);
+    histogram_add(&handler->exec_time, diff);
 #endif
 }
 
@@ -322,25 +360,19 @@ static esp_err_t loop_node_add_handler(esp_event_loop_node_t* loop_node,
     }
 }
 
-static esp_err_t handler_instances_remove(esp_event_handler_nodes_t* handlers, esp_event_handler_instance_context_t* handler_ctx, bool legacy)
+static esp_err_t handler_instances_remove(esp_event_loop_instance_t* loop, esp_event_handler_nodes_t* handlers, esp_event_handler_instance_context_t* handler_ctx, bool legacy)
 {
     esp_event_handler_node_t *it, *temp;
 
     SLIST_FOREACH_SAFE(it, handlers, next, temp) {
-        if (legacy) {
-            if (it->handler_ctx->handler == handler_ctx->handler) {
-                SLIST_REMOVE(handlers, it, esp_event_handler_node, next);
-                free(it->handler_ctx);
-                free(it);
-                return ESP_OK;
-            }
-        } else {
-            if (it->handler_ctx == handler_ctx) {
-                SLIST_REMOVE(handlers, it, esp_event_handler_node, next);
-                free(it->handler_ctx);
-                free(it);
-                return ESP_OK;
-            }
+        if ((legacy && it->handler_ctx->handler == handler_ctx->handler) ||
+            (!legacy && it->handler_ctx == handler_ctx)) {
+            SLIST_REMOVE(handlers, it, esp_event_handler_node, next);
+            // The dispatch table may still refer to the handler, even while it is being executed,
+            // so it is only freed once the table has been replaced.
+            it->unregistered = true;
+            SLIST_INSERT_HEAD(&(loop->retired_handlers), it, next);
+            return ESP_OK;
         }
     }
 
@@ -348,16 +380,16 @@ static esp_err_t handler_instances_remove(esp_event_handler_nodes_t* handlers, e
 }
 
 
-static esp_err_t base_node_remove_handler(esp_event_base_node_t* base_node, int32_t id, esp_event_handler_instance_context_t* handler_ctx, bool legacy)
+static esp_err_t base_node_remove_handler(esp_event_loop_instance_t* loop, esp_event_base_node_t* base_node, int32_t id, esp_event_handler_instance_context_t* handler_ctx, bool legacy)
 {
     if (id == ESP_EVENT_ANY_ID) {
-        return handler_instances_remove(&(base_node->handlers), handler_ctx, legacy);
+        return handler_instances_remove(loop, &(base_node->handlers), handler_ctx, legacy);
     }
     else {
         esp_event_id_node_t *it, *temp;
         SLIST_FOREACH_SAFE(it, &(base_node->id_nodes), next, temp) {
             if (it->id == id) {
-                esp_err_t res = handler_instances_remove(&(it->handlers), handler_ctx, legacy);
+                esp_err_t res = handler_instances_remove(loop, &(it->handlers), handler_ctx, legacy);
 
                 if (res == ESP_OK) {
                     if (SLIST_EMPTY(&(it->handlers))) {
@@ -373,16 +405,16 @@ static esp_err_t base_node_remove_handler(esp_event_base_node_t* base_node, int3
     return ESP_ERR_NOT_FOUND;
 }
 
-static esp_err_t loop_node_remove_handler(esp_event_loop_node_t* loop_node, esp_event_base_t base, int32_t id, esp_event_handler_instance_context_t* handler_ctx, bool legacy)
+static esp_err_t loop_node_remove_handler(esp_event_loop_instance_t* loop, esp_event_loop_node_t* loop_node, esp_event_base_t base, int32_t id, esp_event_handler_instance_context_t* handler_ctx, bool legacy)
 {
     if (base == esp_event_any_base && id == ESP_EVENT_ANY_ID) {
-        return handler_instances_remove(&(loop_node->handlers), handler_ctx, legacy);
+        return handler_instances_remove(loop, &(loop_node->handlers), handler_ctx, legacy);
     }
     else {
         esp_event_base_node_t *it, *temp;
         SLIST_FOREACH_SAFE(it, &(loop_node->base_nodes), next, temp) {
             if (it->base == base) {
-                esp_err_t res = base_node_remove_handler(it, id, handler_ctx, legacy);
+                esp_err_t res = base_node_remove_handler(loop, it, id, handler_ctx, legacy);
 
                 if (res == ESP_OK) {
                     if (SLIST_EMPTY(&(it->handlers)) && SLIST_EMPTY(&(it->id_nodes))) {
@@ -432,20 +464,367 @@ static void loop_node_remove_all_handler(esp_event_loop_node_t* loop_node)
     }
 }
 
+static inline uint32_t dispatch_hash(esp_event_base_t base, int32_t id)
+{
+    uint32_t hash = (uint32_t) ((uintptr_t) base) ^ ((uint32_t) id * 0x9e3779b1);
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6b;
+    hash ^= hash >> 13;
+    return hash;
+}
+
+static esp_event_dispatch_entry_t* dispatch_table_find(const esp_event_dispatch_table_t* table, esp_event_base_t base, int32_t id)
+{
+    // The table is never more than half full, so the probing always reaches an unused entry
+    for (uint32_t i = dispatch_hash(base, id) & table->mask; table->entries[i].base != NULL; i = (i + 1) & table->mask) {
+        if (table->entries[i].base == base && table->entries[i].id == id) {
+            return &(table->entries[i]);
+        }
+    }
+
+    return NULL;
+}
+
+// Collects the handlers executed for the event in the order of execution, which is the order of the
+// registered handler lists. Returns the number of handlers, out may be NULL to only count them.
+static uint32_t loop_collect_handlers(esp_event_loop_instance_t* loop, esp_event_base_t base, int32_t id, esp_event_handler_node_t** out)
+{
+    uint32_t count = 0;
+
+    esp_event_loop_node_t* loop_node;
+    esp_event_base_node_t* base_node;
+    esp_event_id_node_t* id_node;
+    esp_event_handler_node_t* handler;
+
+    SLIST_FOREACH(loop_node, &(loop->loop_nodes), next) {
+        SLIST_FOREACH(handler, &(loop_node->handlers), next) {
+            if (out) {
+                out[count] = handler;
+            }
+            count++;
+        }
+
+        SLIST_FOREACH(base_node, &(loop_node->base_nodes), next) {
+            if (base_node->base != base) {
+                continue;
+            }
+
+            SLIST_FOREACH(handler, &(base_node->handlers), next) {
+                if (out) {
+                    out[count] = handler;
+                }
+                count++;
+            }
+
+            SLIST_FOREACH(id_node, &(base_node->id_nodes), next) {
+                if (id_node->id == id) {
+                    SLIST_FOREACH(handler, &(id_node->handlers), next) {
+                        if (out) {
+                            out[count] = handler;
+                        }
+                        count++;
+                    }
+                    break;
+                }
+            }
+        }
+    }
+
+    return count;
+}
+
+static void dispatch_table_free(esp_event_dispatch_table_t* table)
+{
+    if (table) {
+        free(table->handlers);
+        free(table->entries);
+        free(table);
+    }
+}
+
+static void dispatch_table_add_entry(esp_event_loop_instance_t* loop, esp_event_dispatch_table_t* table, esp_event_base_t base, int32_t id, uint32_t* handlers)
+{
+    uint32_t i = dispatch_hash(base, id) & table->mask;
+
+    for (; table->entries[i].base != NULL; i = (i + 1) & table->mask) {
+        if (table->entries[i].base == base && table->entries[i].id == id) {
+            // Several base nodes of the same base
+            return;
+        }
+    }
+
+    table->entries[i].base = base;
+    table->entries[i].id = id;
+    table->entries[i].first = *handlers;
+    table->entries[i].count = loop_collect_handlers(loop, base, id, NULL);
+    *handlers += table->entries[i].count;
+}
+
+// Builds the dispatch table from the registered handler lists. The lists are only walked here, so that
+// dispatching an event is a hash table lookup followed by the execution of a flat array of handlers.
+static esp_event_dispatch_table_t* dispatch_table_build(esp_event_loop_instance_t* loop)
+{
+    esp_event_loop_node_t* loop_node;
+    esp_event_base_node_t* base_node;
+    esp_event_id_node_t* id_node;
+
+    // Every base node adds an entry for the events without id level handlers, every id node one for its event
+    uint32_t events = 0;
+
+    SLIST_FOREACH(loop_node, &(loop->loop_nodes), next) {
+        SLIST_FOREACH(base_node, &(loop_node->base_nodes), next) {
+            events++;
+            SLIST_FOREACH(id_node, &(base_node->id_nodes), next) {
+                events++;
+            }
+        }
+    }
+
+    esp_event_dispatch_table_t* table = calloc(1, sizeof(*table));
+    if (!table) {
+        return NULL;
+    }
+
+    uint32_t size = 2;
+    while (size < 2 * events) {
+        size <<= 1;
+    }
+
+    table->entries = calloc(size, sizeof(*(table->entries)));
+    if (!table->entries) {
+        goto on_err;
+    }
+    table->mask = size - 1;
+
+    table->loop_handlers = loop_collect_handlers(loop, NULL, ESP_EVENT_ANY_ID, NULL);
+    uint32_t handlers = table->loop_handlers;
+
+    SLIST_FOREACH(loop_node, &(loop->loop_nodes), next) {
+        SLIST_FOREACH(base_node, &(loop_node->base_nodes), next) {
+            dispatch_table_add_entry(loop, table, base_node->base, ESP_EVENT_ANY_ID, &handlers);
+            SLIST_FOREACH(id_node, &(base_node->id_nodes), next) {
+                dispatch_table_add_entry(loop, table, base_node->base, id_node->id, &handlers);
+            }
+        }
+    }
+
+    if (handlers > 0) {
+        table->handlers = calloc(handlers, sizeof(*(table->handlers)));
+        if (!table->handlers) {
+            goto on_err;
+        }
+
+        loop_collect_handlers(loop, NULL, ESP_EVENT_ANY_ID, table->handlers);
+        for (uint32_t i = 0; i < size; i++) {
+            esp_event_dispatch_entry_t* entry = &(table->entries[i]);
+            if (entry->base != NULL) {
+                loop_collect_handlers(loop, entry->base, entry->id, table->handlers + entry->first);
+            }
+        }
+    }
+
+    return table;
+
+on_err:
+    dispatch_table_free(table);
+    return NULL;
+}
+
+// Frees the retired dispatch tables and handlers once no post is being dispatched anymore.
+// Must be called with the loop mutex held.
+static void loop_reclaim(esp_event_loop_instance_t* loop)
+{
+    if (loop->dispatch_depth > 0) {
+        return;
+    }
+
+    esp_event_dispatch_table_t *table, *temp_table;
+    SLIST_FOREACH_SAFE(table, &(loop->retired_tables), next, temp_table) {
+        dispatch_table_free(table);
+    }
+    SLIST_INIT(&(loop->retired_tables));
+
+    // A stale table still refers to the retired handlers
+    if (!loop->dispatch_table_stale) {
+        esp_event_handler_node_t *handler, *temp_handler;
+        SLIST_FOREACH_SAFE(handler, &(loop->retired_handlers), next, temp_handler) {
+            free(handler->handler_ctx);
+            free(handler);
+        }
+        SLIST_INIT(&(loop->retired_handlers));
+    }
+}
+
+// Replaces the dispatch table after the registered handlers have changed. The table in use is not modified,
+// since handlers may register or unregister handlers of the loop while it is being dispatched.
+// Must be called with the loop mutex held.
+static esp_err_t loop_update_dispatch_table(esp_event_loop_instance_t* loop)
+{
+    esp_event_dispatch_table_t* table = dispatch_table_build(loop);
+
+    if (!table) {
+        ESP_LOGE(TAG, "alloc for dispatch table failed");
+        return ESP_ERR_NO_MEM;
+    }
+
+    if (loop->dispatch_table) {
+        SLIST_INSERT_HEAD(&(loop->retired_tables), loop->dispatch_table, next);
+    }
+    loop->dispatch_table = table;
+    loop->dispatch_table_stale = false;
+
+    loop_reclaim(loop);
+
+    return ESP_OK;
+}
+
+// Must be called with the loop mutex held.
+static void loop_remove_handler(esp_event_loop_instance_t* loop, esp_event_base_t base, int32_t id, esp_event_handler_instance_context_t* handler_ctx, bool legacy)
+{
+    esp_event_loop_node_t *it, *temp;
+    esp_event_handler_node_t* last_retired = SLIST_FIRST(&(loop->retired_handlers));
+
+    SLIST_FOREACH_SAFE(it, &(loop->loop_nodes), next, temp) {
+        esp_err_t res = loop_node_remove_handler(loop, it, base, id, handler_ctx, legacy);
+
+        if (res == ESP_OK && SLIST_EMPTY(&(it->base_nodes)) && SLIST_EMPTY(&(it->handlers))) {
+            SLIST_REMOVE(&(loop->loop_nodes), it, esp_event_loop_node, next);
+            free(it);
+            break;
+        }
+    }
+
+    if (SLIST_FIRST(&(loop->retired_handlers)) != last_retired) {
+        if (loop_update_dispatch_table(loop) != ESP_OK) {
+            // The removed handlers are marked as unregistered, so the current table can still be used
+            loop->dispatch_table_stale = true;
+        }
+    }
+}
+
+static bool loop_dispatch(esp_event_loop_instance_t* loop, esp_event_post_instance_t* post)
+{
+    const esp_event_dispatch_table_t* table = loop->dispatch_table;
+
+    if (!table) {
+        return false;
+    }
+
+    uint32_t first = 0;
+    uint32_t count = table->loop_handlers;
+
+    esp_event_dispatch_entry_t* entry = dispatch_table_find(table, post->base, post->id);
+    if (!entry) {
+        // Only loop and base level handlers are registered for this event
+        entry = dispatch_table_find(table, post->base, ESP_EVENT_ANY_ID);
+    }
+    if (entry) {
+        first = entry->first;
+        count = entry->count;
+    }
+
+    bool exec = false;
+
+    for (uint32_t i = first; i < first + count; i++) {
+        esp_event_handler_node_t* handler = table->handlers[i];
+        // Skip handlers unregistered by previously executed handlers
+        if (!handler->unregistered) {
+            handler_execute(loop, handler, post);
+            exec = true;
+        }
+    }
+
+    return exec;
+}
+
+#if CONFIG_ESP_EVENT_DATA_POOL
+static void* event_data_pool_alloc(void)
+{
+    event_data_block_t* block = NULL;
+
+    portENTER_CRITICAL(&s_event_data_pool_spinlock);
+    if (s_event_data_pool_free) {
+        block = s_event_data_pool_free;
+        s_event_data_pool_free = block->next;
+    } else if (s_event_data_pool_untouched < CONFIG_ESP_EVENT_DATA_POOL_BLOCKS) {
+        block = &s_event_data_pool[s_event_data_pool_untouched++];
+    }
+    portEXIT_CRITICAL(&s_event_data_pool_spinlock);
+
+    return block;
+}
+
+static void event_data_pool_free(void* data)
+{
+    event_data_block_t* block = (event_data_block_t*) data;
+
+    portENTER_CRITICAL(&s_event_data_pool_spinlock);
+    block->next = s_event_data_pool_free;
+    s_event_data_pool_free = block;
+    portEXIT_CRITICAL(&s_event_data_pool_spinlock);
+}
+#endif
+
 static void inline __attribute__((always_inline)) post_instance_delete(esp_event_post_instance_t* post)
 {
 #if CONFIG_ESP_EVENT_POST_FROM_ISR
-    if (post->data_allocated && post->data.ptr) {
-        free(post->data.ptr);
+    if (post->release && post->data_allocated && post->data.ptr) {
+        post->release(post->data.ptr);
     }
 #else
-    if (post->data) {
-        free(post->data);
+    if (post->release && post->data) {
+        post->release(post->data);
     }
 #endif
     memset(post, 0, sizeof(*post));
 }
 
+static esp_err_t post_instance_send(esp_event_loop_instance_t* loop, esp_event_post_instance_t* post, TickType_t ticks_to_wait)
+{
+    BaseType_t result = pdFALSE;
+
+#ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
+    post->time_posted = esp_timer_get_time();
+#endif
+
+    // Find the task that currently executes the loop. It is safe to query loop->task since it is
+    // not mutated since loop creation. ENSURE THIS REMAINS TRUE.
+    if (loop->task == NULL) {
+        // The loop has no dedicated task. Find out what task is currently running it.
+        result = xSemaphoreTakeRecursive(loop->mutex, ticks_to_wait);
+
+        if (result == pdTRUE) {
+            if (loop->running_task != xTaskGetCurrentTaskHandle()) {
+                xSemaphoreGiveRecursive(loop->mutex);
+                result = xQueueSendToBack(loop->queue, post, ticks_to_wait);
+            } else {
+                xSemaphoreGiveRecursive(loop->mutex);
+                result = xQueueSendToBack(loop->queue, post, 0);
+            }
+        }
+    } else {
+        // The loop has a dedicated task.
+        if (loop->task != xTaskGetCurrentTaskHandle()) {
+            result = xQueueSendToBack(loop->queue, post, ticks_to_wait);
+        } else {
+            result = xQueueSendToBack(loop->queue, post, 0);
+        }
+    }
+
+    if (result != pdTRUE) {
+#ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
+        atomic_fetch_add(&loop->events_dropped, 1);
+#endif
+        return ESP_ERR_TIMEOUT;
+    }
+
+#ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
+    atomic_fetch_add(&loop->events_recieved, 1);
+#endif
+
+    return ESP_OK;
+}
+
 /* ---------------------------- Public API --------------------------------- */
 
 esp_err_t esp_event_loop_create(const esp_event_loop_args_t* event_loop_args, esp_event_loop_handle_t* event_loop)
@@ -481,14 +860,6 @@ esp_err_t esp_event_loop_create(const esp_event_loop_args_t* event_loop_args, es
         goto on_err;
     }
 
-#ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
-    loop->profiling_mutex = xSemaphoreCreateMutex();
-    if (loop->profiling_mutex == NULL) {
-        ESP_LOGE(TAG, "create event loop profiling mutex failed");
-        goto on_err;
-    }
-#endif
-
     SLIST_INIT(&(loop->loop_nodes));
 
     // Create the loop task if requested
@@ -512,6 +883,7 @@ esp_err_t esp_event_loop_create(const esp_event_loop_args_t* event_loop_args, es
     }
 
     loop->running_task = NULL;
+    loop->batch_size = event_loop_args->batch_size;
 
 #ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
     portENTER_CRITICAL(&s_event_loops_spinlock);
@@ -534,23 +906,15 @@ on_err:
         vSemaphoreDelete(loop->mutex);
     }
 
-#ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
-    if (loop->profiling_mutex != NULL) {
-        vSemaphoreDelete(loop->profiling_mutex);
-    }
-#endif
-
     free(loop);
 
     return err;
 }
 
-// On event lookup performance: The library implements the event list as a linked list, which results to O(n)
-// lookup time. The test comparing this implementation to the O(lg n) performance of rbtrees
-// (https://github.com/freebsd/freebsd/blob/master/sys/sys/tree.h)
-// indicate that the difference is not that substantial, especially considering the additional
-// pointers per node of rbtrees. Code for the rbtree implementation of the event loop library is archived
-// in feature/esp_event_loop_library_rbtrees if needed.
+// On event lookup performance: The library keeps the registered handlers in linked lists, but these are only
+// walked when handlers are registered or unregistered, to build the dispatch table of the loop. Dispatching
+// an event is a hash table lookup of the event followed by the execution of a flat array of handlers,
+// independent of the number of events and handlers registered to the loop.
 esp_err_t esp_event_loop_run(esp_event_loop_handle_t event_loop, TickType_t ticks_to_run)
 {
     assert(event_loop);
@@ -566,53 +930,49 @@ esp_err_t esp_event_loop_run(esp_event_loop_handle_t event_loop, TickType_t tick
     int64_t remaining_ticks = ticks_to_run;
 #endif
 
+    uint32_t batch_size = loop->batch_size > 0 ? loop->batch_size : 1;
+
     while(xQueueReceive(loop->queue, &post, ticks_to_run) == pdTRUE) {
         // The event has already been unqueued, so ensure it gets executed.
         xSemaphoreTakeRecursive(loop->mutex, portMAX_DELAY);
 
         loop->running_task = xTaskGetCurrentTaskHandle();
 
-        bool exec = false;
+        uint32_t batch = 0;
 
-        esp_event_handler_node_t *handler, *temp_handler;
-        esp_event_loop_node_t *loop_node, *temp_node;
-        esp_event_base_node_t *base_node, *temp_base;
-        esp_event_id_node_t *id_node, *temp_id_node;
-
-        SLIST_FOREACH_SAFE(loop_node, &(loop->loop_nodes), next, temp_node) {
-            // Execute loop level handlers
-            SLIST_FOREACH_SAFE(handler, &(loop_node->handlers), next, temp_handler) {
-                handler_execute(loop, handler, post);
-                exec |= true;
+        // Dispatch the events which are already queued behind the first one without giving back the mutex,
+        // up to the batch size of the loop. The events are still dispatched one after the other, in order.
+        do {
+#ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
+            int64_t queue_wait = esp_timer_get_time() - post.time_posted;
+            if (queue_wait > loop->queue_wait_max) {
+                loop->queue_wait_max = queue_wait;
             }
+            histogram_add(&loop->queue_wait, queue_wait);
+#endif
 
-            SLIST_FOREACH_SAFE(base_node, &(loop_node->base_nodes), next, temp_base) {
-                if (base_node->base == post.base) {
-                    // Execute base level handlers
-                    SLIST_FOREACH_SAFE(handler, &(base_node->handlers), next, temp_handler) {
-                        handler_execute(loop, handler, post);
-                        exec |= true;
-                    }
+            loop->dispatch_depth++;
+            bool exec = loop_dispatch(loop, &post);
+            loop->dispatch_depth--;
 
-                    SLIST_FOREACH_SAFE(id_node, &(base_node->id_nodes), next, temp_id_node) {
-                        if (id_node->id == post.id) {
-                            // Execute id level handlers
-                            SLIST_FOREACH_SAFE(handler, &(id_node->handlers), next, temp_handler) {
-                                handler_execute(loop, handler, post);
-                                exec |= true;
-                            }
-                            // Skip to next base node
-                            break;
-                        }
-                    }
-                }
+            loop_reclaim(loop);
+
+            if (!exec) {
+                // No handlers were registered, not even loop/base level handlers
+                ESP_LOGD(TAG, "no handlers have been registered for event %s:%"PRIu32" posted to loop %p", post.base, post.id, event_loop);
             }
-        }
 
-        esp_event_base_t base = post.base;
-        int32_t id = post.id;
+            post_instance_delete(&post);
+            batch++;
+        } while (batch < batch_size && xQueueReceive(loop->queue, &post, 0) == pdTRUE);
 
-        post_instance_delete(&post);
+#ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
+        loop->batches++;
+        loop->batch_events += batch;
+        if (batch > loop->batch_max) {
+            loop->batch_max = batch;
+        }
+#endif
 
         if (ticks_to_run != portMAX_DELAY) {
             end = xTaskGetTickCount();
@@ -629,11 +989,6 @@ esp_err_t esp_event_loop_run(esp_event_loop_handle_t event_loop, TickType_t tick
         loop->running_task = NULL;
 
         xSemaphoreGiveRecursive(loop->mutex);
-
-        if (!exec) {
-            // No handlers were registered, not even loop/base level handlers
-            ESP_LOGD(TAG, "no handlers have been registered for event %s:%"PRIu32" posted to loop %p", base, id, event_loop);
-        }
     }
 
     return ESP_OK;
@@ -646,14 +1001,10 @@ esp_err_t esp_event_loop_delete(esp_event_loop_handle_t event_loop)
 
     esp_event_loop_instance_t* loop = (esp_event_loop_instance_t*) event_loop;
     SemaphoreHandle_t loop_mutex = loop->mutex;
-#ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
-    SemaphoreHandle_t loop_profiling_mutex = loop->profiling_mutex;
-#endif
 
     xSemaphoreTakeRecursive(loop->mutex, portMAX_DELAY);
 
 #ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
-    xSemaphoreTake(loop->profiling_mutex, portMAX_DELAY);
     portENTER_CRITICAL(&s_event_loops_spinlock);
     SLIST_REMOVE(&s_event_loops, loop, esp_event_loop_instance, next);
     portEXIT_CRITICAL(&s_event_loops_spinlock);
@@ -672,6 +1023,12 @@ esp_err_t esp_event_loop_delete(esp_event_loop_handle_t event_loop)
         free(it);
     }
 
+    dispatch_table_free(loop->dispatch_table);
+    loop->dispatch_table = NULL;
+    loop->dispatch_table_stale = false;
+    loop->dispatch_depth = 0;
+    loop_reclaim(loop);
+
     // Drop existing posts on the queue
     esp_event_post_instance_t post;
     while(xQueueReceive(loop->queue, &post, 0) == pdTRUE) {
@@ -683,10 +1040,6 @@ esp_err_t esp_event_loop_delete(esp_event_loop_handle_t event_loop)
     free(loop);
     // Free loop mutex before deleting
     xSemaphoreGiveRecursive(loop_mutex);
-#ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
-    xSemaphoreGive(loop_profiling_mutex);
-    vSemaphoreDelete(loop_profiling_mutex);
-#endif
     vSemaphoreDelete(loop_mutex);
 
     return ESP_OK;
@@ -711,6 +1064,7 @@ esp_err_t esp_event_handler_register_with_internal(esp_event_loop_handle_t event
     }
 
     esp_err_t err = ESP_OK;
+    esp_event_handler_instance_context_t* handler_ctx = NULL;
 
     xSemaphoreTakeRecursive(loop->mutex, portMAX_DELAY);
 
@@ -735,7 +1089,7 @@ esp_err_t esp_event_handler_register_with_internal(esp_event_loop_handle_t event
         SLIST_INIT(&(loop_node->handlers));
         SLIST_INIT(&(loop_node->base_nodes));
 
-        err = loop_node_add_handler(loop_node, event_base, event_id, event_handler, event_handler_arg, handler_ctx_arg, legacy);
+        err = loop_node_add_handler(loop_node, event_base, event_id, event_handler, event_handler_arg, &handler_ctx, legacy);
 
         if (err == ESP_OK) {
             if (!last_loop_node) {
@@ -749,7 +1103,18 @@ esp_err_t esp_event_handler_register_with_internal(esp_event_loop_handle_t event
         }
     }
     else {
-        err = loop_node_add_handler(last_loop_node, event_base, event_id, event_handler, event_handler_arg, handler_ctx_arg, legacy);
+        err = loop_node_add_handler(last_loop_node, event_base, event_id, event_handler, event_handler_arg, &handler_ctx, legacy);
+    }
+
+    // No handler context is returned if the arg of an already registered handler has been updated,
+    // the dispatch table refers to the same handler then.
+    if (err == ESP_OK && handler_ctx) {
+        err = loop_update_dispatch_table(loop);
+        if (err != ESP_OK) {
+            loop_remove_handler(loop, event_base, event_id, handler_ctx, false);
+        } else if (handler_ctx_arg) {
+            *handler_ctx_arg = handler_ctx;
+        }
     }
 
 on_err:
@@ -789,17 +1154,7 @@ esp_err_t esp_event_handler_unregister_with_internal(esp_event_loop_handle_t eve
 
     xSemaphoreTakeRecursive(loop->mutex, portMAX_DELAY);
 
-    esp_event_loop_node_t *it, *temp;
-
-    SLIST_FOREACH_SAFE(it, &(loop->loop_nodes), next, temp) {
-        esp_err_t res = loop_node_remove_handler(it, event_base, event_id, handler_ctx, legacy);
-
-        if (res == ESP_OK && SLIST_EMPTY(&(it->base_nodes)) && SLIST_EMPTY(&(it->handlers))) {
-            SLIST_REMOVE(&(loop->loop_nodes), it, esp_event_loop_node, next);
-            free(it);
-            break;
-        }
-    }
+    loop_remove_handler(loop, event_base, event_id, handler_ctx, legacy);
 
     xSemaphoreGiveRecursive(loop->mutex);
 
@@ -839,8 +1194,20 @@ esp_err_t esp_event_post_to(esp_event_loop_handle_t event_loop, esp_event_base_t
     memset((void*)(&post), 0, sizeof(post));
 
     if (event_data != NULL && event_data_size != 0) {
-        // Make persistent copy of event data on heap.
-        void* event_data_copy = calloc(1, event_data_size);
+        // Make persistent copy of event data, small data is copied into a block of the pool if there is one left.
+        void* event_data_copy = NULL;
+        esp_event_data_release_t release = NULL;
+
+#if CONFIG_ESP_EVENT_DATA_POOL
+        if (event_data_size <= EVENT_DATA_POOL_BLOCK_SIZE) {
+            event_data_copy = event_data_pool_alloc();
+            release = event_data_pool_free;
+        }
+#endif
+        if (event_data_copy == NULL) {
+            event_data_copy = malloc(event_data_size);
+            release = free;
+        }
 
         if (event_data_copy == NULL) {
             return ESP_ERR_NO_MEM;
@@ -854,50 +1221,49 @@ esp_err_t esp_event_post_to(esp_event_loop_handle_t event_loop, esp_event_base_t
 #else
         post.data = event_data_copy;
 #endif
+        post.release = release;
     }
     post.base = event_base;
     post.id = event_id;
 
-    BaseType_t result = pdFALSE;
+    esp_err_t err = post_instance_send(loop, &post, ticks_to_wait);
 
-    // Find the task that currently executes the loop. It is safe to query loop->task since it is
-    // not mutated since loop creation. ENSURE THIS REMAINS TRUE.
-    if (loop->task == NULL) {
-        // The loop has no dedicated task. Find out what task is currently running it.
-        result = xSemaphoreTakeRecursive(loop->mutex, ticks_to_wait);
-
-        if (result == pdTRUE) {
-            if (loop->running_task != xTaskGetCurrentTaskHandle()) {
-                xSemaphoreGiveRecursive(loop->mutex);
-                result = xQueueSendToBack(loop->queue, &post, ticks_to_wait);
-            } else {
-                xSemaphoreGiveRecursive(loop->mutex);
-                result = xQueueSendToBack(loop->queue, &post, 0);
-            }
-        }
-    } else {
-        // The loop has a dedicated task.
-        if (loop->task != xTaskGetCurrentTaskHandle()) {
-            result = xQueueSendToBack(loop->queue, &post, ticks_to_wait);
-        } else {
-            result = xQueueSendToBack(loop->queue, &post, 0);
-        }
+    if (err != ESP_OK) {
+        post_instance_delete(&post);
     }
 
-    if (result != pdTRUE) {
-        post_instance_delete(&post);
+    return err;
+}
 
-#ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
-        atomic_fetch_add(&loop->events_dropped, 1);
-#endif
-        return ESP_ERR_TIMEOUT;
+esp_err_t esp_event_post_to_nocopy(esp_event_loop_handle_t event_loop, esp_event_base_t event_base, int32_t event_id,
+                                   void* event_data, esp_event_data_release_t release, TickType_t ticks_to_wait)
+{
+    assert(event_loop);
+
+    if (event_base == ESP_EVENT_ANY_BASE || event_id == ESP_EVENT_ANY_ID) {
+        return ESP_ERR_INVALID_ARG;
     }
 
-#ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
-    atomic_fetch_add(&loop->events_recieved, 1);
+    esp_event_loop_instance_t* loop = (esp_event_loop_instance_t*) event_loop;
+
+    esp_event_post_instance_t post;
+    memset((void*)(&post), 0, sizeof(post));
+
+    if (event_data != NULL) {
+#if CONFIG_ESP_EVENT_POST_FROM_ISR
+        post.data.ptr = event_data;
+        post.data_allocated = true;
+        post.data_set = true;
+#else
+        post.data = event_data;
 #endif
+        post.release = release;
+    }
+    post.base = event_base;
+    post.id = event_id;
 
-    return ESP_OK;
+    // If the event could not be posted, the buffer stays with the caller and must not be released here.
+    return post_instance_send(loop, &post, ticks_to_wait);
 }
 
 #if CONFIG_ESP_EVENT_POST_FROM_ISR
@@ -929,6 +1295,10 @@ esp_err_t esp_event_isr_post_to(esp_event_loop_handle_t event_loop, esp_event_ba
 
     BaseType_t result = pdFALSE;
 
+#ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
+    post.time_posted = esp_timer_get_time();
+#endif
+
     // Post the event from an ISR,
     result = xQueueSendToBackFromISR(loop->queue, &post, task_unblocked);
 
@@ -949,6 +1319,107 @@ esp_err_t esp_event_isr_post_to(esp_event_loop_handle_t event_loop, esp_event_ba
 }
 #endif
 
+#ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
+static void handler_stats_fill(esp_event_handler_stats_t* stats, esp_event_handler_node_t* handler,
+                               esp_event_base_t base, int32_t id)
+{
+    stats->handler = handler->handler_ctx->handler;
+    stats->handler_arg = handler->handler_ctx->arg;
+    stats->event_base = base;
+    stats->event_id = id;
+    stats->invoked = handler->invoked;
+    stats->time = handler->time;
+    stats->time_max = handler->time_max;
+    stats->exec_time = handler->exec_time;
+}
+#endif
+
+esp_err_t esp_event_loop_get_stats(esp_event_loop_handle_t event_loop, esp_event_loop_stats_t* stats)
+{
+#ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
+    assert(event_loop);
+
+    if (stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_event_loop_instance_t* loop = (esp_event_loop_instance_t*) event_loop;
+
+    xSemaphoreTakeRecursive(loop->mutex, portMAX_DELAY);
+
+    stats->events_received = atomic_load(&loop->events_recieved);
+    stats->events_dropped = atomic_load(&loop->events_dropped);
+    stats->batches = loop->batches;
+    stats->batch_max = loop->batch_max;
+    stats->batch_events = loop->batch_events;
+    stats->queue_wait_max = loop->queue_wait_max;
+    stats->queue_wait = loop->queue_wait;
+
+    xSemaphoreGiveRecursive(loop->mutex);
+
+    return ESP_OK;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+esp_err_t esp_event_loop_get_handler_stats(esp_event_loop_handle_t event_loop, size_t* num_stats,
+                                           esp_event_handler_stats_t* stats)
+{
+#ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
+    assert(event_loop);
+
+    if (num_stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_event_loop_instance_t* loop = (esp_event_loop_instance_t*) event_loop;
+    esp_event_loop_node_t *loop_node_it;
+    esp_event_base_node_t* base_node_it;
+    esp_event_id_node_t* id_node_it;
+    esp_event_handler_node_t* handler_it;
+    size_t capacity = stats != NULL ? *num_stats : SIZE_MAX;
+    size_t count = 0;
+
+    xSemaphoreTakeRecursive(loop->mutex, portMAX_DELAY);
+
+    SLIST_FOREACH(loop_node_it, &(loop->loop_nodes), next) {
+        SLIST_FOREACH(handler_it, &(loop_node_it->handlers), next) {
+            if (stats != NULL && count < capacity) {
+                handler_stats_fill(&stats[count], handler_it, ESP_EVENT_ANY_BASE, ESP_EVENT_ANY_ID);
+            }
+            count++;
+        }
+
+        SLIST_FOREACH(base_node_it, &(loop_node_it->base_nodes), next) {
+            SLIST_FOREACH(handler_it, &(base_node_it->handlers), next) {
+                if (stats != NULL && count < capacity) {
+                    handler_stats_fill(&stats[count], handler_it, base_node_it->base, ESP_EVENT_ANY_ID);
+                }
+                count++;
+            }
+
+            SLIST_FOREACH(id_node_it, &(base_node_it->id_nodes), next) {
+                SLIST_FOREACH(handler_it, &(id_node_it->handlers), next) {
+                    if (stats != NULL && count < capacity) {
+                        handler_stats_fill(&stats[count], handler_it, base_node_it->base, id_node_it->id);
+                    }
+                    count++;
+                }
+            }
+        }
+    }
+
+    xSemaphoreGiveRecursive(loop->mutex);
+
+    *num_stats = count < capacity ? count : capacity;
+
+    return ESP_OK;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
 esp_err_t esp_event_dump(FILE* file)
 {
 #ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
@@ -966,31 +1437,38 @@ esp_err_t esp_event_dump(FILE* file)
     char* dst = buf;
 
     char id_str_buf[20];
+    char hist_str_buf[HISTOGRAM_DUMP_SIZE];
 
     // Print info to buffer
     portENTER_CRITICAL(&s_event_loops_spinlock);
 
     SLIST_FOREACH(loop_it, &s_event_loops, next) {
-        uint32_t events_recieved, events_dropped;
+        uint32_t events_recieved, events_dropped, batches, batch_avg;
 
         events_recieved = atomic_load(&loop_it->events_recieved);
         events_dropped = atomic_load(&loop_it->events_dropped);
+        batches = loop_it->batches;
+        batch_avg = batches > 0 ? (uint32_t) (loop_it->batch_events / batches) : 0;
 
         PRINT_DUMP_INFO(dst, sz, LOOP_DUMP_FORMAT, loop_it, loop_it->task != NULL ? loop_it->name : "none" ,
-                        events_recieved, events_dropped);
+                        events_recieved, events_dropped, batches, batch_avg, loop_it->batch_max);
+        PRINT_DUMP_INFO(dst, sz, WAIT_DUMP_FORMAT, loop_it->queue_wait_max,
+                        histogram_print(hist_str_buf, &loop_it->queue_wait));
 
         int sz_bak = sz;
 
         SLIST_FOREACH(loop_node_it, &(loop_it->loop_nodes), next) {
             SLIST_FOREACH(handler_it, &(loop_node_it->handlers), next) {
                 PRINT_DUMP_INFO(dst, sz, HANDLER_DUMP_FORMAT, handler_it->handler_ctx->handler, "ESP_EVENT_ANY_BASE",
-                                "ESP_EVENT_ANY_ID", handler_it->invoked, handler_it->time);
+                                "ESP_EVENT_ANY_ID", handler_it->invoked, handler_it->time, handler_it->time_max,
+                                histogram_print(hist_str_buf, &handler_it->exec_time));
             }
 
             SLIST_FOREACH(base_node_it, &(loop_node_it->base_nodes), next) {
                 SLIST_FOREACH(handler_it, &(base_node_it->handlers), next) {
                     PRINT_DUMP_INFO(dst, sz, HANDLER_DUMP_FORMAT, handler_it->handler_ctx->handler, base_node_it->base ,
-                                    "ESP_EVENT_ANY_ID", handler_it->invoked, handler_it->time);
+                                    "ESP_EVENT_ANY_ID", handler_it->invoked, handler_it->time, handler_it->time_max,
+                                    histogram_print(hist_str_buf, &handler_it->exec_time));
                 }
 
                 SLIST_FOREACH(id_node_it, &(base_node_it->id_nodes), next) {
@@ -999,7 +1477,8 @@ esp_err_t esp_event_dump(FILE* file)
                         snprintf(id_str_buf, sizeof(id_str_buf), "%" PRIi32, id_node_it->id);
 
                         PRINT_DUMP_INFO(dst, sz, HANDLER_DUMP_FORMAT, handler_it->handler_ctx->handler, base_node_it->base ,
-                                        id_str_buf, handler_it->invoked, handler_it->time);
+                                        id_str_buf, handler_it->invoked, handler_it->time, handler_it->time_max,
+                                        histogram_print(hist_str_buf, &handler_it->exec_time));
                     }
                 }
             }
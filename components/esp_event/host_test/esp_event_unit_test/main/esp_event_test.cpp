@@ -10,6 +10,8 @@
 #define CATCH_CONFIG_MAIN
 
 #include <stdio.h>
+#include <string.h>
+#include <chrono>
 #include "esp_event.h"
 
 #include "catch.hpp"
@@ -43,6 +45,154 @@ static esp_event_loop_args_t test_event_get_default_loop_args(void)
 
 void dummy_handler(void* event_handler_arg, esp_event_base_t event_base, int32_t event_id, void* event_data) { }
 
+void counting_handler(void* event_handler_arg, esp_event_base_t event_base, int32_t event_id, void* event_data)
+{
+    (*static_cast<size_t*>(event_handler_arg))++;
+}
+
+ESP_EVENT_DEFINE_BASE(s_benchmark_base);
+
+/**
+ * Simple FIFO which replaces the mocked event queue in benchmarks, so that the posts go through
+ * the actual event loop code.
+ */
+struct BenchmarkQueue {
+    static const size_t CAPACITY = QUEUE_SIZE;
+    static const size_t MAX_ITEM_SIZE = 48;
+
+    uint8_t items[CAPACITY][MAX_ITEM_SIZE];
+    size_t item_size;
+    size_t head;
+    size_t count;
+};
+
+BenchmarkQueue s_benchmark_queue;
+
+QueueHandle_t benchmark_queue_create(const UBaseType_t queue_length, const UBaseType_t item_size, const uint8_t queue_type, int num_calls)
+{
+    if (queue_length > BenchmarkQueue::CAPACITY || item_size > BenchmarkQueue::MAX_ITEM_SIZE) {
+        return nullptr;
+    }
+    memset(&s_benchmark_queue, 0, sizeof(s_benchmark_queue));
+    s_benchmark_queue.item_size = item_size;
+    return reinterpret_cast<QueueHandle_t>(&s_benchmark_queue);
+}
+
+BaseType_t benchmark_queue_send(QueueHandle_t queue, const void * const item, TickType_t ticks_to_wait, const BaseType_t copy_position, int num_calls)
+{
+    if (s_benchmark_queue.count == BenchmarkQueue::CAPACITY) {
+        return pdFALSE;
+    }
+    size_t tail = (s_benchmark_queue.head + s_benchmark_queue.count) % BenchmarkQueue::CAPACITY;
+    memcpy(s_benchmark_queue.items[tail], item, s_benchmark_queue.item_size);
+    s_benchmark_queue.count++;
+    return pdTRUE;
+}
+
+BaseType_t benchmark_queue_receive(QueueHandle_t queue, void * const buffer, TickType_t ticks_to_wait, int num_calls)
+{
+    if (s_benchmark_queue.count == 0) {
+        return pdFALSE;
+    }
+    memcpy(buffer, s_benchmark_queue.items[s_benchmark_queue.head], s_benchmark_queue.item_size);
+    s_benchmark_queue.head = (s_benchmark_queue.head + 1) % BenchmarkQueue::CAPACITY;
+    s_benchmark_queue.count--;
+    return pdTRUE;
+}
+
+/**
+ * Registers the given number of handlers, either all for the same event or each for a different event id,
+ * and returns the number of dispatched events per second. Events are posted in bursts which fill the queue.
+ */
+double benchmark_dispatch(size_t handlers, bool same_event, uint32_t batch_size = 0)
+{
+    const size_t EVENTS = 100000;
+    esp_event_loop_handle_t loop = nullptr;
+    esp_event_loop_args_t loop_args = test_event_get_default_loop_args();
+    loop_args.task_name = nullptr;
+    loop_args.batch_size = batch_size;
+    size_t calls = 0;
+
+    REQUIRE(esp_event_loop_create(&loop_args, &loop) == ESP_OK);
+    for (size_t i = 0; i < handlers; i++) {
+        REQUIRE(esp_event_handler_instance_register_with(loop,
+                s_benchmark_base,
+                same_event ? 0 : static_cast<int32_t>(i),
+                counting_handler,
+                &calls,
+                nullptr) == ESP_OK);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t posted = 0; posted < EVENTS; posted += QUEUE_SIZE) {
+        for (size_t i = 0; i < QUEUE_SIZE; i++) {
+            int32_t id = same_event ? 0 : static_cast<int32_t>((posted + i) % handlers);
+            esp_event_post_to(loop, s_benchmark_base, id, nullptr, 0, 0);
+        }
+        esp_event_loop_run(loop, portMAX_DELAY);
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    size_t dispatched = (EVENTS + QUEUE_SIZE - 1) / QUEUE_SIZE * QUEUE_SIZE;
+    CHECK(calls == (same_event ? dispatched * handlers : dispatched));
+    CHECK(esp_event_loop_delete(loop) == ESP_OK);
+
+    return dispatched / std::chrono::duration<double>(end - start).count();
+}
+
+void reading_handler(void* event_handler_arg, esp_event_base_t event_base, int32_t event_id, void* event_data)
+{
+    *static_cast<size_t*>(event_handler_arg) += *static_cast<uint8_t*>(event_data);
+}
+
+void counting_release(void* event_data)
+{
+    (*static_cast<size_t*>(event_data))++;
+}
+
+/**
+ * Posts events with data of the given size one by one, each followed by running the loop, and returns
+ * the average time in nanoseconds from posting an event until its handler has returned. If nocopy is set,
+ * the events are posted with esp_event_post_to_nocopy, otherwise with esp_event_post_to.
+ */
+double benchmark_post_latency(size_t data_size, bool nocopy)
+{
+    const size_t EVENTS = 1000000;
+    esp_event_loop_handle_t loop = nullptr;
+    esp_event_loop_args_t loop_args = test_event_get_default_loop_args();
+    loop_args.task_name = nullptr;
+    size_t sum = 0;
+    size_t released = 0;
+    uint8_t data[256] = {};
+
+    REQUIRE(data_size >= sizeof(released));
+    REQUIRE(data_size <= sizeof(data));
+    REQUIRE(esp_event_loop_create(&loop_args, &loop) == ESP_OK);
+    REQUIRE(esp_event_handler_instance_register_with(loop, s_benchmark_base, 0, reading_handler, &sum, nullptr) == ESP_OK);
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < EVENTS; i++) {
+        if (nocopy) {
+            // The release callback counts in the buffer itself, like a driver returning its buffer would touch it
+            esp_event_post_to_nocopy(loop, s_benchmark_base, 0, &released, counting_release, 0);
+        } else {
+            data[0] = 1;
+            esp_event_post_to(loop, s_benchmark_base, 0, data, data_size, 0);
+        }
+        esp_event_loop_run(loop, portMAX_DELAY);
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    if (nocopy) {
+        CHECK(released == EVENTS);
+    } else {
+        CHECK(sum == EVENTS);
+    }
+    CHECK(esp_event_loop_delete(loop) == ESP_OK);
+
+    return std::chrono::duration<double, std::nano>(end - start).count() / EVENTS;
+}
+
 }
 
 // TODO: IDF-2693, function definition just to satisfy linker, implement esp_common instead
@@ -150,3 +300,82 @@ TEST_CASE("registering with ANY_BASE but specific ID fails") {
             dummy_handler,
             nullptr) == ESP_ERR_INVALID_ARG);
 }
+
+TEST_CASE("benchmark dispatch throughput depending on the number of handlers")
+{
+    MockMutex sem(CreateAnd::IGNORE);
+    xQueueGenericCreate_Stub(benchmark_queue_create);
+    xQueueGenericSend_Stub(benchmark_queue_send);
+    xQueueReceive_Stub(benchmark_queue_receive);
+    xQueueTakeMutexRecursive_IgnoreAndReturn(pdTRUE);
+    xQueueGiveMutexRecursive_IgnoreAndReturn(pdTRUE);
+    xTaskGetCurrentTaskHandle_IgnoreAndReturn(nullptr);
+    xTaskGetTickCount_IgnoreAndReturn(0);
+
+    printf("handlers | events/s, one handler per event | events/s, all handlers for one event\n");
+    for (size_t handlers : {1, 10, 100}) {
+        double different_events = benchmark_dispatch(handlers, false);
+        double same_event = benchmark_dispatch(handlers, true);
+        printf("%8zu | %32.0f | %36.0f\n", handlers, different_events, same_event);
+    }
+
+    xQueueGenericCreate_Stub(nullptr);
+    xQueueGenericSend_Stub(nullptr);
+    xQueueReceive_Stub(nullptr);
+    xQueueTakeMutexRecursive_StopIgnore();
+    xQueueGiveMutexRecursive_StopIgnore();
+    xTaskGetCurrentTaskHandle_StopIgnore();
+    xTaskGetTickCount_StopIgnore();
+}
+
+TEST_CASE("benchmark dispatch throughput of bursts depending on the batch size")
+{
+    MockMutex sem(CreateAnd::IGNORE);
+    xQueueGenericCreate_Stub(benchmark_queue_create);
+    xQueueGenericSend_Stub(benchmark_queue_send);
+    xQueueReceive_Stub(benchmark_queue_receive);
+    xQueueTakeMutexRecursive_IgnoreAndReturn(pdTRUE);
+    xQueueGiveMutexRecursive_IgnoreAndReturn(pdTRUE);
+    xTaskGetCurrentTaskHandle_IgnoreAndReturn(nullptr);
+    xTaskGetTickCount_IgnoreAndReturn(0);
+
+    printf("batch size | events/s, one handler per event\n");
+    for (uint32_t batch_size : {1, 4, 16, 32}) {
+        printf("%10u | %32.0f\n", static_cast<unsigned>(batch_size), benchmark_dispatch(10, false, batch_size));
+    }
+
+    xQueueGenericCreate_Stub(nullptr);
+    xQueueGenericSend_Stub(nullptr);
+    xQueueReceive_Stub(nullptr);
+    xQueueTakeMutexRecursive_StopIgnore();
+    xQueueGiveMutexRecursive_StopIgnore();
+    xTaskGetCurrentTaskHandle_StopIgnore();
+    xTaskGetTickCount_StopIgnore();
+}
+
+TEST_CASE("benchmark post to handler latency depending on how the event data is passed")
+{
+    MockMutex sem(CreateAnd::IGNORE);
+    xQueueGenericCreate_Stub(benchmark_queue_create);
+    xQueueGenericSend_Stub(benchmark_queue_send);
+    xQueueReceive_Stub(benchmark_queue_receive);
+    xQueueTakeMutexRecursive_IgnoreAndReturn(pdTRUE);
+    xQueueGiveMutexRecursive_IgnoreAndReturn(pdTRUE);
+    xTaskGetCurrentTaskHandle_IgnoreAndReturn(nullptr);
+    xTaskGetTickCount_IgnoreAndReturn(0);
+
+    // With CONFIG_ESP_EVENT_DATA_POOL, the 16 byte copy comes from the pool and the 256 byte copy from the heap
+    printf("ns/event, copy of 16 bytes | ns/event, copy of 256 bytes | ns/event, no copy\n");
+    printf("%27.1f | %28.1f | %17.1f\n",
+            benchmark_post_latency(16, false),
+            benchmark_post_latency(256, false),
+            benchmark_post_latency(sizeof(size_t), true));
+
+    xQueueGenericCreate_Stub(nullptr);
+    xQueueGenericSend_Stub(nullptr);
+    xQueueReceive_Stub(nullptr);
+    xQueueTakeMutexRecursive_StopIgnore();
+    xQueueGiveMutexRecursive_StopIgnore();
+    xTaskGetCurrentTaskHandle_StopIgnore();
+    xTaskGetTickCount_StopIgnore();
+}
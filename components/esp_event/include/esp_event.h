@@ -29,6 +29,11 @@ typedef struct {
     uint32_t task_stack_size;                   /**< stack size of the event loop task, ignored if task name is NULL */
     BaseType_t task_core_id;                    /**< core to which the event loop task is pinned to,
                                                         ignored if task name is NULL */
+    uint32_t batch_size;                        /**< maximum number of queued events dispatched while the loop is
+                                                        locked; 0 or 1 unlocks the loop after each event. Larger
+                                                        values reduce the overhead per event under bursts, handlers
+                                                        are still executed one event after the other, but other tasks
+                                                        may wait for a whole batch to register or unregister handlers */
 } esp_event_loop_args_t;
 
 /**
@@ -90,7 +95,8 @@ esp_err_t esp_event_loop_delete_default(void);
  * able to exit exactly at time of expiry as (1) blocking on internal mutexes is necessary for dispatching the dequeued
  * event, and (2) during  dispatch of the dequeued event there is no way to control the time occupied by handler code
  * execution. The guaranteed time of exit is therefore the allotted time + amount of time required to dispatch
- * the last dequeued event.
+ * the last dequeued event. If the loop has been created with a batch size larger than one, the time is checked after
+ * each batch, so the last dequeued batch of events is dispatched before the function returns.
  *
  * In cases where waiting on the queue times out, ESP_OK is returned and not ESP_ERR_TIMEOUT, since it is
  * normal behavior.
@@ -391,6 +397,66 @@ esp_err_t esp_event_post_to(esp_event_loop_handle_t event_loop,
                             size_t event_data_size,
                             TickType_t ticks_to_wait);
 
+/**
+ * @brief Posts an event to the system default event loop without copying the event data.
+ *
+ * This function behaves in the same manner as esp_event_post_to_nocopy, except the event is posted to the
+ * default event loop.
+ *
+ * @param[in] event_base the event base that identifies the event
+ * @param[in] event_id the event ID that identifies the event
+ * @param[in] event_data the data, specific to the event occurrence, that gets passed to the handler
+ * @param[in] release function called with event_data once all handlers have been executed, may be NULL
+ * @param[in] ticks_to_wait number of ticks to block on a full event queue
+ *
+ * @return
+ *  - ESP_OK: Success
+ *  - ESP_ERR_TIMEOUT: Time to wait for event queue to unblock expired
+ *  - ESP_ERR_INVALID_ARG: Invalid combination of event base and event ID
+ *  - ESP_ERR_INVALID_STATE: Default event loop has not been created
+ *  - Others: Fail
+ */
+esp_err_t esp_event_post_nocopy(esp_event_base_t event_base,
+                                int32_t event_id,
+                                void *event_data,
+                                esp_event_data_release_t release,
+                                TickType_t ticks_to_wait);
+
+/**
+ * @brief Posts an event to the specified event loop without copying the event data.
+ *
+ * Unlike esp_event_post_to, the handlers receive event_data itself. If the event has been posted successfully, the
+ * event loop takes ownership of event_data: it must not be modified by the caller anymore, and release is called
+ * with event_data after all handlers have been executed, or when the event loop is deleted before the event is
+ * dispatched. If posting fails, event_data stays with the caller and release is not called.
+ *
+ * This avoids the allocation and copy made by esp_event_post_to, for example when the event data is a large buffer
+ * which has been filled in place.
+ *
+ * @param[in] event_loop the event loop to post to, must not be NULL
+ * @param[in] event_base the event base that identifies the event
+ * @param[in] event_id the event ID that identifies the event
+ * @param[in] event_data the data, specific to the event occurrence, that gets passed to the handler
+ * @param[in] release function called with event_data once all handlers have been executed, may be NULL if
+ *                    event_data does not need to be released (e.g. if it is statically allocated)
+ * @param[in] ticks_to_wait number of ticks to block on a full event queue
+ *
+ * @note release is called from the task running the event loop, the handlers must not keep event_data after
+ *       they return.
+ *
+ * @return
+ *  - ESP_OK: Success
+ *  - ESP_ERR_TIMEOUT: Time to wait for event queue to unblock expired
+ *  - ESP_ERR_INVALID_ARG: Invalid combination of event base and event ID
+ *  - Others: Fail
+ */
+esp_err_t esp_event_post_to_nocopy(esp_event_loop_handle_t event_loop,
+                                   esp_event_base_t event_base,
+                                   int32_t event_id,
+                                   void *event_data,
+                                   esp_event_data_release_t release,
+                                   TickType_t ticks_to_wait);
+
 #if CONFIG_ESP_EVENT_POST_FROM_ISR
 /**
  * @brief Special variant of esp_event_post for posting events from interrupt handlers.
@@ -469,20 +535,31 @@ esp_err_t esp_event_isr_post_to(esp_event_loop_handle_t event_loop,
   where:
 
    event loop
-       format: address,name rx:total_received dr:total_dropped
+       format: address,name rx:total_received dr:total_dropped bt:total_batches avg:batch_avg max:batch_max
        where:
            address - memory address of the event loop
            name - name of the event loop, 'none' if no dedicated task
            total_received - number of successfully posted events
            total_dropped - number of events unsuccessfully posted due to queue being full
+           total_batches - number of times the loop has been locked to dispatch events
+           batch_avg - average number of events dispatched per batch
+           batch_max - largest number of events dispatched in a batch, at most the batch size of the loop
+
+   queue wait, printed after each event loop
+       format: WAIT max:max_wait hist:wait_histogram
+       where:
+           max_wait - longest time an event has waited in the queue of the loop before being dispatched
+           wait_histogram - counts of esp_event_histogram_t of the waiting times, separated by commas
 
    handler
-       format: address ev:base,id inv:total_invoked run:total_runtime
+       format: address ev:base,id inv:total_invoked time:total_runtime max:max_runtime hist:runtime_histogram
        where:
            address - address of the handler function
            base,id - the event specified by event base and ID this handler executes
            total_invoked - number of times this handler has been invoked
            total_runtime - total amount of time used for invoking this handler
+           max_runtime - longest time a single invocation of this handler has taken
+           runtime_histogram - counts of esp_event_histogram_t of the invocation times, separated by commas
 
  @endverbatim
  *
@@ -497,6 +574,101 @@ esp_err_t esp_event_isr_post_to(esp_event_loop_handle_t event_loop,
  */
 esp_err_t esp_event_dump(FILE *file);
 
+#define ESP_EVENT_HISTOGRAM_BUCKETS     16      /**< number of buckets of esp_event_histogram_t */
+
+/**
+ * @brief Histogram of durations in microseconds, with buckets of logarithmic width.
+ *
+ * Bucket 0 counts durations of less than 1 us. Bucket i counts durations from 2^(i-1) us up to, but not including,
+ * 2^i us. The last bucket also counts all durations which are longer.
+ */
+typedef struct {
+    uint32_t count[ESP_EVENT_HISTOGRAM_BUCKETS];    /**< number of durations in each bucket */
+} esp_event_histogram_t;
+
+/// Statistics of an event loop, collected with CONFIG_ESP_EVENT_LOOP_PROFILING
+typedef struct {
+    uint32_t events_received;                   /**< number of successfully posted events */
+    uint32_t events_dropped;                    /**< number of events unsuccessfully posted due to queue being full */
+    uint32_t batches;                           /**< number of times the loop has been locked to dispatch events */
+    uint32_t batch_max;                         /**< largest number of events dispatched in a batch */
+    uint64_t batch_events;                      /**< number of events dispatched in all batches */
+    int64_t queue_wait_max;                     /**< longest time in us an event has waited in the queue */
+    esp_event_histogram_t queue_wait;           /**< time events have waited in the queue, from being posted until
+                                                        their dispatch starts */
+} esp_event_loop_stats_t;
+
+/// Statistics of an event handler, collected with CONFIG_ESP_EVENT_LOOP_PROFILING
+typedef struct {
+    esp_event_handler_t handler;                /**< the handler function */
+    void *handler_arg;                          /**< the argument the handler has been registered with */
+    esp_event_base_t event_base;                /**< the event base the handler has been registered for,
+                                                        ESP_EVENT_ANY_BASE for any base */
+    int32_t event_id;                           /**< the event ID the handler has been registered for,
+                                                        ESP_EVENT_ANY_ID for any ID */
+    uint32_t invoked;                           /**< number of times the handler has been invoked */
+    int64_t time;                               /**< total time in us spent executing the handler */
+    int64_t time_max;                           /**< longest time in us a single execution of the handler has taken */
+    esp_event_histogram_t exec_time;            /**< execution time of the handler */
+} esp_event_handler_stats_t;
+
+/**
+ * @brief Get the statistics of an event loop.
+ *
+ * @param[in] event_loop the event loop, must not be NULL
+ * @param[out] stats the statistics of the loop
+ *
+ * @return
+ *  - ESP_OK: Success
+ *  - ESP_ERR_INVALID_ARG: stats is NULL
+ *  - ESP_ERR_NOT_SUPPORTED: CONFIG_ESP_EVENT_LOOP_PROFILING is disabled
+ */
+esp_err_t esp_event_loop_get_stats(esp_event_loop_handle_t event_loop, esp_event_loop_stats_t *stats);
+
+/**
+ * @brief Get the statistics of the handlers registered to an event loop.
+ *
+ * The handlers are reported in the same order as by esp_event_dump. Passing NULL as stats only gets the number
+ * of registered handlers.
+ *
+ * @param[in] event_loop the event loop, must not be NULL
+ * @param[inout] num_stats as input, the number of entries stats can hold; as output, the number of entries written
+ *                         to stats, or the number of registered handlers if stats is NULL
+ * @param[out] stats array receiving the statistics of the handlers
+ *
+ * @return
+ *  - ESP_OK: Success
+ *  - ESP_ERR_INVALID_ARG: num_stats is NULL
+ *  - ESP_ERR_NOT_SUPPORTED: CONFIG_ESP_EVENT_LOOP_PROFILING is disabled
+ */
+esp_err_t esp_event_loop_get_handler_stats(esp_event_loop_handle_t event_loop, size_t *num_stats,
+                                           esp_event_handler_stats_t *stats);
+
+/**
+ * @brief Get the statistics of the default event loop.
+ *
+ * @param[out] stats the statistics of the loop
+ *
+ * @return
+ *  - ESP_OK: Success
+ *  - ESP_ERR_INVALID_STATE: Default event loop has not been created
+ *  - Others: Fail, see esp_event_loop_get_stats
+ */
+esp_err_t esp_event_loop_get_stats_default(esp_event_loop_stats_t *stats);
+
+/**
+ * @brief Get the statistics of the handlers registered to the default event loop.
+ *
+ * @param[inout] num_stats see esp_event_loop_get_handler_stats
+ * @param[out] stats array receiving the statistics of the handlers
+ *
+ * @return
+ *  - ESP_OK: Success
+ *  - ESP_ERR_INVALID_STATE: Default event loop has not been created
+ *  - Others: Fail, see esp_event_loop_get_handler_stats
+ */
+esp_err_t esp_event_loop_get_handler_stats_default(size_t *num_stats, esp_event_handler_stats_t *stats);
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
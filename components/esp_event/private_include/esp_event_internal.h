@@ -37,7 +37,11 @@ typedef struct esp_event_handler_node {
 #ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
     uint32_t invoked;                                               /**< number of times this handler has been invoked */
     int64_t time;                                                   /**< total runtime of this handler across all calls */
+    int64_t time_max;                                               /**< longest runtime of a single call */
+    esp_event_histogram_t exec_time;                                /**< runtimes of all calls */
 #endif
+    bool unregistered;                                              /**< handler has been unregistered, but may still be
+                                                                            referenced by the dispatch table in use */
     SLIST_ENTRY(esp_event_handler_node) next;                   /**< next event handler in the list */
 } esp_event_handler_node_t;
 
@@ -73,6 +77,29 @@ typedef struct esp_event_loop_node {
 
 typedef SLIST_HEAD(esp_event_loop_nodes, esp_event_loop_node) esp_event_loop_nodes_t;
 
+/// Handlers to be executed for one event
+typedef struct esp_event_dispatch_entry {
+    esp_event_base_t base;                                          /**< base of the event, NULL for unused entries */
+    int32_t id;                                                     /**< id of the event, ESP_EVENT_ANY_ID for the
+                                                                            events of the base without id level handlers */
+    uint32_t first;                                                 /**< index of the first handler in the handler array */
+    uint32_t count;                                                 /**< number of handlers */
+} esp_event_dispatch_entry_t;
+
+/// Flattened view of the handlers registered to a loop, rebuilt whenever the handlers change
+typedef struct esp_event_dispatch_table {
+    esp_event_dispatch_entry_t* entries;                            /**< open addressing hash table of the registered
+                                                                            events, size is a power of two */
+    uint32_t mask;                                                  /**< number of entries minus one */
+    uint32_t loop_handlers;                                         /**< number of loop level handlers, these are
+                                                                            stored first in the handler array and
+                                                                            executed for events without an entry */
+    esp_event_handler_node_t** handlers;                            /**< handlers of all entries in the order of execution */
+    SLIST_ENTRY(esp_event_dispatch_table) next;                     /**< next table in the list of retired tables */
+} esp_event_dispatch_table_t;
+
+typedef SLIST_HEAD(esp_event_dispatch_tables, esp_event_dispatch_table) esp_event_dispatch_tables_t;
+
 /// Event loop
 typedef struct esp_event_loop_instance {
     const char* name;                                               /**< name of this event loop */
@@ -81,12 +108,27 @@ typedef struct esp_event_loop_instance {
     TaskHandle_t running_task;                                      /**< for loops with no dedicated task, the
                                                                             task that consumes the queue */
     SemaphoreHandle_t mutex;                                        /**< mutex for updating the events linked list */
+    uint32_t batch_size;                                            /**< maximum number of events dispatched per
+                                                                            acquisition of mutex, 0 for one */
     esp_event_loop_nodes_t loop_nodes;                              /**< set of linked lists containing the
                                                                             registered handlers for the loop */
+    esp_event_dispatch_table_t* dispatch_table;                     /**< handlers to execute for each event, built
+                                                                            from loop_nodes */
+    bool dispatch_table_stale;                                      /**< dispatch table could not be rebuilt after
+                                                                            unregistering a handler */
+    uint32_t dispatch_depth;                                        /**< number of posts being dispatched */
+    esp_event_dispatch_tables_t retired_tables;                     /**< replaced dispatch tables, freed when no post
+                                                                            is being dispatched */
+    esp_event_handler_nodes_t retired_handlers;                     /**< unregistered handlers, freed when no post is
+                                                                            being dispatched and no table refers to them */
 #ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
     atomic_uint_least32_t events_recieved;                          /**< number of events successfully posted to the loop */
     atomic_uint_least32_t events_dropped;                           /**< number of events dropped due to queue being full */
-    SemaphoreHandle_t profiling_mutex;                              /**< mutex used for profiliing */
+    uint32_t batches;                                               /**< number of times mutex was taken to dispatch events */
+    uint64_t batch_events;                                          /**< number of events dispatched in all batches */
+    uint32_t batch_max;                                             /**< largest number of events dispatched in a batch */
+    int64_t queue_wait_max;                                         /**< longest time an event has waited in the queue */
+    esp_event_histogram_t queue_wait;                               /**< time events have waited in the queue */
     SLIST_ENTRY(esp_event_loop_instance) next;                      /**< next event loop in the list */
 #endif
 } esp_event_loop_instance_t;
@@ -103,12 +145,17 @@ typedef void* esp_event_post_data_t;
 /// Event posted to the event queue
 typedef struct esp_event_post_instance {
 #if CONFIG_ESP_EVENT_POST_FROM_ISR
-    bool data_allocated;                                             /**< indicates whether data is allocated from heap */
+    bool data_allocated;                                             /**< indicates whether data is referenced by pointer */
     bool data_set;                                                   /**< indicates if data is null */
 #endif
     esp_event_base_t base;                                           /**< the event base */
     int32_t id;                                                      /**< the event id */
     esp_event_post_data_t data;                                      /**< data associated with the event */
+    esp_event_data_release_t release;                                /**< releases the data after dispatch, NULL if
+                                                                          the data is not owned by the post */
+#ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
+    int64_t time_posted;                                             /**< time the event has been posted at */
+#endif
 } esp_event_post_instance_t;
 
 #ifdef __cplusplus
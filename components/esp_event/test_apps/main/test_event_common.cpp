@@ -882,6 +882,198 @@ TEST_CASE("handler instance can unregister itself", "[event][linux]")
     TEST_ASSERT_EQUAL(1, test_data.count);
 }
 
+typedef struct {
+    esp_event_loop_handle_t loop;
+    esp_event_handler_instance_t other;
+    int *other_count;
+    int count;
+} modify_from_handler_data_t;
+
+static void test_handler_unregister_other(void* event_handler_arg,
+            esp_event_base_t event_base,
+            int32_t event_id,
+            void* event_data)
+{
+    modify_from_handler_data_t *test_data = (modify_from_handler_data_t*) event_handler_arg;
+
+    (test_data->count)++;
+
+    TEST_ESP_OK(esp_event_handler_instance_unregister_with(test_data->loop, event_base, event_id, test_data->other));
+}
+
+static void test_handler_register_other(void* event_handler_arg,
+            esp_event_base_t event_base,
+            int32_t event_id,
+            void* event_data)
+{
+    modify_from_handler_data_t *test_data = (modify_from_handler_data_t*) event_handler_arg;
+
+    (test_data->count)++;
+
+    if (test_data->count == 1) {
+        TEST_ESP_OK(esp_event_handler_instance_register_with(test_data->loop,
+                event_base,
+                event_id,
+                test_handler_inc,
+                test_data->other_count,
+                &test_data->other));
+    }
+}
+
+TEST_CASE("handler instance unregistered by a previous handler of the same event is not executed", "[event][linux]")
+{
+    EV_LoopFix loop_fix;
+    int other_count = 0;
+
+    modify_from_handler_data_t test_data = {
+        .loop = loop_fix.loop,
+        .other = NULL,
+        .other_count = &other_count,
+        .count = 0,
+    };
+
+    TEST_ESP_OK(esp_event_handler_instance_register_with(loop_fix.loop,
+            s_test_base1,
+            TEST_EVENT_BASE1_EV1,
+            test_handler_unregister_other,
+            &test_data,
+            NULL));
+    TEST_ESP_OK(esp_event_handler_instance_register_with(loop_fix.loop,
+            s_test_base1,
+            TEST_EVENT_BASE1_EV1,
+            test_handler_inc,
+            &other_count,
+            &test_data.other));
+
+    TEST_ESP_OK(esp_event_post_to(loop_fix.loop, s_test_base1, TEST_EVENT_BASE1_EV1, NULL, 0, portMAX_DELAY));
+    TEST_ESP_OK(esp_event_loop_run(loop_fix.loop, ZERO_DELAY));
+
+    TEST_ASSERT_EQUAL(1, test_data.count);
+    TEST_ASSERT_EQUAL(0, other_count);
+}
+
+TEST_CASE("handler instance registered by a handler is executed from the next event on", "[event][linux]")
+{
+    EV_LoopFix loop_fix;
+    int other_count = 0;
+
+    modify_from_handler_data_t test_data = {
+        .loop = loop_fix.loop,
+        .other = NULL,
+        .other_count = &other_count,
+        .count = 0,
+    };
+
+    TEST_ESP_OK(esp_event_handler_instance_register_with(loop_fix.loop,
+            s_test_base1,
+            TEST_EVENT_BASE1_EV1,
+            test_handler_register_other,
+            &test_data,
+            NULL));
+
+    TEST_ESP_OK(esp_event_post_to(loop_fix.loop, s_test_base1, TEST_EVENT_BASE1_EV1, NULL, 0, portMAX_DELAY));
+    TEST_ESP_OK(esp_event_loop_run(loop_fix.loop, ZERO_DELAY));
+
+    TEST_ASSERT_EQUAL(1, test_data.count);
+    TEST_ASSERT_EQUAL(0, other_count);
+
+    TEST_ESP_OK(esp_event_post_to(loop_fix.loop, s_test_base1, TEST_EVENT_BASE1_EV1, NULL, 0, portMAX_DELAY));
+    TEST_ESP_OK(esp_event_loop_run(loop_fix.loop, ZERO_DELAY));
+
+    TEST_ASSERT_EQUAL(2, test_data.count);
+    TEST_ASSERT_EQUAL(1, other_count);
+}
+
+static void test_handler_record_order(void* event_handler_arg,
+            esp_event_base_t event_base,
+            int32_t event_id,
+            void* event_data)
+{
+    int *order = (int*) event_handler_arg;
+    int index = *(int*) event_data;
+
+    order[index] = ++order[0];
+}
+
+TEST_CASE("batched loop dispatches queued events in the order they are posted", "[event][linux]")
+{
+    esp_event_loop_args_t loop_args = test_event_get_default_loop_args();
+    loop_args.task_name = NULL;
+    loop_args.batch_size = 4;
+    esp_event_loop_handle_t loop;
+    TEST_ESP_OK(esp_event_loop_create(&loop_args, &loop));
+
+    // order[0] counts the dispatched events, order[i] records when event i has been dispatched
+    int order[11] = {};
+
+    TEST_ESP_OK(esp_event_handler_register_with(loop, s_test_base1, TEST_EVENT_BASE1_EV1, test_handler_record_order, order));
+
+    for (int i = 1; i <= 10; i++) {
+        TEST_ESP_OK(esp_event_post_to(loop, s_test_base1, TEST_EVENT_BASE1_EV1, &i, sizeof(i), ZERO_DELAY));
+    }
+    TEST_ESP_OK(esp_event_loop_run(loop, pdMS_TO_TICKS(10)));
+
+    int expected[11] = {10, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+    TEST_ASSERT_EQUAL_INT_ARRAY(expected, order, 11);
+
+    TEST_ESP_OK(esp_event_loop_delete(loop));
+}
+
+TEST_CASE("batched loop executes handler instance registered by a handler from the next event of the batch on", "[event][linux]")
+{
+    esp_event_loop_args_t loop_args = test_event_get_default_loop_args();
+    loop_args.task_name = NULL;
+    loop_args.batch_size = 8;
+    esp_event_loop_handle_t loop;
+    TEST_ESP_OK(esp_event_loop_create(&loop_args, &loop));
+    int other_count = 0;
+
+    modify_from_handler_data_t test_data = {
+        .loop = loop,
+        .other = NULL,
+        .other_count = &other_count,
+        .count = 0,
+    };
+
+    TEST_ESP_OK(esp_event_handler_instance_register_with(loop,
+            s_test_base1,
+            TEST_EVENT_BASE1_EV1,
+            test_handler_register_other,
+            &test_data,
+            NULL));
+
+    for (int i = 0; i < 3; i++) {
+        TEST_ESP_OK(esp_event_post_to(loop, s_test_base1, TEST_EVENT_BASE1_EV1, NULL, 0, ZERO_DELAY));
+    }
+    TEST_ESP_OK(esp_event_loop_run(loop, pdMS_TO_TICKS(10)));
+
+    TEST_ASSERT_EQUAL(3, test_data.count);
+    TEST_ASSERT_EQUAL(2, other_count);
+
+    TEST_ESP_OK(esp_event_loop_delete(loop));
+}
+
+TEST_CASE("batched loop with dedicated task dispatches all posted events", "[event][linux]")
+{
+    esp_event_loop_args_t loop_args = test_event_get_default_loop_args();
+    loop_args.task_name = "loop";
+    loop_args.batch_size = 4;
+    esp_event_loop_handle_t loop;
+    TEST_ESP_OK(esp_event_loop_create(&loop_args, &loop));
+    int count = 0;
+
+    TEST_ESP_OK(esp_event_handler_register_with(loop, s_test_base1, TEST_EVENT_BASE1_EV1, test_handler_inc, &count));
+
+    for (int i = 0; i < 10; i++) {
+        TEST_ESP_OK(esp_event_post_to(loop, s_test_base1, TEST_EVENT_BASE1_EV1, NULL, 0, portMAX_DELAY));
+    }
+    vTaskDelay(pdMS_TO_TICKS(10));
+
+    TEST_ASSERT_EQUAL(10, count);
+
+    TEST_ESP_OK(esp_event_loop_delete(loop));
+}
+
 typedef struct {
     size_t counter;
     size_t test_data[4];
@@ -1507,6 +1699,184 @@ TEST_CASE("event data many bytes are copied on post", "[event][linux]")
     TEST_ASSERT_EQUAL_HEX8_ARRAY(ev_data_expected, saved_ev_data.event_data, EventData::MAX_SIZE);
 }
 
+static void count_release(void* event_data)
+{
+    EventData *ev_data = (EventData *) event_data;
+    (*(size_t*) ev_data->event_arg)++;
+}
+
+TEST_CASE("event data posted without copy is passed to handler and released", "[event][linux]")
+{
+    EV_LoopFix loop_fix;
+    size_t released = 0;
+    EventData ev_data(0);
+    ev_data.event_arg = &released;
+    EventData saved_ev_data(0);
+
+    TEST_ESP_OK(esp_event_handler_register_with(loop_fix.loop,
+            s_test_base1,
+            TEST_EVENT_BASE1_EV1,
+            save_ev_data,
+            &saved_ev_data));
+
+    TEST_ESP_OK(esp_event_post_to_nocopy(loop_fix.loop,
+            s_test_base1,
+            TEST_EVENT_BASE1_EV1,
+            &ev_data,
+            count_release,
+            portMAX_DELAY));
+    TEST_ASSERT_EQUAL(0, released);
+    TEST_ESP_OK(esp_event_loop_run(loop_fix.loop, ZERO_DELAY));
+
+    TEST_ASSERT_EQUAL_PTR(&ev_data, saved_ev_data.event_arg);
+    TEST_ASSERT_EQUAL(1, released);
+}
+
+TEST_CASE("event data posted without copy is released when loop is deleted", "[event][linux]")
+{
+    esp_event_loop_args_t loop_args = test_event_get_default_loop_args();
+    loop_args.task_name = NULL;
+    esp_event_loop_handle_t loop;
+    TEST_ESP_OK(esp_event_loop_create(&loop_args, &loop));
+
+    size_t released = 0;
+    EventData ev_data(0);
+    ev_data.event_arg = &released;
+
+    TEST_ESP_OK(esp_event_post_to_nocopy(loop, s_test_base1, TEST_EVENT_BASE1_EV1, &ev_data, count_release, ZERO_DELAY));
+    TEST_ESP_OK(esp_event_loop_delete(loop));
+
+    TEST_ASSERT_EQUAL(1, released);
+}
+
+TEST_CASE("event data posted without copy is not released if posting fails", "[event][linux]")
+{
+    EV_LoopFix loop_fix(1);
+    size_t released = 0;
+    EventData ev_data(0);
+    ev_data.event_arg = &released;
+
+    TEST_ESP_OK(esp_event_post_to(loop_fix.loop, s_test_base1, TEST_EVENT_BASE1_EV1, NULL, 0, ZERO_DELAY));
+    TEST_ASSERT_EQUAL(ESP_ERR_TIMEOUT, esp_event_post_to_nocopy(loop_fix.loop,
+            s_test_base1,
+            TEST_EVENT_BASE1_EV1,
+            &ev_data,
+            count_release,
+            ZERO_DELAY));
+    TEST_ESP_OK(esp_event_loop_run(loop_fix.loop, ZERO_DELAY));
+
+    TEST_ASSERT_EQUAL(0, released);
+}
+
+static void sum_ev_data(void* handler_arg, esp_event_base_t base, int32_t id, void* event_arg)
+{
+    uint32_t *sum = (uint32_t *) handler_arg;
+    uint32_t *data = (uint32_t *) event_arg;
+    *sum += data[0] + data[EventData::MAX_SIZE / sizeof(uint32_t) - 1];
+}
+
+TEST_CASE("event data of many pending events is copied on post", "[event][linux]")
+{
+    // More events than blocks in the event data pool, if it is enabled
+    const size_t EVENT_NUM = 48;
+    EV_LoopFix loop_fix(EVENT_NUM);
+    uint32_t sum = 0;
+    uint32_t expected_sum = 0;
+
+    TEST_ESP_OK(esp_event_handler_register_with(loop_fix.loop,
+            s_test_base1,
+            TEST_EVENT_BASE1_EV1,
+            sum_ev_data,
+            &sum));
+
+    for (uint32_t i = 0; i < EVENT_NUM; i++) {
+        uint32_t ev_data[EventData::MAX_SIZE / sizeof(uint32_t)] = {};
+        ev_data[0] = i;
+        ev_data[EventData::MAX_SIZE / sizeof(uint32_t) - 1] = i * 1000;
+        expected_sum += i + i * 1000;
+        TEST_ESP_OK(esp_event_post_to(loop_fix.loop, s_test_base1, TEST_EVENT_BASE1_EV1, ev_data, sizeof(ev_data), ZERO_DELAY));
+    }
+    for (size_t i = 0; i < EVENT_NUM; i++) {
+        TEST_ESP_OK(esp_event_loop_run(loop_fix.loop, ZERO_DELAY));
+    }
+
+    TEST_ASSERT_EQUAL(expected_sum, sum);
+}
+
+#ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
+static uint32_t histogram_total(const esp_event_histogram_t *hist)
+{
+    uint32_t total = 0;
+    for (int i = 0; i < ESP_EVENT_HISTOGRAM_BUCKETS; i++) {
+        total += hist->count[i];
+    }
+    return total;
+}
+#endif
+
+TEST_CASE("loop and handler statistics can be read", "[event][linux]")
+{
+    EV_LoopFix loop_fix;
+    int any_count = 0;
+    int id_count = 0;
+
+    TEST_ESP_OK(esp_event_handler_register_with(loop_fix.loop, ESP_EVENT_ANY_BASE, ESP_EVENT_ANY_ID, test_handler_inc, &any_count));
+    TEST_ESP_OK(esp_event_handler_register_with(loop_fix.loop, s_test_base1, TEST_EVENT_BASE1_EV1, test_handler_inc, &id_count));
+
+    TEST_ESP_OK(esp_event_post_to(loop_fix.loop, s_test_base1, TEST_EVENT_BASE1_EV1, NULL, 0, ZERO_DELAY));
+    TEST_ESP_OK(esp_event_post_to(loop_fix.loop, s_test_base1, TEST_EVENT_BASE1_EV1, NULL, 0, ZERO_DELAY));
+    TEST_ESP_OK(esp_event_post_to(loop_fix.loop, s_test_base2, TEST_EVENT_BASE2_EV1, NULL, 0, ZERO_DELAY));
+    for (int i = 0; i < 3; i++) {
+        TEST_ESP_OK(esp_event_loop_run(loop_fix.loop, ZERO_DELAY));
+    }
+
+    esp_event_loop_stats_t loop_stats;
+    esp_event_handler_stats_t handler_stats[2];
+    size_t num_stats = 0;
+
+#ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
+    TEST_ESP_OK(esp_event_loop_get_stats(loop_fix.loop, &loop_stats));
+    TEST_ASSERT_EQUAL(3, loop_stats.events_received);
+    TEST_ASSERT_EQUAL(0, loop_stats.events_dropped);
+    TEST_ASSERT_EQUAL(3, loop_stats.batches);
+    TEST_ASSERT_EQUAL(1, loop_stats.batch_max);
+    TEST_ASSERT_EQUAL(3, histogram_total(&loop_stats.queue_wait));
+
+    // Only the number of handlers
+    TEST_ESP_OK(esp_event_loop_get_handler_stats(loop_fix.loop, &num_stats, NULL));
+    TEST_ASSERT_EQUAL(2, num_stats);
+
+    // Less room than handlers
+    num_stats = 1;
+    TEST_ESP_OK(esp_event_loop_get_handler_stats(loop_fix.loop, &num_stats, handler_stats));
+    TEST_ASSERT_EQUAL(1, num_stats);
+
+    num_stats = 2;
+    TEST_ESP_OK(esp_event_loop_get_handler_stats(loop_fix.loop, &num_stats, handler_stats));
+    TEST_ASSERT_EQUAL(2, num_stats);
+
+    TEST_ASSERT_EQUAL_PTR(test_handler_inc, handler_stats[0].handler);
+    TEST_ASSERT_EQUAL_PTR(&any_count, handler_stats[0].handler_arg);
+    TEST_ASSERT_EQUAL_PTR(ESP_EVENT_ANY_BASE, handler_stats[0].event_base);
+    TEST_ASSERT_EQUAL(ESP_EVENT_ANY_ID, handler_stats[0].event_id);
+    TEST_ASSERT_EQUAL(3, handler_stats[0].invoked);
+    TEST_ASSERT_EQUAL(3, histogram_total(&handler_stats[0].exec_time));
+
+    TEST_ASSERT_EQUAL_PTR(&id_count, handler_stats[1].handler_arg);
+    TEST_ASSERT_EQUAL_PTR(s_test_base1, handler_stats[1].event_base);
+    TEST_ASSERT_EQUAL(TEST_EVENT_BASE1_EV1, handler_stats[1].event_id);
+    TEST_ASSERT_EQUAL(2, handler_stats[1].invoked);
+    TEST_ASSERT_EQUAL(2, histogram_total(&handler_stats[1].exec_time));
+    TEST_ASSERT_LESS_OR_EQUAL(handler_stats[1].time, handler_stats[1].time_max);
+#else
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_SUPPORTED, esp_event_loop_get_stats(loop_fix.loop, &loop_stats));
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_SUPPORTED, esp_event_loop_get_handler_stats(loop_fix.loop, &num_stats, handler_stats));
+#endif
+
+    TEST_ASSERT_EQUAL(3, any_count);
+    TEST_ASSERT_EQUAL(2, id_count);
+}
+
 TEST_CASE("default loop: registering fails on uninitialized default loop", "[event][default][linux]")
 {
     esp_event_handler_instance_t instance;
@@ -0,0 +1,397 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include "esp_http_server.h"
+#include "esp_partition.h"
+
+#define SERVER_PORT     8006
+#define CONTENT_LEN     (512 * 1024)
+#define GZ_LEN          (128 * 1024)    /* Stands for the compressed content */
+#define GZ_OFFSET       CONTENT_LEN     /* Of the compressed content in the partition */
+#define COPY_BUF_LEN    1024
+#define NUM_DOWNLOADS   200
+
+static const char s_path[] = "/tmp/httpd_file_serving_benchmark.bin";
+static const char s_gz_path[] = "/tmp/httpd_file_serving_benchmark.bin.gz";
+
+static char s_content[CONTENT_LEN];
+static char s_gz[GZ_LEN];
+static httpd_resp_region_t s_region;
+
+/* What handlers do without httpd_resp_send_file(): read the file into a
+ * buffer and send it one chunk at a time */
+static esp_err_t copy_handler(httpd_req_t *req)
+{
+    char buf[COPY_BUF_LEN];
+    FILE *f = fopen(s_path, "r");
+    if (!f) {
+        return httpd_resp_send_404(req);
+    }
+    size_t len;
+    esp_err_t ret = ESP_OK;
+    while (ret == ESP_OK && (len = fread(buf, 1, sizeof(buf), f)) > 0) {
+        ret = httpd_resp_send_chunk(req, buf, len);
+    }
+    fclose(f);
+    return ret == ESP_OK ? httpd_resp_send_chunk(req, NULL, 0) : ret;
+}
+
+static esp_err_t file_handler(httpd_req_t *req)
+{
+    httpd_resp_set_type(req, HTTPD_TYPE_OCTET);
+    return httpd_resp_send_file(req, s_path);
+}
+
+static esp_err_t region_handler(httpd_req_t *req)
+{
+    httpd_resp_set_type(req, HTTPD_TYPE_OCTET);
+    return httpd_resp_send_region(req, &s_region);
+}
+
+/* Without Nagle's algorithm, the end of a response isn't delayed until
+ * the client acknowledges its beginning */
+static esp_err_t open_fn(httpd_handle_t hd, int sockfd)
+{
+    int nodelay = 1;
+    setsockopt(sockfd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+    return ESP_OK;
+}
+
+/* Fills the content and its compressed variant, which isn't actually
+ * compressed as the client doesn't decode it */
+static void fill(char *buf, size_t len, uint32_t seed)
+{
+    for (size_t i = 0; i < len; i++) {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        buf[i] = (char)seed;
+    }
+}
+
+static bool write_file(const char *path, const char *buf, size_t len)
+{
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        return false;
+    }
+    bool ok = fwrite(buf, 1, len, f) == len;
+    return fclose(f) == 0 && ok;
+}
+
+/* Writes the content and its compressed variant to the partition, and maps them */
+static bool map_region(esp_partition_mmap_handle_t *handle)
+{
+    const esp_partition_t *part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, "www");
+    const void *ptr;
+    if (!part ||
+            esp_partition_erase_range(part, 0, part->size) != ESP_OK ||
+            esp_partition_write(part, 0, s_content, CONTENT_LEN) != ESP_OK ||
+            esp_partition_write(part, GZ_OFFSET, s_gz, GZ_LEN) != ESP_OK ||
+            esp_partition_mmap(part, 0, GZ_OFFSET + GZ_LEN, ESP_PARTITION_MMAP_DATA, &ptr, handle) != ESP_OK) {
+        return false;
+    }
+    s_region = (httpd_resp_region_t) {
+        .data = ptr,
+        .len = CONTENT_LEN,
+        .gz_data = (const char *)ptr + GZ_OFFSET,
+        .gz_len = GZ_LEN,
+        .etag = "\"www-1\"",
+    };
+    return true;
+}
+
+static int connect_to_server(void)
+{
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(SERVER_PORT),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    if (sock < 0 || connect(sock, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        if (sock >= 0) {
+            close(sock);
+        }
+        return -1;
+    }
+    int nodelay = 1;
+    setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+    return sock;
+}
+
+typedef struct {
+    int status;
+    char etag[32];
+    char content_range[48];
+    bool gzip;
+    bool vary;
+    bool has_content_length;
+    size_t body_len;
+} response_t;
+
+static char s_body[CONTENT_LEN];
+
+/* Data received from the server and not read yet */
+typedef struct {
+    int sock;
+    char buf[16384];
+    size_t pos;
+    size_t len;
+} reader_t;
+
+static bool read_bytes(reader_t *rd, char *dst, size_t len)
+{
+    while (len > 0) {
+        if (rd->pos == rd->len) {
+            ssize_t ret = recv(rd->sock, rd->buf, sizeof(rd->buf), 0);
+            if (ret <= 0) {
+                return false;
+            }
+            rd->pos = 0;
+            rd->len = ret;
+        }
+        size_t n = rd->len - rd->pos < len ? rd->len - rd->pos : len;
+        if (dst) {
+            memcpy(dst, rd->buf + rd->pos, n);
+            dst += n;
+        }
+        rd->pos += n;
+        len -= n;
+    }
+    return true;
+}
+
+static bool read_line(reader_t *rd, char *line, size_t size)
+{
+    size_t len = 0;
+    while (len + 1 < size) {
+        if (!read_bytes(rd, &line[len], 1)) {
+            return false;
+        }
+        if (line[len] == '\n') {
+            line[len > 0 && line[len - 1] == '\r' ? len - 1 : len] = '\0';
+            return true;
+        }
+        len++;
+    }
+    return false;
+}
+
+static void copy_value(char *dst, size_t size, const char *line)
+{
+    snprintf(dst, size, "%s", strchr(line, ':') + 2);
+}
+
+/* Reads a response, with its content in s_body */
+static bool read_response(reader_t *rd, response_t *resp)
+{
+    char line[256];
+    size_t content_len = 0;
+    bool chunked = false;
+
+    memset(resp, 0, sizeof(*resp));
+    if (!read_line(rd, line, sizeof(line)) || sscanf(line, "HTTP/1.1 %d", &resp->status) != 1) {
+        return false;
+    }
+    while (true) {
+        if (!read_line(rd, line, sizeof(line))) {
+            return false;
+        }
+        if (line[0] == '\0') {
+            break;
+        }
+        if (strncasecmp(line, "Content-Length: ", 16) == 0) {
+            content_len = strtoul(line + 16, NULL, 10);
+            resp->has_content_length = true;
+        } else if (strcasecmp(line, "Transfer-Encoding: chunked") == 0) {
+            chunked = true;
+        } else if (strcasecmp(line, "Content-Encoding: gzip") == 0) {
+            resp->gzip = true;
+        } else if (strcasecmp(line, "Vary: Accept-Encoding") == 0) {
+            resp->vary = true;
+        } else if (strncasecmp(line, "ETag: ", 6) == 0) {
+            copy_value(resp->etag, sizeof(resp->etag), line);
+        } else if (strncasecmp(line, "Content-Range: ", 15) == 0) {
+            copy_value(resp->content_range, sizeof(resp->content_range), line);
+        }
+    }
+    if (!chunked) {
+        resp->body_len = content_len;
+        return content_len <= sizeof(s_body) && read_bytes(rd, s_body, content_len);
+    }
+    while (true) {
+        if (!read_line(rd, line, sizeof(line))) {
+            return false;
+        }
+        size_t chunk_len = strtoul(line, NULL, 16);
+        if (resp->body_len + chunk_len > sizeof(s_body) ||
+                !read_bytes(rd, s_body + resp->body_len, chunk_len) || !read_line(rd, line, sizeof(line))) {
+            return false;
+        }
+        resp->body_len += chunk_len;
+        if (chunk_len == 0) {
+            return true;
+        }
+    }
+}
+
+static bool request(reader_t *rd, const char *uri, const char *headers, response_t *resp)
+{
+    char req[256];
+    int len = snprintf(req, sizeof(req), "GET %s HTTP/1.1\r\nHost: localhost\r\n%s\r\n", uri, headers);
+    return send(rd->sock, req, len, 0) == len && read_response(rd, resp);
+}
+
+static bool body_is(const response_t *resp, const char *expected, size_t len)
+{
+    return resp->body_len == len && memcmp(s_body, expected, len) == 0;
+}
+
+/* Checks the responses to conditional, range and gzip requests */
+static bool check(reader_t *rd, const char *uri)
+{
+    response_t resp;
+    char headers[96];
+
+    if (!request(rd, uri, "", &resp) || resp.status != 200 || !resp.vary ||
+            !body_is(&resp, s_content, CONTENT_LEN)) {
+        printf("%s: invalid response\n", uri);
+        return false;
+    }
+    char etag[sizeof(resp.etag)];
+    strcpy(etag, resp.etag);
+    snprintf(headers, sizeof(headers), "If-None-Match: %s\r\n", etag);
+    if (!etag[0] || !request(rd, uri, headers, &resp) || resp.status != 304 || !resp.vary ||
+            resp.has_content_length) {
+        printf("%s: invalid response to If-None-Match\n", uri);
+        return false;
+    }
+    if (!request(rd, uri, "Range: bytes=1000-1999\r\n", &resp) || resp.status != 206 ||
+            strcmp(resp.content_range, "bytes 1000-1999/524288") != 0 || !body_is(&resp, s_content + 1000, 1000)) {
+        printf("%s: invalid response to Range\n", uri);
+        return false;
+    }
+    if (!request(rd, uri, "Range: bytes=-100\r\n", &resp) || resp.status != 206 ||
+            !body_is(&resp, s_content + CONTENT_LEN - 100, 100)) {
+        printf("%s: invalid response to suffix Range\n", uri);
+        return false;
+    }
+    snprintf(headers, sizeof(headers), "Range: bytes=0-9\r\nIf-Range: \"other\"\r\n");
+    if (!request(rd, uri, headers, &resp) || resp.status != 200 || !body_is(&resp, s_content, CONTENT_LEN)) {
+        printf("%s: invalid response to If-Range\n", uri);
+        return false;
+    }
+    if (!request(rd, uri, "Range: bytes=600000-\r\n", &resp) || resp.status != 416 ||
+            strcmp(resp.content_range, "bytes */524288") != 0) {
+        printf("%s: invalid response to unsatisfiable Range\n", uri);
+        return false;
+    }
+    if (!request(rd, uri, "Accept-Encoding: deflate, gzip\r\n", &resp) || resp.status != 200 ||
+            !resp.gzip || !resp.vary || !body_is(&resp, s_gz, GZ_LEN) || strcmp(resp.etag, etag) == 0) {
+        printf("%s: invalid response to Accept-Encoding\n", uri);
+        return false;
+    }
+    if (!request(rd, uri, "Accept-Encoding: gzip;q=0\r\n", &resp) || resp.status != 200 || resp.gzip ||
+            !resp.vary) {
+        printf("%s: invalid response to Accept-Encoding with q=0\n", uri);
+        return false;
+    }
+    return true;
+}
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Downloads the content repeatedly, returns the throughput in MB/s, 0 on error */
+static double download(reader_t *rd, const char *uri)
+{
+    response_t resp;
+    double start = now_s();
+    for (int i = 0; i < NUM_DOWNLOADS; i++) {
+        if (!request(rd, uri, "", &resp) || resp.status != 200 || resp.body_len != CONTENT_LEN) {
+            printf("%s: invalid response to download %d\n", uri, i);
+            return 0;
+        }
+    }
+    double rate = (double)NUM_DOWNLOADS * CONTENT_LEN / (now_s() - start) / 1e6;
+    printf("%-8s %.0f MB/s\n", uri, rate);
+    return rate;
+}
+
+void app_main(void)
+{
+    static reader_t rd = { .sock = -1 };
+    esp_partition_mmap_handle_t handle;
+    httpd_handle_t server = NULL;
+    bool mapped = false;
+    bool ok = false;
+
+    fill(s_content, CONTENT_LEN, 1);
+    fill(s_gz, GZ_LEN, 2);
+    if (!write_file(s_path, s_content, CONTENT_LEN) || !write_file(s_gz_path, s_gz, GZ_LEN)) {
+        printf("Failed to write the files\n");
+        goto exit;
+    }
+    mapped = map_region(&handle);
+    if (!mapped) {
+        printf("Failed to map the partition\n");
+        goto exit;
+    }
+
+    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    config.server_port = SERVER_PORT;
+    config.open_fn = open_fn;
+    if (httpd_start(&server, &config) != ESP_OK) {
+        printf("Failed to start the server\n");
+        goto exit;
+    }
+    const httpd_uri_t uris[] = {
+        { .uri = "/copy", .method = HTTP_GET, .handler = copy_handler },
+        { .uri = "/file", .method = HTTP_GET, .handler = file_handler },
+        { .uri = "/region", .method = HTTP_GET, .handler = region_handler },
+    };
+    for (int i = 0; i < sizeof(uris) / sizeof(uris[0]); i++) {
+        httpd_register_uri_handler(server, &uris[i]);
+    }
+
+    rd.sock = connect_to_server();
+    if (rd.sock < 0 || !check(&rd, "/file") || !check(&rd, "/region")) {
+        goto exit;
+    }
+    double copy_rate = download(&rd, "/copy");
+    double file_rate = download(&rd, "/file");
+    double region_rate = download(&rd, "/region");
+    ok = copy_rate > 0 && file_rate > copy_rate && region_rate > copy_rate;
+
+exit:
+    if (rd.sock >= 0) {
+        close(rd.sock);
+    }
+    if (server) {
+        httpd_stop(server);
+    }
+    if (mapped) {
+        esp_partition_munmap(handle);
+    }
+    unlink(s_path);
+    unlink(s_gz_path);
+    printf(ok ? "Benchmark passed\n" : "Benchmark failed\n");
+    exit(ok ? EXIT_SUCCESS : EXIT_FAILURE);
+}
@@ -0,0 +1,162 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include "esp_http_server.h"
+
+#define SERVER_PORT     8003
+#define NUM_IDLE        400
+#define NUM_HOT         4
+#define NUM_ROUNDS      5000
+
+static const char s_body[] = "pong";
+static const char s_request[] = "GET /ping HTTP/1.1\r\nHost: localhost\r\n\r\n";
+
+static esp_err_t ping_handler(httpd_req_t *req)
+{
+    return httpd_resp_send(req, s_body, HTTPD_RESP_USE_STRLEN);
+}
+
+static int connect_to_server(void)
+{
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(SERVER_PORT),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    if (sock < 0 || connect(sock, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        if (sock >= 0) {
+            close(sock);
+        }
+        return -1;
+    }
+    int nodelay = 1;
+    setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+    return sock;
+}
+
+static bool send_request(int sock)
+{
+    return send(sock, s_request, strlen(s_request), 0) == strlen(s_request);
+}
+
+/* Reads one response, returns false on error */
+static bool read_response(int sock)
+{
+    char buf[256];
+    size_t len = 0;
+
+    while (true) {
+        ssize_t ret = recv(sock, buf + len, sizeof(buf) - 1 - len, 0);
+        if (ret <= 0) {
+            return false;
+        }
+        len += ret;
+        buf[len] = '\0';
+        char *body = strstr(buf, "\r\n\r\n");
+        if (body && strlen(body + 4) >= strlen(s_body)) {
+            return strncmp(buf, "HTTP/1.1 200 OK\r\n", 17) == 0 && strcmp(body + 4, s_body) == 0;
+        }
+    }
+}
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Sends requests on the hot connections in rounds, one request per connection
+ * and round, so that the server finds several of them readable at once.
+ * Returns the number of requests per second, 0 on error. */
+static double run_hot_connections(const int *hot)
+{
+    double start = now_s();
+    for (int round = 0; round < NUM_ROUNDS; round++) {
+        for (int i = 0; i < NUM_HOT; i++) {
+            if (!send_request(hot[i])) {
+                return 0;
+            }
+        }
+        for (int i = 0; i < NUM_HOT; i++) {
+            if (!read_response(hot[i])) {
+                return 0;
+            }
+        }
+    }
+    return NUM_ROUNDS * NUM_HOT / (now_s() - start);
+}
+
+void app_main(void)
+{
+    static int idle[NUM_IDLE];
+    int hot[NUM_HOT];
+    bool ok = false;
+    int num_idle = 0;
+    int num_hot = 0;
+
+    httpd_handle_t server = NULL;
+    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    config.server_port = SERVER_PORT;
+    config.max_open_sockets = NUM_IDLE + NUM_HOT;
+    config.backlog_conn = 128;
+    if (httpd_start(&server, &config) != ESP_OK) {
+        printf("Failed to start the server\n");
+        goto exit;
+    }
+    const httpd_uri_t ping_uri = {
+        .uri = "/ping",
+        .method = HTTP_GET,
+        .handler = ping_handler,
+    };
+    httpd_register_uri_handler(server, &ping_uri);
+
+    for (num_hot = 0; num_hot < NUM_HOT; num_hot++) {
+        hot[num_hot] = connect_to_server();
+        if (hot[num_hot] < 0) {
+            printf("Failed to open hot connection %d\n", num_hot);
+            goto exit;
+        }
+    }
+    double rate_without_idle = run_hot_connections(hot);
+
+    /* A request on each idle connection makes sure that the server has
+     * opened its session before the measurement */
+    for (num_idle = 0; num_idle < NUM_IDLE; num_idle++) {
+        idle[num_idle] = connect_to_server();
+        if (idle[num_idle] < 0 || !send_request(idle[num_idle]) || !read_response(idle[num_idle])) {
+            printf("Failed to open idle connection %d\n", num_idle);
+            goto exit;
+        }
+    }
+    double rate_with_idle = run_hot_connections(hot);
+
+    printf("%d hot connections: %.0f requests/s\n", NUM_HOT, rate_without_idle);
+    printf("%d hot and %d idle connections: %.0f requests/s\n", NUM_HOT, NUM_IDLE, rate_with_idle);
+    ok = rate_without_idle > 0 && rate_with_idle > 0;
+
+exit:
+    for (int i = 0; i < num_hot; i++) {
+        close(hot[i]);
+    }
+    for (int i = 0; i < num_idle; i++) {
+        close(idle[i]);
+    }
+    if (server) {
+        httpd_stop(server);
+    }
+    printf(ok ? "Benchmark passed\n" : "Benchmark failed\n");
+    exit(ok ? EXIT_SUCCESS : EXIT_FAILURE);
+}
@@ -0,0 +1,14 @@
+# SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+# SPDX-License-Identifier: Unlicense OR CC0-1.0
+import pytest
+from pytest_embedded import Dut
+
+
+@pytest.mark.linux
+@pytest.mark.host_test
+@pytest.mark.parametrize('config', [
+    'poll',
+    'epoll',
+], indirect=True)
+def test_httpd_poll_linux(dut: Dut) -> None:
+    dut.expect_exact('Benchmark passed', timeout=120)
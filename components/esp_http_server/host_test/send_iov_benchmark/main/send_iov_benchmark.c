@@ -0,0 +1,166 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include "esp_http_server.h"
+
+#define SERVER_PORT     8002
+#define NUM_REQUESTS    5000
+
+static const char s_body[] = "<html><body>Hello from the HTTP server benchmark</body></html>";
+static const char s_request[] = "GET /bench HTTP/1.1\r\nHost: localhost\r\n\r\n";
+
+static bool s_use_iov;
+static unsigned s_send_calls;
+
+static int counting_send(httpd_handle_t hd, int sockfd, const char *buf, size_t buf_len, int flags)
+{
+    s_send_calls++;
+    return send(sockfd, buf, buf_len, flags);
+}
+
+static int counting_send_iov(httpd_handle_t hd, int sockfd, const struct iovec *iov, int iov_count, int flags)
+{
+    s_send_calls++;
+    struct msghdr msg = {
+        .msg_iov = (struct iovec *)iov,
+        .msg_iovlen = iov_count,
+    };
+    return sendmsg(sockfd, &msg, flags);
+}
+
+static esp_err_t open_fn(httpd_handle_t hd, int sockfd)
+{
+    /* Without Nagle's algorithm, each send call is a segment on the wire,
+     * so that the fallback mode isn't delayed by acknowledgements */
+    int nodelay = 1;
+    setsockopt(sockfd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+
+    /* Overriding the send function disables the default vectored send */
+    httpd_sess_set_send_override(hd, sockfd, counting_send);
+    if (s_use_iov) {
+        httpd_sess_set_send_iov_override(hd, sockfd, counting_send_iov);
+    }
+    return ESP_OK;
+}
+
+static esp_err_t bench_handler(httpd_req_t *req)
+{
+    httpd_resp_set_type(req, "text/html");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+    httpd_resp_set_hdr(req, "Connection", "keep-alive");
+    httpd_resp_set_hdr(req, "X-Content-Type-Options", "nosniff");
+    httpd_resp_set_hdr(req, "X-Frame-Options", "DENY");
+    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+    httpd_resp_set_hdr(req, "Server", "esp_http_server");
+    return httpd_resp_send(req, s_body, HTTPD_RESP_USE_STRLEN);
+}
+
+/* Reads one response, returns false on error */
+static bool read_response(int sock)
+{
+    static char buf[1024];
+    size_t len = 0;
+    char *body = NULL;
+
+    while (true) {
+        ssize_t ret = recv(sock, buf + len, sizeof(buf) - 1 - len, 0);
+        if (ret <= 0) {
+            return false;
+        }
+        len += ret;
+        buf[len] = '\0';
+        if (!body) {
+            body = strstr(buf, "\r\n\r\n");
+            if (!body) {
+                continue;
+            }
+            body += 4;
+        }
+        if (len - (body - buf) >= strlen(s_body)) {
+            return strncmp(buf, "HTTP/1.1 200 OK\r\n", 17) == 0 && strcmp(body, s_body) == 0;
+        }
+    }
+}
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static bool run_benchmark(const char *name, bool use_iov)
+{
+    httpd_handle_t server = NULL;
+    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    config.server_port = SERVER_PORT;
+    config.open_fn = open_fn;
+    s_use_iov = use_iov;
+    if (httpd_start(&server, &config) != ESP_OK) {
+        printf("%s: failed to start the server\n", name);
+        return false;
+    }
+    const httpd_uri_t bench_uri = {
+        .uri = "/bench",
+        .method = HTTP_GET,
+        .handler = bench_handler,
+    };
+    httpd_register_uri_handler(server, &bench_uri);
+
+    bool ok = false;
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(SERVER_PORT),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    if (connect(sock, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        printf("%s: failed to connect\n", name);
+        goto exit;
+    }
+    int nodelay = 1;
+    setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+
+    /* The first request opens the session, only the responses are counted */
+    if (send(sock, s_request, strlen(s_request), 0) < 0 || !read_response(sock)) {
+        printf("%s: invalid response\n", name);
+        goto exit;
+    }
+    s_send_calls = 0;
+    double start = now_s();
+    for (int i = 0; i < NUM_REQUESTS; i++) {
+        if (send(sock, s_request, strlen(s_request), 0) < 0 || !read_response(sock)) {
+            printf("%s: invalid response to request %d\n", name, i);
+            goto exit;
+        }
+    }
+    double elapsed = now_s() - start;
+    printf("%-9s %d requests, %.0f requests/s, %.2f send calls per response\n", name,
+           NUM_REQUESTS, NUM_REQUESTS / elapsed, (double)s_send_calls / NUM_REQUESTS);
+    ok = use_iov ? s_send_calls == NUM_REQUESTS : s_send_calls > NUM_REQUESTS;
+
+exit:
+    close(sock);
+    httpd_stop(server);
+    return ok;
+}
+
+void app_main(void)
+{
+    bool ok = run_benchmark("send:", false);
+    ok = run_benchmark("sendmsg:", true) && ok;
+    printf(ok ? "Benchmark passed\n" : "Benchmark failed\n");
+    exit(ok ? EXIT_SUCCESS : EXIT_FAILURE);
+}
@@ -0,0 +1,252 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include "esp_http_server.h"
+
+#define SERVER_PORT     8005
+#define NUM_RESOURCES   24      /* Each resource has 4 URI handlers */
+#define NUM_HANDLERS    (NUM_RESOURCES * 4)
+#define BATCH           50      /* Requests pipelined on the connection */
+#define NUM_BATCHES     400
+
+static unsigned s_match_calls;
+
+/* Same matching as httpd_uri_match_wildcard(), but as the server doesn't know
+ * this function, it calls it for each handler in turn */
+static bool counting_match(const char *template, const char *uri, size_t len)
+{
+    s_match_calls++;
+    return httpd_uri_match_wildcard(template, uri, len);
+}
+
+/* Without Nagle's algorithm, the responses to a batch of requests aren't
+ * delayed until the client acknowledges the first one */
+static esp_err_t open_fn(httpd_handle_t hd, int sockfd)
+{
+    int nodelay = 1;
+    setsockopt(sockfd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+    return ESP_OK;
+}
+
+/* Responds with the template of the handler, so that the client knows which one was used */
+static esp_err_t echo_handler(httpd_req_t *req)
+{
+    return httpd_resp_sendstr(req, req->user_ctx);
+}
+
+/* Templates of a REST API, with exact, prefix and optional character matches */
+static char s_templates[NUM_HANDLERS][48];
+
+static bool register_handlers(httpd_handle_t server)
+{
+    static const char *formats[] = {
+        "/api/v1/res%d",
+        "/api/v1/res%d/*",
+        "/api/v1/res%d/items",
+        "/api/v1/res%d/config/?",
+    };
+    static const httpd_method_t methods[] = {
+        HTTP_GET, HTTP_GET, HTTP_POST, HTTP_PUT,
+    };
+    for (int i = 0; i < NUM_HANDLERS; i++) {
+        snprintf(s_templates[i], sizeof(s_templates[i]), formats[i % 4], i / 4);
+        const httpd_uri_t uri = {
+            .uri = s_templates[i],
+            .method = methods[i % 4],
+            .handler = echo_handler,
+            .user_ctx = s_templates[i],
+        };
+        if (httpd_register_uri_handler(server, &uri) != ESP_OK) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Requests whose responses are compared between the router and the linear lookup */
+static const char *s_checks[] = {
+    "GET /api/v1/res0",
+    "GET /api/v1/res23",
+    "GET /api/v1/res23/",
+    "GET /api/v1/res23/items",
+    "POST /api/v1/res23/items",
+    "POST /api/v1/res23/items/1",
+    "PUT /api/v1/res7/config",
+    "PUT /api/v1/res7/config/",
+    "PUT /api/v1/res7/config/x",
+    "GET /api/v1/res7/config/x",
+    "DELETE /api/v1/res7",
+    "GET /api/v1/res24",
+    "GET /api/v1/res2",
+    "GET /api/v1/res",
+    "GET /",
+};
+
+static int connect_to_server(void)
+{
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(SERVER_PORT),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    if (sock < 0 || connect(sock, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        if (sock >= 0) {
+            close(sock);
+        }
+        return -1;
+    }
+    int nodelay = 1;
+    setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+    return sock;
+}
+
+/* Reads count responses, and copies the status line and body of the
+ * last one to summary. Returns false on error. */
+static bool read_responses(int sock, int count, char *summary, size_t summary_size)
+{
+    static char buf[16384];
+    size_t len = 0;
+
+    while (count) {
+        char *end = strstr(buf, "\r\n\r\n");
+        char *clen = strstr(buf, "Content-Length: ");
+        if (len && end && clen && clen < end) {
+            size_t body_len = strtoul(clen + 16, NULL, 10);
+            size_t resp_len = end + 4 - buf + body_len;
+            if (len >= resp_len) {
+                if (count == 1 && summary) {
+                    snprintf(summary, summary_size, "%.12s %.*s", buf, (int)body_len, end + 4);
+                }
+                memmove(buf, buf + resp_len, len - resp_len);
+                len -= resp_len;
+                buf[len] = '\0';
+                count--;
+                continue;
+            }
+        }
+        ssize_t ret = recv(sock, buf + len, sizeof(buf) - 1 - len, 0);
+        if (ret <= 0) {
+            return false;
+        }
+        len += ret;
+        buf[len] = '\0';
+    }
+    return true;
+}
+
+static bool send_request(int sock, const char *check)
+{
+    char request[128];
+    const char *path = strchr(check, ' ');
+    int len = snprintf(request, sizeof(request), "%.*s%s HTTP/1.1\r\nHost: localhost\r\n\r\n",
+                       (int)(path - check), check, path);
+    return send(sock, request, len, 0) == len;
+}
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static bool run_benchmark(const char *name, httpd_uri_match_func_t match_fn,
+                          char summaries[][64], double *rate)
+{
+    httpd_handle_t server = NULL;
+    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    config.server_port = SERVER_PORT;
+    config.max_uri_handlers = NUM_HANDLERS;
+    config.uri_match_fn = match_fn;
+    config.open_fn = open_fn;
+    if (httpd_start(&server, &config) != ESP_OK || !register_handlers(server)) {
+        printf("%s: failed to start the server\n", name);
+        if (server) {
+            httpd_stop(server);
+        }
+        return false;
+    }
+
+    bool ok = false;
+    int sock = -1;
+    /* The server closes the connection after an error response */
+    for (int i = 0; i < sizeof(s_checks) / sizeof(s_checks[0]); i++) {
+        sock = connect_to_server();
+        if (sock < 0 || !send_request(sock, s_checks[i]) || !read_responses(sock, 1, summaries[i], 64)) {
+            printf("%s: invalid response to %s\n", name, s_checks[i]);
+            goto exit;
+        }
+        close(sock);
+    }
+
+    sock = connect_to_server();
+    if (sock < 0) {
+        printf("%s: failed to connect\n", name);
+        goto exit;
+    }
+
+    /* Requests to the handlers registered last, which the linear lookup finds last */
+    static char batch[BATCH * 64];
+    size_t batch_len = 0;
+    for (int i = 0; i < BATCH; i++) {
+        batch_len += snprintf(batch + batch_len, sizeof(batch) - batch_len,
+                              "GET /api/v1/res%d/%d HTTP/1.1\r\nHost: localhost\r\n\r\n",
+                              NUM_RESOURCES - 1 - i % 4, i);
+    }
+    s_match_calls = 0;
+    double start = now_s();
+    for (int i = 0; i < NUM_BATCHES; i++) {
+        if (send(sock, batch, batch_len, 0) != batch_len || !read_responses(sock, BATCH, NULL, 0)) {
+            printf("%s: invalid response to batch %d\n", name, i);
+            goto exit;
+        }
+    }
+    *rate = NUM_BATCHES * BATCH / (now_s() - start);
+    printf("%-8s %d handlers, %.0f requests/s, %.1f match calls per request\n", name,
+           NUM_HANDLERS, *rate, (double)s_match_calls / (NUM_BATCHES * BATCH));
+    ok = true;
+
+exit:
+    if (sock >= 0) {
+        close(sock);
+    }
+    httpd_stop(server);
+    return ok;
+}
+
+void app_main(void)
+{
+    static char linear[sizeof(s_checks) / sizeof(s_checks[0])][64];
+    static char router[sizeof(s_checks) / sizeof(s_checks[0])][64];
+    double linear_rate = 0;
+    double router_rate = 0;
+
+    bool ok = run_benchmark("linear:", counting_match, linear, &linear_rate);
+    ok = run_benchmark("router:", httpd_uri_match_wildcard, router, &router_rate) && ok;
+
+    /* Both lookups must pick the same handlers, and fail the same way */
+    for (int i = 0; ok && i < sizeof(s_checks) / sizeof(s_checks[0]); i++) {
+        printf("%-28s %s\n", s_checks[i], router[i]);
+        if (strcmp(linear[i], router[i]) != 0) {
+            printf("%s: linear lookup responded %s\n", s_checks[i], linear[i]);
+            ok = false;
+        }
+    }
+    if (ok) {
+        printf("router is %.2f times as fast\n", router_rate / linear_rate);
+    }
+    printf(ok ? "Benchmark passed\n" : "Benchmark failed\n");
+    exit(ok ? EXIT_SUCCESS : EXIT_FAILURE);
+}
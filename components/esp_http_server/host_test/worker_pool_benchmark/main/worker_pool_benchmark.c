@@ -0,0 +1,202 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include "esp_http_server.h"
+
+#define SERVER_PORT     8004
+#define NUM_WORKERS     6
+#define NUM_SLOW        4       /* Connections sending requests to the slow handler */
+#define SLOW_DELAY_MS   10
+#define NUM_FAST        200     /* Requests to the fast handler whose latency is measured */
+#define FAST_PERIOD_MS  2       /* Delay between the requests to the fast handler */
+
+static const char s_body[] = "pong";
+static const char s_slow_request[] = "GET /slow HTTP/1.1\r\nHost: localhost\r\n\r\n";
+static const char s_fast_request[] = "GET /fast HTTP/1.1\r\nHost: localhost\r\n\r\n";
+
+static atomic_bool s_stop_slow;
+static atomic_bool s_slow_failed;
+static atomic_uint s_slow_count;
+
+/* Stands for a handler waiting for a slow peripheral or file system */
+static esp_err_t slow_handler(httpd_req_t *req)
+{
+    usleep(SLOW_DELAY_MS * 1000);
+    return httpd_resp_send(req, s_body, HTTPD_RESP_USE_STRLEN);
+}
+
+static esp_err_t fast_handler(httpd_req_t *req)
+{
+    return httpd_resp_send(req, s_body, HTTPD_RESP_USE_STRLEN);
+}
+
+static int connect_to_server(void)
+{
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(SERVER_PORT),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    if (sock < 0 || connect(sock, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        if (sock >= 0) {
+            close(sock);
+        }
+        return -1;
+    }
+    int nodelay = 1;
+    setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+    return sock;
+}
+
+/* Sends a request and reads its response, returns false on error */
+static bool do_request(int sock, const char *request)
+{
+    char buf[256];
+    size_t len = 0;
+
+    if (send(sock, request, strlen(request), 0) != strlen(request)) {
+        return false;
+    }
+    while (true) {
+        ssize_t ret = recv(sock, buf + len, sizeof(buf) - 1 - len, 0);
+        if (ret <= 0) {
+            return false;
+        }
+        len += ret;
+        buf[len] = '\0';
+        char *body = strstr(buf, "\r\n\r\n");
+        if (body && strlen(body + 4) >= strlen(s_body)) {
+            return strncmp(buf, "HTTP/1.1 200 OK\r\n", 17) == 0 && strcmp(body + 4, s_body) == 0;
+        }
+    }
+}
+
+static double now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static void *slow_client(void *arg)
+{
+    int sock = connect_to_server();
+    while (!s_stop_slow) {
+        if (sock < 0 || !do_request(sock, s_slow_request)) {
+            s_slow_failed = true;
+            break;
+        }
+        s_slow_count++;
+    }
+    if (sock >= 0) {
+        close(sock);
+    }
+    return NULL;
+}
+
+static int compare_double(const void *a, const void *b)
+{
+    double da = *(const double *)a;
+    double db = *(const double *)b;
+    return (da > db) - (da < db);
+}
+
+/* Measures the latency of the requests to the fast handler while the slow
+ * handler is kept busy, returns false on error */
+static bool run_benchmark(const char *name, uint16_t worker_count, double *p99)
+{
+    static double latency[NUM_FAST];
+    pthread_t slow[NUM_SLOW];
+    int num_slow = 0;
+    int sock = -1;
+    bool ok = false;
+
+    httpd_handle_t server = NULL;
+    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    config.server_port = SERVER_PORT;
+    config.worker_count = worker_count;
+    if (httpd_start(&server, &config) != ESP_OK) {
+        printf("%s: failed to start the server\n", name);
+        return false;
+    }
+    const httpd_uri_t slow_uri = {
+        .uri = "/slow",
+        .method = HTTP_GET,
+        .handler = slow_handler,
+    };
+    const httpd_uri_t fast_uri = {
+        .uri = "/fast",
+        .method = HTTP_GET,
+        .handler = fast_handler,
+    };
+    httpd_register_uri_handler(server, &slow_uri);
+    httpd_register_uri_handler(server, &fast_uri);
+
+    s_stop_slow = false;
+    s_slow_failed = false;
+    s_slow_count = 0;
+    for (num_slow = 0; num_slow < NUM_SLOW; num_slow++) {
+        if (pthread_create(&slow[num_slow], NULL, slow_client, NULL) != 0) {
+            printf("%s: failed to create client thread\n", name);
+            goto exit;
+        }
+    }
+
+    sock = connect_to_server();
+    for (int i = 0; i < NUM_FAST; i++) {
+        double start = now_ms();
+        if (sock < 0 || !do_request(sock, s_fast_request)) {
+            printf("%s: invalid response to request %d\n", name, i);
+            goto exit;
+        }
+        latency[i] = now_ms() - start;
+        usleep(FAST_PERIOD_MS * 1000);
+    }
+    qsort(latency, NUM_FAST, sizeof(double), compare_double);
+    *p99 = latency[NUM_FAST * 99 / 100];
+    printf("%-11s fast requests: p50 %.2f ms, p99 %.2f ms, max %.2f ms\n", name,
+           latency[NUM_FAST / 2], *p99, latency[NUM_FAST - 1]);
+    ok = true;
+
+exit:
+    s_stop_slow = true;
+    for (int i = 0; i < num_slow; i++) {
+        pthread_join(slow[i], NULL);
+    }
+    if (sock >= 0) {
+        close(sock);
+    }
+    httpd_stop(server);
+    if (s_slow_failed) {
+        printf("%s: invalid response to a slow request\n", name);
+        return false;
+    }
+    printf("%-11s %u slow requests\n", name, s_slow_count);
+    return ok;
+}
+
+void app_main(void)
+{
+    double p99_inline = 0;
+    double p99_workers = 0;
+    bool ok = run_benchmark("no workers:", 0, &p99_inline);
+    ok = run_benchmark("workers:", NUM_WORKERS, &p99_workers) && ok;
+    /* The workers left idle by the slow handler take the fast requests */
+    ok = ok && p99_workers < p99_inline;
+    printf(ok ? "Benchmark passed\n" : "Benchmark failed\n");
+    exit(ok ? EXIT_SUCCESS : EXIT_FAILURE);
+}
@@ -33,7 +33,7 @@ typedef enum {
     HTTP_SERVER_EVENT_START,           /*!< This event occurs when HTTP Server is started */
     HTTP_SERVER_EVENT_ON_CONNECTED,    /*!< Once the HTTP Server has been connected to the client, no data exchange has been performed */
     HTTP_SERVER_EVENT_ON_HEADER,       /*!< Occurs when receiving each header sent from the client */
-    HTTP_SERVER_EVENT_HEADERS_SENT,     /*!< After sending all the headers to the client */
+    HTTP_SERVER_EVENT_HEADERS_SENT,     /*!< After sending all the headers to the client. httpd_resp_send() sends the headers and the content in a single write, the event follows both. */
     HTTP_SERVER_EVENT_ON_DATA,         /*!< Occurs when receiving data from the client */
     HTTP_SERVER_EVENT_SENT_DATA,       /*!< Occurs when an ESP HTTP server session is finished */
     HTTP_SERVER_EVENT_DISCONNECTED,    /*!< The connection has been disconnected */
@@ -75,7 +75,12 @@ initializer that should be kept in sync
         .keep_alive_count = 0,                          \
         .open_fn = NULL,                                \
         .close_fn = NULL,                               \
-        .uri_match_fn = NULL                            \
+        .uri_match_fn = NULL,                           \
+        .worker_count = 0,                              \
+        .worker_queue_depth = 4,                        \
+        .worker_priority = tskIDLE_PRIORITY+5,          \
+        .worker_stack_size = 4096,                      \
+        .worker_core_id = tskNO_AFFINITY                \
 }
 
 #define ESP_ERR_HTTPD_BASE              (0xb000)                    /*!< Starting number of HTTPD error codes */
@@ -273,6 +278,26 @@ typedef struct httpd_config {
      * of the `httpd_uri_match_func_t` function prototype)
      */
     httpd_uri_match_func_t uri_match_fn;
+
+    /**
+     * Number of worker tasks which run the URI handlers.
+     *
+     * With 0, the URI handlers run in the server task, so a slow handler delays
+     * all the other sessions. Otherwise the server task receives and parses the
+     * requests, and hands them to the worker tasks. Each worker has a queue of
+     * requests, a worker whose queue is empty takes requests from the queues of
+     * the other workers. The session of a request isn't read by the server task
+     * until the handler returns, but the handlers of different sessions may run
+     * at the same time. If all the queues are full, the server task runs the
+     * handler itself.
+     *
+     * WebSocket handlers and error handlers always run in the server task.
+     */
+    uint16_t    worker_count;
+    uint16_t    worker_queue_depth; /*!< Number of requests waiting in the queue of each worker */
+    unsigned    worker_priority;    /*!< Priority of the worker tasks */
+    size_t      worker_stack_size;  /*!< Stack size of each worker task */
+    BaseType_t  worker_core_id;     /*!< The core the worker tasks run on */
 } httpd_config_t;
 
 /**
@@ -700,6 +725,33 @@ esp_err_t httpd_register_err_handler(httpd_handle_t handle,
  */
 typedef int (*httpd_send_func_t)(httpd_handle_t hd, int sockfd, const char *buf, size_t buf_len, int flags);
 
+struct iovec;
+
+/**
+ * @brief  Prototype for HTTPDs low-level vectored send function
+ *
+ * Sends the buffers described by iov as one contiguous stream of bytes,
+ * like sendmsg() or writev(). This is used to send the status line, the
+ * headers and the body of a response with a single call.
+ *
+ * @note   User specified send function must handle errors internally,
+ *         depending upon the set value of errno, and return specific
+ *         HTTPD_SOCK_ERR_ codes, which will eventually be conveyed as
+ *         return value of the httpd_resp_send*() functions
+ *
+ * @param[in] hd        server instance
+ * @param[in] sockfd    session socket file descriptor
+ * @param[in] iov       array of buffers to send
+ * @param[in] iov_count number of buffers
+ * @param[in] flags     flags for the sendmsg() function
+ * @return
+ *  - Bytes : The number of bytes sent successfully, which may be less than the total size of the buffers
+ *  - HTTPD_SOCK_ERR_INVALID  : Invalid arguments
+ *  - HTTPD_SOCK_ERR_TIMEOUT  : Timeout/interrupted while calling socket sendmsg()
+ *  - HTTPD_SOCK_ERR_FAIL     : Unrecoverable error while calling socket sendmsg()
+ */
+typedef int (*httpd_send_iov_func_t)(httpd_handle_t hd, int sockfd, const struct iovec *iov, int iov_count, int flags);
+
 /**
  * @brief  Prototype for HTTPDs low-level recv function
  *
@@ -792,6 +844,30 @@ esp_err_t httpd_sess_set_recv_override(httpd_handle_t hd, int sockfd, httpd_recv
  */
 esp_err_t httpd_sess_set_send_override(httpd_handle_t hd, int sockfd, httpd_send_func_t send_func);
 
+/**
+ * @brief   Override web server's vectored send function (by session FD)
+ *
+ * By default, responses are sent with sendmsg(), the status line, the headers
+ * and the body in a single call. When the send function of the session is
+ * overridden with httpd_sess_set_send_override(), e.g. to encrypt the data,
+ * responses are sent with that function instead, one buffer at a time, unless
+ * a vectored send function is also set with this function.
+ *
+ * @note    This API is supposed to be called either from the context of
+ *          - an http session APIs where sockfd is a valid parameter
+ *          - a URI handler where sockfd is obtained using httpd_req_to_sockfd()
+ *
+ * @param[in] hd            HTTPD instance handle
+ * @param[in] sockfd        Session socket FD
+ * @param[in] send_iov_func The vectored send function to be set for this session,
+ *                          or NULL to send each buffer with the send function
+ *
+ * @return
+ *  - ESP_OK : On successfully registering override
+ *  - ESP_ERR_INVALID_ARG : Null arguments
+ */
+esp_err_t httpd_sess_set_send_iov_override(httpd_handle_t hd, int sockfd, httpd_send_iov_func_t send_iov_func);
+
 /**
  * @brief   Override web server's pending function (by session FD)
  *
@@ -1084,6 +1160,12 @@ bool httpd_uri_match_wildcard(const char *uri_template, const char *uri_to_match
  *  - Once this API is called, all request headers are purged, so
  *    request headers need be copied into separate buffers if
  *    they are required later.
+ *  - The headers and the content are sent together, so
+ *    HTTP_SERVER_EVENT_HEADERS_SENT is dispatched after the content
+ *    has been sent, and not at all if sending fails.
+ *  - If the status set with httpd_resp_set_status() is 304 Not Modified,
+ *    the content is dropped and no Content-Length is sent, so
+ *    HTTP_SERVER_EVENT_SENT_DATA reports 0 bytes.
  *
  * @param[in] r         The request being responded to
  * @param[in] buf       Buffer from where the content is to be fetched
@@ -1179,13 +1261,109 @@ static inline esp_err_t httpd_resp_sendstr_chunk(httpd_req_t *r, const char *str
     return httpd_resp_send_chunk(r, str, (str == NULL) ? 0 : HTTPD_RESP_USE_STRLEN);
 }
 
+/**
+ * @brief Content in memory sent by httpd_resp_send_region(), for
+ *        instance a region of a partition mapped with esp_partition_mmap()
+ */
+typedef struct httpd_resp_region {
+    const void *data;       /*!< Content, which must stay valid while it's being sent */
+    size_t      len;        /*!< Length of the content */
+    const void *gz_data;    /*!< The content compressed with gzip, sent to the clients accepting it, or NULL */
+    size_t      gz_len;     /*!< Length of the compressed content */
+    const char *etag;       /*!< Entity tag of the content including its quotes, e.g. "\"v1\"", or NULL */
+} httpd_resp_region_t;
+
+/**
+ * @brief   API to send content in memory as HTTP response, answering
+ *          conditional and range requests
+ *
+ * The content is sent along with the headers, straight from the memory
+ * it is in, so a region of flash mapped once with esp_partition_mmap()
+ * is sent without being copied to a buffer first.
+ *
+ * Depending on the request headers:
+ *  - If-None-Match listing the entity tag of the content is answered
+ *    with 304 Not Modified, without content.
+ *  - Range with a single byte range is answered with 206 Partial Content
+ *    and this range, or 416 Range Not Satisfiable if the range is beyond
+ *    the content. Several ranges are answered with the whole content, as
+ *    is a Range when If-Range doesn't name the entity tag of the content.
+ *  - Accept-Encoding accepting gzip is answered with gz_data if present,
+ *    with Content-Encoding: gzip. The entity tag of the compressed content
+ *    is the one of the content with "-gz" appended inside the quotes.
+ *
+ * Up to 5 additional headers are set along with the ones already set,
+ * which must be allowed by max_resp_headers: ETag, Accept-Ranges, Vary,
+ * Content-Range and Content-Encoding.
+ *
+ * @note
+ *  - This API is supposed to be called only from the context of
+ *    a URI handler where httpd_req_t* request pointer is valid.
+ *  - Once this API is called, the request has been responded to.
+ *  - The status set with httpd_resp_set_status() is replaced for the
+ *    responses listed above.
+ *
+ * @param[in] r         The request being responded to
+ * @param[in] region    The content to send
+ *
+ * @return
+ *  - ESP_OK : On successfully sending the response packet
+ *  - ESP_ERR_INVALID_ARG : Null arguments
+ *  - ESP_ERR_HTTPD_RESP_HDR    : Essential headers are too large for internal buffer, or too many headers
+ *  - ESP_ERR_HTTPD_RESP_SEND   : Error in raw send
+ *  - ESP_ERR_HTTPD_INVALID_REQ : Invalid request
+ */
+esp_err_t httpd_resp_send_region(httpd_req_t *r, const httpd_resp_region_t *region);
+
+/**
+ * @brief   API to send a file as HTTP response, answering conditional
+ *          and range requests
+ *
+ * The file at path in the VFS is sent with Content-Length, and the
+ * requests are answered as with httpd_resp_send_region(). The entity tag
+ * of the file is derived from its size and modification time. If the
+ * client accepts gzip and the file at path with ".gz" appended exists,
+ * this file is sent instead, with Content-Encoding: gzip. As long as this
+ * file exists, the response has Vary: Accept-Encoding for all the clients.
+ *
+ * On Linux, the file is sent by the kernel with sendfile() if the session
+ * uses the default send function. Otherwise, it's read into a buffer of
+ * CONFIG_HTTPD_FILE_BUF_SIZE bytes and sent from there, one buffer at a time.
+ *
+ * @note
+ *  - This API is supposed to be called only from the context of
+ *    a URI handler where httpd_req_t* request pointer is valid.
+ *  - Once this API is called, the request has been responded to.
+ *  - The content type isn't derived from the path, set it with
+ *    httpd_resp_set_type() before.
+ *  - If the file can't be read once the headers have been sent, the
+ *    error must be returned by the URI handler to close the session.
+ *
+ * @param[in] r         The request being responded to
+ * @param[in] path      Path of the file
+ *
+ * @return
+ *  - ESP_OK : On successfully sending the response packet
+ *  - ESP_ERR_NOT_FOUND   : The file doesn't exist, 404 Not Found was sent
+ *  - ESP_ERR_NO_MEM      : Failed to allocate the buffer
+ *  - ESP_FAIL            : Error reading the file
+ *  - ESP_ERR_INVALID_ARG : Null arguments
+ *  - ESP_ERR_HTTPD_RESP_HDR    : Essential headers are too large for internal buffer, or too many headers
+ *  - ESP_ERR_HTTPD_RESP_SEND   : Error in raw send
+ *  - ESP_ERR_HTTPD_INVALID_REQ : Invalid request
+ */
+esp_err_t httpd_resp_send_file(httpd_req_t *r, const char *path);
+
 /* Some commonly used status codes */
 #define HTTPD_200      "200 OK"                     /*!< HTTP Response 200 */
 #define HTTPD_204      "204 No Content"             /*!< HTTP Response 204 */
+#define HTTPD_206      "206 Partial Content"        /*!< HTTP Response 206 */
 #define HTTPD_207      "207 Multi-Status"           /*!< HTTP Response 207 */
+#define HTTPD_304      "304 Not Modified"           /*!< HTTP Response 304 */
 #define HTTPD_400      "400 Bad Request"            /*!< HTTP Response 400 */
 #define HTTPD_404      "404 Not Found"              /*!< HTTP Response 404 */
 #define HTTPD_408      "408 Request Timeout"        /*!< HTTP Response 408 */
+#define HTTPD_416      "416 Range Not Satisfiable"  /*!< HTTP Response 416 */
 #define HTTPD_500      "500 Internal Server Error"  /*!< HTTP Response 500 */
 
 /**
@@ -1,5 +1,5 @@
 /*
- * SPDX-FileCopyrightText: 2018-2021 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2018-2023 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
@@ -66,6 +66,7 @@ struct sock_db {
     httpd_free_ctx_fn_t free_ctx;      /*!< Function for freeing the context */
     httpd_free_ctx_fn_t free_transport_ctx; /*!< Function for freeing the 'transport' context */
     httpd_send_func_t send_fn;              /*!< Send function for this socket */
+    httpd_send_iov_func_t send_iov_fn;      /*!< Vectored send function for this socket, NULL to use send_fn */
     httpd_recv_func_t recv_fn;              /*!< Receive function for this socket */
     httpd_pending_func_t pending_fn;        /*!< Pending function for this socket */
     uint64_t lru_counter;                   /*!< LRU Counter indicating when the socket was last used */
@@ -73,6 +74,9 @@ struct sock_db {
     char pending_data[PARSER_BLOCK_SIZE];   /*!< Buffer for pending data to be received */
     size_t pending_len;                     /*!< Length of pending data to be received */
     bool for_async_req;                     /*!< If true, the socket will not be LRU purged */
+    int poll_index;                         /*!< Index of the socket in the set of the poll() backend, 0 if not in the set */
+    httpd_req_t *worker_req;                /*!< Request being handled by a worker, the server doesn't process the session until it is done */
+    bool worker_close;                      /*!< Set to true to close the socket when the worker is done with the request */
 #ifdef CONFIG_HTTPD_WS_SUPPORT
     bool ws_handshake_done;                 /*!< True if it has done WebSocket handshake (if this socket is a valid WS) */
     bool ws_close;                          /*!< Set to true to close the socket later (when WS Close frame received) */
@@ -124,9 +128,18 @@ struct httpd_data {
     struct sock_db *hd_sd;                  /*!< The socket database */
     int hd_sd_active_count;                 /*!< The number of the active sockets */
     httpd_uri_t **hd_calls;                 /*!< Registered URI handlers */
+#if CONFIG_HTTPD_URI_ROUTER
+    struct httpd_router *hd_router;         /*!< Radix tree of the URI handlers, NULL to scan hd_calls, see httpd_router.c */
+    struct httpd_router *hd_router_retired; /*!< Trees replaced while being looked up, freed once no lookup is in progress */
+    unsigned hd_router_readers;             /*!< Number of lookups in progress, which don't take hd_router_lock */
+    omutex_t hd_router_lock;                /*!< Serializes the updates of hd_router, handlers may be registered while requests are served */
+#endif
     struct httpd_req hd_req;                /*!< The current HTTPD request */
     struct httpd_req_aux hd_req_aux;        /*!< Additional data about the HTTPD request kept unexposed */
     uint64_t lru_counter;                   /*!< LRU counter */
+    struct httpd_poll *hd_poll;             /*!< Set of sockets the server waits on, see httpd_poll.c */
+    bool hd_sess_pending;                   /*!< A session may have pending data to process */
+    struct httpd_workers *hd_workers;       /*!< Pool of tasks running the URI handlers, see httpd_worker.c */
 
     /* Array of registered error handler functions */
     httpd_err_handler_func_t *err_handler_fns;
@@ -172,7 +185,7 @@ struct sock_db *httpd_sess_get(struct httpd_data *hd, int sockfd);
 
 /**
  * @brief Delete sessions whose FDs have became invalid.
- *        This is a recovery strategy e.g. after select() fails.
+ *        This is a recovery strategy e.g. after poll() fails.
  *
  * @param[in] hd    Server instance data
  */
@@ -227,17 +240,6 @@ void httpd_sess_delete(struct httpd_data *hd, struct sock_db *session);
  */
 void httpd_sess_free_ctx(void **ctx, httpd_free_ctx_fn_t free_fn);
 
-/**
- * @brief   Add descriptors present in the socket database to an fdset and
- *          update the value of maxfd which are needed by the select function
- *          for looking through all available sockets for incoming data.
- *
- * @param[in]  hd    Server instance data
- * @param[out] fdset File descriptor set to be updated.
- * @param[out] maxfd Maximum value among all file descriptors.
- */
-void httpd_sess_set_descriptors(struct httpd_data *hd, fd_set *fdset, int *maxfd);
-
 /**
  * @brief   Checks if session can accept another connection from new client.
  *          If sockets database is full then this returns false.
@@ -254,7 +256,7 @@ bool httpd_is_sess_available(struct httpd_data *hd);
  *
  * This is needed as httpd_unrecv may un-receive next
  * packet in the stream. If only partial packet was
- * received then select() would mark the fd for processing
+ * received then poll() would mark the fd for processing
  * as remaining part of the packet would still be in socket
  * recv queue. But if a complete packet got unreceived
  * then it would not be processed until further data is
@@ -296,6 +298,159 @@ void httpd_sess_close_all(struct httpd_data *hd);
  * @}
  */
 
+/****************** Group : Socket Polling ********************/
+/** @name Socket Polling
+ * Functions for waiting on the sockets of the server. The server keeps its
+ * control and listening sockets and the sockets of the sessions in a set,
+ * which is updated when sessions are opened and closed, instead of building
+ * a descriptor set on each wait.
+ * @{
+ */
+
+/**
+ * @brief   Sockets found readable by httpd_poll_wait()
+ */
+struct httpd_poll_events {
+    bool ctrl;                  /*!< The control socket is readable */
+    bool listen;                /*!< The listening socket is readable */
+    size_t sessions_count;      /*!< Number of elements of sessions */
+    struct sock_db **sessions;  /*!< Sessions whose socket is readable or has an error */
+};
+
+/**
+ * @brief   Creates the set of sockets of the server, with the control
+ *          and listening sockets
+ *
+ * @param[in] hd  Server instance data
+ *
+ * @return
+ *  - ESP_OK   : on success
+ *  - ESP_FAIL : if the set can't be created
+ */
+esp_err_t httpd_poll_init(struct httpd_data *hd);
+
+/**
+ * @brief   Frees the set of sockets of the server, does nothing if it
+ *          hasn't been created
+ *
+ * @param[in] hd  Server instance data
+ */
+void httpd_poll_deinit(struct httpd_data *hd);
+
+/**
+ * @brief   Adds the socket of a session to the set
+ *
+ * @param[in] hd      Server instance data
+ * @param[in] session Session
+ *
+ * @return
+ *  - ESP_OK   : on success
+ *  - ESP_FAIL : if the socket can't be added
+ */
+esp_err_t httpd_poll_add(struct httpd_data *hd, struct sock_db *session);
+
+/**
+ * @brief   Removes the socket of a session from the set, does nothing if
+ *          it isn't in the set. This must be called before closing the socket.
+ *
+ * @param[in] hd      Server instance data
+ * @param[in] session Session
+ */
+void httpd_poll_remove(struct httpd_data *hd, struct sock_db *session);
+
+/**
+ * @brief   Sets whether the server waits for new connections
+ *
+ * @param[in] hd      Server instance data
+ * @param[in] enable  True to report the listening socket when it is readable
+ */
+void httpd_poll_set_listen(struct httpd_data *hd, bool enable);
+
+/**
+ * @brief   Waits for sockets of the set to become readable
+ *
+ * @param[in]  hd         Server instance data
+ * @param[in]  timeout_ms Maximum time to wait, -1 to wait forever
+ * @param[out] events     Readable sockets, valid until the next call
+ *
+ * @return
+ *  - Number of readable sockets, 0 on timeout
+ *  - -1 on error, with errno set
+ */
+int httpd_poll_wait(struct httpd_data *hd, int timeout_ms, struct httpd_poll_events *events);
+
+/** End of Group : Socket Polling
+ * @}
+ */
+
+/****************** Group : Worker Pool ********************/
+/** @name Worker Pool
+ * Functions for running the URI handlers in a pool of worker tasks. While a
+ * worker handles a request, its session is removed from the set of sockets
+ * of the server, the server gives the session back to the set once the
+ * worker is done.
+ * @{
+ */
+
+/**
+ * @brief   Creates the worker tasks, does nothing if worker_count is 0
+ *
+ * @param[in] hd  Server instance data
+ *
+ * @return
+ *  - ESP_OK                 : on success
+ *  - ESP_ERR_INVALID_ARG    : if worker_queue_depth is 0
+ *  - ESP_ERR_HTTPD_ALLOC_MEM: if memory can't be allocated
+ *  - ESP_ERR_HTTPD_TASK     : if a task can't be created
+ */
+esp_err_t httpd_workers_start(struct httpd_data *hd);
+
+/**
+ * @brief   Stops the worker tasks, after the handlers they are running
+ *          return, and frees the pool. The requests still queued are dropped.
+ *
+ * @note    This must be called from the server task, before the sessions are closed
+ *
+ * @param[in] hd  Server instance data
+ */
+void httpd_workers_stop(struct httpd_data *hd);
+
+/**
+ * @brief   Queues the current request of the server to a worker, which
+ *          calls the handler and then purges the request
+ *
+ * @param[in] hd      Server instance data
+ * @param[in] handler URI handler
+ *
+ * @return
+ *  - ESP_OK   : if the request is queued, the server must not use it any more
+ *  - ESP_FAIL : if all the queues are full, the handler must be called by the server
+ */
+esp_err_t httpd_workers_dispatch(struct httpd_data *hd, esp_err_t (*handler)(httpd_req_t *r));
+
+/**
+ * @brief   Gives the sessions of the requests the workers are done with
+ *          back to the server, or closes them if their handler failed
+ *
+ * @note    This must be called from the server task
+ *
+ * @param[in] hd  Server instance data
+ */
+void httpd_workers_collect(struct httpd_data *hd);
+
+/**
+ * @brief   Checks if the calling task is a worker of the server
+ *
+ * @param[in] hd  Server instance data
+ *
+ * @return True if called from a worker task
+ */
+bool httpd_workers_is_current(struct httpd_data *hd);
+
+/** End of Group : Worker Pool
+ * @}
+ */
+
 /****************** Group : URI Handling ********************/
 /** @name URI Handling
  * Methods for accessing URI handlers
@@ -321,6 +476,62 @@ esp_err_t httpd_uri(struct httpd_data *hd);
  */
 void httpd_unregister_all_uri_handlers(struct httpd_data *hd);
 
+#if CONFIG_HTTPD_URI_ROUTER
+/**
+ * @brief   Checks if the URI handlers can be looked up with the router, which
+ *          is the case with the default URI matching and with
+ *          httpd_uri_match_wildcard() as uri_match_fn
+ *
+ * @param[in] hd  Server instance data
+ *
+ * @return True if the router can be used
+ */
+bool httpd_router_supported(struct httpd_data *hd);
+
+/**
+ * @brief   Finds the first registered URI handler matching a URI and method.
+ *          Doesn't take hd_router_lock, so that the lookups don't wait for
+ *          each other nor for the updates of the router.
+ *
+ * @param[in]  hd      Server instance data
+ * @param[in]  uri     URI, not necessarily null-terminated
+ * @param[in]  uri_len Length of the URI
+ * @param[in]  method  Method
+ * @param[out] handler Set to the handler, NULL if not found
+ * @param[out] err     Set to 0, HTTPD_404_NOT_FOUND or HTTPD_405_METHOD_NOT_ALLOWED, may be NULL
+ *
+ * @return False if the router hasn't been built, handler and err are then
+ *         left unchanged and the handlers must be scanned
+ */
+bool httpd_router_find(struct httpd_data *hd, const char *uri, size_t uri_len,
+                       httpd_method_t method, httpd_uri_t **handler, httpd_err_code_t *err);
+
+/* The functions below must be called with hd_router_lock held */
+
+/**
+ * @brief   Builds the router from the registered URI handlers, and makes
+ *          the lookups use it instead of the previous one, which is freed
+ *          once no lookup is in progress. Only removes the router if it isn't
+ *          supported by the configuration.
+ *
+ * @param[in] hd  Server instance data
+ *
+ * @return
+ *  - ESP_OK        : on success
+ *  - ESP_ERR_NO_MEM: if memory can't be allocated, hd_router is then NULL
+ */
+esp_err_t httpd_router_build(struct httpd_data *hd);
+
+/**
+ * @brief   Frees the router, does nothing if it hasn't been built
+ *
+ * @note    No lookup may be in progress, as when the server is stopped
+ *
+ * @param[in] hd  Server instance data
+ */
+void httpd_router_free(struct httpd_data *hd);
+#endif
+
 /**
  * @brief   Validates the request to prevent users from calling APIs, that are to
  *          be called only inside a URI handler, outside the handler context
@@ -381,6 +592,26 @@ esp_err_t httpd_req_new(struct httpd_data *hd, struct sock_db *sd);
  */
 esp_err_t httpd_req_delete(struct httpd_data *hd);
 
+/**
+ * @brief   Purges the data of a request left to be received and resets
+ *          the resources allocated for it
+ *
+ * @param[in] r  Request, the current request of the server or a request
+ *               handled by a worker
+ *
+ * @return
+ *  - ESP_OK    : if request packet purged and resources cleaned.
+ *  - ESP_FAIL  : otherwise.
+ */
+esp_err_t httpd_req_finish(httpd_req_t *r);
+
+/**
+ * @brief   Resets the resources allocated for a request
+ *
+ * @param[in] r  Request
+ */
+void httpd_req_cleanup(httpd_req_t *r);
+
 /**
  * @brief   For handling HTTP errors by invoking registered
  *          error handler function
@@ -459,6 +690,38 @@ int httpd_recv_with_opt(httpd_req_t *r, char *buf, size_t buf_len, bool halt_aft
  */
 size_t httpd_unrecv(struct httpd_req *r, const char *buf, size_t buf_len);
 
+/**
+ * @brief   Sends the status line and headers of a response whose content is
+ *          content_len bytes long, together with the first bytes of the content
+ *
+ * @note    The rest of the content is then sent with httpd_resp_send_body().
+ *          A 304 response is sent without Content-Length and content.
+ *
+ * @param[in] r           The request being responded to
+ * @param[in] content_len Length of the content, sent as Content-Length
+ * @param[in] buf         First bytes of the content, or NULL
+ * @param[in] buf_len     Number of bytes in buf
+ *
+ * @return
+ *  - ESP_OK : if successful
+ *  - ESP_ERR_HTTPD_RESP_HDR  : Essential headers are too large for internal buffer
+ *  - ESP_ERR_HTTPD_RESP_SEND : Error in raw send
+ */
+esp_err_t httpd_resp_send_hdr(httpd_req_t *r, size_t content_len, const char *buf, size_t buf_len);
+
+/**
+ * @brief   Sends more of the content of a response after httpd_resp_send_hdr()
+ *
+ * @param[in] r       The request being responded to
+ * @param[in] buf     Next bytes of the content
+ * @param[in] buf_len Number of bytes in buf
+ *
+ * @return
+ *  - ESP_OK : if successful
+ *  - ESP_ERR_HTTPD_RESP_SEND : Error in raw send
+ */
+esp_err_t httpd_resp_send_body(httpd_req_t *r, const char *buf, size_t buf_len);
+
 /**
  * @brief   This is the low level default send function of the HTTPD. This should
  *          NEVER be called directly. The semantics of this is exactly similar to
@@ -476,6 +739,23 @@ size_t httpd_unrecv(struct httpd_req *r, const char *buf, size_t buf_len);
  */
 int httpd_default_send(httpd_handle_t hd, int sockfd, const char *buf, size_t buf_len, int flags);
 
+/**
+ * @brief   This is the low level default vectored send function of the HTTPD. This
+ *          should NEVER be called directly. The semantics of this is exactly similar
+ *          to sendmsg() of the BSD socket API, with the buffers in iov.
+ *
+ * @param[in] hd        Server instance data
+ * @param[in] sockfd    Socket descriptor for sending data
+ * @param[in] iov       Array of buffers to send
+ * @param[in] iov_count Number of buffers
+ * @param[in] flags     Flags for mode selection
+ *
+ * @return
+ *  - Length of data : if successful
+ *  - -1             : if failed (appropriate errno is set)
+ */
+int httpd_default_send_iov(httpd_handle_t hd, int sockfd, const struct iovec *iov, int iov_count, int flags);
+
 /**
  * @brief   This is the low level default recv function of the HTTPD. This should
  *          NEVER be called directly. The semantics of this is exactly similar to
@@ -0,0 +1,434 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <limits.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <esp_log.h>
+#include <esp_err.h>
+
+#include <esp_http_server.h>
+#include "esp_httpd_priv.h"
+#include "osal.h"
+
+static const char *TAG = "httpd_file";
+
+/* Longer request headers are ignored, which only makes the whole content sent */
+#define HTTPD_FILE_HDR_LEN  64
+
+/* Length of the entity tags, including the quotes and the "-gz" suffix */
+#define HTTPD_FILE_ETAG_LEN 48
+
+/* The request headers selecting the response, copied before any of it is sent,
+ * and the values of the response headers, which must live until it is sent */
+struct httpd_file_req {
+    char if_none_match[HTTPD_FILE_HDR_LEN];
+    char if_range[HTTPD_FILE_HDR_LEN];
+    char range[HTTPD_FILE_HDR_LEN];
+    bool accepts_gzip;
+    char etag[HTTPD_FILE_ETAG_LEN];
+    char content_range[64];
+};
+
+/* Checks if an Accept-Encoding header accepts gzip, either by name or with
+ * '*', with a weight other than 0 */
+static bool httpd_file_accepts_gzip(const char *list)
+{
+    int gzip = -1;
+    int any = -1;
+
+    while (*list) {
+        while (*list == ' ' || *list == ',') {
+            list++;
+        }
+        size_t name_len = strcspn(list, ",; ");
+        const char *name = list;
+        const char *params = list + name_len;
+        list = params + strcspn(params, ",");
+
+        bool accepted = true;
+        for (const char *q = params; q + 1 < list; q++) {
+            if ((q[0] == 'q' || q[0] == 'Q') && q[1] == '=') {
+                accepted = strtod(q + 2, NULL) > 0;
+                break;
+            }
+        }
+        if (name_len == 4 && strncasecmp(name, "gzip", 4) == 0) {
+            gzip = accepted;
+        } else if (name_len == 1 && name[0] == '*') {
+            any = accepted;
+        }
+    }
+    return gzip >= 0 ? gzip : any > 0;
+}
+
+/* Checks if a list of entity tags, as in If-None-Match, matches the given
+ * one with the weak comparison */
+static bool httpd_file_etag_listed(const char *list, const char *etag)
+{
+    size_t etag_len = strlen(etag);
+
+    while (*list) {
+        while (*list == ' ' || *list == ',') {
+            list++;
+        }
+        if (*list == '*') {
+            return true;
+        }
+        if (strncmp(list, "W/", 2) == 0) {
+            list += 2;
+        }
+        size_t len = strcspn(list, ", ");
+        if (len == etag_len && strncmp(list, etag, len) == 0) {
+            return true;
+        }
+        list += len;
+    }
+    return false;
+}
+
+/* Parses a Range header with a single byte range. Returns 1 and sets the range
+ * if it is satisfiable, -1 if it isn't, and 0 if the header must be ignored,
+ * as it is invalid, uses another unit or has several ranges. */
+static int httpd_file_parse_range(const char *range, size_t len, size_t *offset, size_t *count)
+{
+    unsigned long long first;
+    unsigned long long last;
+    char *end;
+
+    if (strncmp(range, "bytes=", 6) != 0 || strchr(range, ',')) {
+        return 0;
+    }
+    range += 6;
+    if (range[0] == '-') {
+        /* The last bytes of the content */
+        if (!isdigit((unsigned char)range[1])) {
+            return 0;
+        }
+        unsigned long long suffix = strtoull(range + 1, &end, 10);
+        if (*end != '\0') {
+            return 0;
+        }
+        if (suffix == 0 || len == 0) {
+            return -1;
+        }
+        first = suffix < len ? len - suffix : 0;
+        last = len - 1;
+    } else {
+        if (!isdigit((unsigned char)range[0])) {
+            return 0;
+        }
+        first = strtoull(range, &end, 10);
+        if (*end != '-') {
+            return 0;
+        }
+        range = end + 1;
+        last = ULLONG_MAX;
+        if (*range != '\0') {
+            if (!isdigit((unsigned char)*range)) {
+                return 0;
+            }
+            last = strtoull(range, &end, 10);
+            if (*end != '\0' || last < first) {
+                return 0;
+            }
+        }
+        if (first >= len) {
+            return -1;
+        }
+        if (last >= len) {
+            last = len - 1;
+        }
+    }
+    *offset = first;
+    *count = last - first + 1;
+    return 1;
+}
+
+/* Copies the request headers selecting the response */
+static void httpd_file_req_init(httpd_req_t *r, struct httpd_file_req *fr)
+{
+    char accept_encoding[HTTPD_FILE_HDR_LEN];
+
+    memset(fr, 0, sizeof(*fr));
+    /* Truncated headers are ignored */
+    if (httpd_req_get_hdr_value_str(r, "If-None-Match", fr->if_none_match, sizeof(fr->if_none_match)) != ESP_OK) {
+        fr->if_none_match[0] = '\0';
+    }
+    if (httpd_req_get_hdr_value_str(r, "If-Range", fr->if_range, sizeof(fr->if_range)) != ESP_OK) {
+        fr->if_range[0] = '\0';
+    }
+    if (httpd_req_get_hdr_value_str(r, "Range", fr->range, sizeof(fr->range)) != ESP_OK) {
+        fr->range[0] = '\0';
+    }
+    if (httpd_req_get_hdr_value_str(r, "Accept-Encoding", accept_encoding, sizeof(accept_encoding)) == ESP_OK) {
+        fr->accepts_gzip = httpd_file_accepts_gzip(accept_encoding);
+    }
+}
+
+/* Sets the status and headers of the response for content of len bytes whose
+ * entity tag is in fr->etag, if any, and selects the part of it to send. Sets
+ * count to 0 if no content is to be sent, for 304 and 416 responses. */
+static esp_err_t httpd_file_prepare(httpd_req_t *r, struct httpd_file_req *fr, size_t len,
+                                    bool has_gz, bool gzip, size_t *offset, size_t *count)
+{
+    const char *etag = fr->etag[0] ? fr->etag : NULL;
+    esp_err_t ret = ESP_OK;
+
+    *offset = 0;
+    *count = len;
+    if (etag) {
+        ret = httpd_resp_set_hdr(r, "ETag", etag);
+    }
+    if (ret == ESP_OK && has_gz) {
+        ret = httpd_resp_set_hdr(r, "Vary", "Accept-Encoding");
+    }
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    if (etag && fr->if_none_match[0] && httpd_file_etag_listed(fr->if_none_match, etag)) {
+        *count = 0;
+        return httpd_resp_set_status(r, HTTPD_304);
+    }
+
+    ret = httpd_resp_set_hdr(r, "Accept-Ranges", "bytes");
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    /* A Range for another version of the content is ignored */
+    if (fr->range[0] && (!fr->if_range[0] || (etag && strcmp(fr->if_range, etag) == 0))) {
+        int range = httpd_file_parse_range(fr->range, len, offset, count);
+        if (range > 0) {
+            snprintf(fr->content_range, sizeof(fr->content_range),
+                     "bytes %"NEWLIB_NANO_COMPAT_FORMAT"-%"NEWLIB_NANO_COMPAT_FORMAT"/%"NEWLIB_NANO_COMPAT_FORMAT,
+                     NEWLIB_NANO_COMPAT_CAST(*offset), NEWLIB_NANO_COMPAT_CAST((*offset + *count - 1)),
+                     NEWLIB_NANO_COMPAT_CAST(len));
+            httpd_resp_set_status(r, HTTPD_206);
+            ret = httpd_resp_set_hdr(r, "Content-Range", fr->content_range);
+        } else if (range < 0) {
+            snprintf(fr->content_range, sizeof(fr->content_range),
+                     "bytes */%"NEWLIB_NANO_COMPAT_FORMAT, NEWLIB_NANO_COMPAT_CAST(len));
+            *count = 0;
+            httpd_resp_set_status(r, HTTPD_416);
+            return httpd_resp_set_hdr(r, "Content-Range", fr->content_range);
+        }
+    }
+    if (ret == ESP_OK && gzip) {
+        ret = httpd_resp_set_hdr(r, "Content-Encoding", "gzip");
+    }
+    return ret;
+}
+
+static void httpd_file_sent(httpd_req_t *r, size_t count)
+{
+    struct httpd_req_aux *ra = r->aux;
+    esp_http_server_event_data evt_data = {
+        .fd = ra->sd->fd,
+        .data_len = count,
+    };
+    esp_http_server_dispatch_event(HTTP_SERVER_EVENT_SENT_DATA, &evt_data, sizeof(esp_http_server_event_data));
+}
+
+esp_err_t httpd_resp_send_region(httpd_req_t *r, const httpd_resp_region_t *region)
+{
+    if (r == NULL || region == NULL || (region->data == NULL && region->len) ||
+            (region->gz_data == NULL && region->gz_len)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (!httpd_valid_req(r)) {
+        return ESP_ERR_HTTPD_INVALID_REQ;
+    }
+
+    struct httpd_file_req fr;
+    httpd_file_req_init(r, &fr);
+
+    bool has_gz = region->gz_data != NULL;
+    bool gzip = has_gz && fr.accepts_gzip;
+    const char *data = gzip ? region->gz_data : region->data;
+    size_t len = gzip ? region->gz_len : region->len;
+    if (region->etag) {
+        size_t etag_len = strlen(region->etag);
+        if (!gzip) {
+            strlcpy(fr.etag, region->etag, sizeof(fr.etag));
+        } else if (etag_len > 0 && region->etag[etag_len - 1] == '"') {
+            snprintf(fr.etag, sizeof(fr.etag), "%.*s-gz\"", (int)(etag_len - 1), region->etag);
+        }
+    }
+
+    size_t offset;
+    size_t count;
+    esp_err_t ret = httpd_file_prepare(r, &fr, len, has_gz, gzip, &offset, &count);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    /* The content goes out in the same vectored write as the headers */
+    ret = httpd_resp_send_hdr(r, count, data + offset, count);
+    if (ret == ESP_OK) {
+        httpd_file_sent(r, count);
+    }
+    return ret;
+}
+
+/* Sends count bytes of the file from offset, reading them into a buffer. The
+ * first part goes out along with the headers, unless they have been sent. */
+static esp_err_t httpd_file_send_buf(httpd_req_t *r, int fd, size_t offset, size_t count, bool hdr_sent)
+{
+    if (count == 0) {
+        return hdr_sent ? ESP_OK : httpd_resp_send_hdr(r, 0, NULL, 0);
+    }
+    if (offset && lseek(fd, offset, SEEK_SET) < 0) {
+        return ESP_FAIL;
+    }
+
+    size_t buf_size = MIN(count, CONFIG_HTTPD_FILE_BUF_SIZE);
+    char *buf = malloc(buf_size);
+    if (!buf) {
+        ESP_LOGE(TAG, LOG_FMT("Failed to allocate memory for the file buffer"));
+        return ESP_ERR_NO_MEM;
+    }
+
+    esp_err_t ret = ESP_OK;
+    size_t left = count;
+    while (left > 0) {
+        ssize_t len = read(fd, buf, MIN(left, buf_size));
+        if (len <= 0) {
+            ESP_LOGD(TAG, LOG_FMT("error in read = %d"), errno);
+            ret = ESP_FAIL;
+            break;
+        }
+        if (!hdr_sent) {
+            ret = httpd_resp_send_hdr(r, count, buf, len);
+            hdr_sent = true;
+        } else {
+            ret = httpd_resp_send_body(r, buf, len);
+        }
+        if (ret != ESP_OK) {
+            break;
+        }
+        left -= len;
+    }
+    free(buf);
+    return ret;
+}
+
+/* Sends count bytes of the file from offset, with the headers */
+static esp_err_t httpd_file_send_fd(httpd_req_t *r, int fd, size_t offset, size_t count)
+{
+#ifdef HTTPD_OS_SENDFILE
+    struct httpd_req_aux *ra = r->aux;
+
+    /* The kernel can only send to the socket if nothing else is to be done
+     * with the data, such as encrypting it */
+    if (ra->sd->send_fn == httpd_default_send && count > 0) {
+        esp_err_t ret = httpd_resp_send_hdr(r, count, NULL, 0);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+        off_t pos = offset;
+        size_t left = count;
+        while (left > 0) {
+            ssize_t sent = httpd_os_sendfile(ra->sd->fd, fd, &pos, left);
+            if (sent < 0 && errno == EINTR) {
+                continue;
+            }
+            if (sent < 0 && left == count && (errno == EINVAL || errno == ENOSYS)) {
+                /* The file doesn't support it */
+                return httpd_file_send_buf(r, fd, offset, count, true);
+            }
+            if (sent <= 0) {
+                ESP_LOGD(TAG, LOG_FMT("error in sendfile = %d"), errno);
+                return sent < 0 ? ESP_ERR_HTTPD_RESP_SEND : ESP_FAIL;
+            }
+            left -= sent;
+        }
+        return ESP_OK;
+    }
+#endif
+    return httpd_file_send_buf(r, fd, offset, count, false);
+}
+
+/* Opens the file and derives its entity tag from its size and modification time */
+static int httpd_file_open(const char *path, struct httpd_file_req *fr, size_t *len)
+{
+    struct stat st;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        close(fd);
+        return -1;
+    }
+    *len = st.st_size;
+    snprintf(fr->etag, sizeof(fr->etag), "\"%llx-%llx\"",
+             (unsigned long long)st.st_size, (unsigned long long)st.st_mtime);
+    return fd;
+}
+
+esp_err_t httpd_resp_send_file(httpd_req_t *r, const char *path)
+{
+    if (r == NULL || path == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (!httpd_valid_req(r)) {
+        return ESP_ERR_HTTPD_INVALID_REQ;
+    }
+
+    struct httpd_file_req fr;
+    httpd_file_req_init(r, &fr);
+
+    int fd = -1;
+    size_t len = 0;
+    size_t gz_path_size = strlen(path) + sizeof(".gz");
+    char *gz_path = malloc(gz_path_size);
+    if (!gz_path) {
+        ESP_LOGE(TAG, LOG_FMT("Failed to allocate memory for the file path"));
+        return ESP_ERR_NO_MEM;
+    }
+    snprintf(gz_path, gz_path_size, "%s.gz", path);
+    /* The response depends on Accept-Encoding whenever there is a
+     * compressed version, even for the clients not accepting it */
+    bool has_gz;
+    if (fr.accepts_gzip) {
+        fd = httpd_file_open(gz_path, &fr, &len);
+        has_gz = fd >= 0;
+    } else {
+        struct stat st;
+        has_gz = stat(gz_path, &st) == 0 && S_ISREG(st.st_mode);
+    }
+    bool gzip = has_gz && fr.accepts_gzip;
+    free(gz_path);
+    if (fd < 0) {
+        fd = httpd_file_open(path, &fr, &len);
+    }
+    if (fd < 0) {
+        ESP_LOGD(TAG, LOG_FMT("failed to open %s = %d"), path, errno);
+        httpd_resp_send_err(r, HTTPD_404_NOT_FOUND, NULL);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    size_t offset;
+    size_t count;
+    esp_err_t ret = httpd_file_prepare(r, &fr, len, has_gz, gzip, &offset, &count);
+    if (ret == ESP_OK) {
+        ret = httpd_file_send_fd(r, fd, offset, count);
+    }
+    close(fd);
+    if (ret == ESP_OK) {
+        httpd_file_sent(r, count);
+    }
+    return ret;
+}
@@ -1,5 +1,5 @@
 /*
- * SPDX-FileCopyrightText: 2018-2021 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2018-2023 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
@@ -20,7 +20,10 @@
 #include "freertos/semphr.h"
 #endif
 
-#if defined(CONFIG_LWIP_MAX_SOCKETS)
+#if CONFIG_IDF_TARGET_LINUX
+/* Host sockets are only limited by the number of files the process may open */
+#define HTTPD_MAX_SOCKETS (UINT16_MAX + 3)
+#elif defined(CONFIG_LWIP_MAX_SOCKETS)
 #define HTTPD_MAX_SOCKETS CONFIG_LWIP_MAX_SOCKETS
 #else
 /* LwIP component is not included into the build, use a default value */
@@ -31,11 +34,6 @@ static const int DEFAULT_KEEP_ALIVE_IDLE = 5;
 static const int DEFAULT_KEEP_ALIVE_INTERVAL= 5;
 static const int DEFAULT_KEEP_ALIVE_COUNT= 3;
 
-typedef struct {
-    fd_set *fdset;
-    struct httpd_data *hd;
-} process_session_context_t;
-
 static const char *TAG = "httpd";
 
 ESP_EVENT_DEFINE_BASE(ESP_HTTP_SERVER_EVENT);
@@ -236,25 +234,33 @@ static void httpd_process_ctrl_msg(struct httpd_data *hd)
 #endif
 }
 
-// Called for each session from httpd_server
-static int httpd_process_session(struct sock_db *session, void *context)
+// Processes a session with a readable socket or pending data
+static void httpd_process_session(struct httpd_data *hd, struct sock_db *session)
 {
-    if ((!session) || (!context)) {
-        return 0;
+    /* The session may have been closed by a control message, or
+     * handed over to a worker by a previous request */
+    if (session->fd < 0 || session->worker_req) {
+        return;
     }
 
-    if (session->fd < 0) {
-        return 1;
+    ESP_LOGD(TAG, LOG_FMT("processing socket %d"), session->fd);
+    if (httpd_sess_process(hd, session) != ESP_OK) {
+        httpd_sess_delete(hd, session); // Delete session
+    } else if (httpd_sess_pending(hd, session)) {
+        hd->hd_sess_pending = true;
     }
+}
 
-    process_session_context_t *ctx = (process_session_context_t *)context;
-    int fd = session->fd;
+// Called for each session from httpd_server when sessions may have pending data
+static int httpd_process_pending_session(struct sock_db *session, void *context)
+{
+    if ((!session) || (!context)) {
+        return 0;
+    }
 
-    if (FD_ISSET(fd, ctx->fdset) || httpd_sess_pending(ctx->hd, session)) {
-        ESP_LOGD(TAG, LOG_FMT("processing socket %d"), fd);
-        if (httpd_sess_process(ctx->hd, session) != ESP_OK) {
-            httpd_sess_delete(ctx->hd, session); // Delete session
-        }
+    struct httpd_data *hd = (struct httpd_data *)context;
+    if (session->fd >= 0 && !session->worker_req && httpd_sess_pending(hd, session)) {
+        httpd_process_session(hd, session);
     }
     return 1;
 }
@@ -262,51 +268,50 @@ static int httpd_process_session(struct sock_db *session, void *context)
 /* Manage in-coming connection or data requests */
 static esp_err_t httpd_server(struct httpd_data *hd)
 {
-    fd_set read_set;
-    FD_ZERO(&read_set);
-    if (hd->config.lru_purge_enable || httpd_is_sess_available(hd)) {
-        /* Only listen for new connections if server has capacity to
-         * handle more (or when LRU purge is enabled, in which case
-         * older connections will be closed) */
-        FD_SET(hd->listen_fd, &read_set);
-    }
-    FD_SET(hd->ctrl_fd, &read_set);
-
-    int tmp_max_fd;
-    httpd_sess_set_descriptors(hd, &read_set, &tmp_max_fd);
-    int maxfd = MAX(hd->listen_fd, tmp_max_fd);
-    tmp_max_fd = maxfd;
-    maxfd = MAX(hd->ctrl_fd, tmp_max_fd);
-
-    ESP_LOGD(TAG, LOG_FMT("doing select maxfd+1 = %d"), maxfd + 1);
-    int active_cnt = select(maxfd + 1, &read_set, NULL, NULL, NULL);
+    /* Only listen for new connections if server has capacity to
+     * handle more (or when LRU purge is enabled, in which case
+     * older connections will be closed) */
+    httpd_poll_set_listen(hd, hd->config.lru_purge_enable || httpd_is_sess_available(hd));
+
+    /* Don't wait if a session has data left in its buffers,
+     * its socket may not become readable */
+    struct httpd_poll_events events;
+    int active_cnt = httpd_poll_wait(hd, hd->hd_sess_pending ? 0 : -1, &events);
     if (active_cnt < 0) {
-        ESP_LOGE(TAG, LOG_FMT("error in select (%d)"), errno);
+        ESP_LOGE(TAG, LOG_FMT("error in poll (%d)"), errno);
         httpd_sess_delete_invalid(hd);
         return ESP_OK;
     }
+    bool check_pending = hd->hd_sess_pending;
+    hd->hd_sess_pending = false;
 
     /* Case0: Do we have a control message? */
-    if (FD_ISSET(hd->ctrl_fd, &read_set)) {
+    if (events.ctrl) {
         ESP_LOGD(TAG, LOG_FMT("processing ctrl message"));
         httpd_process_ctrl_msg(hd);
         if (hd->hd_td.status == THREAD_STOPPING) {
             ESP_LOGD(TAG, LOG_FMT("stopping thread"));
             return ESP_FAIL;
         }
+        /* Take back the sessions of the workers which are done, either
+         * woken up by this message or by a message which has been lost */
+        httpd_workers_collect(hd);
+        /* The work may have left data pending in a session */
+        check_pending = true;
     }
 
     /* Case1: Do we have any activity on the current data
      * sessions? */
-    process_session_context_t context = {
-        .fdset = &read_set,
-        .hd = hd
-    };
-    httpd_sess_enum(hd, httpd_process_session, &context);
+    for (size_t i = 0; i < events.sessions_count; i++) {
+        httpd_process_session(hd, events.sessions[i]);
+    }
+    if (check_pending) {
+        httpd_sess_enum(hd, httpd_process_pending_session, hd);
+    }
 
     /* Case2: Do we have any incoming connection requests to
      * process? */
-    if (FD_ISSET(hd->listen_fd, &read_set)) {
+    if (events.listen) {
         ESP_LOGD(TAG, LOG_FMT("processing listen socket %d"), hd->listen_fd);
         if (httpd_accept_conn(hd, hd->listen_fd) != ESP_OK) {
             ESP_LOGW(TAG, LOG_FMT("error accepting new connection"));
@@ -331,6 +336,7 @@ static void httpd_thread(void *arg)
     }
 
     ESP_LOGD(TAG, LOG_FMT("web server exiting"));
+    httpd_workers_stop(hd);
     close(hd->msg_fd);
     cs_free_ctrl_sock(hd->ctrl_fd);
     httpd_sess_close_all(hd);
@@ -407,6 +413,13 @@ static esp_err_t httpd_server_init(struct httpd_data *hd)
     hd->listen_fd = fd;
     hd->ctrl_fd = ctrl_fd;
     hd->msg_fd  = msg_fd;
+
+    if (httpd_poll_init(hd) != ESP_OK) {
+        close(fd);
+        close(ctrl_fd);
+        close(msg_fd);
+        return ESP_FAIL;
+    }
     return ESP_OK;
 }
 
@@ -449,6 +462,17 @@ static struct httpd_data *httpd_create(const httpd_config_t *config)
         free(hd);
         return NULL;
     }
+#if CONFIG_HTTPD_URI_ROUTER
+    if (httpd_os_mutex_create(&hd->hd_router_lock) != OS_SUCCESS) {
+        ESP_LOGE(TAG, LOG_FMT("Failed to create URI router lock"));
+        free(hd->err_handler_fns);
+        free(ra->resp_hdrs);
+        free(hd->hd_sd);
+        free(hd->hd_calls);
+        free(hd);
+        return NULL;
+    }
+#endif
     /* Save the configuration for this instance */
     hd->config = *config;
     return hd;
@@ -458,6 +482,7 @@ static void httpd_delete(struct httpd_data *hd)
 {
     struct httpd_req_aux *ra = &hd->hd_req_aux;
     /* Free memory of httpd instance data */
+    httpd_poll_deinit(hd);
     free(hd->err_handler_fns);
     free(ra->resp_hdrs);
     free(hd->hd_sd);
@@ -465,6 +490,9 @@ static void httpd_delete(struct httpd_data *hd)
     /* Free registered URI handlers */
     httpd_unregister_all_uri_handlers(hd);
     free(hd->hd_calls);
+#if CONFIG_HTTPD_URI_ROUTER
+    httpd_os_mutex_delete(&hd->hd_router_lock);
+#endif
     free(hd);
 }
 
@@ -515,12 +543,18 @@ esp_err_t httpd_start(httpd_handle_t *handle, const httpd_config_t *config)
     }
 
     httpd_sess_init(hd);
+    esp_err_t err = httpd_workers_start(hd);
+    if (err != ESP_OK) {
+        httpd_delete(hd);
+        return err;
+    }
     if (httpd_os_thread_create(&hd->hd_td.handle, "httpd",
                                hd->config.stack_size,
                                hd->config.task_priority,
                                httpd_thread, hd,
                                hd->config.core_id) != ESP_OK) {
         /* Failed to launch task */
+        httpd_workers_stop(hd);
         httpd_delete(hd);
         return ESP_ERR_HTTPD_TASK;
     }
@@ -696,7 +696,7 @@ static void init_req_aux(struct httpd_req_aux *ra, httpd_config_t *config)
     memset(ra->resp_hdrs, 0, config->max_resp_headers * sizeof(struct resp_hdr));
 }
 
-static void httpd_req_cleanup(httpd_req_t *r)
+void httpd_req_cleanup(httpd_req_t *r)
 {
     struct httpd_req_aux *ra = r->aux;
 
@@ -803,7 +803,11 @@ esp_err_t httpd_req_new(struct httpd_data *hd, struct sock_db *sd)
  */
 esp_err_t httpd_req_delete(struct httpd_data *hd)
 {
-    httpd_req_t *r = &hd->hd_req;
+    return httpd_req_finish(&hd->hd_req);
+}
+
+esp_err_t httpd_req_finish(httpd_req_t *r)
+{
     struct httpd_req_aux *ra = r->aux;
 
     /* Finish off reading any pending/leftover data */
@@ -847,6 +851,8 @@ bool httpd_validate_req_ptr(httpd_req_t *r)
             if (httpd_os_thread_handle() == hd->hd_td.handle) {
                 return true;
             }
+            /* or of one of its workers */
+            return httpd_workers_is_current(hd);
         }
     }
     return false;
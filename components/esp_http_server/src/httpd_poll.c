@@ -0,0 +1,245 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <esp_log.h>
+#include <esp_err.h>
+
+#include <esp_http_server.h>
+#include "esp_httpd_priv.h"
+
+#if CONFIG_HTTPD_POLL_EPOLL
+#include <sys/epoll.h>
+#else
+#include <sys/poll.h>
+#endif
+
+static const char *TAG = "httpd_poll";
+
+#if CONFIG_HTTPD_POLL_EPOLL
+
+/* The sockets are registered with an epoll instance. The data of the events
+ * of a session socket is the session, the data of the events of the control
+ * and listening sockets point to their descriptors in struct httpd_data. */
+struct httpd_poll {
+    int epoll_fd;
+    bool listen;                    /* The listening socket is reported */
+    int max_events;
+    struct epoll_event *events;     /* Events returned by epoll_wait() */
+    struct sock_db **sessions;      /* Sessions with events */
+};
+
+static esp_err_t httpd_poll_ctl(struct httpd_poll *p, int op, int fd, uint32_t events, void *ptr)
+{
+    struct epoll_event event = {
+        .events = events,
+        .data.ptr = ptr,
+    };
+    if (epoll_ctl(p->epoll_fd, op, fd, &event) < 0) {
+        ESP_LOGE(TAG, LOG_FMT("error in epoll_ctl %d for fd %d (%d)"), op, fd, errno);
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+esp_err_t httpd_poll_init(struct httpd_data *hd)
+{
+    struct httpd_poll *p = calloc(1, sizeof(struct httpd_poll));
+    if (!p) {
+        return ESP_FAIL;
+    }
+    p->max_events = hd->config.max_open_sockets + 2;
+    p->events = calloc(p->max_events, sizeof(struct epoll_event));
+    p->sessions = calloc(hd->config.max_open_sockets, sizeof(struct sock_db *));
+    p->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    hd->hd_poll = p;
+    if (!p->events || !p->sessions || p->epoll_fd < 0) {
+        ESP_LOGE(TAG, LOG_FMT("error in creating epoll instance (%d)"), errno);
+        httpd_poll_deinit(hd);
+        return ESP_FAIL;
+    }
+    p->listen = true;
+    if (httpd_poll_ctl(p, EPOLL_CTL_ADD, hd->ctrl_fd, EPOLLIN, &hd->ctrl_fd) != ESP_OK ||
+            httpd_poll_ctl(p, EPOLL_CTL_ADD, hd->listen_fd, EPOLLIN, &hd->listen_fd) != ESP_OK) {
+        httpd_poll_deinit(hd);
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+void httpd_poll_deinit(struct httpd_data *hd)
+{
+    struct httpd_poll *p = hd->hd_poll;
+    if (!p) {
+        return;
+    }
+    if (p->epoll_fd >= 0) {
+        close(p->epoll_fd);
+    }
+    free(p->sessions);
+    free(p->events);
+    free(p);
+    hd->hd_poll = NULL;
+}
+
+esp_err_t httpd_poll_add(struct httpd_data *hd, struct sock_db *session)
+{
+    return httpd_poll_ctl(hd->hd_poll, EPOLL_CTL_ADD, session->fd, EPOLLIN, session);
+}
+
+void httpd_poll_remove(struct httpd_data *hd, struct sock_db *session)
+{
+    struct epoll_event event = { 0 };
+    /* Fails with ENOENT if the socket hasn't been added */
+    epoll_ctl(hd->hd_poll->epoll_fd, EPOLL_CTL_DEL, session->fd, &event);
+}
+
+void httpd_poll_set_listen(struct httpd_data *hd, bool enable)
+{
+    struct httpd_poll *p = hd->hd_poll;
+    if (p->listen != enable &&
+            httpd_poll_ctl(p, EPOLL_CTL_MOD, hd->listen_fd, enable ? EPOLLIN : 0, &hd->listen_fd) == ESP_OK) {
+        p->listen = enable;
+    }
+}
+
+int httpd_poll_wait(struct httpd_data *hd, int timeout_ms, struct httpd_poll_events *events)
+{
+    struct httpd_poll *p = hd->hd_poll;
+    memset(events, 0, sizeof(*events));
+    events->sessions = p->sessions;
+
+    int count = epoll_wait(p->epoll_fd, p->events, p->max_events, timeout_ms);
+    for (int i = 0; i < count; i++) {
+        void *ptr = p->events[i].data.ptr;
+        if (ptr == &hd->ctrl_fd) {
+            events->ctrl = true;
+        } else if (ptr == &hd->listen_fd) {
+            events->listen = p->listen;
+        } else {
+            events->sessions[events->sessions_count++] = ptr;
+        }
+    }
+    return count;
+}
+
+#else // CONFIG_HTTPD_POLL_EPOLL
+
+/* Index of the control and listening sockets in the set, the sockets
+ * of the sessions follow */
+#define POLL_INDEX_CTRL     0
+#define POLL_INDEX_LISTEN   1
+#define POLL_INDEX_SESSIONS 2
+
+/* The sockets are kept contiguous in an array of struct pollfd, a session
+ * knows the index of its socket so that it is removed by moving the last
+ * socket of the array in its place */
+struct httpd_poll {
+    nfds_t nfds;
+    struct pollfd *fds;
+    struct sock_db **fd_sessions;   /* Session of each element of fds, NULL for the server sockets */
+    struct sock_db **sessions;      /* Sessions with events */
+};
+
+esp_err_t httpd_poll_init(struct httpd_data *hd)
+{
+    struct httpd_poll *p = calloc(1, sizeof(struct httpd_poll));
+    if (!p) {
+        return ESP_FAIL;
+    }
+    size_t max_fds = hd->config.max_open_sockets + POLL_INDEX_SESSIONS;
+    p->fds = calloc(max_fds, sizeof(struct pollfd));
+    p->fd_sessions = calloc(max_fds, sizeof(struct sock_db *));
+    p->sessions = calloc(hd->config.max_open_sockets, sizeof(struct sock_db *));
+    hd->hd_poll = p;
+    if (!p->fds || !p->fd_sessions || !p->sessions) {
+        ESP_LOGE(TAG, LOG_FMT("Failed to allocate memory for the socket set"));
+        httpd_poll_deinit(hd);
+        return ESP_FAIL;
+    }
+    p->fds[POLL_INDEX_CTRL].fd = hd->ctrl_fd;
+    p->fds[POLL_INDEX_CTRL].events = POLLIN;
+    p->fds[POLL_INDEX_LISTEN].fd = hd->listen_fd;
+    p->fds[POLL_INDEX_LISTEN].events = POLLIN;
+    p->nfds = POLL_INDEX_SESSIONS;
+    return ESP_OK;
+}
+
+void httpd_poll_deinit(struct httpd_data *hd)
+{
+    struct httpd_poll *p = hd->hd_poll;
+    if (!p) {
+        return;
+    }
+    free(p->sessions);
+    free(p->fd_sessions);
+    free(p->fds);
+    free(p);
+    hd->hd_poll = NULL;
+}
+
+esp_err_t httpd_poll_add(struct httpd_data *hd, struct sock_db *session)
+{
+    struct httpd_poll *p = hd->hd_poll;
+    if (p->nfds >= hd->config.max_open_sockets + POLL_INDEX_SESSIONS) {
+        ESP_LOGE(TAG, LOG_FMT("socket set is full"));
+        return ESP_FAIL;
+    }
+    p->fds[p->nfds].fd = session->fd;
+    p->fds[p->nfds].events = POLLIN;
+    p->fds[p->nfds].revents = 0;
+    p->fd_sessions[p->nfds] = session;
+    session->poll_index = p->nfds++;
+    return ESP_OK;
+}
+
+void httpd_poll_remove(struct httpd_data *hd, struct sock_db *session)
+{
+    struct httpd_poll *p = hd->hd_poll;
+    int index = session->poll_index;
+    if (index < POLL_INDEX_SESSIONS) {
+        return;
+    }
+    /* Move the last socket in place of the removed one */
+    p->nfds--;
+    if (index != p->nfds) {
+        p->fds[index] = p->fds[p->nfds];
+        p->fd_sessions[index] = p->fd_sessions[p->nfds];
+        p->fd_sessions[index]->poll_index = index;
+    }
+    session->poll_index = 0;
+}
+
+void httpd_poll_set_listen(struct httpd_data *hd, bool enable)
+{
+    hd->hd_poll->fds[POLL_INDEX_LISTEN].events = enable ? POLLIN : 0;
+}
+
+int httpd_poll_wait(struct httpd_data *hd, int timeout_ms, struct httpd_poll_events *events)
+{
+    struct httpd_poll *p = hd->hd_poll;
+    memset(events, 0, sizeof(*events));
+    events->sessions = p->sessions;
+
+    int count = poll(p->fds, p->nfds, timeout_ms);
+    if (count <= 0) {
+        return count;
+    }
+    events->ctrl = p->fds[POLL_INDEX_CTRL].revents != 0;
+    events->listen = (p->fds[POLL_INDEX_LISTEN].revents & POLLIN) != 0;
+    int found = events->ctrl + events->listen;
+    for (nfds_t i = POLL_INDEX_SESSIONS; i < p->nfds && found < count; i++) {
+        if (p->fds[i].revents) {
+            events->sessions[events->sessions_count++] = p->fd_sessions[i];
+            found++;
+        }
+    }
+    return count;
+}
+
+#endif // CONFIG_HTTPD_POLL_EPOLL
@@ -0,0 +1,335 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <esp_log.h>
+#include <esp_err.h>
+
+#include <esp_http_server.h>
+#include "esp_httpd_priv.h"
+
+#if CONFIG_HTTPD_URI_ROUTER
+
+static const char *TAG = "httpd_router";
+
+/* A handler reachable from a node of the tree. The routes of a node are
+ * sorted by the index of their handler in hd_calls, so that the handler
+ * registered first wins as with the linear scan. */
+struct httpd_route {
+    httpd_uri_t *handler;
+    unsigned index;
+};
+
+struct httpd_route_list {
+    struct httpd_route *routes;
+    size_t count;
+};
+
+/* A node of the radix tree. The path from the root to a node spells the
+ * URI or URI prefix the node stands for, each edge is labelled with the
+ * characters it adds to the path of its parent. */
+struct httpd_router_node {
+    struct httpd_router_node *child;    /* First child */
+    struct httpd_router_node *sibling;  /* Next child of the parent */
+    struct httpd_route_list exact;      /* Handlers matching the URIs equal to the path */
+    struct httpd_route_list prefix;     /* Handlers matching the URIs starting with the path */
+    size_t label_len;
+    char label[];
+};
+
+struct httpd_router {
+    struct httpd_router_node *root;
+    struct httpd_router *next_retired;  /* Next tree in hd_router_retired */
+};
+
+/* Conditions on the URI a handler template is compiled to, see httpd_uri_match_wildcard() */
+struct httpd_route_key {
+    const char *path;
+    size_t len;
+    bool prefix;
+};
+
+static struct httpd_router_node *httpd_router_node_new(const char *label, size_t label_len)
+{
+    struct httpd_router_node *node = calloc(1, sizeof(struct httpd_router_node) + label_len);
+    if (node) {
+        memcpy(node->label, label, label_len);
+        node->label_len = label_len;
+    }
+    return node;
+}
+
+static void httpd_router_node_free(struct httpd_router_node *node)
+{
+    while (node) {
+        struct httpd_router_node *sibling = node->sibling;
+        httpd_router_node_free(node->child);
+        free(node->exact.routes);
+        free(node->prefix.routes);
+        free(node);
+        node = sibling;
+    }
+}
+
+static struct httpd_router_node *httpd_router_node_child(struct httpd_router_node *node, char c)
+{
+    struct httpd_router_node *child = node->child;
+    while (child && child->label[0] != c) {
+        child = child->sibling;
+    }
+    return child;
+}
+
+/* Returns the node whose path is the given one, creating it if needed */
+static struct httpd_router_node *httpd_router_node_get(struct httpd_router_node *node,
+                                                       const char *path, size_t len)
+{
+    while (len) {
+        struct httpd_router_node *child = httpd_router_node_child(node, path[0]);
+        if (!child) {
+            child = httpd_router_node_new(path, len);
+            if (!child) {
+                return NULL;
+            }
+            child->sibling = node->child;
+            node->child = child;
+            return child;
+        }
+
+        size_t common = 1;
+        while (common < child->label_len && common < len && child->label[common] == path[common]) {
+            common++;
+        }
+        if (common < child->label_len) {
+            /* Split the edge, the new node takes the place of the child */
+            struct httpd_router_node *split = httpd_router_node_new(child->label, common);
+            if (!split) {
+                return NULL;
+            }
+            struct httpd_router_node **link = &node->child;
+            while (*link != child) {
+                link = &(*link)->sibling;
+            }
+            *link = split;
+            split->sibling = child->sibling;
+            split->child = child;
+            child->sibling = NULL;
+            child->label_len -= common;
+            memmove(child->label, child->label + common, child->label_len);
+            child = split;
+        }
+        node = child;
+        path += common;
+        len -= common;
+    }
+    return node;
+}
+
+static esp_err_t httpd_route_list_add(struct httpd_route_list *list, httpd_uri_t *handler, unsigned index)
+{
+    struct httpd_route *routes = realloc(list->routes, (list->count + 1) * sizeof(struct httpd_route));
+    if (!routes) {
+        return ESP_ERR_NO_MEM;
+    }
+    size_t i = list->count;
+    while (i > 0 && routes[i - 1].index > index) {
+        routes[i] = routes[i - 1];
+        i--;
+    }
+    routes[i].handler = handler;
+    routes[i].index = index;
+    list->routes = routes;
+    list->count++;
+    return ESP_OK;
+}
+
+/* Checks the routes of a list, keeps the first handler registered for the
+ * method in best, and sets uri_found if any handler matches the URI */
+static void httpd_route_list_find(const struct httpd_route_list *list, httpd_method_t method,
+                                  const struct httpd_route **best, bool *uri_found)
+{
+    if (list->count) {
+        *uri_found = true;
+    }
+    for (size_t i = 0; i < list->count; i++) {
+        if (list->routes[i].handler->method == method) {
+            if (!*best || list->routes[i].index < (*best)->index) {
+                *best = &list->routes[i];
+            }
+            return;
+        }
+    }
+}
+
+/* Compiles a template to the conditions the URI must meet for
+ * httpd_uri_match_wildcard() to match it, returns their number */
+static int httpd_route_keys_wildcard(const char *template, struct httpd_route_key keys[2])
+{
+    const size_t tpl_len = strlen(template);
+    const char last = (const char) (tpl_len > 0 ? template[tpl_len - 1] : 0);
+    const char prevlast = (const char) (tpl_len > 1 ? template[tpl_len - 2] : 0);
+    const bool asterisk = last == '*' || (prevlast == '*' && last == '?');
+    const bool quest = last == '?' || (prevlast == '?' && last == '*');
+
+    if (tpl_len < asterisk + quest*2) {
+        /* Invalid template, which matches nothing */
+        return 0;
+    }
+    const size_t exact_match_chars = tpl_len - (asterisk + quest*2);
+
+    if (!quest) {
+        keys[0] = (struct httpd_route_key) {
+            template, exact_match_chars, asterisk
+        };
+        return 1;
+    }
+    /* Without the optional character, or with it and any
+     * trailing characters if the asterisk is present */
+    keys[0] = (struct httpd_route_key) {
+        template, exact_match_chars, false
+    };
+    keys[1] = (struct httpd_route_key) {
+        template, exact_match_chars + 1, asterisk
+    };
+    return 2;
+}
+
+bool httpd_router_supported(struct httpd_data *hd)
+{
+    return hd->config.uri_match_fn == NULL || hd->config.uri_match_fn == httpd_uri_match_wildcard;
+}
+
+/* Adds a URI handler to a router which hasn't been published yet */
+static esp_err_t httpd_router_add(struct httpd_data *hd, struct httpd_router *router,
+                                  httpd_uri_t *handler, unsigned index)
+{
+    struct httpd_route_key keys[2];
+    int num_keys;
+
+    if (hd->config.uri_match_fn) {
+        num_keys = httpd_route_keys_wildcard(handler->uri, keys);
+    } else {
+        keys[0] = (struct httpd_route_key) {
+            handler->uri, strlen(handler->uri), false
+        };
+        num_keys = 1;
+    }
+
+    for (int i = 0; i < num_keys; i++) {
+        struct httpd_router_node *node = httpd_router_node_get(router->root, keys[i].path, keys[i].len);
+        if (!node ||
+                httpd_route_list_add(keys[i].prefix ? &node->prefix : &node->exact, handler, index) != ESP_OK) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    return ESP_OK;
+}
+
+static httpd_uri_t *httpd_router_lookup(const struct httpd_router *router, const char *uri, size_t uri_len,
+                                        httpd_method_t method, httpd_err_code_t *err)
+{
+    const struct httpd_route *best = NULL;
+    bool uri_found = false;
+    struct httpd_router_node *node = router->root;
+    size_t pos = 0;
+
+    while (true) {
+        httpd_route_list_find(&node->prefix, method, &best, &uri_found);
+        if (pos == uri_len) {
+            httpd_route_list_find(&node->exact, method, &best, &uri_found);
+            break;
+        }
+        struct httpd_router_node *child = httpd_router_node_child(node, uri[pos]);
+        if (!child || child->label_len > uri_len - pos ||
+                memcmp(child->label, uri + pos, child->label_len) != 0) {
+            break;
+        }
+        node = child;
+        pos += child->label_len;
+    }
+
+    if (err) {
+        *err = best ? 0 : (uri_found ? HTTPD_405_METHOD_NOT_ALLOWED : HTTPD_404_NOT_FOUND);
+    }
+    return best ? best->handler : NULL;
+}
+
+bool httpd_router_find(struct httpd_data *hd, const char *uri, size_t uri_len,
+                       httpd_method_t method, httpd_uri_t **handler, httpd_err_code_t *err)
+{
+    /* Announce the lookup before loading the tree, so that a tree replaced
+     * after this load isn't freed until the lookup is done */
+    __atomic_fetch_add(&hd->hd_router_readers, 1, __ATOMIC_SEQ_CST);
+    const struct httpd_router *router = __atomic_load_n(&hd->hd_router, __ATOMIC_SEQ_CST);
+    if (router) {
+        *handler = httpd_router_lookup(router, uri, uri_len, method, err);
+    }
+    __atomic_fetch_sub(&hd->hd_router_readers, 1, __ATOMIC_RELEASE);
+    return router != NULL;
+}
+
+static void httpd_router_delete(struct httpd_router *router)
+{
+    if (router) {
+        httpd_router_node_free(router->root);
+        free(router);
+    }
+}
+
+/* Replaces the tree used by the lookups. The replaced tree is retired, and
+ * the retired trees are freed if no lookup is in progress. Otherwise they
+ * are freed by a later update, or when the server is stopped. */
+static void httpd_router_publish(struct httpd_data *hd, struct httpd_router *router)
+{
+    struct httpd_router *old = __atomic_exchange_n(&hd->hd_router, router, __ATOMIC_SEQ_CST);
+    if (old) {
+        old->next_retired = hd->hd_router_retired;
+        hd->hd_router_retired = old;
+    }
+    /* The lookups starting after this load find the new tree */
+    if (__atomic_load_n(&hd->hd_router_readers, __ATOMIC_SEQ_CST) != 0) {
+        return;
+    }
+    while (hd->hd_router_retired) {
+        struct httpd_router *next = hd->hd_router_retired->next_retired;
+        httpd_router_delete(hd->hd_router_retired);
+        hd->hd_router_retired = next;
+    }
+}
+
+void httpd_router_free(struct httpd_data *hd)
+{
+    /* Without lookups in progress, the retired trees are freed as well */
+    httpd_router_publish(hd, NULL);
+}
+
+esp_err_t httpd_router_build(struct httpd_data *hd)
+{
+    if (!httpd_router_supported(hd)) {
+        httpd_router_publish(hd, NULL);
+        return ESP_OK;
+    }
+
+    struct httpd_router *router = calloc(1, sizeof(struct httpd_router));
+    if (!router || !(router->root = httpd_router_node_new("", 0))) {
+        goto err;
+    }
+    for (unsigned i = 0; i < hd->config.max_uri_handlers && hd->hd_calls[i]; i++) {
+        if (httpd_router_add(hd, router, hd->hd_calls[i], i) != ESP_OK) {
+            goto err;
+        }
+    }
+    httpd_router_publish(hd, router);
+    return ESP_OK;
+
+err:
+    ESP_LOGW(TAG, LOG_FMT("Failed to allocate memory for the URI router, using linear lookup"));
+    httpd_router_delete(router);
+    httpd_router_publish(hd, NULL);
+    return ESP_ERR_NO_MEM;
+}
+
+#endif // CONFIG_HTTPD_URI_ROUTER
@@ -1,5 +1,5 @@
 /*
- * SPDX-FileCopyrightText: 2018-2021 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2018-2023 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
@@ -21,7 +21,6 @@ typedef enum {
     HTTPD_TASK_GET_ACTIVE,      // Get active session (fd!=-1)
     HTTPD_TASK_GET_FREE,        // Get free session slot (fd<0)
     HTTPD_TASK_FIND_FD,         // Find session with specific fd
-    HTTPD_TASK_SET_DESCRIPTOR,  // Set descriptor
     HTTPD_TASK_DELETE_INVALID,  // Delete invalid session
     HTTPD_TASK_FIND_LOWEST_LRU, // Find session with lowest lru
     HTTPD_TASK_CLOSE            // Close session
@@ -30,8 +29,6 @@ typedef enum {
 typedef struct {
     task_t task;
     int fd;
-    fd_set *fdset;
-    int max_fd;
     struct httpd_data *hd;
     uint64_t lru_counter;
     struct sock_db    *session;
@@ -85,15 +82,6 @@ static int enum_function(struct sock_db *session, void *context)
     case HTTPD_TASK_FIND_FD:
         found = (session->fd == ctx->fd);
         break;
-    // Set descriptor
-    case HTTPD_TASK_SET_DESCRIPTOR:
-        if (session->fd != -1) {
-            FD_SET(session->fd, ctx->fdset);
-            if (session->fd > ctx->max_fd) {
-                ctx->max_fd = session->fd;
-            }
-        }
-        break;
     // Delete invalid session
     case HTTPD_TASK_DELETE_INVALID:
         if (!fd_is_valid(session->fd)) {
@@ -108,7 +96,7 @@ static int enum_function(struct sock_db *session, void *context)
             return 0;
         }
         // Only close sockets that are not in use
-        if (session->for_async_req == false) {
+        if (session->for_async_req == false && session->worker_req == NULL) {
             // Check/update lowest lru
             if (session->lru_counter < ctx->lru_counter) {
                 ctx->lru_counter = session->lru_counter;
@@ -139,6 +127,12 @@ static void httpd_sess_close(void *arg)
         return;
     }
 
+    // A worker is handling a request of the session, close it when it is done
+    if (sock_db->worker_req) {
+        sock_db->worker_close = true;
+        return;
+    }
+
     if (!sock_db->lru_counter && !sock_db->lru_socket) {
         ESP_LOGD(TAG, "Skipping session close for %d as it seems to be a race condition", sock_db->fd);
         return;
@@ -162,7 +156,7 @@ struct sock_db *httpd_sess_get_free(struct httpd_data *hd)
 
 bool httpd_is_sess_available(struct httpd_data *hd)
 {
-    return httpd_sess_get_free(hd) ? true : false;
+    return hd->hd_sd_active_count < hd->config.max_open_sockets;
 }
 
 struct sock_db *httpd_sess_get(struct httpd_data *hd, int sockfd)
@@ -205,8 +199,15 @@ esp_err_t httpd_sess_new(struct httpd_data *hd, int newfd)
     session->fd = newfd;
     session->handle = (httpd_handle_t) hd;
     session->send_fn = httpd_default_send;
+    session->send_iov_fn = httpd_default_send_iov;
     session->recv_fn = httpd_default_recv;
 
+    // Wait for requests on the socket
+    if (httpd_poll_add(hd, session) != ESP_OK) {
+        session->fd = -1;
+        return ESP_FAIL;
+    }
+
     // increment number of sessions
     hd->hd_sd_active_count++;
 
@@ -271,6 +272,10 @@ void *httpd_sess_get_ctx(httpd_handle_t handle, int sockfd)
     if (hd->hd_req_aux.sd == session) {
         return hd->hd_req.sess_ctx;
     }
+    // or from inside a request handler running in a worker task
+    if (session->worker_req) {
+        return session->worker_req->sess_ctx;
+    }
     return session->ctx;
 }
 
@@ -285,16 +290,22 @@ void httpd_sess_set_ctx(httpd_handle_t handle, int sockfd, void *ctx, httpd_free
     // request handler, in which case set the context inside
     // the httpd_req_t structure
     struct httpd_data *hd = (struct httpd_data *) handle;
+    httpd_req_t *req = NULL;
     if (hd->hd_req_aux.sd == session) {
-        if (hd->hd_req.sess_ctx != ctx) {
+        req = &hd->hd_req;
+    } else if (session->worker_req) {
+        req = session->worker_req;
+    }
+    if (req) {
+        if (req->sess_ctx != ctx) {
             // Don't free previous context if it is in sockdb
             // as it will be freed inside httpd_req_cleanup()
-            if (session->ctx != hd->hd_req.sess_ctx) {
-                httpd_sess_free_ctx(&hd->hd_req.sess_ctx, hd->hd_req.free_ctx); // Free previous context
+            if (session->ctx != req->sess_ctx) {
+                httpd_sess_free_ctx(&req->sess_ctx, req->free_ctx); // Free previous context
             }
-            hd->hd_req.sess_ctx = ctx;
+            req->sess_ctx = ctx;
         }
-        hd->hd_req.free_ctx = free_fn;
+        req->free_ctx = free_fn;
         return;
     }
 
@@ -328,19 +339,6 @@ void httpd_sess_set_transport_ctx(httpd_handle_t handle, int sockfd, void *ctx,
     session->free_transport_ctx = free_fn;
 }
 
-void httpd_sess_set_descriptors(struct httpd_data *hd, fd_set *fdset, int *maxfd)
-{
-    enum_context_t context = {
-        .task = HTTPD_TASK_SET_DESCRIPTOR,
-        .max_fd = -1,
-        .fdset = fdset
-    };
-    httpd_sess_enum(hd, enum_function, &context);
-    if (maxfd) {
-        *maxfd = context.max_fd;
-    }
-}
-
 void httpd_sess_delete_invalid(struct httpd_data *hd)
 {
     enum_context_t context = {
@@ -356,6 +354,13 @@ void httpd_sess_delete(struct httpd_data *hd, struct sock_db *session)
         return;
     }
 
+    // A worker is handling a request of the session, close it when it is done
+    if (session->worker_req) {
+        ESP_LOGD(TAG, LOG_FMT("fd = %d closed after the worker is done"), session->fd);
+        session->worker_close = true;
+        return;
+    }
+
     ESP_LOGD(TAG, LOG_FMT("fd = %d"), session->fd);
     if (hd->config.enable_so_linger) {
         struct linger so_linger = {
@@ -367,6 +372,9 @@ void httpd_sess_delete(struct httpd_data *hd, struct sock_db *session)
         }
     }
 
+    // The socket must leave the set before it is closed
+    httpd_poll_remove(hd, session);
+
     // Call close function if defined
     if (hd->config.close_fn) {
         hd->config.close_fn(hd, session->fd);
@@ -403,7 +411,7 @@ bool httpd_sess_pending(struct httpd_data *hd, struct sock_db *session)
         return false;
     }
     if (session->pending_fn) {
-        // test if there's any data to be read (besides read() function, which is handled by select() in the main httpd loop)
+        // test if there's any data to be read (besides read() function, which is handled by poll() in the main httpd loop)
         // this should check e.g. for the SSL data buffer
         if (session->pending_fn(hd, session->fd) > 0) {
             return true;
@@ -426,6 +434,11 @@ esp_err_t httpd_sess_process(struct httpd_data *hd, struct sock_db *session)
     if (httpd_req_new(hd, session) != ESP_OK) {
         return ESP_FAIL;
     }
+    if (session->worker_req) {
+        // The request has been handed over to a worker, which deletes it
+        ESP_LOGD(TAG, LOG_FMT("handed over to a worker"));
+        return ESP_OK;
+    }
     ESP_LOGD(TAG, LOG_FMT("httpd_req_delete"));
     if (httpd_req_delete(hd) != ESP_OK) {
         return ESP_FAIL;
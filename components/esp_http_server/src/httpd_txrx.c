@@ -1,5 +1,5 @@
 /*
- * SPDX-FileCopyrightText: 2018-2021 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2018-2023 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
@@ -22,6 +22,20 @@ esp_err_t httpd_sess_set_send_override(httpd_handle_t hd, int sockfd, httpd_send
         return ESP_ERR_INVALID_ARG;
     }
     sess->send_fn = send_func;
+    /* The default vectored send would bypass the new send function */
+    if (sess->send_iov_fn == httpd_default_send_iov) {
+        sess->send_iov_fn = NULL;
+    }
+    return ESP_OK;
+}
+
+esp_err_t httpd_sess_set_send_iov_override(httpd_handle_t hd, int sockfd, httpd_send_iov_func_t send_iov_func)
+{
+    struct sock_db *sess = httpd_sess_get(hd, sockfd);
+    if (!sess) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    sess->send_iov_fn = send_iov_func;
     return ESP_OK;
 }
 
@@ -82,6 +96,93 @@ static esp_err_t httpd_send_all(httpd_req_t *r, const char *buf, size_t buf_len)
     return ESP_OK;
 }
 
+/* Sends all the buffers, in a single call of the vectored send function of the session if
+ * the socket accepts all the data, or one buffer at a time with the send function if the
+ * session has no vectored send function. The buffers are modified. */
+static esp_err_t httpd_send_all_iov(httpd_req_t *r, struct iovec *iov, int iov_count)
+{
+    struct httpd_req_aux *ra = r->aux;
+
+    if (!ra->sd->send_iov_fn) {
+        for (int i = 0; i < iov_count; i++) {
+            if (httpd_send_all(r, iov[i].iov_base, iov[i].iov_len) != ESP_OK) {
+                return ESP_FAIL;
+            }
+        }
+        return ESP_OK;
+    }
+
+    while (iov_count > 0) {
+        int ret = ra->sd->send_iov_fn(ra->sd->handle, ra->sd->fd, iov, iov_count, 0);
+        if (ret < 0) {
+            ESP_LOGD(TAG, LOG_FMT("error in send_iov_fn"));
+            return ESP_FAIL;
+        }
+        ESP_LOGD(TAG, LOG_FMT("sent = %d"), ret);
+        /* Skip the buffers which have been sent, and the part of the
+         * first remaining buffer which has been sent */
+        size_t sent = ret;
+        while (iov_count > 0 && sent >= iov->iov_len) {
+            sent -= iov->iov_len;
+            iov++;
+            iov_count--;
+        }
+        if (iov_count > 0) {
+            iov->iov_base = (char *)iov->iov_base + sent;
+            iov->iov_len -= sent;
+        }
+    }
+    return ESP_OK;
+}
+
+static inline void httpd_set_iov(struct iovec *iov, const char *buf, size_t buf_len)
+{
+    iov->iov_base = (void *)buf;
+    iov->iov_len = buf_len;
+}
+
+/* Maximum number of buffers of the header section in a single vectored write: the status line
+ * and essential headers, four for each additional header and the end of the header section */
+#define HTTPD_HDR_IOV_MAX (2 + 4 * CONFIG_HTTPD_MAX_IOV_RESP_HEADERS)
+
+/* Maximum number of buffers of the content passed to httpd_resp_send_iov() */
+#define HTTPD_BODY_IOV_MAX 3
+
+/* Sends the header section of the response if send_hdr is set, followed by body_count buffers of
+ * the content. The header section consists of the status line and essential headers, which must
+ * be in the scratch buffer, the additional headers and the end of the header section. Everything
+ * is sent in a single vectored write, unless there are more than CONFIG_HTTPD_MAX_IOV_RESP_HEADERS
+ * additional headers, so the buffers are kept in an array of fixed size on the stack. */
+static esp_err_t httpd_resp_send_iov(httpd_req_t *r, bool send_hdr, const struct iovec *body, int body_count)
+{
+    struct httpd_req_aux *ra = r->aux;
+    const char *colon_separator = ": ";
+    const char *cr_lf_seperator = "\r\n";
+    struct iovec iov[HTTPD_HDR_IOV_MAX + HTTPD_BODY_IOV_MAX];
+    int count = 0;
+
+    if (send_hdr) {
+        httpd_set_iov(&iov[count++], ra->scratch, strlen(ra->scratch));
+        for (unsigned i = 0; i < ra->resp_hdrs_count; i++) {
+            /* Send the headers described so far, if there is no room for this one and the end of the header section */
+            if (count + 4 > HTTPD_HDR_IOV_MAX - 1) {
+                if (httpd_send_all_iov(r, iov, count) != ESP_OK) {
+                    return ESP_FAIL;
+                }
+                count = 0;
+            }
+            httpd_set_iov(&iov[count++], ra->resp_hdrs[i].field, strlen(ra->resp_hdrs[i].field));
+            httpd_set_iov(&iov[count++], colon_separator, strlen(colon_separator));
+            httpd_set_iov(&iov[count++], ra->resp_hdrs[i].value, strlen(ra->resp_hdrs[i].value));
+            httpd_set_iov(&iov[count++], cr_lf_seperator, strlen(cr_lf_seperator));
+        }
+        httpd_set_iov(&iov[count++], cr_lf_seperator, strlen(cr_lf_seperator));
+    }
+    memcpy(&iov[count], body, body_count * sizeof(struct iovec));
+    count += body_count;
+    return httpd_send_all_iov(r, iov, count);
+}
+
 static size_t httpd_recv_pending(httpd_req_t *r, char *buf, size_t buf_len)
 {
     struct httpd_req_aux *ra = r->aux;
@@ -225,74 +326,73 @@ esp_err_t httpd_resp_set_type(httpd_req_t *r, const char *type)
     return ESP_OK;
 }
 
-esp_err_t httpd_resp_send(httpd_req_t *r, const char *buf, ssize_t buf_len)
+esp_err_t httpd_resp_send_hdr(httpd_req_t *r, size_t content_len, const char *buf, size_t buf_len)
 {
-    if (r == NULL) {
-        return ESP_ERR_INVALID_ARG;
-    }
-
-    if (!httpd_valid_req(r)) {
-        return ESP_ERR_HTTPD_INVALID_REQ;
-    }
-
     struct httpd_req_aux *ra = r->aux;
-    const char *httpd_hdr_str = "HTTP/1.1 %s\r\nContent-Type: %s\r\nContent-Length: %d\r\n";
-    const char *colon_separator = ": ";
-    const char *cr_lf_seperator = "\r\n";
-
-    if (buf_len == HTTPD_RESP_USE_STRLEN) {
-        buf_len = strlen(buf);
-    }
+    const char *httpd_hdr_str = "HTTP/1.1 %s\r\nContent-Type: %s\r\nContent-Length: %"NEWLIB_NANO_COMPAT_FORMAT"\r\n";
 
     /* Request headers are no longer available */
     ra->req_hdrs_count = 0;
 
+    /* A 304 response has no content, and a Content-Length would have to
+     * be that of the selected representation (RFC 9110 section 8.6) */
+    if (strncmp(ra->status, "304", 3) == 0) {
+        httpd_hdr_str = "HTTP/1.1 %s\r\nContent-Type: %s\r\n";
+        content_len = 0;
+        buf_len = 0;
+    }
+
     /* Size of essential headers is limited by scratch buffer size */
     if (snprintf(ra->scratch, sizeof(ra->scratch), httpd_hdr_str,
-                 ra->status, ra->content_type, buf_len) >= sizeof(ra->scratch)) {
+                 ra->status, ra->content_type, NEWLIB_NANO_COMPAT_CAST(content_len)) >= sizeof(ra->scratch)) {
         return ESP_ERR_HTTPD_RESP_HDR;
     }
 
-    /* Sending essential headers */
-    if (httpd_send_all(r, ra->scratch, strlen(ra->scratch)) != ESP_OK) {
+    /* Send the headers, including the additional ones based on set_header,
+     * and the content together. The number of additional headers is limited
+     * by max_resp_headers. */
+    struct iovec body;
+    httpd_set_iov(&body, buf, buf_len);
+    if (httpd_resp_send_iov(r, true, &body, (buf && buf_len) ? 1 : 0) != ESP_OK) {
+        return ESP_ERR_HTTPD_RESP_SEND;
+    }
+    /* Dispatched once the content passed along with the headers has been sent as well */
+    esp_http_server_dispatch_event(HTTP_SERVER_EVENT_HEADERS_SENT, &(ra->sd->fd), sizeof(int));
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_send_body(httpd_req_t *r, const char *buf, size_t buf_len)
+{
+    if (httpd_send_all(r, buf, buf_len) != ESP_OK) {
         return ESP_ERR_HTTPD_RESP_SEND;
     }
+    return ESP_OK;
+}
 
-    /* Sending additional headers based on set_header */
-    for (unsigned i = 0; i < ra->resp_hdrs_count; i++) {
-        /* Send header field */
-        if (httpd_send_all(r, ra->resp_hdrs[i].field, strlen(ra->resp_hdrs[i].field)) != ESP_OK) {
-            return ESP_ERR_HTTPD_RESP_SEND;
-        }
-        /* Send ': ' */
-        if (httpd_send_all(r, colon_separator, strlen(colon_separator)) != ESP_OK) {
-            return ESP_ERR_HTTPD_RESP_SEND;
-        }
-        /* Send header value */
-        if (httpd_send_all(r, ra->resp_hdrs[i].value, strlen(ra->resp_hdrs[i].value)) != ESP_OK) {
-            return ESP_ERR_HTTPD_RESP_SEND;
-        }
-        /* Send CR + LF */
-        if (httpd_send_all(r, cr_lf_seperator, strlen(cr_lf_seperator)) != ESP_OK) {
-            return ESP_ERR_HTTPD_RESP_SEND;
-        }
+esp_err_t httpd_resp_send(httpd_req_t *r, const char *buf, ssize_t buf_len)
+{
+    if (r == NULL) {
+        return ESP_ERR_INVALID_ARG;
     }
 
-    /* End header section */
-    if (httpd_send_all(r, cr_lf_seperator, strlen(cr_lf_seperator)) != ESP_OK) {
-        return ESP_ERR_HTTPD_RESP_SEND;
+    if (!httpd_valid_req(r)) {
+        return ESP_ERR_HTTPD_INVALID_REQ;
     }
-    esp_http_server_dispatch_event(HTTP_SERVER_EVENT_HEADERS_SENT, &(ra->sd->fd), sizeof(int));
 
-    /* Sending content */
-    if (buf && buf_len) {
-        if (httpd_send_all(r, buf, buf_len) != ESP_OK) {
-            return ESP_ERR_HTTPD_RESP_SEND;
-        }
+    if (buf_len == HTTPD_RESP_USE_STRLEN) {
+        buf_len = strlen(buf);
     }
+
+    esp_err_t ret = httpd_resp_send_hdr(r, buf_len, buf, buf_len);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    struct httpd_req_aux *ra = r->aux;
     esp_http_server_event_data evt_data = {
         .fd = ra->sd->fd,
-        .data_len = buf_len,
+        /* The content of a 304 response has been dropped */
+        .data_len = strncmp(ra->status, "304", 3) == 0 ? 0 : buf_len,
     };
     esp_http_server_dispatch_event(HTTP_SERVER_EVENT_SENT_DATA, &evt_data, sizeof(esp_http_server_event_data));
     return ESP_OK;
@@ -314,7 +414,6 @@ esp_err_t httpd_resp_send_chunk(httpd_req_t *r, const char *buf, ssize_t buf_len
 
     struct httpd_req_aux *ra = r->aux;
     const char *httpd_chunked_hdr_str = "HTTP/1.1 %s\r\nContent-Type: %s\r\nTransfer-Encoding: chunked\r\n";
-    const char *colon_separator = ": ";
     const char *cr_lf_seperator = "\r\n";
 
     /* Request headers are no longer available */
@@ -326,56 +425,27 @@ esp_err_t httpd_resp_send_chunk(httpd_req_t *r, const char *buf, ssize_t buf_len
                      ra->status, ra->content_type) >= sizeof(ra->scratch)) {
             return ESP_ERR_HTTPD_RESP_HDR;
         }
-
-        /* Sending essential headers */
-        if (httpd_send_all(r, ra->scratch, strlen(ra->scratch)) != ESP_OK) {
-            return ESP_ERR_HTTPD_RESP_SEND;
-        }
-
-        /* Sending additional headers based on set_header */
-        for (unsigned i = 0; i < ra->resp_hdrs_count; i++) {
-            /* Send header field */
-            if (httpd_send_all(r, ra->resp_hdrs[i].field, strlen(ra->resp_hdrs[i].field)) != ESP_OK) {
-                return ESP_ERR_HTTPD_RESP_SEND;
-            }
-            /* Send ': ' */
-            if (httpd_send_all(r, colon_separator, strlen(colon_separator)) != ESP_OK) {
-                return ESP_ERR_HTTPD_RESP_SEND;
-            }
-            /* Send header value */
-            if (httpd_send_all(r, ra->resp_hdrs[i].value, strlen(ra->resp_hdrs[i].value)) != ESP_OK) {
-                return ESP_ERR_HTTPD_RESP_SEND;
-            }
-            /* Send CR + LF */
-            if (httpd_send_all(r, cr_lf_seperator, strlen(cr_lf_seperator)) != ESP_OK) {
-                return ESP_ERR_HTTPD_RESP_SEND;
-            }
-        }
-
-        /* End header section */
-        if (httpd_send_all(r, cr_lf_seperator, strlen(cr_lf_seperator)) != ESP_OK) {
-            return ESP_ERR_HTTPD_RESP_SEND;
-        }
-        ra->first_chunk_sent = true;
     }
 
+    /* Headers (with the first chunk only), chunk size, chunk and end of chunk */
+    struct iovec iov[HTTPD_BODY_IOV_MAX];
+    int iov_count = 0;
+
     /* Sending chunked content */
     char len_str[10];
     snprintf(len_str, sizeof(len_str), "%lx\r\n", (long)buf_len);
-    if (httpd_send_all(r, len_str, strlen(len_str)) != ESP_OK) {
-        return ESP_ERR_HTTPD_RESP_SEND;
-    }
-
-    if (buf) {
-        if (httpd_send_all(r, buf, (size_t) buf_len) != ESP_OK) {
-            return ESP_ERR_HTTPD_RESP_SEND;
-        }
+    httpd_set_iov(&iov[iov_count++], len_str, strlen(len_str));
+    if (buf && buf_len) {
+        httpd_set_iov(&iov[iov_count++], buf, (size_t) buf_len);
     }
-
     /* Indicate end of chunk */
-    if (httpd_send_all(r, "\r\n", strlen("\r\n")) != ESP_OK) {
+    httpd_set_iov(&iov[iov_count++], cr_lf_seperator, strlen(cr_lf_seperator));
+
+    if (httpd_resp_send_iov(r, !ra->first_chunk_sent, iov, iov_count) != ESP_OK) {
         return ESP_ERR_HTTPD_RESP_SEND;
     }
+    ra->first_chunk_sent = true;
+
     esp_http_server_event_data evt_data = {
         .fd = ra->sd->fd,
         .data_len = buf_len,
@@ -650,6 +720,24 @@ int httpd_default_send(httpd_handle_t hd, int sockfd, const char *buf, size_t bu
     return ret;
 }
 
+int httpd_default_send_iov(httpd_handle_t hd, int sockfd, const struct iovec *iov, int iov_count, int flags)
+{
+    (void)hd;
+    if (iov == NULL) {
+        return HTTPD_SOCK_ERR_INVALID;
+    }
+
+    struct msghdr msg = {
+        .msg_iov = (struct iovec *)iov,
+        .msg_iovlen = iov_count,
+    };
+    int ret = sendmsg(sockfd, &msg, flags);
+    if (ret < 0) {
+        return httpd_sock_err("sendmsg", sockfd);
+    }
+    return ret;
+}
+
 int httpd_default_recv(httpd_handle_t hd, int sockfd, char *buf, size_t buf_len, int flags)
 {
     (void)hd;
@@ -1,5 +1,5 @@
 /*
- * SPDX-FileCopyrightText: 2018-2021 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2018-2023 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
@@ -21,6 +21,8 @@ static bool httpd_uri_match_simple(const char *uri1, const char *uri2, size_t le
         (strncmp(uri1, uri2, len2) == 0);   // Then match actual URIs
 }
 
+/* httpd_route_keys_wildcard() compiles the templates for the router
+ * following the same rules, both must be kept in sync */
 bool httpd_uri_match_wildcard(const char *template, const char *uri, size_t len)
 {
     const size_t tpl_len = strlen(template);
@@ -87,6 +89,13 @@ static httpd_uri_t* httpd_find_uri_handler(struct httpd_data *hd,
                                            httpd_method_t method,
                                            httpd_err_code_t *err)
 {
+#if CONFIG_HTTPD_URI_ROUTER
+    httpd_uri_t *found;
+    if (httpd_router_find(hd, uri, uri_len, method, &found, err)) {
+        return found;
+    }
+#endif
+
     if (err) {
         *err = HTTPD_404_NOT_FOUND;
     }
@@ -172,6 +181,13 @@ esp_err_t httpd_register_uri_handler(httpd_handle_t handle,
             } else {
                 hd->hd_calls[i]->supported_subprotocol = NULL;
             }
+#endif
+#if CONFIG_HTTPD_URI_ROUTER
+            /* The router is rebuilt with the handler rather than changed,
+             * as the lookups in progress may still use the previous one */
+            httpd_os_mutex_lock(&hd->hd_router_lock);
+            httpd_router_build(hd);
+            httpd_os_mutex_unlock(&hd->hd_router_lock);
 #endif
             ESP_LOGD(TAG, LOG_FMT("[%d] installed %s"), i, uri_handler->uri);
             return ESP_OK;
@@ -212,6 +228,11 @@ esp_err_t httpd_unregister_uri_handler(httpd_handle_t handle,
             }
             /* Nullify the following non null entry */
             hd->hd_calls[i-1] = NULL;
+#if CONFIG_HTTPD_URI_ROUTER
+            httpd_os_mutex_lock(&hd->hd_router_lock);
+            httpd_router_build(hd);
+            httpd_os_mutex_unlock(&hd->hd_router_lock);
+#endif
             return ESP_OK;
         }
     }
@@ -252,6 +273,13 @@ esp_err_t httpd_unregister_uri(httpd_handle_t handle, const char *uri)
     for (int k = (i - j); k < i; k++) {
         hd->hd_calls[k] = NULL;
     }
+#if CONFIG_HTTPD_URI_ROUTER
+    if (found) {
+        httpd_os_mutex_lock(&hd->hd_router_lock);
+        httpd_router_build(hd);
+        httpd_os_mutex_unlock(&hd->hd_router_lock);
+    }
+#endif
 
     if (!found) {
         ESP_LOGW(TAG, LOG_FMT("no handler found for URI %s"), uri);
@@ -261,6 +289,11 @@ esp_err_t httpd_unregister_uri(httpd_handle_t handle, const char *uri)
 
 void httpd_unregister_all_uri_handlers(struct httpd_data *hd)
 {
+#if CONFIG_HTTPD_URI_ROUTER
+    httpd_os_mutex_lock(&hd->hd_router_lock);
+    httpd_router_free(hd);
+    httpd_os_mutex_unlock(&hd->hd_router_lock);
+#endif
     for (unsigned i = 0; i < hd->config.max_uri_handlers; i++) {
         if (!hd->hd_calls[i]) {
             break;
@@ -325,7 +358,16 @@ esp_err_t httpd_uri(struct httpd_data *hd)
     }
 #endif
 
-    /* Invoke handler */
+    /* Hand the request over to a worker task, WebSocket handlers are kept
+     * in the server task as the frames of a socket must be handled in order */
+    if (hd->hd_workers
+#ifdef CONFIG_HTTPD_WS_SUPPORT
+            && !uri->is_websocket
+#endif
+            && httpd_workers_dispatch(hd, uri->handler) == ESP_OK) {
+        return ESP_OK;
+    }
+    /* Invoke handler, here if there are no workers or their queues are full */
     if (uri->handler(req) != ESP_OK) {
         /* Handler returns error, this socket should be closed */
         ESP_LOGW(TAG, LOG_FMT("uri handler execution failed"));
@@ -0,0 +1,386 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <esp_log.h>
+#include <esp_err.h>
+
+#include <esp_http_server.h>
+#include "esp_httpd_priv.h"
+
+static const char *TAG = "httpd_worker";
+
+/* A request handed to a worker. The request and its additional data are
+ * copies of those of the server, which receives the next requests of the
+ * other sessions while the worker runs the handler. */
+struct httpd_job {
+    struct httpd_job *next;             /* In the list of free or completed jobs */
+    esp_err_t (*handler)(httpd_req_t *r);
+    esp_err_t ret;                      /* Result of the handler and of the purge of the request */
+    struct sock_db *sd;                 /* Session of the request */
+    httpd_req_t req;
+    struct httpd_req_aux aux;
+    struct resp_hdr resp_hdrs[];        /* max_resp_headers additional headers of the response */
+};
+
+/* Each worker has a deque of jobs. The server pushes jobs at the back of the
+ * deques in turn, a worker takes the oldest job from the front of its deque,
+ * or when it is empty steals the newest job from the back of another deque. */
+struct httpd_worker {
+    struct thread_data td;
+    struct httpd_workers *workers;
+    omutex_t lock;
+    struct httpd_job **jobs;            /* Ring buffer of worker_queue_depth jobs */
+    uint16_t head;
+    uint16_t count;
+};
+
+struct httpd_workers {
+    struct httpd_data *hd;
+    uint16_t count;                     /* Number of workers */
+    uint16_t started;                   /* Number of workers whose task has been created */
+    uint16_t next;                      /* Worker which the next job is pushed to first */
+    bool stopping;
+    osem_t jobs_sem;                    /* Given for each job pushed */
+    omutex_t lock;                      /* Protects the lists of free and completed jobs */
+    struct httpd_job *free_jobs;
+    struct httpd_job *done_jobs;
+    bool done_wake_pending;             /* The server has been woken up to collect the completed jobs */
+    struct httpd_job *jobs_mem;
+    size_t job_size;
+    struct httpd_worker worker[];
+};
+
+static bool httpd_worker_push(struct httpd_worker *worker, struct httpd_job *job, uint16_t depth)
+{
+    bool pushed = false;
+    httpd_os_mutex_lock(&worker->lock);
+    if (worker->count < depth) {
+        worker->jobs[(worker->head + worker->count) % depth] = job;
+        worker->count++;
+        pushed = true;
+    }
+    httpd_os_mutex_unlock(&worker->lock);
+    return pushed;
+}
+
+static struct httpd_job *httpd_worker_pop_front(struct httpd_worker *worker, uint16_t depth)
+{
+    struct httpd_job *job = NULL;
+    httpd_os_mutex_lock(&worker->lock);
+    if (worker->count) {
+        job = worker->jobs[worker->head];
+        worker->head = (worker->head + 1) % depth;
+        worker->count--;
+    }
+    httpd_os_mutex_unlock(&worker->lock);
+    return job;
+}
+
+static struct httpd_job *httpd_worker_pop_back(struct httpd_worker *worker, uint16_t depth)
+{
+    struct httpd_job *job = NULL;
+    httpd_os_mutex_lock(&worker->lock);
+    if (worker->count) {
+        worker->count--;
+        job = worker->jobs[(worker->head + worker->count) % depth];
+    }
+    httpd_os_mutex_unlock(&worker->lock);
+    return job;
+}
+
+/* Takes a job, the caller must have taken jobs_sem so that there is one */
+static struct httpd_job *httpd_worker_take(struct httpd_worker *worker)
+{
+    struct httpd_workers *w = worker->workers;
+    uint16_t depth = w->hd->config.worker_queue_depth;
+    uint16_t index = worker - w->worker;
+
+    while (true) {
+        struct httpd_job *job = httpd_worker_pop_front(worker, depth);
+        /* Steal from the other workers, the job may be taken by another
+         * worker between the pushes, so try until one is found */
+        for (uint16_t i = 1; !job && i < w->count; i++) {
+            job = httpd_worker_pop_back(&w->worker[(index + i) % w->count], depth);
+        }
+        if (job) {
+            return job;
+        }
+    }
+}
+
+/* Runs on the server task, to collect the completed jobs */
+static void httpd_workers_collect_work(void *arg)
+{
+    httpd_workers_collect((struct httpd_data *)arg);
+}
+
+static void httpd_worker_run(struct httpd_workers *w, struct httpd_job *job)
+{
+    httpd_req_t *r = &job->req;
+
+    if (job->handler(r) != ESP_OK) {
+        /* Handler returns error, this socket should be closed */
+        ESP_LOGW(TAG, LOG_FMT("uri handler execution failed"));
+        httpd_req_cleanup(r);
+        job->ret = ESP_FAIL;
+    } else {
+        job->ret = httpd_req_finish(r);
+    }
+
+    /* Give the session back to the server */
+    httpd_os_mutex_lock(&w->lock);
+    job->next = w->done_jobs;
+    w->done_jobs = job;
+    bool wake = !w->done_wake_pending && !w->stopping;
+    w->done_wake_pending = true;
+    httpd_os_mutex_unlock(&w->lock);
+
+    if (wake && httpd_queue_work(w->hd, httpd_workers_collect_work, w->hd) != ESP_OK) {
+        /* The next completed job or control message wakes the server up */
+        httpd_os_mutex_lock(&w->lock);
+        w->done_wake_pending = false;
+        httpd_os_mutex_unlock(&w->lock);
+    }
+}
+
+static void httpd_worker_thread(void *arg)
+{
+    struct httpd_worker *worker = (struct httpd_worker *) arg;
+    struct httpd_workers *w = worker->workers;
+    worker->td.status = THREAD_RUNNING;
+
+    while (1) {
+        httpd_os_sem_take(&w->jobs_sem);
+        if (w->stopping) {
+            break;
+        }
+        httpd_worker_run(w, httpd_worker_take(worker));
+    }
+
+    worker->td.status = THREAD_STOPPED;
+    httpd_os_thread_delete();
+}
+
+static void httpd_workers_delete(struct httpd_workers *w)
+{
+    for (uint16_t i = 0; i < w->count; i++) {
+        if (w->worker[i].lock) {
+            httpd_os_mutex_delete(&w->worker[i].lock);
+        }
+        free(w->worker[i].jobs);
+    }
+    if (w->lock) {
+        httpd_os_mutex_delete(&w->lock);
+    }
+    if (w->jobs_sem) {
+        httpd_os_sem_delete(&w->jobs_sem);
+    }
+    free(w->jobs_mem);
+    free(w);
+}
+
+esp_err_t httpd_workers_start(struct httpd_data *hd)
+{
+    const httpd_config_t *config = &hd->config;
+    if (config->worker_count == 0) {
+        return ESP_OK;
+    }
+    if (config->worker_queue_depth == 0) {
+        ESP_LOGE(TAG, LOG_FMT("worker_queue_depth must not be 0"));
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    struct httpd_workers *w = calloc(1, sizeof(struct httpd_workers) +
+                                     config->worker_count * sizeof(struct httpd_worker));
+    if (!w) {
+        return ESP_ERR_HTTPD_ALLOC_MEM;
+    }
+    w->hd = hd;
+    w->count = config->worker_count;
+
+    /* Each worker may run a job while its deque is full */
+    size_t num_jobs = (size_t) config->worker_count * (config->worker_queue_depth + 1);
+    w->job_size = sizeof(struct httpd_job) + config->max_resp_headers * sizeof(struct resp_hdr);
+    w->jobs_mem = calloc(num_jobs, w->job_size);
+    if (!w->jobs_mem ||
+            httpd_os_mutex_create(&w->lock) != OS_SUCCESS ||
+            httpd_os_sem_create(&w->jobs_sem, num_jobs + config->worker_count) != OS_SUCCESS) {
+        ESP_LOGE(TAG, LOG_FMT("Failed to allocate memory for HTTP workers"));
+        httpd_workers_delete(w);
+        return ESP_ERR_HTTPD_ALLOC_MEM;
+    }
+    for (size_t i = 0; i < num_jobs; i++) {
+        struct httpd_job *job = (struct httpd_job *)((char *) w->jobs_mem + i * w->job_size);
+        job->next = w->free_jobs;
+        w->free_jobs = job;
+    }
+    for (uint16_t i = 0; i < w->count; i++) {
+        struct httpd_worker *worker = &w->worker[i];
+        worker->workers = w;
+        worker->jobs = calloc(config->worker_queue_depth, sizeof(struct httpd_job *));
+        if (!worker->jobs || httpd_os_mutex_create(&worker->lock) != OS_SUCCESS) {
+            ESP_LOGE(TAG, LOG_FMT("Failed to allocate memory for HTTP workers"));
+            httpd_workers_delete(w);
+            return ESP_ERR_HTTPD_ALLOC_MEM;
+        }
+    }
+
+    hd->hd_workers = w;
+    for (uint16_t i = 0; i < w->count; i++) {
+        if (httpd_os_thread_create(&w->worker[i].td.handle, "httpd_worker",
+                                   config->worker_stack_size,
+                                   config->worker_priority,
+                                   httpd_worker_thread, &w->worker[i],
+                                   config->worker_core_id) != OS_SUCCESS) {
+            ESP_LOGE(TAG, LOG_FMT("Failed to launch HTTP worker task"));
+            httpd_workers_stop(hd);
+            return ESP_ERR_HTTPD_TASK;
+        }
+        w->started++;
+    }
+    return ESP_OK;
+}
+
+void httpd_workers_stop(struct httpd_data *hd)
+{
+    struct httpd_workers *w = hd->hd_workers;
+    if (!w) {
+        return;
+    }
+
+    /* Wake all the workers up, those running a handler stop after it returns */
+    httpd_os_mutex_lock(&w->lock);
+    w->stopping = true;
+    httpd_os_mutex_unlock(&w->lock);
+    for (uint16_t i = 0; i < w->started; i++) {
+        httpd_os_sem_give(&w->jobs_sem);
+    }
+    for (uint16_t i = 0; i < w->started; i++) {
+        while (w->worker[i].td.status != THREAD_STOPPED) {
+            httpd_os_thread_sleep(10);
+        }
+    }
+
+    httpd_workers_collect(hd);
+
+    /* Give back the sessions of the jobs which haven't run */
+    for (uint16_t i = 0; i < w->count; i++) {
+        struct httpd_job *job;
+        while ((job = httpd_worker_pop_front(&w->worker[i], hd->config.worker_queue_depth)) != NULL) {
+            httpd_req_cleanup(&job->req);
+            job->sd->worker_req = NULL;
+        }
+    }
+
+    hd->hd_workers = NULL;
+    httpd_workers_delete(w);
+}
+
+esp_err_t httpd_workers_dispatch(struct httpd_data *hd, esp_err_t (*handler)(httpd_req_t *r))
+{
+    struct httpd_workers *w = hd->hd_workers;
+    if (!w) {
+        return ESP_FAIL;
+    }
+
+    httpd_os_mutex_lock(&w->lock);
+    struct httpd_job *job = w->free_jobs;
+    if (job) {
+        w->free_jobs = job->next;
+    }
+    httpd_os_mutex_unlock(&w->lock);
+    if (!job) {
+        return ESP_FAIL;
+    }
+
+    /* Copy the request, the worker may start running the handler as soon as it is pushed */
+    struct sock_db *sd = hd->hd_req_aux.sd;
+    job->handler = handler;
+    job->sd = sd;
+    memcpy(&job->req, &hd->hd_req, sizeof(httpd_req_t));
+    job->aux = hd->hd_req_aux;
+    memcpy(job->resp_hdrs, hd->hd_req_aux.resp_hdrs, hd->config.max_resp_headers * sizeof(struct resp_hdr));
+    job->aux.resp_hdrs = job->resp_hdrs;
+    job->req.aux = &job->aux;
+
+    /* The server doesn't read from the session until the worker gives it back */
+    sd->worker_req = &job->req;
+
+    for (uint16_t i = 0; i < w->count; i++) {
+        struct httpd_worker *worker = &w->worker[(w->next + i) % w->count];
+        if (httpd_worker_push(worker, job, hd->config.worker_queue_depth)) {
+            w->next = (w->next + i + 1) % w->count;
+            httpd_os_sem_give(&w->jobs_sem);
+            httpd_poll_remove(hd, sd);
+
+            /* The request now belongs to the worker */
+            hd->hd_req_aux.sd = NULL;
+            hd->hd_req.handle = NULL;
+            hd->hd_req.aux = NULL;
+            return ESP_OK;
+        }
+    }
+
+    /* All the deques are full */
+    sd->worker_req = NULL;
+    httpd_os_mutex_lock(&w->lock);
+    job->next = w->free_jobs;
+    w->free_jobs = job;
+    httpd_os_mutex_unlock(&w->lock);
+    return ESP_FAIL;
+}
+
+void httpd_workers_collect(struct httpd_data *hd)
+{
+    struct httpd_workers *w = hd->hd_workers;
+    if (!w) {
+        return;
+    }
+
+    httpd_os_mutex_lock(&w->lock);
+    struct httpd_job *job = w->done_jobs;
+    w->done_jobs = NULL;
+    w->done_wake_pending = false;
+    httpd_os_mutex_unlock(&w->lock);
+
+    while (job) {
+        struct httpd_job *next = job->next;
+        struct sock_db *sd = job->sd;
+        sd->worker_req = NULL;
+        if (job->ret != ESP_OK || sd->worker_close) {
+            httpd_sess_delete(hd, sd);
+        } else if (httpd_poll_add(hd, sd) != ESP_OK) {
+            httpd_sess_delete(hd, sd);
+        } else {
+            sd->lru_counter = ++hd->lru_counter;
+            if (httpd_sess_pending(hd, sd)) {
+                hd->hd_sess_pending = true;
+            }
+        }
+
+        httpd_os_mutex_lock(&w->lock);
+        job->next = w->free_jobs;
+        w->free_jobs = job;
+        httpd_os_mutex_unlock(&w->lock);
+        job = next;
+    }
+}
+
+bool httpd_workers_is_current(struct httpd_data *hd)
+{
+    struct httpd_workers *w = hd->hd_workers;
+    if (!w) {
+        return false;
+    }
+    othread_t current = httpd_os_thread_handle();
+    for (uint16_t i = 0; i < w->started; i++) {
+        if (w->worker[i].td.handle == current) {
+            return true;
+        }
+    }
+    return false;
+}
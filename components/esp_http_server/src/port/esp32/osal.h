@@ -1,5 +1,5 @@
 /*
- * SPDX-FileCopyrightText: 2018-2022 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2018-2023 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
@@ -9,6 +9,7 @@
 
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
+#include <freertos/semphr.h>
 #include <unistd.h>
 #include <stdint.h>
 #include <esp_timer.h>
@@ -50,6 +51,53 @@ static inline othread_t httpd_os_thread_handle(void)
     return xTaskGetCurrentTaskHandle();
 }
 
+typedef SemaphoreHandle_t omutex_t;
+
+static inline int httpd_os_mutex_create(omutex_t *mutex)
+{
+    *mutex = xSemaphoreCreateMutex();
+    return *mutex ? OS_SUCCESS : OS_FAIL;
+}
+
+static inline void httpd_os_mutex_lock(omutex_t *mutex)
+{
+    xSemaphoreTake(*mutex, portMAX_DELAY);
+}
+
+static inline void httpd_os_mutex_unlock(omutex_t *mutex)
+{
+    xSemaphoreGive(*mutex);
+}
+
+static inline void httpd_os_mutex_delete(omutex_t *mutex)
+{
+    vSemaphoreDelete(*mutex);
+}
+
+typedef SemaphoreHandle_t osem_t;
+
+static inline int httpd_os_sem_create(osem_t *sem, unsigned max_count)
+{
+    *sem = xSemaphoreCreateCounting(max_count, 0);
+    return *sem ? OS_SUCCESS : OS_FAIL;
+}
+
+/* Waits until the semaphore can be taken */
+static inline void httpd_os_sem_take(osem_t *sem)
+{
+    xSemaphoreTake(*sem, portMAX_DELAY);
+}
+
+static inline void httpd_os_sem_give(osem_t *sem)
+{
+    xSemaphoreGive(*sem);
+}
+
+static inline void httpd_os_sem_delete(osem_t *sem)
+{
+    vSemaphoreDelete(*sem);
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -8,6 +8,10 @@
 #include <unistd.h>
 #include <stdint.h>
 #include <pthread.h>
+#include <stdlib.h>
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
 
 #ifdef __cplusplus
 extern "C" {
@@ -50,6 +54,89 @@ static inline othread_t httpd_os_thread_handle(void)
     return (othread_t)pthread_self();
 }
 
+typedef pthread_mutex_t *omutex_t;
+
+static inline int httpd_os_mutex_create(omutex_t *mutex)
+{
+    *mutex = malloc(sizeof(pthread_mutex_t));
+    if (*mutex == NULL || pthread_mutex_init(*mutex, NULL) != 0) {
+        free(*mutex);
+        return OS_FAIL;
+    }
+    return OS_SUCCESS;
+}
+
+static inline void httpd_os_mutex_lock(omutex_t *mutex)
+{
+    pthread_mutex_lock(*mutex);
+}
+
+static inline void httpd_os_mutex_unlock(omutex_t *mutex)
+{
+    pthread_mutex_unlock(*mutex);
+}
+
+static inline void httpd_os_mutex_delete(omutex_t *mutex)
+{
+    pthread_mutex_destroy(*mutex);
+    free(*mutex);
+}
+
+/* Counting semaphore, unnamed POSIX semaphores aren't available on all hosts */
+typedef struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    unsigned count;
+} *osem_t;
+
+static inline int httpd_os_sem_create(osem_t *sem, unsigned max_count)
+{
+    (void)max_count;
+    *sem = calloc(1, sizeof(**sem));
+    if (*sem == NULL) {
+        return OS_FAIL;
+    }
+    pthread_mutex_init(&(*sem)->mutex, NULL);
+    pthread_cond_init(&(*sem)->cond, NULL);
+    return OS_SUCCESS;
+}
+
+/* Waits until the semaphore can be taken */
+static inline void httpd_os_sem_take(osem_t *sem)
+{
+    pthread_mutex_lock(&(*sem)->mutex);
+    while ((*sem)->count == 0) {
+        pthread_cond_wait(&(*sem)->cond, &(*sem)->mutex);
+    }
+    (*sem)->count--;
+    pthread_mutex_unlock(&(*sem)->mutex);
+}
+
+static inline void httpd_os_sem_give(osem_t *sem)
+{
+    pthread_mutex_lock(&(*sem)->mutex);
+    (*sem)->count++;
+    pthread_cond_signal(&(*sem)->cond);
+    pthread_mutex_unlock(&(*sem)->mutex);
+}
+
+static inline void httpd_os_sem_delete(osem_t *sem)
+{
+    pthread_cond_destroy(&(*sem)->cond);
+    pthread_mutex_destroy(&(*sem)->mutex);
+    free(*sem);
+}
+
+#ifdef __linux__
+/* The content of a file can be sent without being copied to the process */
+#define HTTPD_OS_SENDFILE 1
+
+static inline ssize_t httpd_os_sendfile(int sockfd, int fd, off_t *offset, size_t count)
+{
+    return sendfile(sockfd, fd, offset, count);
+}
+#endif
+
 #ifdef __cplusplus
 }
 #endif
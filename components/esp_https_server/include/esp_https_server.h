@@ -148,7 +148,12 @@ typedef struct httpd_ssl_config httpd_ssl_config_t;
         .keep_alive_count = 0,                    \
         .open_fn = NULL,                          \
         .close_fn = NULL,                         \
-        .uri_match_fn = NULL                      \
+        .uri_match_fn = NULL,                     \
+        .worker_count = 0,                        \
+        .worker_queue_depth = 4,                  \
+        .worker_priority = tskIDLE_PRIORITY+5,    \
+        .worker_stack_size = 10240,               \
+        .worker_core_id = tskNO_AFFINITY          \
     },                                            \
     .servercert = NULL,                           \
     .servercert_len = 0,                          \
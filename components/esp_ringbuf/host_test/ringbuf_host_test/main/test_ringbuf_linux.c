@@ -0,0 +1,431 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <inttypes.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "freertos/ringbuf.h"
+#include "unity.h"
+
+#define BUFFER_SIZE             512
+#define SMALL_ITEM_SIZE         32
+#define TIMEOUT_TICKS           10
+#define STRESS_NUM_ITEMS        5000
+#define STRESS_MAX_ITEM_SIZE    100
+#define BENCH_BUFFER_SIZE       4096
+#define BENCH_NUM_ITEMS         5000
+#define BENCH_HDR_SIZE          (sizeof(uint32_t) + sizeof(uint64_t))   //Sequence number and send timestamp
+
+static void fill_item(uint8_t *item, size_t size, uint32_t seed)
+{
+    for (size_t i = 0; i < size; i++) {
+        item[i] = (uint8_t)(seed + i);
+    }
+}
+
+static bool check_item(const uint8_t *item, size_t size, uint32_t seed)
+{
+    for (size_t i = 0; i < size; i++) {
+        if (item[i] != (uint8_t)(seed + i)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static uint64_t get_time_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+TEST_CASE("SPSC no-split buffer send, receive and wrap around", "[ringbuf][spsc]")
+{
+    uint8_t item[BUFFER_SIZE];
+    RingbufHandle_t handle = xRingbufferCreateWithFlags(BUFFER_SIZE, RINGBUF_TYPE_NOSPLIT, RINGBUF_FLAG_SPSC);
+    TEST_ASSERT_NOT_NULL(handle);
+    size_t max_item_size = xRingbufferGetMaxItemSize(handle);
+    TEST_ASSERT_EQUAL(max_item_size, xRingbufferGetCurFreeSize(handle));
+
+    //Varying item sizes (including zero) make the items wrap around at different offsets
+    for (uint32_t i = 0; i < 1000; i++) {
+        size_t size = (i * 7) % (max_item_size + 1);
+        fill_item(item, size, i);
+        TEST_ASSERT_EQUAL(pdTRUE, xRingbufferSend(handle, item, size, 0));
+        size_t item_size;
+        uint8_t *received = xRingbufferReceive(handle, &item_size, 0);
+        TEST_ASSERT_NOT_NULL(received);
+        TEST_ASSERT_EQUAL(size, item_size);
+        TEST_ASSERT_TRUE(check_item(received, item_size, i));
+        vRingbufferReturnItem(handle, received);
+    }
+    size_t item_size;
+    TEST_ASSERT_NULL(xRingbufferReceive(handle, &item_size, 0));
+    TEST_ASSERT_EQUAL(max_item_size, xRingbufferGetCurFreeSize(handle));
+    vRingbufferDelete(handle);
+}
+
+TEST_CASE("SPSC no-split buffer full, out of order return and timeouts", "[ringbuf][spsc]")
+{
+    uint8_t item[SMALL_ITEM_SIZE];
+    uint8_t *received[BUFFER_SIZE / SMALL_ITEM_SIZE];
+    RingbufHandle_t handle = xRingbufferCreateWithFlags(BUFFER_SIZE, RINGBUF_TYPE_NOSPLIT, RINGBUF_FLAG_SPSC);
+    TEST_ASSERT_NOT_NULL(handle);
+
+    //Fill the buffer
+    uint32_t num_items = 0;
+    fill_item(item, SMALL_ITEM_SIZE, num_items);
+    while (xRingbufferSend(handle, item, SMALL_ITEM_SIZE, 0) == pdTRUE) {
+        num_items++;
+        fill_item(item, SMALL_ITEM_SIZE, num_items);
+    }
+    TEST_ASSERT_GREATER_THAN(1, num_items);
+    TEST_ASSERT_LESS_THAN(SMALL_ITEM_SIZE, xRingbufferGetCurFreeSize(handle));
+
+    //Sending to a full buffer times out
+    TickType_t start = xTaskGetTickCount();
+    TEST_ASSERT_EQUAL(pdFALSE, xRingbufferSend(handle, item, SMALL_ITEM_SIZE, TIMEOUT_TICKS));
+    TEST_ASSERT_GREATER_OR_EQUAL(TIMEOUT_TICKS, xTaskGetTickCount() - start);
+
+    //Retrieve all items before returning any of them
+    for (uint32_t i = 0; i < num_items; i++) {
+        size_t item_size;
+        received[i] = xRingbufferReceive(handle, &item_size, 0);
+        TEST_ASSERT_NOT_NULL(received[i]);
+        TEST_ASSERT_EQUAL(SMALL_ITEM_SIZE, item_size);
+        TEST_ASSERT_TRUE(check_item(received[i], item_size, i));
+    }
+
+    //Receiving from an empty buffer times out
+    start = xTaskGetTickCount();
+    size_t item_size;
+    TEST_ASSERT_NULL(xRingbufferReceive(handle, &item_size, TIMEOUT_TICKS));
+    TEST_ASSERT_GREATER_OR_EQUAL(TIMEOUT_TICKS, xTaskGetTickCount() - start);
+
+    //Space is only freed once the oldest item has been returned
+    for (uint32_t i = num_items - 1; i > 0; i--) {
+        vRingbufferReturnItem(handle, received[i]);
+    }
+    TEST_ASSERT_EQUAL(pdFALSE, xRingbufferSend(handle, item, SMALL_ITEM_SIZE, 0));
+    vRingbufferReturnItem(handle, received[0]);
+    TEST_ASSERT_EQUAL(xRingbufferGetMaxItemSize(handle), xRingbufferGetCurFreeSize(handle));
+    TEST_ASSERT_EQUAL(pdTRUE, xRingbufferSend(handle, item, SMALL_ITEM_SIZE, 0));
+    vRingbufferDelete(handle);
+}
+
+TEST_CASE("SPSC no-split buffer reports the same items waiting as a regular buffer", "[ringbuf][spsc]")
+{
+    uint8_t item[BUFFER_SIZE];
+    RingbufHandle_t handles[2];
+    for (int spsc = 0; spsc < 2; spsc++) {
+        handles[spsc] = xRingbufferCreateWithFlags(BUFFER_SIZE, RINGBUF_TYPE_NOSPLIT, spsc ? RINGBUF_FLAG_SPSC : 0);
+        TEST_ASSERT_NOT_NULL(handles[spsc]);
+    }
+
+    //Odd item sizes make the buffers wrap around with dummy data and skipped space at the tail
+    for (uint32_t i = 0; i < 100; i++) {
+        size_t size = 1 + (i * 11) % (2 * SMALL_ITEM_SIZE);
+        fill_item(item, size, i);
+        uint32_t sent = 0;
+        while (xRingbufferSend(handles[0], item, size, 0) == pdTRUE) {
+            TEST_ASSERT_EQUAL(pdTRUE, xRingbufferSend(handles[1], item, size, 0));
+            sent++;
+        }
+        TEST_ASSERT_EQUAL(pdFALSE, xRingbufferSend(handles[1], item, size, 0));
+
+        //Items are counted until they are retrieved, not until they are returned
+        uint8_t *received[2];
+        UBaseType_t waiting[2];
+        for (uint32_t j = 0; j <= sent; j++) {
+            for (int spsc = 0; spsc < 2; spsc++) {
+                vRingbufferGetInfo(handles[spsc], NULL, NULL, NULL, NULL, &waiting[spsc]);
+            }
+            TEST_ASSERT_EQUAL(sent - j, waiting[0]);
+            TEST_ASSERT_EQUAL(waiting[0], waiting[1]);
+            if (j == sent) {
+                break;
+            }
+            for (int spsc = 0; spsc < 2; spsc++) {
+                size_t item_size;
+                received[spsc] = xRingbufferReceive(handles[spsc], &item_size, 0);
+                TEST_ASSERT_NOT_NULL(received[spsc]);
+                TEST_ASSERT_EQUAL(size, item_size);
+                vRingbufferReturnItem(handles[spsc], received[spsc]);
+            }
+        }
+    }
+    for (int spsc = 0; spsc < 2; spsc++) {
+        vRingbufferDelete(handles[spsc]);
+    }
+}
+
+TEST_CASE("SPSC byte buffer send, receive and wrap around", "[ringbuf][spsc]")
+{
+    uint8_t data[BUFFER_SIZE];
+    RingbufHandle_t handle = xRingbufferCreateWithFlags(BUFFER_SIZE, RINGBUF_TYPE_BYTEBUF, RINGBUF_FLAG_SPSC);
+    TEST_ASSERT_NOT_NULL(handle);
+
+    //Partial retrieval, only one retrieval can be outstanding
+    fill_item(data, 100, 0);
+    TEST_ASSERT_EQUAL(pdTRUE, xRingbufferSend(handle, data, 100, 0));
+    size_t size;
+    uint8_t *received = xRingbufferReceiveUpTo(handle, &size, 0, 40);
+    TEST_ASSERT_NOT_NULL(received);
+    TEST_ASSERT_EQUAL(40, size);
+    TEST_ASSERT_TRUE(check_item(received, size, 0));
+    TEST_ASSERT_NULL(xRingbufferReceive(handle, &size, 0));
+    vRingbufferReturnItem(handle, received);
+    received = xRingbufferReceive(handle, &size, 0);
+    TEST_ASSERT_NOT_NULL(received);
+    TEST_ASSERT_EQUAL(60, size);
+    TEST_ASSERT_TRUE(check_item(received, size, 40));
+    vRingbufferReturnItem(handle, received);
+
+    //Data wrapping around the end of the buffer is received in two pieces
+    uint32_t seed = 0;
+    for (uint32_t i = 0; i < 1000; i++) {
+        size_t len = 1 + (i * 13) % 200;
+        fill_item(data, len, seed);
+        TEST_ASSERT_EQUAL(pdTRUE, xRingbufferSend(handle, data, len, 0));
+        while (len > 0) {
+            received = xRingbufferReceive(handle, &size, 0);
+            TEST_ASSERT_NOT_NULL(received);
+            TEST_ASSERT_LESS_OR_EQUAL(len, size);
+            TEST_ASSERT_TRUE(check_item(received, size, seed));
+            vRingbufferReturnItem(handle, received);
+            seed += size;
+            len -= size;
+        }
+    }
+
+    //The whole buffer can be filled
+    TEST_ASSERT_EQUAL(BUFFER_SIZE, xRingbufferGetCurFreeSize(handle));
+    fill_item(data, BUFFER_SIZE, 0);
+    TEST_ASSERT_EQUAL(pdTRUE, xRingbufferSend(handle, data, BUFFER_SIZE, 0));
+    TEST_ASSERT_EQUAL(0, xRingbufferGetCurFreeSize(handle));
+    TEST_ASSERT_EQUAL(pdFALSE, xRingbufferSend(handle, data, 1, TIMEOUT_TICKS));
+    UBaseType_t waiting;
+    vRingbufferGetInfo(handle, NULL, NULL, NULL, NULL, &waiting);
+    TEST_ASSERT_EQUAL(BUFFER_SIZE, waiting);
+    vRingbufferDelete(handle);
+}
+
+TEST_CASE("SPSC ring buffer from ISR functions", "[ringbuf][spsc]")
+{
+    uint8_t item[SMALL_ITEM_SIZE];
+    RingbufHandle_t handle = xRingbufferCreateWithFlags(BUFFER_SIZE, RINGBUF_TYPE_NOSPLIT, RINGBUF_FLAG_SPSC);
+    TEST_ASSERT_NOT_NULL(handle);
+
+    BaseType_t task_woken = pdFALSE;
+    fill_item(item, SMALL_ITEM_SIZE, 1);
+    TEST_ASSERT_EQUAL(pdTRUE, xRingbufferSendFromISR(handle, item, SMALL_ITEM_SIZE, &task_woken));
+    size_t item_size;
+    uint8_t *received = xRingbufferReceiveFromISR(handle, &item_size);
+    TEST_ASSERT_NOT_NULL(received);
+    TEST_ASSERT_EQUAL(SMALL_ITEM_SIZE, item_size);
+    TEST_ASSERT_TRUE(check_item(received, item_size, 1));
+    TEST_ASSERT_NULL(xRingbufferReceiveFromISR(handle, &item_size));
+    vRingbufferReturnItemFromISR(handle, received, &task_woken);
+    TEST_ASSERT_EQUAL(pdFALSE, task_woken);
+    vRingbufferDelete(handle);
+}
+
+/* ------------------------------------ Producer/consumer tasks --------------------------------------
+ * The producer sends items starting with a sequence number and the time they were sent, followed by a
+ * pattern derived from the sequence number. The consumer checks the order and the contents of the items
+ * and accumulates the time it took for each item to be received. With byte buffers, the consumer
+ * reassembles the items from the pieces it receives.
+ */
+
+typedef struct {
+    RingbufHandle_t handle;
+    RingbufferType_t type;
+    size_t item_size;           //Fixed item size, or 0 to vary the item size between BENCH_HDR_SIZE and STRESS_MAX_ITEM_SIZE
+    uint32_t num_items;
+    uint32_t errors;
+    uint64_t latency_sum_ns;
+    SemaphoreHandle_t done;
+} pc_test_ctx_t;
+
+static size_t pc_item_size(const pc_test_ctx_t *ctx, uint32_t seq)
+{
+    if (ctx->item_size != 0) {
+        return ctx->item_size;
+    }
+    return BENCH_HDR_SIZE + (seq * 31) % (STRESS_MAX_ITEM_SIZE - BENCH_HDR_SIZE + 1);
+}
+
+static void producer_task(void *arg)
+{
+    pc_test_ctx_t *ctx = (pc_test_ctx_t *)arg;
+    uint8_t item[256];
+
+    for (uint32_t seq = 0; seq < ctx->num_items; seq++) {
+        size_t size = pc_item_size(ctx, seq);
+        fill_item(item + BENCH_HDR_SIZE, size - BENCH_HDR_SIZE, seq);
+        memcpy(item, &seq, sizeof(seq));
+        uint64_t now = get_time_ns();
+        memcpy(item + sizeof(seq), &now, sizeof(now));
+        if (xRingbufferSend(ctx->handle, item, size, portMAX_DELAY) != pdTRUE) {
+            ctx->errors++;
+        }
+    }
+    xSemaphoreGive(ctx->done);
+    vTaskDelete(NULL);
+}
+
+static void consumer_task(void *arg)
+{
+    pc_test_ctx_t *ctx = (pc_test_ctx_t *)arg;
+    uint8_t item[256];
+
+    for (uint32_t seq = 0; seq < ctx->num_items; seq++) {
+        size_t size = pc_item_size(ctx, seq);
+        size_t received_size;
+        uint8_t *received;
+        if (ctx->type == RINGBUF_TYPE_BYTEBUF) {
+            for (size_t len = 0; len < size; len += received_size) {
+                received = xRingbufferReceiveUpTo(ctx->handle, &received_size, portMAX_DELAY, size - len);
+                memcpy(item + len, received, received_size);
+                vRingbufferReturnItem(ctx->handle, received);
+            }
+        } else {
+            received = xRingbufferReceive(ctx->handle, &received_size, portMAX_DELAY);
+            if (received_size != size) {
+                ctx->errors++;
+                received_size = 0;
+            }
+            memcpy(item, received, received_size);
+            vRingbufferReturnItem(ctx->handle, received);
+        }
+        uint64_t now = get_time_ns();
+
+        uint32_t received_seq;
+        uint64_t sent_time;
+        memcpy(&received_seq, item, sizeof(received_seq));
+        memcpy(&sent_time, item + sizeof(received_seq), sizeof(sent_time));
+        if (received_seq != seq || !check_item(item + BENCH_HDR_SIZE, size - BENCH_HDR_SIZE, seq)) {
+            ctx->errors++;
+        }
+        ctx->latency_sum_ns += now - sent_time;
+    }
+    xSemaphoreGive(ctx->done);
+    vTaskDelete(NULL);
+}
+
+/*
+ * Runs a producer and a consumer task until all items are transferred. Returns the elapsed time in ns.
+ * The consumer has the higher priority, so it blocks on the empty buffer and is woken up for every item.
+ */
+static uint64_t run_producer_consumer(pc_test_ctx_t *ctx)
+{
+    UBaseType_t priority = uxTaskPriorityGet(NULL) + 1;
+    ctx->errors = 0;
+    ctx->latency_sum_ns = 0;
+    ctx->done = xSemaphoreCreateCounting(2, 0);
+    TEST_ASSERT_NOT_NULL(ctx->done);
+
+    uint64_t start = get_time_ns();
+    TEST_ASSERT_EQUAL(pdPASS, xTaskCreate(consumer_task, "consumer", 4096, ctx, priority + 1, NULL));
+    TEST_ASSERT_EQUAL(pdPASS, xTaskCreate(producer_task, "producer", 4096, ctx, priority, NULL));
+    for (int i = 0; i < 2; i++) {
+        TEST_ASSERT_EQUAL(pdTRUE, xSemaphoreTake(ctx->done, portMAX_DELAY));
+    }
+    uint64_t elapsed = get_time_ns() - start;
+
+    vSemaphoreDelete(ctx->done);
+    vTaskDelay(1);  //Let the idle task clean up the deleted tasks
+    return elapsed;
+}
+
+TEST_CASE("SPSC ring buffer producer and consumer tasks", "[ringbuf][spsc]")
+{
+    const RingbufferType_t types[] = {RINGBUF_TYPE_NOSPLIT, RINGBUF_TYPE_BYTEBUF};
+
+    for (int i = 0; i < sizeof(types) / sizeof(types[0]); i++) {
+        pc_test_ctx_t ctx = {
+            .handle = xRingbufferCreateWithFlags(BUFFER_SIZE, types[i], RINGBUF_FLAG_SPSC),
+            .type = types[i],
+            .item_size = 0,
+            .num_items = STRESS_NUM_ITEMS,
+        };
+        TEST_ASSERT_NOT_NULL(ctx.handle);
+        run_producer_consumer(&ctx);
+        TEST_ASSERT_EQUAL(0, ctx.errors);
+        vRingbufferDelete(ctx.handle);
+    }
+}
+
+//Sends, receives and returns items in a single task, i.e., without ever blocking. Returns the average time in ns
+static double run_single_task(RingbufHandle_t handle, RingbufferType_t type, size_t item_size)
+{
+    uint8_t item[256];
+    fill_item(item, item_size, 0);
+
+    uint64_t start = get_time_ns();
+    for (uint32_t i = 0; i < BENCH_NUM_ITEMS; i++) {
+        TEST_ASSERT_EQUAL(pdTRUE, xRingbufferSend(handle, item, item_size, 0));
+        size_t received_size;
+        void *received;
+        if (type == RINGBUF_TYPE_BYTEBUF) {
+            for (size_t len = 0; len < item_size; len += received_size) {
+                received = xRingbufferReceiveUpTo(handle, &received_size, 0, item_size - len);
+                TEST_ASSERT_NOT_NULL(received);
+                vRingbufferReturnItem(handle, received);
+            }
+        } else {
+            received = xRingbufferReceive(handle, &received_size, 0);
+            TEST_ASSERT_NOT_NULL(received);
+            vRingbufferReturnItem(handle, received);
+        }
+    }
+    return (double)(get_time_ns() - start) / BENCH_NUM_ITEMS;
+}
+
+TEST_CASE("SPSC ring buffer throughput and latency", "[ringbuf][spsc][benchmark]")
+{
+    const RingbufferType_t types[] = {RINGBUF_TYPE_NOSPLIT, RINGBUF_TYPE_BYTEBUF};
+    const char *type_names[] = {"no-split", "byte buf"};
+    const size_t item_sizes[] = {16, 64, 256};
+
+    //Each column pair shows the default ring buffer, then the single-producer single-consumer one
+    printf("%-9s %5s  %19s  %21s  %21s\n", "type", "size", "round trip ns", "items/s", "latency us");
+    for (int i = 0; i < sizeof(types) / sizeof(types[0]); i++) {
+        for (int j = 0; j < sizeof(item_sizes) / sizeof(item_sizes[0]); j++) {
+            double round_trip_ns[2];
+            double items_per_s[2];
+            double latency_us[2];
+            for (int spsc = 0; spsc < 2; spsc++) {
+                pc_test_ctx_t ctx = {
+                    .handle = xRingbufferCreateWithFlags(BENCH_BUFFER_SIZE, types[i], spsc ? RINGBUF_FLAG_SPSC : 0),
+                    .type = types[i],
+                    .item_size = item_sizes[j],
+                    .num_items = BENCH_NUM_ITEMS,
+                };
+                TEST_ASSERT_NOT_NULL(ctx.handle);
+                round_trip_ns[spsc] = run_single_task(ctx.handle, types[i], item_sizes[j]);
+                uint64_t elapsed = run_producer_consumer(&ctx);
+                TEST_ASSERT_EQUAL(0, ctx.errors);
+                items_per_s[spsc] = (double)BENCH_NUM_ITEMS * 1e9 / elapsed;
+                latency_us[spsc] = (double)ctx.latency_sum_ns / BENCH_NUM_ITEMS / 1000;
+                vRingbufferDelete(ctx.handle);
+            }
+            printf("%-9s %5zu  %9.0f %9.0f  %10.0f %10.0f  %10.1f %10.1f\n", type_names[i], item_sizes[j],
+                   round_trip_ns[0], round_trip_ns[1], items_per_s[0], items_per_s[1], latency_us[0], latency_us[1]);
+        }
+    }
+}
+
+void app_main(void)
+{
+    printf("Running esp_ringbuf linux host test app");
+    unity_run_menu();
+}
@@ -44,6 +44,22 @@ typedef enum {
     RINGBUF_TYPE_MAX,
 } RingbufferType_t;
 
+/**
+ * @brief Flag for xRingbufferCreateWithFlags() and xRingbufferCreateStaticWithFlags()
+ *
+ * Single-producer single-consumer ring buffer. Items are only ever sent by one
+ * task (or ISR) and only ever received and returned by one other task (or
+ * ISR). Sending, receiving and returning then do not enter a critical section,
+ * the producer and the consumer only exchange their positions in the buffer
+ * through atomic loads and stores. A critical section is only entered to block
+ * or to wake up a blocked task, i.e., when the buffer runs empty or full.
+ *
+ * Only supported for no-split ring buffers and byte buffers. Such ring buffers
+ * cannot be used with xRingbufferSendAcquire(), xRingbufferSendBatch(),
+ * xRingbufferReceiveBatch() or queue sets.
+ */
+#define RINGBUF_FLAG_SPSC   ( ( UBaseType_t ) 1 )
+
 /**
  * @brief Struct that is equivalent in size to the ring buffer's data structure
  *
@@ -62,9 +78,24 @@ typedef struct xSTATIC_RINGBUFFER {
     StaticList_t xDummy5[2];
     void * pvDummy6;
     portMUX_TYPE muxDummy;
+    size_t xDummy7[5];
+    BaseType_t xDummy8[2];
     /** @endcond */
 } StaticRingbuffer_t;
 
+/**
+ * @brief Describes one item moved by xRingbufferSendBatch() or xRingbufferReceiveBatch()
+ *
+ * An array of these structs is used like an iovec array, each element pointing
+ * to the data of one item.
+ */
+typedef struct {
+    void *pvItem;           /**< Pointer to the data of the item */
+    size_t xItemSize;       /**< Size of the data of the item in bytes */
+    BaseType_t xIsSplit;    /**< Set by xRingbufferReceiveBatch() to pdTRUE if this element is the first part of
+                                 a split item and the next element holds its second part. Ignored when sending. */
+} RingbufferItem_t;
+
 /**
  * @brief       Create a ring buffer
  *
@@ -111,6 +142,45 @@ RingbufHandle_t xRingbufferCreateStatic(size_t xBufferSize,
                                         uint8_t *pucRingbufferStorage,
                                         StaticRingbuffer_t *pxStaticRingbuffer);
 
+/**
+ * @brief       Create a ring buffer with additional flags
+ *
+ * This API is similar to xRingbufferCreate(), but allows to select additional
+ * properties of the ring buffer.
+ *
+ * @param[in]   xBufferSize Size of the buffer in bytes. Note that items require
+ *              space for a header in no-split/allow-split buffers
+ * @param[in]   xBufferType Type of ring buffer, see documentation.
+ * @param[in]   uxFlags     Bitwise OR of RINGBUF_FLAG_* values, or 0
+ *
+ * @return  A handle to the created ring buffer, or NULL in case of error.
+ */
+RingbufHandle_t xRingbufferCreateWithFlags(size_t xBufferSize, RingbufferType_t xBufferType, UBaseType_t uxFlags);
+
+/**
+ * @brief       Create a ring buffer with additional flags but manually provide the required memory
+ *
+ * This API is similar to xRingbufferCreateStatic(), but allows to select
+ * additional properties of the ring buffer.
+ *
+ * @param[in]   xBufferSize Size of the buffer in bytes.
+ * @param[in]   xBufferType Type of ring buffer, see documentation
+ * @param[in]   uxFlags     Bitwise OR of RINGBUF_FLAG_* values, or 0
+ * @param[in]   pucRingbufferStorage Pointer to the ring buffer's storage area.
+ *              Storage area must have the same size as specified by xBufferSize
+ * @param[in]   pxStaticRingbuffer Pointed to a struct of type StaticRingbuffer_t
+ *              which will be used to hold the ring buffer's data structure
+ *
+ * @note    xBufferSize of no-split/allow-split buffers MUST be 32-bit aligned.
+ *
+ * @return  A handle to the created ring buffer
+ */
+RingbufHandle_t xRingbufferCreateStaticWithFlags(size_t xBufferSize,
+                                                 RingbufferType_t xBufferType,
+                                                 UBaseType_t uxFlags,
+                                                 uint8_t *pucRingbufferStorage,
+                                                 StaticRingbuffer_t *pxStaticRingbuffer);
+
 /**
  * @brief       Insert an item into the ring buffer
  *
@@ -363,6 +433,63 @@ void *xRingbufferReceiveUpTo(RingbufHandle_t xRingbuffer,
  */
 void *xRingbufferReceiveUpToFromISR(RingbufHandle_t xRingbuffer, size_t *pxItemSize, size_t xMaxSize);
 
+/**
+ * @brief   Insert multiple items into the ring buffer
+ *
+ * Attempt to insert the items described by pxItems into the ring buffer in
+ * order. This function will block until the first item fits or until it times
+ * out. Once the first item fits, the first item and all following items which
+ * fit at that moment are copied under a single critical section. Up to one
+ * blocked receiver per inserted item is then woken up, within that same
+ * critical section.
+ *
+ * @param[in]   xRingbuffer     Ring buffer to insert the items into
+ * @param[in]   pxItems         Array of items to insert. The xIsSplit members are ignored.
+ * @param[in]   uxNumItems      Number of elements in pxItems
+ * @param[in]   xTicksToWait    Ticks to wait for room for the first item in the ring buffer.
+ *
+ * @note    Items are inserted in order and the batch stops at the first item that
+ *          does not fit, so the items which have not been inserted are always
+ *          pxItems[return value] to pxItems[uxNumItems - 1].
+ * @note    The same size rules as for xRingbufferSend() apply to every item. On
+ *          byte buffers, the items are appended to the stream of bytes one after
+ *          another.
+ *
+ * @return  Number of items inserted. 0 on time-out or when the first item is
+ *          larger than the maximum permissible size of the buffer.
+ */
+UBaseType_t xRingbufferSendBatch(RingbufHandle_t xRingbuffer,
+                                 const RingbufferItem_t *pxItems,
+                                 UBaseType_t uxNumItems,
+                                 TickType_t xTicksToWait);
+
+/**
+ * @brief   Retrieve multiple items from a no-split/allow-split ring buffer
+ *
+ * Attempt to retrieve up to uxMaxItems items from the ring buffer. This function
+ * will block until an item is available or until it times out. Once an item is
+ * available, all items available at that moment (up to uxMaxItems) are
+ * retrieved under a single critical section.
+ *
+ * @param[in]   xRingbuffer     Ring buffer to retrieve the items from
+ * @param[out]  pxItems         Array to which the retrieved items will be written
+ * @param[in]   uxMaxItems      Number of elements in pxItems
+ * @param[in]   xTicksToWait    Ticks to wait for items in the ring buffer.
+ *
+ * @note    Every element written to pxItems must be returned with
+ *          vRingbufferReturnItem() or vRingbufferReturnItemBatch().
+ * @note    On allow-split buffers, a split item takes two elements. The first
+ *          one has xIsSplit set to pdTRUE. A split item is only retrieved if
+ *          both of its parts fit into pxItems, so uxMaxItems should be at least 2.
+ * @note    This function should not be called on byte buffers
+ *
+ * @return  Number of elements written to pxItems. 0 on time-out.
+ */
+UBaseType_t xRingbufferReceiveBatch(RingbufHandle_t xRingbuffer,
+                                    RingbufferItem_t *pxItems,
+                                    UBaseType_t uxMaxItems,
+                                    TickType_t xTicksToWait);
+
 /**
  * @brief   Return a previously-retrieved item to the ring buffer
  *
@@ -385,6 +512,19 @@ void vRingbufferReturnItem(RingbufHandle_t xRingbuffer, void *pvItem);
  */
 void vRingbufferReturnItemFromISR(RingbufHandle_t xRingbuffer, void *pvItem, BaseType_t *pxHigherPriorityTaskWoken);
 
+/**
+ * @brief   Return multiple previously-retrieved items to the ring buffer
+ *
+ * Returns all the items under a single critical section.
+ *
+ * @param[in]   xRingbuffer Ring buffer the items were retrieved from
+ * @param[in]   pxItems     Items that were received earlier, e.g. by xRingbufferReceiveBatch()
+ * @param[in]   uxNumItems  Number of elements in pxItems
+ *
+ * @note    Both parts of a split item have to be returned
+ */
+void vRingbufferReturnItemBatch(RingbufHandle_t xRingbuffer, const RingbufferItem_t *pxItems, UBaseType_t uxNumItems);
+
 /**
  * @brief   Delete a ring buffer
  *
@@ -498,6 +638,9 @@ BaseType_t xRingbufferRemoveFromQueueSetRead(RingbufHandle_t xRingbuffer, QueueS
  * @param[out]  uxWrite         Pointer use to store write pointer position
  * @param[out]  uxAcquire       Pointer use to store acquire pointer position
  * @param[out]  uxItemsWaiting  Pointer use to store number of items (bytes for byte buffer) waiting to be retrieved
+ *
+ * @note    For RINGBUF_FLAG_SPSC ring buffers, uxItemsWaiting is the number of bytes waiting to be
+ *          retrieved, including item headers.
  */
 void vRingbufferGetInfo(RingbufHandle_t xRingbuffer,
                         UBaseType_t *uxFree,
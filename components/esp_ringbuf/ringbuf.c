@@ -27,6 +27,7 @@
 #define rbBUFFER_FULL_FLAG          ( ( UBaseType_t ) 4 )   //The ring buffer is currently full (write pointer == free pointer)
 #define rbBUFFER_STATIC_FLAG        ( ( UBaseType_t ) 8 )   //The ring buffer is statically allocated
 #define rbUSING_QUEUE_SET           ( ( UBaseType_t ) 16 )  //The ring buffer has been added to a queue set
+#define rbSPSC_FLAG                 ( ( UBaseType_t ) 32 )  //The ring buffer is a single-producer single-consumer ring buffer
 
 //Item flags
 #define rbITEM_FREE_FLAG            ( ( UBaseType_t ) 1 )   //Item has been retrieved and returned by application, free to overwrite
@@ -73,6 +74,19 @@ typedef struct RingbufferDefinition {
     QueueSetHandle_t xQueueSet;                 //Ring buffer's read queue set handle.
 
     portMUX_TYPE mux;                           //Spinlock required for SMP
+
+    /*
+     * Only used by single-producer single-consumer ring buffers. Instead of the flags and pointers shared by the
+     * producer and the consumer, each of them publishes how far it got with a running count of bytes that only it
+     * writes. pucAcquire/pucWrite belong to the producer, pucRead/pucFree to the consumer.
+     */
+    size_t xSpscWritten;                        //Bytes (including headers and dummy data) sent by the producer
+    size_t xSpscRead;                           //Bytes retrieved by the consumer
+    size_t xSpscFreed;                          //Bytes returned by the consumer
+    size_t xSpscItemsSent;                      //Items sent by the producer (no-split buffers only)
+    size_t xSpscItemsRead;                      //Items retrieved by the consumer (no-split buffers only)
+    BaseType_t xSpscSenderWaiting;              //The producer is blocked (or about to block) waiting for free space
+    BaseType_t xSpscReceiverWaiting;            //The consumer is blocked (or about to block) waiting for data
 } Ringbuffer_t;
 
 _Static_assert(sizeof(StaticRingbuffer_t) == sizeof(Ringbuffer_t), "StaticRingbuffer_t != Ringbuffer_t");
@@ -88,6 +102,7 @@ _Static_assert(sizeof(StaticRingbuffer_t) == sizeof(Ringbuffer_t), "StaticRingbu
 //Initialize a ring buffer after space has been allocated for it
 static void prvInitializeNewRingbuffer(size_t xBufferSize,
                                        RingbufferType_t xBufferType,
+                                       UBaseType_t uxFlags,
                                        Ringbuffer_t *pxNewRingbuffer,
                                        uint8_t *pucRingbufferStorage);
 
@@ -128,6 +143,9 @@ static void prvCopyItemAllowSplit(Ringbuffer_t *pxRingbuffer, const uint8_t *puc
 //Copies an item to a byte buffer. Only call this function  after calling prvCheckItemFitsByteBuffer()
 static void prvCopyItemByteBuf(Ringbuffer_t *pxRingbuffer, const uint8_t *pucItem, size_t xItemSize);
 
+//Copies items in order until one does not fit or is too large. Returns the number of items copied
+static UBaseType_t prvCopyItemBatch(Ringbuffer_t *pxRingbuffer, const RingbufferItem_t *pxItems, UBaseType_t uxNumItems);
+
 //Retrieve item from no-split/allow-split ring buffer. *pxIsSplit is set to pdTRUE if the retrieved item is split
 /*
 Entry:
@@ -157,6 +175,17 @@ Exit:
 */
 static void prvReturnItemDefault(Ringbuffer_t *pxRingbuffer, uint8_t *pucItem);
 
+/*
+Retrieve up to uxMaxItems items from a no-split/allow-split ring buffer
+Entry:
+    - Must have already guaranteed that there is an item available for retrieval by calling prvCheckItemAvail()
+Exit:
+    - Both parts of a split item are retrieved, the first part is marked with xIsSplit
+    - A split item is left in the buffer if both parts do not fit into pxItems
+    - Returns the number of elements written to pxItems
+*/
+static UBaseType_t prvGetItemBatch(Ringbuffer_t *pxRingbuffer, RingbufferItem_t *pxItems, UBaseType_t uxMaxItems);
+
 //Return data to a byte buffer
 static void prvReturnItemByteBuf(Ringbuffer_t *pxRingbuffer, uint8_t *pucItem);
 
@@ -202,10 +231,42 @@ static BaseType_t prvReceiveGenericFromISR(Ringbuffer_t *pxRingbuffer,
                                            size_t *xItemSize2,
                                            size_t xMaxSize);
 
+/*
+ * The following functions implement single-producer single-consumer ring buffers.
+ * They ARE thread safe as long as prvSpscCopyItem() is only called by the producer
+ * and prvSpscGetItem()/prvSpscReturnItem() are only called by the consumer. A
+ * critical section is only needed to block or to wake up a blocked task.
+ */
+
+//Copies an item to a no-split ring buffer or a byte buffer if it fits. Returns pdFALSE if there is not enough free space
+static BaseType_t prvSpscCopyItem(Ringbuffer_t *pxRingbuffer, const uint8_t *pucItem, size_t xItemSize);
+
+//Retrieves an item/data if available. xMaxSize only takes effect on byte buffers. Returns NULL if nothing is available
+static void *prvSpscGetItem(Ringbuffer_t *pxRingbuffer, size_t xMaxSize, size_t *pxItemSize);
+
+//Returns an item/data retrieved by prvSpscGetItem()
+static void prvSpscReturnItem(Ringbuffer_t *pxRingbuffer, uint8_t *pucItem);
+
+//Wake up the consumer if it is blocked and the producer has just made the buffer non-empty
+static void prvSpscWakeReceiver(Ringbuffer_t *pxRingbuffer, size_t xOldWritten, BaseType_t xFromISR, BaseType_t *pxHigherPriorityTaskWoken);
+
+//Wake up the producer if it is blocked, i.e., the consumer has just freed space in a buffer that was too full
+static void prvSpscWakeSender(Ringbuffer_t *pxRingbuffer, BaseType_t xFromISR, BaseType_t *pxHigherPriorityTaskWoken);
+
+//Get the maximum size an item that can currently have if sent to a single-producer single-consumer ring buffer
+static size_t prvSpscGetCurMaxSize(Ringbuffer_t *pxRingbuffer);
+
+//Blocking send for single-producer single-consumer ring buffers
+static BaseType_t prvSpscSend(Ringbuffer_t *pxRingbuffer, const void *pvItem, size_t xItemSize, TickType_t xTicksToWait);
+
+//Blocking receive for single-producer single-consumer ring buffers
+static void *prvSpscReceive(Ringbuffer_t *pxRingbuffer, size_t *pxItemSize, size_t xMaxSize, TickType_t xTicksToWait);
+
 // ------------------------------------------------ Static Functions ---------------------------------------------------
 
 static void prvInitializeNewRingbuffer(size_t xBufferSize,
                                        RingbufferType_t xBufferType,
+                                       UBaseType_t uxFlags,
                                        Ringbuffer_t *pxNewRingbuffer,
                                        uint8_t *pucRingbufferStorage)
 {
@@ -256,13 +317,27 @@ static void prvInitializeNewRingbuffer(size_t xBufferSize,
     vListInitialise(&pxNewRingbuffer->xTasksWaitingToReceive);
     pxNewRingbuffer->xQueueSet = NULL;
 
+    if (uxFlags & RINGBUF_FLAG_SPSC) {
+        pxNewRingbuffer->uxRingbufferFlags |= rbSPSC_FLAG;
+    }
+    pxNewRingbuffer->xSpscWritten = 0;
+    pxNewRingbuffer->xSpscRead = 0;
+    pxNewRingbuffer->xSpscFreed = 0;
+    pxNewRingbuffer->xSpscItemsSent = 0;
+    pxNewRingbuffer->xSpscItemsRead = 0;
+    pxNewRingbuffer->xSpscSenderWaiting = pdFALSE;
+    pxNewRingbuffer->xSpscReceiverWaiting = pdFALSE;
+
     portMUX_INITIALIZE(&pxNewRingbuffer->mux);
 }
 
 static size_t prvGetFreeSize(Ringbuffer_t *pxRingbuffer)
 {
     size_t xReturn;
-    if (pxRingbuffer->uxRingbufferFlags & rbBUFFER_FULL_FLAG) {
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        //Single-producer single-consumer ring buffers don't maintain the full flag
+        xReturn = pxRingbuffer->xSize - (pxRingbuffer->xSpscWritten - pxRingbuffer->xSpscFreed);
+    } else if (pxRingbuffer->uxRingbufferFlags & rbBUFFER_FULL_FLAG) {
         xReturn =  0;
     } else {
         BaseType_t xFreeSize = pxRingbuffer->pucFree - pxRingbuffer->pucAcquire;
@@ -500,6 +575,26 @@ static void prvCopyItemByteBuf(Ringbuffer_t *pxRingbuffer, const uint8_t *pucIte
     pxRingbuffer->pucWrite = pxRingbuffer->pucAcquire;
 }
 
+static UBaseType_t prvCopyItemBatch(Ringbuffer_t *pxRingbuffer, const RingbufferItem_t *pxItems, UBaseType_t uxNumItems)
+{
+    UBaseType_t uxCopied;
+    for (uxCopied = 0; uxCopied < uxNumItems; uxCopied++) {
+        const RingbufferItem_t *pxItem = &pxItems[uxCopied];
+        configASSERT(pxItem->pvItem != NULL || pxItem->xItemSize == 0);
+        if (pxItem->xItemSize > pxRingbuffer->xMaxItemSize) {
+            break;      //Item will never fit, leave it to the caller
+        }
+        if ((pxRingbuffer->uxRingbufferFlags & rbBYTE_BUFFER_FLAG) && pxItem->xItemSize == 0) {
+            continue;   //Sending 0 bytes to byte buffer has no effect
+        }
+        if (pxRingbuffer->xCheckItemFits(pxRingbuffer, pxItem->xItemSize) == pdFALSE) {
+            break;
+        }
+        pxRingbuffer->vCopyItem(pxRingbuffer, pxItem->pvItem, pxItem->xItemSize);
+    }
+    return uxCopied;
+}
+
 static BaseType_t prvCheckItemAvail(Ringbuffer_t *pxRingbuffer)
 {
     if ((pxRingbuffer->uxRingbufferFlags & rbBYTE_BUFFER_FLAG) && pxRingbuffer->pucRead != pxRingbuffer->pucFree) {
@@ -594,6 +689,31 @@ static void *prvGetItemByteBuf(Ringbuffer_t *pxRingbuffer,
     return (void *)ret;
 }
 
+static UBaseType_t prvGetItemBatch(Ringbuffer_t *pxRingbuffer, RingbufferItem_t *pxItems, UBaseType_t uxMaxItems)
+{
+    UBaseType_t uxCount = 0;
+    while (uxCount < uxMaxItems && prvCheckItemAvail(pxRingbuffer) == pdTRUE) {
+        //A split item needs two elements, do not retrieve only its first part
+        ItemHeader_t *pxHeader = (ItemHeader_t *)pxRingbuffer->pucRead;
+        if ((pxHeader->uxItemFlags & rbITEM_SPLIT_FLAG) && uxMaxItems - uxCount < 2) {
+            break;
+        }
+        BaseType_t xIsSplit = pdFALSE;
+        pxItems[uxCount].pvItem = pxRingbuffer->pvGetItem(pxRingbuffer, &xIsSplit, 0, &pxItems[uxCount].xItemSize);
+        pxItems[uxCount].xIsSplit = xIsSplit;
+        uxCount++;
+        if (xIsSplit == pdTRUE) {
+            configASSERT(pxRingbuffer->uxRingbufferFlags & rbALLOW_SPLIT_FLAG);
+            pxItems[uxCount].pvItem = pxRingbuffer->pvGetItem(pxRingbuffer, &xIsSplit, 0, &pxItems[uxCount].xItemSize);
+            configASSERT(pxItems[uxCount].pvItem < pxItems[uxCount - 1].pvItem);  //Check wrap around has occurred
+            configASSERT(xIsSplit == pdFALSE);  //Second part should not have wrapped flag
+            pxItems[uxCount].xIsSplit = pdFALSE;
+            uxCount++;
+        }
+    }
+    return uxCount;
+}
+
 static void prvReturnItemDefault(Ringbuffer_t *pxRingbuffer, uint8_t *pucItem)
 {
     //Check arguments and buffer state
@@ -924,12 +1044,348 @@ static BaseType_t prvReceiveGenericFromISR(Ringbuffer_t *pxRingbuffer,
     return xReturn;
 }
 
+static BaseType_t prvSpscCopyItem(Ringbuffer_t *pxRingbuffer, const uint8_t *pucItem, size_t xItemSize)
+{
+    //Only the producer writes xSpscWritten. Pairs with the release store of xSpscFreed in prvSpscReturnItem()
+    size_t xWritten = pxRingbuffer->xSpscWritten;
+    size_t xFreeSize = pxRingbuffer->xSize - (xWritten - __atomic_load_n(&pxRingbuffer->xSpscFreed, __ATOMIC_ACQUIRE));
+    size_t xRemLen = pxRingbuffer->pucTail - pxRingbuffer->pucAcquire;    //Length from pucAcquire until end of buffer
+    size_t xUsedLen;
+
+    if (pxRingbuffer->uxRingbufferFlags & rbBYTE_BUFFER_FLAG) {
+        if (xItemSize > xFreeSize) {
+            return pdFALSE;
+        }
+        //Copy as much as possible into remaining length, then the rest to the start of the buffer
+        size_t xFirstLen = (xItemSize < xRemLen) ? xItemSize : xRemLen;
+        memcpy(pxRingbuffer->pucAcquire, pucItem, xFirstLen);
+        memcpy(pxRingbuffer->pucHead, pucItem + xFirstLen, xItemSize - xFirstLen);
+        pxRingbuffer->pucAcquire += xItemSize;
+        if (pxRingbuffer->pucAcquire >= pxRingbuffer->pucTail) {
+            pxRingbuffer->pucAcquire -= pxRingbuffer->xSize;
+        }
+        xUsedLen = xItemSize;
+    } else {
+        configASSERT(rbCHECK_ALIGNED(pxRingbuffer->pucAcquire));
+        configASSERT(xRemLen >= rbHEADER_SIZE);
+        //Free space starts at pucAcquire and wraps around, if the item does not fit at the tail it
+        //additionally needs the rest of the buffer to be marked as dummy data
+        size_t xTotalItemSize = rbALIGN_SIZE(xItemSize) + rbHEADER_SIZE;
+        xUsedLen = (xRemLen < xTotalItemSize) ? xRemLen + xTotalItemSize : xTotalItemSize;
+        if (xUsedLen > xFreeSize) {
+            return pdFALSE;
+        }
+        if (xRemLen < xTotalItemSize) {
+            ItemHeader_t *pxDummy = (ItemHeader_t *)pxRingbuffer->pucAcquire;
+            pxDummy->uxItemFlags = rbITEM_DUMMY_DATA_FLAG;
+            pxDummy->xItemLen = 0;
+            pxRingbuffer->pucAcquire = pxRingbuffer->pucHead;
+        }
+        ItemHeader_t *pxHeader = (ItemHeader_t *)pxRingbuffer->pucAcquire;
+        pxHeader->xItemLen = xItemSize;
+        pxHeader->uxItemFlags = 0;
+        memcpy(pxRingbuffer->pucAcquire + rbHEADER_SIZE, pucItem, xItemSize);
+        pxRingbuffer->pucAcquire += xTotalItemSize;
+        //If current remaining length can't fit a header, skip it. The consumer skips it the same way. This
+        //space is always free as no item can start there.
+        xRemLen = pxRingbuffer->pucTail - pxRingbuffer->pucAcquire;
+        if (xRemLen < rbHEADER_SIZE) {
+            xUsedLen += xRemLen;
+            pxRingbuffer->pucAcquire = pxRingbuffer->pucHead;
+        }
+        //Ordered before the item by the release store of xSpscWritten below
+        __atomic_store_n(&pxRingbuffer->xSpscItemsSent, pxRingbuffer->xSpscItemsSent + 1, __ATOMIC_RELAXED);
+    }
+    pxRingbuffer->pucWrite = pxRingbuffer->pucAcquire;
+    //Publish the item. Pairs with the acquire load of xSpscWritten in prvSpscGetItem()
+    __atomic_store_n(&pxRingbuffer->xSpscWritten, xWritten + xUsedLen, __ATOMIC_RELEASE);
+    return pdTRUE;
+}
+
+static void *prvSpscGetItem(Ringbuffer_t *pxRingbuffer, size_t xMaxSize, size_t *pxItemSize)
+{
+    //Only the consumer writes xSpscRead and xSpscFreed
+    size_t xRead = pxRingbuffer->xSpscRead;
+    size_t xAvailable = __atomic_load_n(&pxRingbuffer->xSpscWritten, __ATOMIC_ACQUIRE) - xRead;
+    uint8_t *pucReturn;
+
+    if (xAvailable == 0) {
+        return NULL;
+    }
+    if (pxRingbuffer->uxRingbufferFlags & rbBYTE_BUFFER_FLAG) {
+        if (xRead != pxRingbuffer->xSpscFreed) {
+            return NULL;    //Byte buffers do not allow multiple retrievals before return
+        }
+        //Return contiguous data from read pointer, limited by the buffer tail and xMaxSize
+        size_t xLen = pxRingbuffer->pucTail - pxRingbuffer->pucRead;
+        if (xAvailable < xLen) {
+            xLen = xAvailable;
+        }
+        if (xMaxSize != 0 && xMaxSize < xLen) {
+            xLen = xMaxSize;
+        }
+        pucReturn = pxRingbuffer->pucRead;
+        pxRingbuffer->pucRead += xLen;
+        if (pxRingbuffer->pucRead == pxRingbuffer->pucTail) {
+            pxRingbuffer->pucRead = pxRingbuffer->pucHead;
+        }
+        *pxItemSize = xLen;
+        xRead += xLen;
+    } else {
+        ItemHeader_t *pxHeader = (ItemHeader_t *)pxRingbuffer->pucRead;
+        //Wrap around if dummy data
+        if (pxHeader->uxItemFlags & rbITEM_DUMMY_DATA_FLAG) {
+            xRead += pxRingbuffer->pucTail - pxRingbuffer->pucRead;
+            pxRingbuffer->pucRead = pxRingbuffer->pucHead;
+            pxHeader = (ItemHeader_t *)pxRingbuffer->pucRead;
+        }
+        configASSERT(pxHeader->xItemLen <= pxRingbuffer->xMaxItemSize);
+        pucReturn = pxRingbuffer->pucRead + rbHEADER_SIZE;
+        *pxItemSize = pxHeader->xItemLen;
+        size_t xLen = rbHEADER_SIZE + rbALIGN_SIZE(pxHeader->xItemLen);
+        pxRingbuffer->pucRead += xLen;
+        xRead += xLen;
+        //Skip the rest of the buffer if it can't fit a header
+        if ((size_t)(pxRingbuffer->pucTail - pxRingbuffer->pucRead) < rbHEADER_SIZE) {
+            xRead += pxRingbuffer->pucTail - pxRingbuffer->pucRead;
+            pxRingbuffer->pucRead = pxRingbuffer->pucHead;
+        }
+        //Pairs with the acquire load in vRingbufferGetInfo(), the count of items read never exceeds the count sent
+        __atomic_store_n(&pxRingbuffer->xSpscItemsRead, pxRingbuffer->xSpscItemsRead + 1, __ATOMIC_RELEASE);
+    }
+    //The producer only reads xSpscRead to detect the empty to non-empty transition. The release pairs with the
+    //acquire load in vRingbufferGetInfo() so that it never sees more bytes read than written.
+    __atomic_store_n(&pxRingbuffer->xSpscRead, xRead, __ATOMIC_RELEASE);
+    return (void *)pucReturn;
+}
+
+static void prvSpscReturnItem(Ringbuffer_t *pxRingbuffer, uint8_t *pucItem)
+{
+    size_t xFreed = pxRingbuffer->xSpscFreed;
+
+    configASSERT(pucItem >= pxRingbuffer->pucHead);
+    configASSERT(pucItem <= pxRingbuffer->pucTail);     //Inclusive of pucTail in the case of zero length item at the very end
+    if (pxRingbuffer->uxRingbufferFlags & rbBYTE_BUFFER_FLAG) {
+        //Byte buffers only allow a single outstanding retrieval, free everything that was read
+        pxRingbuffer->pucFree = pxRingbuffer->pucRead;
+        xFreed = pxRingbuffer->xSpscRead;
+    } else {
+        ItemHeader_t *pxCurHeader = (ItemHeader_t *)(pucItem - rbHEADER_SIZE);
+        configASSERT((pxCurHeader->uxItemFlags & (rbITEM_DUMMY_DATA_FLAG | rbITEM_FREE_FLAG)) == 0);
+        pxCurHeader->uxItemFlags |= rbITEM_FREE_FLAG;
+        //Items might not be returned in the order they were retrieved. Move the free pointer up to the next
+        //item that has not been returned yet or up to the read pointer, skipping over dummy data.
+        while (xFreed != pxRingbuffer->xSpscRead) {
+            pxCurHeader = (ItemHeader_t *)pxRingbuffer->pucFree;
+            if (pxCurHeader->uxItemFlags & rbITEM_DUMMY_DATA_FLAG) {
+                xFreed += pxRingbuffer->pucTail - pxRingbuffer->pucFree;
+                pxRingbuffer->pucFree = pxRingbuffer->pucHead;
+                continue;
+            }
+            if ((pxCurHeader->uxItemFlags & rbITEM_FREE_FLAG) == 0) {
+                break;
+            }
+            size_t xLen = rbHEADER_SIZE + rbALIGN_SIZE(pxCurHeader->xItemLen);
+            pxRingbuffer->pucFree += xLen;
+            xFreed += xLen;
+            if ((size_t)(pxRingbuffer->pucTail - pxRingbuffer->pucFree) < rbHEADER_SIZE) {
+                xFreed += pxRingbuffer->pucTail - pxRingbuffer->pucFree;
+                pxRingbuffer->pucFree = pxRingbuffer->pucHead;
+            }
+        }
+    }
+    //Pairs with the acquire load of xSpscFreed in prvSpscCopyItem()
+    __atomic_store_n(&pxRingbuffer->xSpscFreed, xFreed, __ATOMIC_RELEASE);
+}
+
+static void prvSpscWakeReceiver(Ringbuffer_t *pxRingbuffer, size_t xOldWritten, BaseType_t xFromISR, BaseType_t *pxHigherPriorityTaskWoken)
+{
+    /*
+     * The consumer sets xSpscReceiverWaiting before checking for data a last time before blocking. The full
+     * barriers on both sides guarantee that either the consumer sees the new item or we see the flag. The
+     * consumer can only be waiting if it has read everything sent before this item.
+     */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&pxRingbuffer->xSpscRead, __ATOMIC_RELAXED) != xOldWritten ||
+            __atomic_load_n(&pxRingbuffer->xSpscReceiverWaiting, __ATOMIC_RELAXED) == pdFALSE) {
+        return;
+    }
+    if (xFromISR) {
+        portENTER_CRITICAL_ISR(&pxRingbuffer->mux);
+    } else {
+        portENTER_CRITICAL(&pxRingbuffer->mux);
+    }
+    pxRingbuffer->xSpscReceiverWaiting = pdFALSE;
+    if (listLIST_IS_EMPTY(&pxRingbuffer->xTasksWaitingToReceive) == pdFALSE) {
+        if (xTaskRemoveFromEventList(&pxRingbuffer->xTasksWaitingToReceive) == pdTRUE) {
+            //The unblocked task will preempt us
+            if (!xFromISR) {
+                portYIELD_WITHIN_API();
+            } else if (pxHigherPriorityTaskWoken != NULL) {
+                *pxHigherPriorityTaskWoken = pdTRUE;
+            }
+        }
+    }
+    if (xFromISR) {
+        portEXIT_CRITICAL_ISR(&pxRingbuffer->mux);
+    } else {
+        portEXIT_CRITICAL(&pxRingbuffer->mux);
+    }
+}
+
+static void prvSpscWakeSender(Ringbuffer_t *pxRingbuffer, BaseType_t xFromISR, BaseType_t *pxHigherPriorityTaskWoken)
+{
+    //See prvSpscWakeReceiver(). The producer only waits if the item it is sending did not fit.
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&pxRingbuffer->xSpscSenderWaiting, __ATOMIC_RELAXED) == pdFALSE) {
+        return;
+    }
+    if (xFromISR) {
+        portENTER_CRITICAL_ISR(&pxRingbuffer->mux);
+    } else {
+        portENTER_CRITICAL(&pxRingbuffer->mux);
+    }
+    pxRingbuffer->xSpscSenderWaiting = pdFALSE;
+    if (listLIST_IS_EMPTY(&pxRingbuffer->xTasksWaitingToSend) == pdFALSE) {
+        if (xTaskRemoveFromEventList(&pxRingbuffer->xTasksWaitingToSend) == pdTRUE) {
+            //The unblocked task will preempt us
+            if (!xFromISR) {
+                portYIELD_WITHIN_API();
+            } else if (pxHigherPriorityTaskWoken != NULL) {
+                *pxHigherPriorityTaskWoken = pdTRUE;
+            }
+        }
+    }
+    if (xFromISR) {
+        portEXIT_CRITICAL_ISR(&pxRingbuffer->mux);
+    } else {
+        portEXIT_CRITICAL(&pxRingbuffer->mux);
+    }
+}
+
+static size_t prvSpscGetCurMaxSize(Ringbuffer_t *pxRingbuffer)
+{
+    size_t xFreeSize = pxRingbuffer->xSize - (__atomic_load_n(&pxRingbuffer->xSpscWritten, __ATOMIC_ACQUIRE) -
+                                              __atomic_load_n(&pxRingbuffer->xSpscFreed, __ATOMIC_ACQUIRE));
+    if (pxRingbuffer->uxRingbufferFlags & rbBYTE_BUFFER_FLAG) {
+        return xFreeSize;
+    }
+    //Free space starts at pucAcquire and may wrap around, no-split items require contiguous space
+    size_t xRemLen = pxRingbuffer->pucTail - pxRingbuffer->pucAcquire;
+    size_t xSize1 = (xFreeSize < xRemLen) ? xFreeSize : xRemLen;
+    size_t xSize2 = xFreeSize - xSize1;
+    xFreeSize = (xSize1 > xSize2) ? xSize1 : xSize2;
+    if (xFreeSize < rbHEADER_SIZE) {
+        return 0;
+    }
+    xFreeSize -= rbHEADER_SIZE;
+    return (xFreeSize > pxRingbuffer->xMaxItemSize) ? pxRingbuffer->xMaxItemSize : xFreeSize;
+}
+
+static BaseType_t prvSpscSend(Ringbuffer_t *pxRingbuffer, const void *pvItem, size_t xItemSize, TickType_t xTicksToWait)
+{
+    BaseType_t xEntryTimeSet = pdFALSE;
+    TimeOut_t xTimeOut;
+
+    while (1) {
+        size_t xOldWritten = pxRingbuffer->xSpscWritten;
+        if (prvSpscCopyItem(pxRingbuffer, pvItem, xItemSize) == pdTRUE) {
+            prvSpscWakeReceiver(pxRingbuffer, xOldWritten, pdFALSE, NULL);
+            return pdTRUE;
+        }
+        if (xTicksToWait == (TickType_t) 0) {
+            //No block time. Return immediately.
+            return pdFALSE;
+        }
+
+        BaseType_t xTimedOut = pdFALSE;
+        portENTER_CRITICAL(&pxRingbuffer->mux);
+        if (xEntryTimeSet == pdFALSE) {
+            //This is our first block. Set entry time
+            vTaskInternalSetTimeOutState(&xTimeOut);
+            xEntryTimeSet = pdTRUE;
+        }
+        //Announce that we are going to block, then check for space again before actually blocking
+        pxRingbuffer->xSpscSenderWaiting = pdTRUE;
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        if (prvSpscCopyItem(pxRingbuffer, pvItem, xItemSize) == pdTRUE) {
+            pxRingbuffer->xSpscSenderWaiting = pdFALSE;
+            portEXIT_CRITICAL(&pxRingbuffer->mux);
+            prvSpscWakeReceiver(pxRingbuffer, xOldWritten, pdFALSE, NULL);
+            return pdTRUE;
+        }
+        if (xTaskCheckForTimeOut(&xTimeOut, &xTicksToWait) == pdFALSE) {
+            //Not timed out yet. Block the current task
+            vTaskPlaceOnEventList(&pxRingbuffer->xTasksWaitingToSend, xTicksToWait);
+            portYIELD_WITHIN_API();
+        } else {
+            //We have timed out
+            pxRingbuffer->xSpscSenderWaiting = pdFALSE;
+            xTimedOut = pdTRUE;
+        }
+        portEXIT_CRITICAL(&pxRingbuffer->mux);
+        if (xTimedOut == pdTRUE) {
+            return pdFALSE;
+        }
+    }
+}
+
+static void *prvSpscReceive(Ringbuffer_t *pxRingbuffer, size_t *pxItemSize, size_t xMaxSize, TickType_t xTicksToWait)
+{
+    BaseType_t xEntryTimeSet = pdFALSE;
+    TimeOut_t xTimeOut;
+    void *pvItem;
+
+    while (1) {
+        pvItem = prvSpscGetItem(pxRingbuffer, xMaxSize, pxItemSize);
+        if (pvItem != NULL || xTicksToWait == (TickType_t) 0) {
+            return pvItem;
+        }
+
+        BaseType_t xTimedOut = pdFALSE;
+        portENTER_CRITICAL(&pxRingbuffer->mux);
+        if (xEntryTimeSet == pdFALSE) {
+            //This is our first block. Set entry time
+            vTaskInternalSetTimeOutState(&xTimeOut);
+            xEntryTimeSet = pdTRUE;
+        }
+        //Announce that we are going to block, then check for data again before actually blocking
+        pxRingbuffer->xSpscReceiverWaiting = pdTRUE;
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        pvItem = prvSpscGetItem(pxRingbuffer, xMaxSize, pxItemSize);
+        if (pvItem != NULL) {
+            pxRingbuffer->xSpscReceiverWaiting = pdFALSE;
+            portEXIT_CRITICAL(&pxRingbuffer->mux);
+            return pvItem;
+        }
+        if (xTaskCheckForTimeOut(&xTimeOut, &xTicksToWait) == pdFALSE) {
+            //Not timed out yet. Block the current task
+            vTaskPlaceOnEventList(&pxRingbuffer->xTasksWaitingToReceive, xTicksToWait);
+            portYIELD_WITHIN_API();
+        } else {
+            //We have timed out
+            pxRingbuffer->xSpscReceiverWaiting = pdFALSE;
+            xTimedOut = pdTRUE;
+        }
+        portEXIT_CRITICAL(&pxRingbuffer->mux);
+        if (xTimedOut == pdTRUE) {
+            return NULL;
+        }
+    }
+}
+
 // ------------------------------------------------ Public Functions ---------------------------------------------------
 
 RingbufHandle_t xRingbufferCreate(size_t xBufferSize, RingbufferType_t xBufferType)
+{
+    return xRingbufferCreateWithFlags(xBufferSize, xBufferType, 0);
+}
+
+RingbufHandle_t xRingbufferCreateWithFlags(size_t xBufferSize, RingbufferType_t xBufferType, UBaseType_t uxFlags)
 {
     configASSERT(xBufferSize > 0);
     configASSERT(xBufferType < RINGBUF_TYPE_MAX);
+    configASSERT(!(uxFlags & RINGBUF_FLAG_SPSC) || xBufferType != RINGBUF_TYPE_ALLOWSPLIT);
 
     //Allocate memory
     if (xBufferType != RINGBUF_TYPE_BYTEBUF) {
@@ -941,7 +1397,7 @@ RingbufHandle_t xRingbufferCreate(size_t xBufferSize, RingbufferType_t xBufferTy
         goto err;
     }
 
-    prvInitializeNewRingbuffer(xBufferSize, xBufferType, pxNewRingbuffer, pucRingbufferStorage);
+    prvInitializeNewRingbuffer(xBufferSize, xBufferType, uxFlags, pxNewRingbuffer, pucRingbufferStorage);
     return (RingbufHandle_t)pxNewRingbuffer;
 
 err:
@@ -960,10 +1416,20 @@ RingbufHandle_t xRingbufferCreateStatic(size_t xBufferSize,
                                         RingbufferType_t xBufferType,
                                         uint8_t *pucRingbufferStorage,
                                         StaticRingbuffer_t *pxStaticRingbuffer)
+{
+    return xRingbufferCreateStaticWithFlags(xBufferSize, xBufferType, 0, pucRingbufferStorage, pxStaticRingbuffer);
+}
+
+RingbufHandle_t xRingbufferCreateStaticWithFlags(size_t xBufferSize,
+                                                 RingbufferType_t xBufferType,
+                                                 UBaseType_t uxFlags,
+                                                 uint8_t *pucRingbufferStorage,
+                                                 StaticRingbuffer_t *pxStaticRingbuffer)
 {
     //Check arguments
     configASSERT(xBufferSize > 0);
     configASSERT(xBufferType < RINGBUF_TYPE_MAX);
+    configASSERT(!(uxFlags & RINGBUF_FLAG_SPSC) || xBufferType != RINGBUF_TYPE_ALLOWSPLIT);
     configASSERT(pucRingbufferStorage != NULL && pxStaticRingbuffer != NULL);
     if (xBufferType != RINGBUF_TYPE_BYTEBUF) {
         //No-split/allow-split buffer sizes must be 32-bit aligned
@@ -971,7 +1437,7 @@ RingbufHandle_t xRingbufferCreateStatic(size_t xBufferSize,
     }
 
     Ringbuffer_t *pxNewRingbuffer = (Ringbuffer_t *)pxStaticRingbuffer;
-    prvInitializeNewRingbuffer(xBufferSize, xBufferType, pxNewRingbuffer, pucRingbufferStorage);
+    prvInitializeNewRingbuffer(xBufferSize, xBufferType, uxFlags, pxNewRingbuffer, pucRingbufferStorage);
     pxNewRingbuffer->uxRingbufferFlags |= rbBUFFER_STATIC_FLAG;
     return (RingbufHandle_t)pxNewRingbuffer;
 }
@@ -983,7 +1449,7 @@ BaseType_t xRingbufferSendAcquire(RingbufHandle_t xRingbuffer, void **ppvItem, s
     //Check arguments
     configASSERT(pxRingbuffer);
     configASSERT(ppvItem != NULL);
-    configASSERT((pxRingbuffer->uxRingbufferFlags & (rbBYTE_BUFFER_FLAG | rbALLOW_SPLIT_FLAG)) == 0); //Send acquire currently only supported in NoSplit buffers
+    configASSERT((pxRingbuffer->uxRingbufferFlags & (rbBYTE_BUFFER_FLAG | rbALLOW_SPLIT_FLAG | rbSPSC_FLAG)) == 0); //Send acquire currently only supported in NoSplit buffers
 
     *ppvItem = NULL;
     if (xItemSize > pxRingbuffer->xMaxItemSize) {
@@ -1044,6 +1510,9 @@ BaseType_t xRingbufferSend(RingbufHandle_t xRingbuffer,
     if ((pxRingbuffer->uxRingbufferFlags & rbBYTE_BUFFER_FLAG) && xItemSize == 0) {
         return pdTRUE;      //Sending 0 bytes to byte buffer has no effect
     }
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        return prvSpscSend(pxRingbuffer, pvItem, xItemSize, xTicksToWait);
+    }
 
     return prvSendAcquireGeneric(pxRingbuffer, pvItem, NULL, xItemSize, xTicksToWait);
 }
@@ -1066,6 +1535,14 @@ BaseType_t xRingbufferSendFromISR(RingbufHandle_t xRingbuffer,
     if ((pxRingbuffer->uxRingbufferFlags & rbBYTE_BUFFER_FLAG) && xItemSize == 0) {
         return pdTRUE;      //Sending 0 bytes to byte buffer has no effect
     }
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        size_t xOldWritten = pxRingbuffer->xSpscWritten;
+        xReturn = prvSpscCopyItem(pxRingbuffer, pvItem, xItemSize);
+        if (xReturn == pdTRUE) {
+            prvSpscWakeReceiver(pxRingbuffer, xOldWritten, pdTRUE, pxHigherPriorityTaskWoken);
+        }
+        return xReturn;
+    }
 
     portENTER_CRITICAL_ISR(&pxRingbuffer->mux);
     if (pxRingbuffer->xCheckItemFits(xRingbuffer, xItemSize) == pdTRUE) {
@@ -1103,6 +1580,10 @@ void *xRingbufferReceive(RingbufHandle_t xRingbuffer, size_t *pxItemSize, TickTy
     //Check arguments
     configASSERT(pxRingbuffer && pxItemSize);
 
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        return prvSpscReceive(pxRingbuffer, pxItemSize, 0, xTicksToWait);
+    }
+
     //Attempt to retrieve an item
     void *pvTempItem;
     if (prvReceiveGeneric(pxRingbuffer, &pvTempItem, NULL, pxItemSize, NULL, 0, xTicksToWait) == pdTRUE) {
@@ -1119,6 +1600,10 @@ void *xRingbufferReceiveFromISR(RingbufHandle_t xRingbuffer, size_t *pxItemSize)
     //Check arguments
     configASSERT(pxRingbuffer && pxItemSize);
 
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        return prvSpscGetItem(pxRingbuffer, 0, pxItemSize);
+    }
+
     //Attempt to retrieve an item
     void *pvTempItem;
     if (prvReceiveGenericFromISR(pxRingbuffer, &pvTempItem, NULL, pxItemSize, NULL, 0) == pdTRUE) {
@@ -1173,6 +1658,9 @@ void *xRingbufferReceiveUpTo(RingbufHandle_t xRingbuffer,
     if (xMaxSize == 0) {
         return NULL;
     }
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        return prvSpscReceive(pxRingbuffer, pxItemSize, xMaxSize, xTicksToWait);
+    }
     //Attempt to retrieve up to xMaxSize bytes
     void *pvTempItem;
     if (prvReceiveGeneric(pxRingbuffer, &pvTempItem, NULL, pxItemSize, NULL, xMaxSize, xTicksToWait) == pdTRUE) {
@@ -1193,6 +1681,9 @@ void *xRingbufferReceiveUpToFromISR(RingbufHandle_t xRingbuffer, size_t *pxItemS
     if (xMaxSize == 0) {
         return NULL;
     }
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        return prvSpscGetItem(pxRingbuffer, xMaxSize, pxItemSize);
+    }
     //Attempt to retrieve up to xMaxSize bytes
     void *pvTempItem;
     if (prvReceiveGenericFromISR(pxRingbuffer, &pvTempItem, NULL, pxItemSize, NULL, xMaxSize) == pdTRUE) {
@@ -1202,12 +1693,140 @@ void *xRingbufferReceiveUpToFromISR(RingbufHandle_t xRingbuffer, size_t *pxItemS
     }
 }
 
+UBaseType_t xRingbufferSendBatch(RingbufHandle_t xRingbuffer,
+                                 const RingbufferItem_t *pxItems,
+                                 UBaseType_t uxNumItems,
+                                 TickType_t xTicksToWait)
+{
+    Ringbuffer_t *pxRingbuffer = (Ringbuffer_t *)xRingbuffer;
+    UBaseType_t uxSent = 0;
+    BaseType_t xExitLoop = pdFALSE;
+    BaseType_t xEntryTimeSet = pdFALSE;
+    TimeOut_t xTimeOut;
+
+    //Check arguments
+    configASSERT(pxRingbuffer);
+    configASSERT(pxItems != NULL || uxNumItems == 0);
+    configASSERT((pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) == 0);
+    if (uxNumItems == 0 || pxItems[0].xItemSize > pxRingbuffer->xMaxItemSize) {
+        return 0;   //Nothing to send or the first item will never fit
+    }
+
+    while (xExitLoop == pdFALSE) {
+        portENTER_CRITICAL(&pxRingbuffer->mux);
+        uxSent = prvCopyItemBatch(pxRingbuffer, pxItems, uxNumItems);
+        if (uxSent > 0) {
+            //If tasks were waiting for data to arrive on the ring buffer, unblock them. The queue set is notified below.
+            if (pxRingbuffer->xQueueSet == NULL) {
+                BaseType_t xYieldRequired = pdFALSE;
+                for (UBaseType_t i = 0; i < uxSent && listLIST_IS_EMPTY(&pxRingbuffer->xTasksWaitingToReceive) == pdFALSE; i++) {
+                    if (xTaskRemoveFromEventList(&pxRingbuffer->xTasksWaitingToReceive) == pdTRUE) {
+                        xYieldRequired = pdTRUE;
+                    }
+                }
+                if (xYieldRequired == pdTRUE) {
+                    //An unblocked task will preempt us. Trigger a yield here.
+                    portYIELD_WITHIN_API();
+                }
+            }
+            xExitLoop = pdTRUE;
+            goto loop_end;
+        } else if (xTicksToWait == (TickType_t) 0) {
+            //No block time. Return immediately.
+            xExitLoop = pdTRUE;
+            goto loop_end;
+        } else if (xEntryTimeSet == pdFALSE) {
+            //This is our first block. Set entry time
+            vTaskInternalSetTimeOutState(&xTimeOut);
+            xEntryTimeSet = pdTRUE;
+        }
+
+        if (xTaskCheckForTimeOut(&xTimeOut, &xTicksToWait) == pdFALSE) {
+            //Not timed out yet. Block the current task
+            vTaskPlaceOnEventList(&pxRingbuffer->xTasksWaitingToSend, xTicksToWait);
+            portYIELD_WITHIN_API();
+        } else {
+            //We have timed out
+            xExitLoop = pdTRUE;
+        }
+loop_end:
+        portEXIT_CRITICAL(&pxRingbuffer->mux);
+    }
+    //Defer notifying the queue set until we are outside the loop and critical section. Notify once per item, same
+    //as if the items had been sent one by one.
+    if (pxRingbuffer->xQueueSet) {
+        for (UBaseType_t i = 0; i < uxSent; i++) {
+            xQueueSend((QueueHandle_t)pxRingbuffer->xQueueSet, (QueueSetMemberHandle_t *)&pxRingbuffer, 0);
+        }
+    }
+
+    return uxSent;
+}
+
+UBaseType_t xRingbufferReceiveBatch(RingbufHandle_t xRingbuffer,
+                                    RingbufferItem_t *pxItems,
+                                    UBaseType_t uxMaxItems,
+                                    TickType_t xTicksToWait)
+{
+    Ringbuffer_t *pxRingbuffer = (Ringbuffer_t *)xRingbuffer;
+    UBaseType_t uxReceived = 0;
+    BaseType_t xExitLoop = pdFALSE;
+    BaseType_t xEntryTimeSet = pdFALSE;
+    TimeOut_t xTimeOut;
+
+    //Check arguments
+    configASSERT(pxRingbuffer && pxItems);
+    configASSERT((pxRingbuffer->uxRingbufferFlags & rbBYTE_BUFFER_FLAG) == 0);  //Byte buffers do not allow multiple retrievals
+    configASSERT((pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) == 0);
+    configASSERT(uxMaxItems >= 2 || (pxRingbuffer->uxRingbufferFlags & rbALLOW_SPLIT_FLAG) == 0);
+    if (uxMaxItems == 0) {
+        return 0;
+    }
+
+    while (xExitLoop == pdFALSE) {
+        portENTER_CRITICAL(&pxRingbuffer->mux);
+        if (prvCheckItemAvail(pxRingbuffer) == pdTRUE) {
+            //Items are available for retrieval
+            uxReceived = prvGetItemBatch(pxRingbuffer, pxItems, uxMaxItems);
+            xExitLoop = pdTRUE;
+            goto loop_end;
+        } else if (xTicksToWait == (TickType_t) 0) {
+            //No block time. Return immediately.
+            xExitLoop = pdTRUE;
+            goto loop_end;
+        } else if (xEntryTimeSet == pdFALSE) {
+            //This is our first block. Set entry time
+            vTaskInternalSetTimeOutState(&xTimeOut);
+            xEntryTimeSet = pdTRUE;
+        }
+
+        if (xTaskCheckForTimeOut(&xTimeOut, &xTicksToWait) == pdFALSE) {
+            //Not timed out yet. Block the current task
+            vTaskPlaceOnEventList(&pxRingbuffer->xTasksWaitingToReceive, xTicksToWait);
+            portYIELD_WITHIN_API();
+        } else {
+            //We have timed out.
+            xExitLoop = pdTRUE;
+        }
+loop_end:
+        portEXIT_CRITICAL(&pxRingbuffer->mux);
+    }
+
+    return uxReceived;
+}
+
 void vRingbufferReturnItem(RingbufHandle_t xRingbuffer, void *pvItem)
 {
     Ringbuffer_t *pxRingbuffer = (Ringbuffer_t *)xRingbuffer;
     configASSERT(pxRingbuffer);
     configASSERT(pvItem != NULL);
 
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        prvSpscReturnItem(pxRingbuffer, (uint8_t *)pvItem);
+        prvSpscWakeSender(pxRingbuffer, pdFALSE, NULL);
+        return;
+    }
+
     portENTER_CRITICAL(&pxRingbuffer->mux);
     pxRingbuffer->vReturnItem(pxRingbuffer, (uint8_t *)pvItem);
     //If a task was waiting for space to send, unblock it immediately.
@@ -1226,6 +1845,12 @@ void vRingbufferReturnItemFromISR(RingbufHandle_t xRingbuffer, void *pvItem, Bas
     configASSERT(pxRingbuffer);
     configASSERT(pvItem != NULL);
 
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        prvSpscReturnItem(pxRingbuffer, (uint8_t *)pvItem);
+        prvSpscWakeSender(pxRingbuffer, pdTRUE, pxHigherPriorityTaskWoken);
+        return;
+    }
+
     portENTER_CRITICAL_ISR(&pxRingbuffer->mux);
     pxRingbuffer->vReturnItem(pxRingbuffer, (uint8_t *)pvItem);
     //If a task was waiting for space to send, unblock it immediately.
@@ -1240,6 +1865,32 @@ void vRingbufferReturnItemFromISR(RingbufHandle_t xRingbuffer, void *pvItem, Bas
     portEXIT_CRITICAL_ISR(&pxRingbuffer->mux);
 }
 
+void vRingbufferReturnItemBatch(RingbufHandle_t xRingbuffer, const RingbufferItem_t *pxItems, UBaseType_t uxNumItems)
+{
+    Ringbuffer_t *pxRingbuffer = (Ringbuffer_t *)xRingbuffer;
+    configASSERT(pxRingbuffer);
+    configASSERT(pxItems != NULL || uxNumItems == 0);
+    configASSERT((pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) == 0);
+
+    portENTER_CRITICAL(&pxRingbuffer->mux);
+    for (UBaseType_t i = 0; i < uxNumItems; i++) {
+        configASSERT(pxItems[i].pvItem != NULL);
+        pxRingbuffer->vReturnItem(pxRingbuffer, (uint8_t *)pxItems[i].pvItem);
+    }
+    //If tasks were waiting for space to send, unblock them immediately.
+    BaseType_t xYieldRequired = pdFALSE;
+    for (UBaseType_t i = 0; i < uxNumItems && listLIST_IS_EMPTY(&pxRingbuffer->xTasksWaitingToSend) == pdFALSE; i++) {
+        if (xTaskRemoveFromEventList(&pxRingbuffer->xTasksWaitingToSend) == pdTRUE) {
+            xYieldRequired = pdTRUE;
+        }
+    }
+    if (xYieldRequired == pdTRUE) {
+        //An unblocked task will preempt us. Trigger a yield here.
+        portYIELD_WITHIN_API();
+    }
+    portEXIT_CRITICAL(&pxRingbuffer->mux);
+}
+
 void vRingbufferDelete(RingbufHandle_t xRingbuffer)
 {
     Ringbuffer_t *pxRingbuffer = (Ringbuffer_t *)xRingbuffer;
@@ -1265,6 +1916,9 @@ size_t xRingbufferGetCurFreeSize(RingbufHandle_t xRingbuffer)
     configASSERT(pxRingbuffer);
 
     size_t xFreeSize;
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        return prvSpscGetCurMaxSize(pxRingbuffer);
+    }
     portENTER_CRITICAL(&pxRingbuffer->mux);
     xFreeSize = pxRingbuffer->xGetCurMaxSize(pxRingbuffer);
     portEXIT_CRITICAL(&pxRingbuffer->mux);
@@ -1277,6 +1931,7 @@ BaseType_t xRingbufferAddToQueueSetRead(RingbufHandle_t xRingbuffer, QueueSetHan
     BaseType_t xReturn;
 
     configASSERT(pxRingbuffer && xQueueSet);
+    configASSERT((pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) == 0);    //Single-producer single-consumer ring buffers do not notify queue sets
 
     portENTER_CRITICAL(&pxRingbuffer->mux);
     if (pxRingbuffer->xQueueSet != NULL || prvCheckItemAvail(pxRingbuffer) == pdTRUE) {
@@ -1343,7 +1998,16 @@ void vRingbufferGetInfo(RingbufHandle_t xRingbuffer,
         *uxAcquire = (UBaseType_t)(pxRingbuffer->pucAcquire - pxRingbuffer->pucHead);
     }
     if (uxItemsWaiting != NULL) {
-        *uxItemsWaiting = (UBaseType_t)(pxRingbuffer->xItemsWaiting);
+        if ((pxRingbuffer->uxRingbufferFlags & (rbSPSC_FLAG | rbBYTE_BUFFER_FLAG)) == rbSPSC_FLAG) {
+            //The written and read byte counts include headers and dummy data, count the items instead
+            size_t xItemsRead = __atomic_load_n(&pxRingbuffer->xSpscItemsRead, __ATOMIC_ACQUIRE);
+            *uxItemsWaiting = (UBaseType_t)(__atomic_load_n(&pxRingbuffer->xSpscItemsSent, __ATOMIC_RELAXED) - xItemsRead);
+        } else if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+            size_t xRead = __atomic_load_n(&pxRingbuffer->xSpscRead, __ATOMIC_ACQUIRE);
+            *uxItemsWaiting = (UBaseType_t)(__atomic_load_n(&pxRingbuffer->xSpscWritten, __ATOMIC_ACQUIRE) - xRead);
+        } else {
+            *uxItemsWaiting = (UBaseType_t)(pxRingbuffer->xItemsWaiting);
+        }
     }
     portEXIT_CRITICAL(&pxRingbuffer->mux);
 }
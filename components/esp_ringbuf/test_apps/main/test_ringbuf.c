@@ -6,6 +6,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <inttypes.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/queue.h"
@@ -15,6 +16,7 @@
 #include "esp_private/spi_flash_os.h"
 #include "esp_memory_utils.h"
 #include "esp_heap_caps.h"
+#include "esp_timer.h"
 #include "spi_flash_mmap.h"
 #include "unity.h"
 #include "esp_rom_sys.h"
@@ -1122,3 +1124,161 @@ TEST_CASE("Test ringbuffer with caps", "[esp_ringbuf]")
     // Free the ring buffer
     vRingbufferDeleteWithCaps(rb_handle);
 }
+
+/* ---------------------- Test ring buffer batch functions ---------------------
+ * The following test case tests sending, receiving and returning multiple items
+ * at once. Specifically the following APIs:
+ *
+ * - xRingbufferSendBatch()
+ * - xRingbufferReceiveBatch()
+ * - vRingbufferReturnItemBatch()
+ */
+
+#define BATCH_SIZE      12
+
+static void check_batch_item(const RingbufferItem_t *item, const uint8_t *expected_data, size_t expected_size)
+{
+    TEST_ASSERT_MESSAGE(item->pvItem != NULL, "Failed to receive item");
+    TEST_ASSERT_MESSAGE(item->xIsSplit == pdFALSE, "Item should not be split");
+    TEST_ASSERT_EQUAL_MESSAGE(expected_size, item->xItemSize, "Item size is incorrect");
+    TEST_ASSERT_EQUAL_HEX8_ARRAY_MESSAGE(expected_data, item->pvItem, expected_size, "Item data is invalid");
+}
+
+TEST_CASE("Test ring buffer batch send and receive", "[esp_ringbuf]")
+{
+    RingbufferItem_t tx_items[BATCH_SIZE];
+    RingbufferItem_t rx_items[BATCH_SIZE];
+    for (int i = 0; i < BATCH_SIZE; i++) {
+        tx_items[i].pvItem = (void *)small_item;
+        tx_items[i].xItemSize = SMALL_ITEM_SIZE;
+    }
+
+    //No-split buffer: a batch is cut short when the buffer becomes full
+    RingbufHandle_t no_split_rb = xRingbufferCreate(BUFFER_SIZE, RINGBUF_TYPE_NOSPLIT);
+    TEST_ASSERT_MESSAGE(no_split_rb != NULL, "Failed to create ring buffer");
+    const UBaseType_t max_items = BUFFER_SIZE / (SMALL_ITEM_SIZE + ITEM_HDR_SIZE);
+    TEST_ASSERT_EQUAL(max_items, xRingbufferSendBatch(no_split_rb, tx_items, BATCH_SIZE, 0));
+    TEST_ASSERT_EQUAL(0, xRingbufferSendBatch(no_split_rb, &tx_items[max_items], BATCH_SIZE - max_items, TIMEOUT_TICKS));
+    TEST_ASSERT_EQUAL(4, xRingbufferReceiveBatch(no_split_rb, rx_items, 4, 0));
+    for (int i = 0; i < 4; i++) {
+        check_batch_item(&rx_items[i], small_item, SMALL_ITEM_SIZE);
+    }
+    vRingbufferReturnItemBatch(no_split_rb, rx_items, 4);
+    //Only the space of the returned items is free again
+    TEST_ASSERT_EQUAL(4, xRingbufferSendBatch(no_split_rb, tx_items, BATCH_SIZE, 0));
+    TEST_ASSERT_EQUAL(max_items, xRingbufferReceiveBatch(no_split_rb, rx_items, BATCH_SIZE, 0));
+    for (int i = 0; i < max_items; i++) {
+        check_batch_item(&rx_items[i], small_item, SMALL_ITEM_SIZE);
+    }
+    vRingbufferReturnItemBatch(no_split_rb, rx_items, max_items);
+    TEST_ASSERT_EQUAL(0, xRingbufferReceiveBatch(no_split_rb, rx_items, BATCH_SIZE, TIMEOUT_TICKS));
+    TEST_ASSERT_EQUAL(xRingbufferGetMaxItemSize(no_split_rb), xRingbufferGetCurFreeSize(no_split_rb));
+    vRingbufferDelete(no_split_rb);
+
+    //Allow-split buffer: both parts of a split item are retrieved together
+    RingbufHandle_t allow_split_rb = xRingbufferCreate(BUFFER_SIZE, RINGBUF_TYPE_ALLOWSPLIT);
+    TEST_ASSERT_MESSAGE(allow_split_rb != NULL, "Failed to create ring buffer");
+    for (int i = 0; i < BATCH_SIZE; i++) {
+        tx_items[i].pvItem = (void *)large_item;
+        tx_items[i].xItemSize = LARGE_ITEM_SIZE;
+    }
+    //Move the write pointer to where the 2nd item of the next batch has to be split in half
+    const size_t pad_size = BUFFER_SIZE - (ITEM_HDR_SIZE + LARGE_ITEM_SIZE) - (ITEM_HDR_SIZE + LARGE_ITEM_SIZE / 2) - ITEM_HDR_SIZE;
+    static uint8_t pad_data[BUFFER_SIZE];
+    TEST_ASSERT_EQUAL(pdTRUE, xRingbufferSend(allow_split_rb, pad_data, pad_size, 0));
+    TEST_ASSERT_EQUAL(1, xRingbufferReceiveBatch(allow_split_rb, rx_items, BATCH_SIZE, 0));
+    check_batch_item(&rx_items[0], pad_data, pad_size);
+    vRingbufferReturnItemBatch(allow_split_rb, rx_items, 1);
+    TEST_ASSERT_EQUAL(2, xRingbufferSendBatch(allow_split_rb, tx_items, 2, 0));
+    //The split item does not fit into the remaining element
+    TEST_ASSERT_EQUAL(1, xRingbufferReceiveBatch(allow_split_rb, rx_items, 2, 0));
+    check_batch_item(&rx_items[0], large_item, LARGE_ITEM_SIZE);
+    TEST_ASSERT_EQUAL(2, xRingbufferReceiveBatch(allow_split_rb, &rx_items[1], 2, 0));
+    TEST_ASSERT_EQUAL(pdTRUE, rx_items[1].xIsSplit);
+    TEST_ASSERT_EQUAL(pdFALSE, rx_items[2].xIsSplit);
+    TEST_ASSERT_EQUAL(LARGE_ITEM_SIZE, rx_items[1].xItemSize + rx_items[2].xItemSize);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(large_item, rx_items[1].pvItem, rx_items[1].xItemSize);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(&large_item[rx_items[1].xItemSize], rx_items[2].pvItem, rx_items[2].xItemSize);
+    vRingbufferReturnItemBatch(allow_split_rb, rx_items, 3);
+    TEST_ASSERT_EQUAL(xRingbufferGetMaxItemSize(allow_split_rb), xRingbufferGetCurFreeSize(allow_split_rb));
+    vRingbufferDelete(allow_split_rb);
+
+    //Byte buffer: items are appended to the stream of bytes, items of 0 size are skipped
+    RingbufHandle_t byte_rb = xRingbufferCreate(BUFFER_SIZE, RINGBUF_TYPE_BYTEBUF);
+    TEST_ASSERT_MESSAGE(byte_rb != NULL, "Failed to create ring buffer");
+    const RingbufferItem_t byte_items[] = {
+        { .pvItem = (void *)small_item, .xItemSize = SMALL_ITEM_SIZE },
+        { .pvItem = NULL, .xItemSize = 0 },
+        { .pvItem = (void *)large_item, .xItemSize = LARGE_ITEM_SIZE },
+    };
+    TEST_ASSERT_EQUAL(3, xRingbufferSendBatch(byte_rb, byte_items, 3, 0));
+    size_t item_size;
+    uint8_t *item = (uint8_t *)xRingbufferReceiveUpTo(byte_rb, &item_size, 0, BUFFER_SIZE);
+    TEST_ASSERT_MESSAGE(item != NULL, "Failed to receive item");
+    TEST_ASSERT_EQUAL(SMALL_ITEM_SIZE + LARGE_ITEM_SIZE, item_size);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(small_item, item, SMALL_ITEM_SIZE);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(large_item, item + SMALL_ITEM_SIZE, LARGE_ITEM_SIZE);
+    vRingbufferReturnItem(byte_rb, item);
+    vRingbufferDelete(byte_rb);
+}
+
+/* -------------------- Test ring buffer batch throughput ----------------------
+ * The following test case compares the number of items per second moved through
+ * a no-split ring buffer by single item calls and by batch calls, for item
+ * sizes from 8 to 256 bytes. The items are sent, received and returned in
+ * rounds of BENCH_BATCH_SIZE items from a single task, so that only the cost of
+ * the ring buffer calls is measured.
+ */
+
+#define BENCH_BUFFER_SIZE       8192
+#define BENCH_BATCH_SIZE        16
+#define BENCH_ITEMS             8192
+#define BENCH_MAX_ITEM_SIZE     256
+
+static uint32_t bench_items_per_sec(RingbufHandle_t handle, size_t item_size, bool batch)
+{
+    static uint8_t data[BENCH_MAX_ITEM_SIZE];
+    RingbufferItem_t tx_items[BENCH_BATCH_SIZE];
+    RingbufferItem_t rx_items[BENCH_BATCH_SIZE];
+    for (int i = 0; i < BENCH_BATCH_SIZE; i++) {
+        tx_items[i].pvItem = data;
+        tx_items[i].xItemSize = item_size;
+    }
+
+    int64_t start = esp_timer_get_time();
+    for (int round = 0; round < BENCH_ITEMS / BENCH_BATCH_SIZE; round++) {
+        if (batch) {
+            TEST_ASSERT_EQUAL(BENCH_BATCH_SIZE, xRingbufferSendBatch(handle, tx_items, BENCH_BATCH_SIZE, 0));
+            TEST_ASSERT_EQUAL(BENCH_BATCH_SIZE, xRingbufferReceiveBatch(handle, rx_items, BENCH_BATCH_SIZE, 0));
+            vRingbufferReturnItemBatch(handle, rx_items, BENCH_BATCH_SIZE);
+        } else {
+            for (int i = 0; i < BENCH_BATCH_SIZE; i++) {
+                TEST_ASSERT_EQUAL(pdTRUE, xRingbufferSend(handle, data, item_size, 0));
+            }
+            for (int i = 0; i < BENCH_BATCH_SIZE; i++) {
+                rx_items[i].pvItem = xRingbufferReceive(handle, &rx_items[i].xItemSize, 0);
+                TEST_ASSERT_NOT_NULL(rx_items[i].pvItem);
+            }
+            for (int i = 0; i < BENCH_BATCH_SIZE; i++) {
+                vRingbufferReturnItem(handle, rx_items[i].pvItem);
+            }
+        }
+    }
+    int64_t elapsed = esp_timer_get_time() - start;
+    return (uint32_t)((int64_t)BENCH_ITEMS * 1000000 / (elapsed > 0 ? elapsed : 1));
+}
+
+TEST_CASE("Test ring buffer batch throughput", "[esp_ringbuf]")
+{
+    RingbufHandle_t handle = xRingbufferCreate(BENCH_BUFFER_SIZE, RINGBUF_TYPE_NOSPLIT);
+    TEST_ASSERT_MESSAGE(handle != NULL, "Failed to create ring buffer");
+
+    for (size_t item_size = 8; item_size <= BENCH_MAX_ITEM_SIZE; item_size *= 2) {
+        uint32_t single = bench_items_per_sec(handle, item_size, false);
+        uint32_t batch = bench_items_per_sec(handle, item_size, true);
+        printf("%3u byte items: %"PRIu32" items/s single, %"PRIu32" items/s batch (x%d)\n",
+               (unsigned)item_size, single, batch, BENCH_BATCH_SIZE);
+    }
+
+    vRingbufferDelete(handle);
+}
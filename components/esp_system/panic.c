@@ -58,6 +58,10 @@
 #include "esp_gdbstub.h"
 #endif
 
+#if CONFIG_LOG_ASYNC
+#include "esp_log_async.h"
+#endif
+
 #if CONFIG_ESP_CONSOLE_USB_SERIAL_JTAG || CONFIG_ESP_CONSOLE_SECONDARY_USB_SERIAL_JTAG
 #include "hal/usb_serial_jtag_ll.h"
 #endif
@@ -252,6 +256,11 @@ void esp_panic_handler(panic_info_t *info)
         info->exception = PANIC_EXCEPTION_ABORT;
     }
 
+#if CONFIG_LOG_ASYNC
+    // The log messages which the asynchronous log task hasn't written yet precede the panic
+    esp_log_async_panic_flush(&panic_print_char);
+#endif
+
     /*
       * For any supported chip, the panic handler prints the contents of panic_info_t in the following format:
       *
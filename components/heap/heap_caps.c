@@ -114,6 +114,58 @@ bool heap_caps_match(const heap_t *heap, uint32_t caps)
 }
 
 
+/*
+Return the indexes into lookup->heaps of the heaps to try for an allocation with these
+capabilities, or NULL if they are not in the lookup table.
+*/
+HEAP_IRAM_ATTR static const uint8_t *lookup_candidates(const heap_caps_lookup_t *lookup, uint32_t caps, size_t *num_candidates)
+{
+    if (lookup == NULL) {
+        return NULL;
+    }
+    for (size_t entry = 0; entry < HEAP_CAPS_LOOKUP_NUM_CAPS; entry++) {
+        if (lookup->caps[entry] == caps) {
+            *num_candidates = lookup->num_candidates[entry];
+            return &lookup->candidates[entry * lookup->num_heaps];
+        }
+    }
+    return NULL;
+}
+
+/*
+Try to allocate from a heap which satisfies the requested capabilities.
+*/
+HEAP_IRAM_ATTR static void *heap_caps_malloc_from_heap(heap_t *heap, size_t size, uint32_t caps)
+{
+    void *ret;
+
+    // If MALLOC_CAP_EXEC is requested but the DRAM and IRAM are on the same addresses (like on esp32c6)
+    // proceed as for a default allocation.
+    if ((caps & MALLOC_CAP_EXEC) && !esp_dram_match_iram() && esp_ptr_in_diram_dram((void *)heap->start)) {
+        //This is special, insofar that what we're going to get back is a DRAM address. If so,
+        //we need to 'invert' it (lowest address in DRAM == highest address in IRAM and vice-versa) and
+        //add a pointer to the DRAM equivalent before the address we're going to return.
+        ret = multi_heap_malloc(heap->heap, MULTI_HEAP_ADD_BLOCK_OWNER_SIZE(size) + 4);  // int overflow checked by the caller
+        if (ret != NULL) {
+            MULTI_HEAP_SET_BLOCK_OWNER(ret);
+            ret = MULTI_HEAP_ADD_BLOCK_OWNER_OFFSET(ret);
+            uint32_t *iptr = dram_alloc_to_iram_addr(ret, size + 4);  // int overflow checked by the caller
+            CALL_HOOK(esp_heap_trace_alloc_hook, iptr, size, caps);
+            return iptr;
+        }
+    } else {
+        //Just try to alloc, nothing special.
+        ret = multi_heap_malloc(heap->heap, MULTI_HEAP_ADD_BLOCK_OWNER_SIZE(size));
+        if (ret != NULL) {
+            MULTI_HEAP_SET_BLOCK_OWNER(ret);
+            ret = MULTI_HEAP_ADD_BLOCK_OWNER_OFFSET(ret);
+            CALL_HOOK(esp_heap_trace_alloc_hook, ret, size, caps);
+            return ret;
+        }
+    }
+    return NULL;
+}
+
 /*
 This function should not be called directly as it does not
 check for failure / call heap_caps_alloc_failed()
@@ -146,6 +198,21 @@ HEAP_IRAM_ATTR static void *heap_caps_malloc_base( size_t size, uint32_t caps)
         size = (size + 3) & (~3); // int overflow checked above
     }
 
+    size_t num_candidates;
+    const heap_caps_lookup_t *lookup = heap_caps_lookup_acquire();
+    const uint8_t *candidates = lookup_candidates(lookup, caps, &num_candidates);
+    if (candidates != NULL) {
+        for (size_t i = 0; i < num_candidates; i++) {
+            ret = heap_caps_malloc_from_heap(lookup->heaps[candidates[i]].heap, size, caps);
+            if (ret != NULL) {
+                break;
+            }
+        }
+        heap_caps_lookup_release();
+        return ret;
+    }
+    heap_caps_lookup_release();
+
     for (int prio = 0; prio < SOC_MEMORY_TYPE_NO_PRIOS; prio++) {
         //Iterate over heaps and check capabilities at this priority
         heap_t *heap;
@@ -158,29 +225,9 @@ HEAP_IRAM_ATTR static void *heap_caps_malloc_base( size_t size, uint32_t caps)
                 //doesn't cover, see if they're available in other prios.
                 if ((get_all_caps(heap) & caps) == caps) {
                     //This heap can satisfy all the requested capabilities. See if we can grab some memory using it.
-                    // If MALLOC_CAP_EXEC is requested but the DRAM and IRAM are on the same addresses (like on esp32c6)
-                    // proceed as for a default allocation.
-                    if ((caps & MALLOC_CAP_EXEC) && !esp_dram_match_iram() && esp_ptr_in_diram_dram((void *)heap->start)) {
-                        //This is special, insofar that what we're going to get back is a DRAM address. If so,
-                        //we need to 'invert' it (lowest address in DRAM == highest address in IRAM and vice-versa) and
-                        //add a pointer to the DRAM equivalent before the address we're going to return.
-                        ret = multi_heap_malloc(heap->heap, MULTI_HEAP_ADD_BLOCK_OWNER_SIZE(size) + 4);  // int overflow checked above
-                        if (ret != NULL) {
-                            MULTI_HEAP_SET_BLOCK_OWNER(ret);
-                            ret = MULTI_HEAP_ADD_BLOCK_OWNER_OFFSET(ret);
-                            uint32_t *iptr = dram_alloc_to_iram_addr(ret, size + 4);  // int overflow checked above
-                            CALL_HOOK(esp_heap_trace_alloc_hook, iptr, size, caps);
-                            return iptr;
-                        }
-                    } else {
-                        //Just try to alloc, nothing special.
-                        ret = multi_heap_malloc(heap->heap, MULTI_HEAP_ADD_BLOCK_OWNER_SIZE(size));
-                        if (ret != NULL) {
-                            MULTI_HEAP_SET_BLOCK_OWNER(ret);
-                            ret = MULTI_HEAP_ADD_BLOCK_OWNER_OFFSET(ret);
-                            CALL_HOOK(esp_heap_trace_alloc_hook, ret, size, caps);
-                            return ret;
-                        }
+                    ret = heap_caps_malloc_from_heap(heap, size, caps);
+                    if (ret != NULL) {
+                        return ret;
                     }
                 }
             }
@@ -363,6 +410,28 @@ HEAP_IRAM_ATTR void *heap_caps_calloc_prefer( size_t n, size_t size, size_t num,
 HEAP_IRAM_ATTR static heap_t *find_containing_heap(void *ptr )
 {
     intptr_t p = (intptr_t)ptr;
+    const heap_caps_lookup_t *lookup = heap_caps_lookup_acquire();
+    if (lookup != NULL && !lookup->heaps_nested) {
+        //Binary search for the last heap starting at or before p
+        size_t low = 0;
+        size_t high = lookup->num_heaps;
+        while (low < high) {
+            size_t mid = (low + high) / 2;
+            if (lookup->heaps[mid].start <= p) {
+                low = mid + 1;
+            } else {
+                high = mid;
+            }
+        }
+        if (low > 0 && p < lookup->heaps[low - 1].end) {
+            heap_t *heap = lookup->heaps[low - 1].heap;
+            heap_caps_lookup_release();
+            return heap;
+        }
+        //Not found, the heap may have been registered after the lookup table was built
+    }
+    heap_caps_lookup_release();
+
     heap_t *heap;
     SLIST_FOREACH(heap, &registered_heaps, next) {
         if (heap->heap != NULL && p >= heap->start && p < heap->end) {
@@ -579,6 +648,20 @@ void heap_caps_get_info( multi_heap_info_t *info, uint32_t caps )
             info->allocated_blocks += hinfo.allocated_blocks;
             info->free_blocks += hinfo.free_blocks;
             info->total_blocks += hinfo.total_blocks;
+#if CONFIG_HEAP_SIZE_CLASS_CACHE
+            info->cached_bytes += hinfo.cached_bytes;
+            info->cached_blocks += hinfo.cached_blocks;
+#endif
+        }
+    }
+}
+
+void heap_caps_cache_flush( uint32_t caps )
+{
+    heap_t *heap;
+    SLIST_FOREACH(heap, &registered_heaps, next) {
+        if (heap_caps_match(heap, caps)) {
+            multi_heap_cache_flush(heap->heap);
         }
     }
 }
@@ -597,12 +680,30 @@ void heap_caps_print_heap_info( uint32_t caps )
             printf("    largest_free_block %d alloc_blocks %d free_blocks %d total_blocks %d\n",
                    info.largest_free_block, info.allocated_blocks,
                    info.free_blocks, info.total_blocks);
+#if CONFIG_HEAP_SIZE_CLASS_CACHE
+            printf("    cached %d cached_blocks %d\n", info.cached_bytes, info.cached_blocks);
+#endif
         }
     }
     printf("  Totals:\n");
     heap_caps_get_info(&info, caps);
 
     printf("    free %d allocated %d min_free %d largest_free_block %d\n", info.total_free_bytes, info.total_allocated_bytes, info.minimum_free_bytes, info.largest_free_block);
+#if CONFIG_HEAP_SIZE_CLASS_CACHE
+    printf("    cached %d\n", info.cached_bytes);
+#endif
+
+    heap_caps_pool_info_t pool_info;
+    intptr_t pool_objects;
+    for (size_t i = 0; heap_caps_pool_get_info_at(i, &pool_info, &pool_objects); i++) {
+        heap = find_containing_heap((void *)pool_objects);
+        if (heap != NULL && heap_caps_match(heap, caps)) {
+            printf("  Pool at 0x%08x object_size %d objects %d free %d min_free %d\n",
+                   pool_objects, pool_info.object_size, pool_info.total_objects,
+                   pool_info.free_objects, pool_info.minimum_free_objects);
+            printf("    failed_allocations %d\n", pool_info.failed_allocations);
+        }
+    }
 }
 
 bool heap_caps_check_integrity(uint32_t caps, bool print_errors)
@@ -685,6 +786,29 @@ HEAP_IRAM_ATTR void *heap_caps_aligned_alloc(size_t alignment, size_t size, uint
         return NULL;
     }
 
+    size_t num_candidates;
+    const heap_caps_lookup_t *lookup = heap_caps_lookup_acquire();
+    const uint8_t *candidates = lookup_candidates(lookup, caps, &num_candidates);
+    if (candidates != NULL) {
+        for (size_t i = 0; i < num_candidates; i++) {
+            heap_t *heap = lookup->heaps[candidates[i]].heap;
+            ret = multi_heap_aligned_alloc(heap->heap, MULTI_HEAP_ADD_BLOCK_OWNER_SIZE(size), alignment);
+            if (ret != NULL) {
+                break;
+            }
+        }
+        heap_caps_lookup_release();
+        if (ret != NULL) {
+            MULTI_HEAP_SET_BLOCK_OWNER(ret);
+            ret = MULTI_HEAP_ADD_BLOCK_OWNER_OFFSET(ret);
+            CALL_HOOK(esp_heap_trace_alloc_hook, ret, size, caps);
+            return ret;
+        }
+        heap_caps_alloc_failed(size, caps, __func__);
+        return NULL;
+    }
+    heap_caps_lookup_release();
+
     for (int prio = 0; prio < SOC_MEMORY_TYPE_NO_PRIOS; prio++) {
         //Iterate over heaps and check capabilities at this priority
         heap_t *heap;
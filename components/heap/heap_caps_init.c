@@ -19,6 +19,171 @@ static const char *TAG = "heap_init";
 /* Linked-list of registered heaps */
 struct registered_heap_ll registered_heaps;
 
+/* Lookup tables for registered_heaps, see heap_private.h */
+heap_caps_lookup_t *heap_caps_lookup;
+uint32_t heap_caps_lookup_readers;
+
+/* Replaced lookup tables which may still be in use, protected by registered_heaps_write_lock */
+static heap_caps_lookup_t *s_retired_lookups;
+
+/* Serializes modifications of registered_heaps and heap_caps_lookup */
+static multi_heap_lock_t registered_heaps_write_lock = MULTI_HEAP_LOCK_STATIC_INITIALIZER;
+
+/* Capabilities masks with precomputed candidate heaps, as passed to heap_caps_malloc_base()
+   after its adjustments: malloc(), the common driver and application requests */
+static const uint32_t s_lookup_caps[HEAP_CAPS_LOOKUP_NUM_CAPS] = {
+    MALLOC_CAP_DEFAULT | MALLOC_CAP_INTERNAL,
+    MALLOC_CAP_DEFAULT | MALLOC_CAP_SPIRAM,
+    MALLOC_CAP_DEFAULT,
+    MALLOC_CAP_8BIT,
+    MALLOC_CAP_8BIT | MALLOC_CAP_INTERNAL,
+    MALLOC_CAP_32BIT,
+    MALLOC_CAP_32BIT | MALLOC_CAP_INTERNAL,
+    MALLOC_CAP_INTERNAL,
+    MALLOC_CAP_DMA,
+    MALLOC_CAP_DMA | MALLOC_CAP_8BIT,
+    MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL,
+    MALLOC_CAP_DMA | MALLOC_CAP_8BIT | MALLOC_CAP_INTERNAL,
+    MALLOC_CAP_SPIRAM,
+    MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT,
+    MALLOC_CAP_EXEC | MALLOC_CAP_32BIT,
+    MALLOC_CAP_EXEC | MALLOC_CAP_32BIT | MALLOC_CAP_INTERNAL,
+};
+
+/* Number of entries of registered_heaps, an upper bound of the number of heaps in the lookup tables */
+static size_t count_registered_heaps(void)
+{
+    size_t count = 0;
+    heap_t *heap;
+    SLIST_FOREACH(heap, &registered_heaps, next) {
+        count++;
+    }
+    return count;
+}
+
+/* Allocate lookup tables for the registered heaps and extra_heaps heaps about to be
+   registered, then take registered_heaps_write_lock. The allocation is done before
+   taking the lock, which is a spinlock. Returns NULL if the tables can't be allocated. */
+static heap_caps_lookup_t *alloc_lookup_and_lock(size_t extra_heaps)
+{
+    while (true) {
+        size_t max_heaps = count_registered_heaps() + extra_heaps;
+        heap_caps_lookup_t *lookup = NULL;
+        if (max_heaps <= UINT8_MAX) {
+            lookup = heap_caps_malloc(sizeof(heap_caps_lookup_t) + max_heaps * sizeof(heap_range_t)
+                                      + HEAP_CAPS_LOOKUP_NUM_CAPS * max_heaps, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        }
+        MULTI_HEAP_LOCK(&registered_heaps_write_lock);
+        /* Retry if another region has been added meanwhile */
+        if (lookup == NULL || count_registered_heaps() + extra_heaps <= max_heaps) {
+            return lookup;
+        }
+        MULTI_HEAP_UNLOCK(&registered_heaps_write_lock);
+        heap_caps_free(lookup);
+    }
+}
+
+/* Publish lookup as heap_caps_lookup and retire the previous tables. Returns the list of
+   retired tables which can be freed, as no task is using any lookup tables. */
+static heap_caps_lookup_t *publish_lookup(heap_caps_lookup_t *lookup)
+{
+    heap_caps_lookup_t *previous = __atomic_exchange_n(&heap_caps_lookup, lookup, __ATOMIC_SEQ_CST);
+    if (previous != NULL) {
+        previous->next_retired = s_retired_lookups;
+        s_retired_lookups = previous;
+    }
+    /* See heap_caps_lookup_acquire(), a task which starts using the tables now gets the new ones */
+    if (__atomic_load_n(&heap_caps_lookup_readers, __ATOMIC_SEQ_CST) != 0) {
+        return NULL;
+    }
+    heap_caps_lookup_t *retired = s_retired_lookups;
+    s_retired_lookups = NULL;
+    return retired;
+}
+
+/* Rebuild heap_caps_lookup from registered_heaps into lookup, allocated by alloc_lookup_and_lock().
+   Called with registered_heaps_write_lock held. Returns the retired tables to be freed by
+   free_retired_lookups() after releasing the lock. */
+static heap_caps_lookup_t *update_lookup(heap_caps_lookup_t *lookup)
+{
+    size_t num_heaps = 0;
+    heap_t *heap;
+    SLIST_FOREACH(heap, &registered_heaps, next) {
+        if (heap->heap != NULL) {
+            num_heaps++;
+        }
+    }
+
+    if (lookup == NULL) {
+        /* Allocations and frees walk registered_heaps */
+        return publish_lookup(NULL);
+    }
+    lookup->num_heaps = num_heaps;
+    lookup->heaps = (heap_range_t *)(lookup + 1);
+    lookup->candidates = (uint8_t *)(lookup->heaps + num_heaps);
+
+    /* Insertion sort by start address */
+    size_t count = 0;
+    SLIST_FOREACH(heap, &registered_heaps, next) {
+        if (heap->heap == NULL) {
+            continue;
+        }
+        size_t i = count++;
+        while (i > 0 && lookup->heaps[i - 1].start > heap->start) {
+            lookup->heaps[i] = lookup->heaps[i - 1];
+            i--;
+        }
+        lookup->heaps[i] = (heap_range_t) {
+            .start = heap->start, .end = heap->end, .heap = heap
+        };
+    }
+    lookup->heaps_nested = false;
+    for (size_t i = 1; i < num_heaps; i++) {
+        if (lookup->heaps[i].start < lookup->heaps[i - 1].end) {
+            lookup->heaps_nested = true;
+        }
+    }
+
+    /* Same order as the walk in heap_caps_malloc_base(), without the repetitions */
+    for (size_t entry = 0; entry < HEAP_CAPS_LOOKUP_NUM_CAPS; entry++) {
+        const uint32_t caps = s_lookup_caps[entry];
+        uint8_t *candidates = &lookup->candidates[entry * num_heaps];
+        size_t num_candidates = 0;
+        for (int prio = 0; prio < SOC_MEMORY_TYPE_NO_PRIOS; prio++) {
+            SLIST_FOREACH(heap, &registered_heaps, next) {
+                if (heap->heap == NULL || (heap->caps[prio] & caps) == 0 || (get_all_caps(heap) & caps) != caps) {
+                    continue;
+                }
+                size_t index = 0;
+                while (lookup->heaps[index].heap != heap) {
+                    index++;
+                }
+                bool listed = false;
+                for (size_t i = 0; i < num_candidates; i++) {
+                    listed |= (candidates[i] == index);
+                }
+                if (!listed) {
+                    candidates[num_candidates++] = index;
+                }
+            }
+        }
+        lookup->caps[entry] = caps;
+        lookup->num_candidates[entry] = num_candidates;
+    }
+
+    lookup->next_retired = NULL;
+    return publish_lookup(lookup);
+}
+
+static void free_retired_lookups(heap_caps_lookup_t *retired)
+{
+    while (retired != NULL) {
+        heap_caps_lookup_t *next = retired->next_retired;
+        heap_caps_free(retired);
+        retired = next;
+    }
+}
+
 static void register_heap(heap_t *region)
 {
     size_t heap_size = region->end - region->start;
@@ -42,6 +207,11 @@ void heap_caps_enable_nonos_stack_heaps(void)
             }
         }
     }
+
+    heap_caps_lookup_t *lookup = alloc_lookup_and_lock(0);
+    heap_caps_lookup_t *retired = update_lookup(lookup);
+    MULTI_HEAP_UNLOCK(&registered_heaps_write_lock);
+    free_retired_lookups(retired);
 }
 
 /* Initialize the heap allocator to use all of the memory not
@@ -146,6 +316,12 @@ void heap_caps_init(void)
             SLIST_INSERT_AFTER(&heaps_array[i-1], &heaps_array[i], next);
         }
     }
+
+    /* Nothing else runs yet, the lock is only taken for alloc_lookup_and_lock() */
+    heap_caps_lookup_t *lookup = alloc_lookup_and_lock(0);
+    heap_caps_lookup_t *retired = update_lookup(lookup);
+    MULTI_HEAP_UNLOCK(&registered_heaps_write_lock);
+    free_retired_lookups(retired);
 }
 
 esp_err_t heap_caps_add_region(intptr_t start, intptr_t end)
@@ -241,10 +417,11 @@ esp_err_t heap_caps_add_region_with_caps(const uint32_t caps[], intptr_t start,
     /* (This insertion is atomic to registered_heaps, so
        we don't need to worry about thread safety for readers,
        only for writers. */
-    static multi_heap_lock_t registered_heaps_write_lock = MULTI_HEAP_LOCK_STATIC_INITIALIZER;
-    MULTI_HEAP_LOCK(&registered_heaps_write_lock);
+    heap_caps_lookup_t *lookup = alloc_lookup_and_lock(1);
     SLIST_INSERT_HEAD(&registered_heaps, p_new, next);
+    heap_caps_lookup_t *retired = update_lookup(lookup);
     MULTI_HEAP_UNLOCK(&registered_heaps_write_lock);
+    free_retired_lookups(retired);
 
     err = ESP_OK;
 
@@ -162,6 +162,10 @@ void heap_caps_get_info( multi_heap_info_t *info, uint32_t caps )
     memset(info, 0, sizeof(multi_heap_info_t));
 }
 
+void heap_caps_cache_flush( uint32_t caps )
+{
+}
+
 void heap_caps_print_heap_info( uint32_t caps )
 {
     printf("No heap summary available when building for the linux target");
@@ -0,0 +1,220 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Pools of fixed-size objects.
+ *
+ * The objects of a pool are an array in a single block allocated with
+ * heap_caps_malloc(). Free objects form singly linked lists, the first word
+ * of each free object holds the index of the next free object.
+ *
+ * A free list is a lock-free stack: its head word holds the index of the first
+ * free object in the lower 16 bits and a counter in the upper 16 bits, which
+ * is incremented by every change of the head. The counter makes the
+ * compare-and-swap of a pop fail if other tasks popped and pushed objects in
+ * between, even if the first object is the same again.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <assert.h>
+#include <sys/queue.h>
+#include "sdkconfig.h"
+#include "esp_heap_caps.h"
+#include "esp_heap_caps_pool.h"
+#include "multi_heap_platform.h"
+#if !CONFIG_IDF_TARGET_LINUX
+#include "heap_private.h"
+#endif
+
+#ifdef CONFIG_HEAP_USE_HOOKS
+#define CALL_HOOK(hook, ...) {      \
+    if (hook != NULL) {             \
+        hook(__VA_ARGS__);          \
+    }                               \
+}
+#else
+#define CALL_HOOK(hook, ...) {}
+#endif
+
+#define FREE_LIST_END       0xffffu
+#define FREE_LIST_INDEX     0xffffu
+#define FREE_LIST_COUNTER   0x10000u
+
+struct heap_caps_pool {
+    SLIST_ENTRY(heap_caps_pool) next;
+    uint8_t *objects;
+    size_t object_size;
+    size_t count;
+    uint32_t caps;
+    size_t num_free_lists;
+    uint32_t in_use;                // accessed atomically
+    uint32_t max_in_use;            // accessed atomically
+    uint32_t failed_allocations;    // accessed atomically
+    uint32_t free_lists[];          // one, or one per core, accessed atomically
+};
+
+/* All pools, for heap_caps_print_heap_info() */
+static SLIST_HEAD(heap_caps_pool_ll, heap_caps_pool) s_pools = SLIST_HEAD_INITIALIZER(s_pools);
+static multi_heap_lock_t s_pools_lock = MULTI_HEAP_LOCK_STATIC_INITIALIZER;
+
+static inline uint32_t *link_word(heap_caps_pool_handle_t pool, uint32_t index)
+{
+    return (uint32_t *)(pool->objects + index * pool->object_size);
+}
+
+HEAP_IRAM_ATTR static void *pop(heap_caps_pool_handle_t pool, uint32_t *free_list)
+{
+    uint32_t head = __atomic_load_n(free_list, __ATOMIC_ACQUIRE);
+    uint32_t index;
+    uint32_t new_head;
+    do {
+        index = head & FREE_LIST_INDEX;
+        if (index == FREE_LIST_END) {
+            return NULL;
+        }
+        // If another task has taken the object meanwhile, this reads garbage, but the head has changed
+        uint32_t next = __atomic_load_n(link_word(pool, index), __ATOMIC_RELAXED);
+        new_head = ((head + FREE_LIST_COUNTER) & ~FREE_LIST_INDEX) | (next & FREE_LIST_INDEX);
+    } while (!__atomic_compare_exchange_n(free_list, &head, new_head, true, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE));
+    return link_word(pool, index);
+}
+
+HEAP_IRAM_ATTR static void push(heap_caps_pool_handle_t pool, uint32_t *free_list, uint32_t index)
+{
+    uint32_t head = __atomic_load_n(free_list, __ATOMIC_RELAXED);
+    uint32_t new_head;
+    do {
+        __atomic_store_n(link_word(pool, index), head & FREE_LIST_INDEX, __ATOMIC_RELAXED);
+        new_head = ((head + FREE_LIST_COUNTER) & ~FREE_LIST_INDEX) | index;
+    } while (!__atomic_compare_exchange_n(free_list, &head, new_head, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+static inline size_t own_free_list(heap_caps_pool_handle_t pool)
+{
+    return (pool->num_free_lists > 1) ? MULTI_HEAP_CORE_ID() : 0;
+}
+
+heap_caps_pool_handle_t heap_caps_pool_create(size_t object_size, size_t count, uint32_t caps)
+{
+    return heap_caps_pool_create_with_flags(object_size, count, caps, 0);
+}
+
+heap_caps_pool_handle_t heap_caps_pool_create_with_flags(size_t object_size, size_t count, uint32_t caps, uint32_t flags)
+{
+    if (object_size == 0 || count == 0 || count > HEAP_CAPS_POOL_MAX_OBJECTS) {
+        return NULL;
+    }
+    // Objects are aligned like pointers, and have room for the index of the next free object
+    size_t aligned_size = (object_size + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+    size_t objects_size;
+    if (aligned_size < object_size || __builtin_mul_overflow(aligned_size, count, &objects_size)) {
+        return NULL;
+    }
+
+    size_t num_free_lists = (flags & HEAP_CAPS_POOL_FLAG_PER_CORE) ? MULTI_HEAP_NUM_CORES : 1;
+    heap_caps_pool_handle_t pool = heap_caps_calloc(1, sizeof(struct heap_caps_pool) + num_free_lists * sizeof(uint32_t),
+                                                    MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (pool == NULL) {
+        return NULL;
+    }
+    pool->objects = heap_caps_malloc(objects_size, caps);
+    if (pool->objects == NULL) {
+        heap_caps_free(pool);
+        return NULL;
+    }
+    pool->object_size = aligned_size;
+    pool->count = count;
+    pool->caps = caps;
+    pool->num_free_lists = num_free_lists;
+
+    // Each free list gets a contiguous part of the objects
+    for (size_t list = 0; list < num_free_lists; list++) {
+        uint32_t first = count * list / num_free_lists;
+        uint32_t end = count * (list + 1) / num_free_lists;
+        for (uint32_t index = first; index < end; index++) {
+            *link_word(pool, index) = (index + 1 < end) ? index + 1 : FREE_LIST_END;
+        }
+        pool->free_lists[list] = (first < end) ? first : FREE_LIST_END;
+    }
+
+    MULTI_HEAP_LOCK(&s_pools_lock);
+    SLIST_INSERT_HEAD(&s_pools, pool, next);
+    MULTI_HEAP_UNLOCK(&s_pools_lock);
+    return pool;
+}
+
+void heap_caps_pool_delete(heap_caps_pool_handle_t pool)
+{
+    if (pool == NULL) {
+        return;
+    }
+    MULTI_HEAP_LOCK(&s_pools_lock);
+    SLIST_REMOVE(&s_pools, pool, heap_caps_pool, next);
+    MULTI_HEAP_UNLOCK(&s_pools_lock);
+    heap_caps_free(pool->objects);
+    heap_caps_free(pool);
+}
+
+HEAP_IRAM_ATTR void *heap_caps_pool_alloc(heap_caps_pool_handle_t pool)
+{
+    size_t own = own_free_list(pool);
+    void *ptr = NULL;
+    for (size_t i = 0; i < pool->num_free_lists && ptr == NULL; i++) {
+        ptr = pop(pool, &pool->free_lists[(own + i) % pool->num_free_lists]);
+    }
+    if (ptr == NULL) {
+        __atomic_fetch_add(&pool->failed_allocations, 1, __ATOMIC_RELAXED);
+        return NULL;
+    }
+
+    uint32_t in_use = __atomic_add_fetch(&pool->in_use, 1, __ATOMIC_RELAXED);
+    uint32_t max_in_use = __atomic_load_n(&pool->max_in_use, __ATOMIC_RELAXED);
+    while (in_use > max_in_use
+           && !__atomic_compare_exchange_n(&pool->max_in_use, &max_in_use, in_use, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+    CALL_HOOK(esp_heap_trace_alloc_hook, ptr, pool->object_size, pool->caps);
+    return ptr;
+}
+
+HEAP_IRAM_ATTR void heap_caps_pool_free(heap_caps_pool_handle_t pool, void *ptr)
+{
+    if (ptr == NULL) {
+        return;
+    }
+    size_t offset = (uint8_t *)ptr - pool->objects;
+    assert((uint8_t *)ptr >= pool->objects && offset < pool->count * pool->object_size
+           && offset % pool->object_size == 0 && "free() target pointer is not an object of this pool");
+    CALL_HOOK(esp_heap_trace_free_hook, ptr);
+
+    __atomic_fetch_sub(&pool->in_use, 1, __ATOMIC_RELAXED);
+    push(pool, &pool->free_lists[own_free_list(pool)], offset / pool->object_size);
+}
+
+void heap_caps_pool_get_info(heap_caps_pool_handle_t pool, heap_caps_pool_info_t *info)
+{
+    info->object_size = pool->object_size;
+    info->total_objects = pool->count;
+    info->free_objects = pool->count - __atomic_load_n(&pool->in_use, __ATOMIC_RELAXED);
+    info->minimum_free_objects = pool->count - __atomic_load_n(&pool->max_in_use, __ATOMIC_RELAXED);
+    info->failed_allocations = __atomic_load_n(&pool->failed_allocations, __ATOMIC_RELAXED);
+}
+
+bool heap_caps_pool_get_info_at(size_t position, heap_caps_pool_info_t *info, intptr_t *objects)
+{
+    heap_caps_pool_handle_t pool;
+    MULTI_HEAP_LOCK(&s_pools_lock);
+    SLIST_FOREACH(pool, &s_pools, next) {
+        if (position-- == 0) {
+            heap_caps_pool_get_info(pool, info);
+            *objects = (intptr_t)pool->objects;
+            break;
+        }
+    }
+    MULTI_HEAP_UNLOCK(&s_pools_lock);
+    return pool != NULL;
+}
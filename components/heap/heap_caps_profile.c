@@ -0,0 +1,471 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Allocation site profiler.
+ *
+ * The heap functions are wrapped by the linker (see CMakeLists.txt), like for
+ * heap tracing, so that the return address of the wrapper is the call site in
+ * the application. Calls between the heap functions themselves aren't wrapped.
+ *
+ * Two fixed tables are kept, both with open addressing and linear probing:
+ * - the call sites, identified by their return addresses, with the
+ *   statistics of each site. Sites are never removed, allocations made from
+ *   new sites when the table is full are attributed to an "other" site;
+ * - the live allocations, mapping the address of each allocation to its
+ *   size and site, so that a free can be attributed. Entries are removed by
+ *   shifting the following entries back, so no tombstones are needed.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <sys/param.h>
+#include "sdkconfig.h"
+#include "esp_heap_caps.h"
+#include "esp_heap_caps_profile.h"
+#include "multi_heap_platform.h"
+#if !CONFIG_IDF_TARGET_LINUX
+#include "esp_memory_utils.h"
+#endif
+
+#define STACK_DEPTH         CONFIG_HEAP_PROFILING_STACK_DEPTH
+#define MAX_SITES           CONFIG_HEAP_PROFILING_MAX_SITES
+#define MAX_ALLOCATIONS     CONFIG_HEAP_PROFILING_MAX_ALLOCATIONS
+#define OTHER_SITE          MAX_SITES
+
+_Static_assert((MAX_SITES & (MAX_SITES - 1)) == 0, "CONFIG_HEAP_PROFILING_MAX_SITES must be a power of 2");
+_Static_assert((MAX_ALLOCATIONS & (MAX_ALLOCATIONS - 1)) == 0, "CONFIG_HEAP_PROFILING_MAX_ALLOCATIONS must be a power of 2");
+_Static_assert(MAX_SITES < UINT16_MAX, "site index must fit into uint16_t");
+
+typedef struct {
+    void *callers[STACK_DEPTH];     // callers[0] is NULL for an unused entry
+    size_t allocations;
+    size_t frees;
+    size_t live_bytes;
+    size_t peak_live_bytes;
+    size_t sampled_allocations;     // value of allocations at the previous sample of the rate
+} site_t;
+
+typedef struct {
+    void *ptr;                      // NULL for an unused entry
+    size_t size;
+    uint16_t site;
+} live_allocation_t;
+
+static site_t s_sites[MAX_SITES + 1];   // the last one is OTHER_SITE
+static size_t s_num_sites;
+static live_allocation_t s_live[MAX_ALLOCATIONS];
+static size_t s_num_live;
+static size_t s_untracked_allocations;
+static int64_t s_sample_time_us;
+static multi_heap_lock_t s_profile_lock = MULTI_HEAP_LOCK_STATIC_INITIALIZER;
+
+#if CONFIG_IDF_TARGET_LINUX
+#define CALLER_IS_VALID(PC) ((PC) != NULL)
+#else
+#define CALLER_IS_VALID(PC) esp_ptr_executable(PC)
+#endif
+
+/* Stores the return addresses of the calling function, must be expanded in the wrapper
+   itself. __builtin_return_address needs a constant argument, so the loop is unrolled. */
+#define CALLER(CALLERS, N) do {                                         \
+        if (STACK_DEPTH > N && !stop) {                                 \
+            CALLERS[N] = __builtin_return_address(N);                   \
+            stop = !CALLER_IS_VALID(CALLERS[N]);                        \
+            if (stop) {                                                 \
+                CALLERS[N] = NULL;                                      \
+            }                                                           \
+        }                                                               \
+    } while (0)
+
+#define GET_CALLERS(CALLERS) do {                                       \
+        bool stop = false;                                              \
+        memset(CALLERS, 0, sizeof(void *) * STACK_DEPTH);               \
+        CALLER(CALLERS, 0);                                             \
+        CALLER(CALLERS, 1);                                             \
+        CALLER(CALLERS, 2);                                             \
+        CALLER(CALLERS, 3);                                             \
+    } while (0)
+
+_Static_assert(STACK_DEPTH >= 1 && STACK_DEPTH <= 4, "CONFIG_HEAP_PROFILING_STACK_DEPTH must be in range 1-4");
+
+static inline size_t hash_ptr(const void *ptr, size_t table_size)
+{
+    uint32_t value = (uint32_t)(uintptr_t)ptr;
+    return ((value >> 3) * 2654435761u) & (table_size - 1);
+}
+
+/* Returns the index of the site of the callers, adding it if necessary */
+static HEAP_IRAM_ATTR uint16_t find_site(void * const *callers)
+{
+    if (callers[0] == NULL) {
+        return OTHER_SITE;
+    }
+    size_t index = hash_ptr(callers[0], MAX_SITES);
+    for (size_t probe = 0; probe < MAX_SITES; probe++) {
+        site_t *site = &s_sites[index];
+        if (site->callers[0] == NULL) {
+            // Keep one entry free, so that a lookup always ends
+            if (s_num_sites + 1 == MAX_SITES) {
+                return OTHER_SITE;
+            }
+            memcpy(site->callers, callers, sizeof(site->callers));
+            s_num_sites++;
+            return index;
+        }
+        if (memcmp(site->callers, callers, sizeof(site->callers)) == 0) {
+            return index;
+        }
+        index = (index + 1) & (MAX_SITES - 1);
+    }
+    return OTHER_SITE;
+}
+
+static HEAP_IRAM_ATTR bool live_insert(void *ptr, size_t size, uint16_t site)
+{
+    if (s_num_live + 1 >= MAX_ALLOCATIONS) {
+        return false;
+    }
+    size_t index = hash_ptr(ptr, MAX_ALLOCATIONS);
+    while (s_live[index].ptr != NULL) {
+        index = (index + 1) & (MAX_ALLOCATIONS - 1);
+    }
+    s_live[index] = (live_allocation_t) {
+        .ptr = ptr,
+        .size = size,
+        .site = site,
+    };
+    s_num_live++;
+    return true;
+}
+
+/* Removes the allocation from the table and returns it, returns false if it's not in the table */
+static HEAP_IRAM_ATTR bool live_remove(void *ptr, live_allocation_t *removed)
+{
+    size_t index = hash_ptr(ptr, MAX_ALLOCATIONS);
+    while (s_live[index].ptr != ptr) {
+        if (s_live[index].ptr == NULL) {
+            return false;
+        }
+        index = (index + 1) & (MAX_ALLOCATIONS - 1);
+    }
+    *removed = s_live[index];
+    s_num_live--;
+
+    // Move back the following entries which would not be found anymore behind the gap
+    size_t gap = index;
+    for (size_t next = (gap + 1) & (MAX_ALLOCATIONS - 1); s_live[next].ptr != NULL; next = (next + 1) & (MAX_ALLOCATIONS - 1)) {
+        size_t home = hash_ptr(s_live[next].ptr, MAX_ALLOCATIONS);
+        // Distance from the home index of the entry to next and to the gap
+        if (((next - home) & (MAX_ALLOCATIONS - 1)) >= ((next - gap) & (MAX_ALLOCATIONS - 1))) {
+            s_live[gap] = s_live[next];
+            gap = next;
+        }
+    }
+    s_live[gap].ptr = NULL;
+    return true;
+}
+
+static HEAP_IRAM_ATTR void add_live(void *ptr, size_t size, uint16_t site_index)
+{
+    site_t *site = &s_sites[site_index];
+    if (!live_insert(ptr, size, site_index)) {
+        s_untracked_allocations++;
+        return;
+    }
+    site->live_bytes += size;
+    if (site->live_bytes > site->peak_live_bytes) {
+        site->peak_live_bytes = site->live_bytes;
+    }
+}
+
+static HEAP_IRAM_ATTR void record_alloc(void *ptr, size_t size, void * const *callers)
+{
+    if (ptr == NULL) {
+        return;
+    }
+    MULTI_HEAP_LOCK(&s_profile_lock);
+    uint16_t site_index = find_site(callers);
+    s_sites[site_index].allocations++;
+    add_live(ptr, size, site_index);
+    MULTI_HEAP_UNLOCK(&s_profile_lock);
+}
+
+/* Removes the allocation from the live allocations, before it is freed or reallocated.
+   Returns false if the allocation is unknown. */
+static HEAP_IRAM_ATTR bool remove_live(void *ptr, live_allocation_t *removed, bool is_free)
+{
+    if (ptr == NULL) {
+        return false;
+    }
+    MULTI_HEAP_LOCK(&s_profile_lock);
+    bool found = live_remove(ptr, removed);
+    if (found) {
+        s_sites[removed->site].live_bytes -= removed->size;
+        if (is_free) {
+            s_sites[removed->site].frees++;
+        }
+    }
+    MULTI_HEAP_UNLOCK(&s_profile_lock);
+    return found;
+}
+
+static HEAP_IRAM_ATTR void record_free(void *ptr)
+{
+    live_allocation_t removed;
+    remove_live(ptr, &removed, true);
+}
+
+/* The old allocation is removed before reallocating it: once it is freed, another task may get
+   the same address, and its allocation must not be removed by the free recorded here. */
+static HEAP_IRAM_ATTR void record_realloc(void *new_ptr, size_t size, bool known, const live_allocation_t *old,
+                                          void * const *callers)
+{
+    if (new_ptr == NULL && size != 0) {
+        // Reallocation failed, the old allocation is still alive
+        if (known) {
+            MULTI_HEAP_LOCK(&s_profile_lock);
+            add_live(old->ptr, old->size, old->site);
+            MULTI_HEAP_UNLOCK(&s_profile_lock);
+        }
+        return;
+    }
+    if (known) {
+        MULTI_HEAP_LOCK(&s_profile_lock);
+        s_sites[old->site].frees++;
+        MULTI_HEAP_UNLOCK(&s_profile_lock);
+    }
+    record_alloc(new_ptr, size, callers);
+}
+
+void *__real_heap_caps_malloc(size_t size, uint32_t caps);
+void *__real_heap_caps_malloc_default(size_t size);
+void *__real_heap_caps_calloc(size_t n, size_t size, uint32_t caps);
+void *__real_heap_caps_realloc(void *ptr, size_t size, uint32_t caps);
+void *__real_heap_caps_realloc_default(void *ptr, size_t size);
+void *__real_heap_caps_aligned_alloc(size_t alignment, size_t size, uint32_t caps);
+void __real_heap_caps_aligned_free(void *ptr);
+void __real_heap_caps_free(void *ptr);
+
+static int64_t now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+size_t heap_caps_profile_get_sites(heap_caps_profile_site_t *sites, size_t max_sites, heap_caps_profile_info_t *info)
+{
+    size_t count = 0;
+    int64_t now = now_us();
+
+    MULTI_HEAP_LOCK(&s_profile_lock);
+    int64_t elapsed_us = MAX(now - s_sample_time_us, 1);
+    s_sample_time_us = now;
+    if (info != NULL) {
+        info->num_sites = s_num_sites;
+        info->untracked_allocations = s_untracked_allocations;
+    }
+    MULTI_HEAP_UNLOCK(&s_profile_lock);
+
+    for (size_t index = 0; index <= MAX_SITES; index++) {
+        // Each site is copied in a short critical section, the sorting is done outside of it
+        site_t site;
+        MULTI_HEAP_LOCK(&s_profile_lock);
+        site = s_sites[index];
+        s_sites[index].sampled_allocations = site.allocations;
+        MULTI_HEAP_UNLOCK(&s_profile_lock);
+        if (site.callers[0] == NULL && site.allocations == 0) {
+            continue;
+        }
+        size_t new_allocations = site.allocations - site.sampled_allocations;
+
+        // Insert into the sorted output, dropping the site holding the fewest bytes if it is full
+        size_t pos = count;
+        while (pos > 0 && sites[pos - 1].live_bytes < site.live_bytes) {
+            pos--;
+        }
+        if (pos == max_sites) {
+            continue;
+        }
+        if (count < max_sites) {
+            count++;
+        }
+        memmove(&sites[pos + 1], &sites[pos], (count - 1 - pos) * sizeof(heap_caps_profile_site_t));
+        heap_caps_profile_site_t *out = &sites[pos];
+        memcpy(out->callers, site.callers, sizeof(out->callers));
+        out->allocations = site.allocations;
+        out->frees = site.frees;
+        out->live_bytes = site.live_bytes;
+        out->peak_live_bytes = site.peak_live_bytes;
+        out->alloc_rate = (uint32_t)(new_allocations * 1000000LL / elapsed_us);
+    }
+    return count;
+}
+
+void heap_caps_profile_print(size_t max_sites)
+{
+    // The real functions are called, so that the profile doesn't count its own buffer
+    heap_caps_profile_site_t *sites = __real_heap_caps_malloc(max_sites * sizeof(heap_caps_profile_site_t), MALLOC_CAP_DEFAULT);
+    if (sites == NULL) {
+        printf("Heap profile: not enough memory to print %zu call sites\n", max_sites);
+        return;
+    }
+    heap_caps_profile_info_t info;
+    size_t count = heap_caps_profile_get_sites(sites, max_sites, &info);
+    printf("Heap profile: %zu call sites, %zu untracked allocations\n", info.num_sites, info.untracked_allocations);
+    printf("%10s %10s %8s %8s %8s  %s\n", "live", "peak", "allocs", "frees", "allocs/s", "call site");
+    for (size_t i = 0; i < count; i++) {
+        const heap_caps_profile_site_t *site = &sites[i];
+        printf("%10zu %10zu %8zu %8zu %8" PRIu32 " ", site->live_bytes, site->peak_live_bytes,
+               site->allocations, site->frees, site->alloc_rate);
+        if (site->callers[0] == NULL) {
+            printf(" (other call sites)");
+        }
+        for (int j = 0; j < STACK_DEPTH && site->callers[j] != NULL; j++) {
+            printf("%s%p", (j == 0) ? " " : ":", site->callers[j]);
+        }
+        printf("\n");
+    }
+    __real_heap_caps_free(sites);
+}
+
+void heap_caps_profile_reset(void)
+{
+    int64_t now = now_us();
+    MULTI_HEAP_LOCK(&s_profile_lock);
+    for (size_t index = 0; index <= MAX_SITES; index++) {
+        site_t *site = &s_sites[index];
+        site->allocations = 0;
+        site->frees = 0;
+        site->sampled_allocations = 0;
+        site->peak_live_bytes = site->live_bytes;
+    }
+    s_untracked_allocations = 0;
+    s_sample_time_us = now;
+    MULTI_HEAP_UNLOCK(&s_profile_lock);
+}
+
+/* Wrappers of the heap functions, the wrappers are never inlined so that their
+   return address is the call site */
+HEAP_IRAM_ATTR __attribute__((noinline)) void *__wrap_heap_caps_malloc(size_t size, uint32_t caps)
+{
+    void *callers[STACK_DEPTH];
+    GET_CALLERS(callers);
+    void *ptr = __real_heap_caps_malloc(size, caps);
+    record_alloc(ptr, size, callers);
+    return ptr;
+}
+
+HEAP_IRAM_ATTR __attribute__((noinline)) void *__wrap_heap_caps_malloc_default(size_t size)
+{
+    void *callers[STACK_DEPTH];
+    GET_CALLERS(callers);
+    void *ptr = __real_heap_caps_malloc_default(size);
+    record_alloc(ptr, size, callers);
+    return ptr;
+}
+
+HEAP_IRAM_ATTR __attribute__((noinline)) void *__wrap_heap_caps_calloc(size_t n, size_t size, uint32_t caps)
+{
+    void *callers[STACK_DEPTH];
+    GET_CALLERS(callers);
+    void *ptr = __real_heap_caps_calloc(n, size, caps);
+    record_alloc(ptr, n * size, callers);
+    return ptr;
+}
+
+HEAP_IRAM_ATTR __attribute__((noinline)) void *__wrap_heap_caps_aligned_alloc(size_t alignment, size_t size, uint32_t caps)
+{
+    void *callers[STACK_DEPTH];
+    GET_CALLERS(callers);
+    void *ptr = __real_heap_caps_aligned_alloc(alignment, size, caps);
+    record_alloc(ptr, size, callers);
+    return ptr;
+}
+
+HEAP_IRAM_ATTR __attribute__((noinline)) void *__wrap_heap_caps_realloc(void *ptr, size_t size, uint32_t caps)
+{
+    void *callers[STACK_DEPTH];
+    GET_CALLERS(callers);
+    live_allocation_t old;
+    bool known = remove_live(ptr, &old, false);
+    void *new_ptr = __real_heap_caps_realloc(ptr, size, caps);
+    record_realloc(new_ptr, size, known, &old, callers);
+    return new_ptr;
+}
+
+HEAP_IRAM_ATTR __attribute__((noinline)) void *__wrap_heap_caps_realloc_default(void *ptr, size_t size)
+{
+    void *callers[STACK_DEPTH];
+    GET_CALLERS(callers);
+    live_allocation_t old;
+    bool known = remove_live(ptr, &old, false);
+    void *new_ptr = __real_heap_caps_realloc_default(ptr, size);
+    record_realloc(new_ptr, size, known, &old, callers);
+    return new_ptr;
+}
+
+HEAP_IRAM_ATTR void __wrap_heap_caps_free(void *ptr)
+{
+    record_free(ptr);
+    __real_heap_caps_free(ptr);
+}
+
+HEAP_IRAM_ATTR void __wrap_heap_caps_aligned_free(void *ptr)
+{
+    record_free(ptr);
+    __real_heap_caps_aligned_free(ptr);
+}
+
+#if !CONFIG_IDF_TARGET_LINUX
+/* malloc() and friends of newlib call the heap_caps_*_default functions, which are wrapped as well,
+   so the wrappers of malloc() call the real functions directly. On Linux, the C library functions
+   are not profiled. */
+
+HEAP_IRAM_ATTR __attribute__((noinline)) void *__wrap_malloc(size_t size)
+{
+    void *callers[STACK_DEPTH];
+    GET_CALLERS(callers);
+    void *ptr = __real_heap_caps_malloc_default(size);
+    record_alloc(ptr, size, callers);
+    return ptr;
+}
+
+HEAP_IRAM_ATTR __attribute__((noinline)) void *__wrap_calloc(size_t n, size_t size)
+{
+    void *callers[STACK_DEPTH];
+    GET_CALLERS(callers);
+    size_t size_bytes;
+    if (__builtin_mul_overflow(n, size, &size_bytes)) {
+        return NULL;
+    }
+    void *ptr = __real_heap_caps_malloc_default(size_bytes);
+    if (ptr != NULL) {
+        memset(ptr, 0, size_bytes);
+    }
+    record_alloc(ptr, size_bytes, callers);
+    return ptr;
+}
+
+HEAP_IRAM_ATTR __attribute__((noinline)) void *__wrap_realloc(void *ptr, size_t size)
+{
+    void *callers[STACK_DEPTH];
+    GET_CALLERS(callers);
+    live_allocation_t old;
+    bool known = remove_live(ptr, &old, false);
+    void *new_ptr = __real_heap_caps_realloc_default(ptr, size);
+    record_realloc(new_ptr, size, known, &old, callers);
+    return new_ptr;
+}
+
+void __wrap_free(void *ptr) __attribute__((alias("__wrap_heap_caps_free")));
+#endif // !CONFIG_IDF_TARGET_LINUX
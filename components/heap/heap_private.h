@@ -7,8 +7,10 @@
 
 #include <stdlib.h>
 #include <stdint.h>
+#include <stdbool.h>
 #include <soc/soc_memory_layout.h>
 #include "multi_heap.h"
+#include "esp_heap_caps_pool.h"
 #include "multi_heap_platform.h"
 #include "sys/queue.h"
 
@@ -40,8 +42,68 @@ typedef struct heap_t_ {
 */
 extern SLIST_HEAD(registered_heap_ll, heap_t_) registered_heaps;
 
+/* Address range of a registered heap */
+typedef struct {
+    intptr_t start;
+    intptr_t end;
+    heap_t *heap;
+} heap_range_t;
+
+/* Number of capabilities masks with precomputed candidate heaps */
+#define HEAP_CAPS_LOOKUP_NUM_CAPS 16
+
+/* Lookup tables built from registered_heaps whenever a heap is registered.
+
+   For the most commonly requested capabilities masks, candidates lists the
+   indexes into heaps of all heaps which can satisfy the request, in the order
+   in which they are tried: by priority, then in the order of registered_heaps.
+   heaps is sorted by start address, for finding the heap containing a pointer
+   with a binary search, unless a heap has been added within another heap.
+
+   The tables are replaced as a whole and never modified after they have been
+   published. If heap_caps_lookup is NULL, or a capabilities mask is not in the
+   table, or a pointer is not found, registered_heaps is walked instead.
+
+   The tables are used between heap_caps_lookup_acquire() and
+   heap_caps_lookup_release(). Replaced tables are kept in a list of retired
+   tables until a later update finds that no task is using the tables any more.
+*/
+typedef struct heap_caps_lookup_ {
+    size_t num_heaps;
+    bool heaps_nested;
+    heap_range_t *heaps;
+    uint32_t caps[HEAP_CAPS_LOOKUP_NUM_CAPS];
+    uint8_t num_candidates[HEAP_CAPS_LOOKUP_NUM_CAPS];
+    uint8_t *candidates;    // HEAP_CAPS_LOOKUP_NUM_CAPS lists of num_heaps entries each
+    struct heap_caps_lookup_ *next_retired;
+} heap_caps_lookup_t;
+
+extern heap_caps_lookup_t *heap_caps_lookup;
+
+/* Number of tasks between heap_caps_lookup_acquire() and heap_caps_lookup_release() */
+extern uint32_t heap_caps_lookup_readers;
+
+/* Get the current lookup tables, which stay valid until heap_caps_lookup_release() is
+   called. Must be called even if NULL is returned. */
+__attribute__((always_inline)) static inline const heap_caps_lookup_t *heap_caps_lookup_acquire(void)
+{
+    /* Sequentially consistent with the update in update_lookup(): either it sees this
+       reader, or this reader sees the new tables */
+    __atomic_fetch_add(&heap_caps_lookup_readers, 1, __ATOMIC_SEQ_CST);
+    return __atomic_load_n(&heap_caps_lookup, __ATOMIC_SEQ_CST);
+}
+
+__attribute__((always_inline)) static inline void heap_caps_lookup_release(void)
+{
+    __atomic_fetch_sub(&heap_caps_lookup_readers, 1, __ATOMIC_RELEASE);
+}
+
 bool heap_caps_match(const heap_t *heap, uint32_t caps);
 
+/* Get the statistics and the address of the objects of the pool at this position
+   in the list of all pools. Returns false if there are fewer pools. */
+bool heap_caps_pool_get_info_at(size_t position, heap_caps_pool_info_t *info, intptr_t *objects);
+
 /* return all possible capabilities (across all priorities) for a given heap */
 inline static uint32_t get_all_caps(const heap_t *heap)
 {
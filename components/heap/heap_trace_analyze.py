@@ -0,0 +1,229 @@
+#!/usr/bin/env python
+#
+# heap_trace_analyze.py rebuilds the live allocations of a heap trace stream
+# (CONFIG_HEAP_TRACING_STREAMING) and reports them as leaks, grouped by call stack.
+#
+# The input is the data passed to the heap trace sink, for example a file written
+# with heap_trace_stream_sink_fd(). Each call of heap_trace_start() begins a new run,
+# only the last run is reported unless --all is given. If the ELF file of the
+# application is given, the addresses of the callers are resolved to function names.
+#
+# SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+# SPDX-License-Identifier: Apache-2.0
+
+import argparse
+import bisect
+import struct
+import sys
+from typing import BinaryIO, Dict, List, Optional, Tuple
+
+# Keep in sync with heap_trace_streaming.c
+HEADER = struct.Struct('<BBH')
+START = struct.Struct('<BBHI')
+ALLOC = struct.Struct('<IIIIII')
+FREE = struct.Struct('<IIII')
+STREAM_VERSION = 1
+RECORD_START = ord('H')
+RECORD_ALLOC = ord('A')
+RECORD_FREE = ord('F')
+RECORD_STACK = ord('S')
+MAX_LEAKED_ADDRESSES = 8
+
+
+class ElfSymbols(object):
+    """ Resolves addresses to function names using the symbol table of an ELF file """
+
+    def __init__(self, elf_file):  # type: (BinaryIO) -> None
+        from elftools.elf.elffile import ELFFile
+        from elftools.elf.sections import SymbolTableSection
+
+        functions = []  # type: List[Tuple[int, int, str]]
+        for section in ELFFile(elf_file).iter_sections():
+            if not isinstance(section, SymbolTableSection):
+                continue
+            for symbol in section.iter_symbols():
+                if symbol['st_info']['type'] == 'STT_FUNC' and symbol['st_value'] != 0:
+                    functions.append((symbol['st_value'], symbol['st_size'], symbol.name))
+        functions.sort()
+        self.starts = [f[0] for f in functions]
+        self.functions = functions
+
+    def get(self, address):  # type: (int) -> Optional[str]
+        index = bisect.bisect_right(self.starts, address) - 1
+        if index < 0:
+            return None
+        start, size, name = self.functions[index]
+        if address >= start + max(size, 1):
+            return None
+        return '%s+0x%x' % (name, address - start)
+
+
+class Event(object):
+    def __init__(self, seq, ccount, address, stack, size=None, caps=0):
+        # type: (int, int, int, int, Optional[int], int) -> None
+        self.seq = seq
+        self.ccount = ccount
+        self.address = address
+        self.stack = stack
+        self.size = size  # None for a free
+        self.caps = caps
+
+
+class Stream(object):
+    def __init__(self):  # type: () -> None
+        self.events = []  # type: List[Event]
+        self.stacks = {}  # type: Dict[int, Tuple[int, ...]]
+        self.run_starts = []  # type: List[int]
+        self.dropped = 0
+        self.stack_depth = 0
+
+    def parse(self, data):  # type: (bytes) -> bytes
+        """ Parses complete records from data, returns the bytes left over """
+        offset = 0
+        while offset + HEADER.size <= len(data):
+            record_type, size, dropped = HEADER.unpack_from(data, offset)
+            if size < HEADER.size:
+                raise ValueError('invalid record size %d' % size)
+            if offset + size > len(data):
+                break
+            self.dropped += dropped
+            payload = offset + HEADER.size
+            if record_type == RECORD_START:
+                version, depth, _, first_seq = START.unpack_from(data, payload)
+                if version != STREAM_VERSION:
+                    raise ValueError('unsupported heap trace stream version %d' % version)
+                self.stack_depth = depth
+                self.run_starts.append(first_seq)
+            elif record_type == RECORD_ALLOC:
+                seq, ccount, address, alloc_size, caps, stack = ALLOC.unpack_from(data, payload)
+                self.events.append(Event(seq, ccount, address, stack, alloc_size, caps))
+            elif record_type == RECORD_FREE:
+                seq, ccount, address, stack = FREE.unpack_from(data, payload)
+                self.events.append(Event(seq, ccount, address, stack))
+            elif record_type == RECORD_STACK:
+                count = (size - HEADER.size) // 4
+                values = struct.unpack_from('<%dI' % count, data, payload)
+                self.stacks[values[0]] = tuple(pc for pc in values[1:] if pc != 0)
+            else:
+                raise ValueError('invalid record type 0x%02x' % record_type)
+            offset += size
+        return data[offset:]
+
+    def runs(self):  # type: () -> List[List[Event]]
+        """ Returns the events of each run, ordered by sequence number """
+        self.events.sort(key=lambda e: e.seq)
+        starts = sorted(self.run_starts) or [0]
+        runs = [[] for _ in starts]  # type: List[List[Event]]
+        for event in self.events:
+            index = bisect.bisect_right(starts, event.seq) - 1
+            if index >= 0:
+                runs[index].append(event)
+        return runs
+
+
+def format_stack(stream, symbols, stack):  # type: (Stream, Optional[ElfSymbols], int) -> List[str]
+    if stack == 0:
+        return ['(no call stack recorded)']
+    callers = stream.stacks.get(stack)
+    if callers is None:
+        return ['(call stack 0x%08x not in the stream)' % stack]
+    lines = []
+    for pc in callers:
+        name = symbols.get(pc) if symbols else None
+        lines.append('0x%08x%s' % (pc, ' ' + name if name else ''))
+    return lines
+
+
+def report_run(stream, symbols, number, events, out):
+    # type: (Stream, Optional[ElfSymbols], int, List[Event], BinaryIO) -> None
+    live = {}  # type: Dict[int, Event]
+    allocations = 0
+    allocated_bytes = 0
+    frees = 0
+    untracked_frees = 0
+    live_bytes = 0
+    peak_bytes = 0
+    peak_count = 0
+    for event in events:
+        if event.size is not None:
+            allocations += 1
+            allocated_bytes += event.size
+            replaced = live.pop(event.address, None)
+            if replaced is not None:
+                # The free of the previous allocation has been dropped
+                live_bytes -= replaced.size or 0
+            live[event.address] = event
+            live_bytes += event.size
+            if live_bytes > peak_bytes:
+                peak_bytes = live_bytes
+                peak_count = len(live)
+        else:
+            frees += 1
+            freed = live.pop(event.address, None)
+            if freed is None:
+                untracked_frees += 1
+            else:
+                live_bytes -= freed.size or 0
+
+    def write(line):  # type: (str) -> None
+        out.write((line + '\n').encode('utf-8'))
+
+    write('====== Heap trace run %d ======' % number)
+    write('%d allocations (%d bytes), %d frees' % (allocations, allocated_bytes, frees))
+    write('%d frees of memory allocated before the run' % untracked_frees)
+    write('peak: %d bytes in %d allocations' % (peak_bytes, peak_count))
+
+    by_stack = {}  # type: Dict[Tuple[int, int], List[Event]]
+    for event in live.values():
+        by_stack.setdefault((event.stack, event.caps), []).append(event)
+    groups = sorted(by_stack.values(), key=lambda g: -sum(e.size or 0 for e in g))
+    write('%d bytes alive in %d allocations, from %d call stacks:' % (live_bytes, len(live), len(groups)))
+    for group in groups:
+        group.sort(key=lambda e: e.seq)
+        write('')
+        write('%d bytes in %d allocations with caps 0x%x, allocated by' % (
+            sum(e.size or 0 for e in group), len(group), group[0].caps))
+        for line in format_stack(stream, symbols, group[0].stack):
+            write('    ' + line)
+        addresses = ', '.join('0x%08x (%d bytes, CPU %d)' % (e.address, e.size or 0, e.ccount & 1)
+                              for e in group[:MAX_LEAKED_ADDRESSES])
+        if len(group) > MAX_LEAKED_ADDRESSES:
+            addresses += ', ...'
+        write('  at ' + addresses)
+    write('================================')
+
+
+def main():  # type: () -> None
+    parser = argparse.ArgumentParser(description='Report live allocations and leaks from a heap trace stream')
+    parser.add_argument('input', help='Heap trace stream, standard input by default', nargs='?',
+                        type=argparse.FileType('rb'), default=sys.stdin.buffer)
+    parser.add_argument('--elf', help='ELF file of the application, to resolve the callers',
+                        type=argparse.FileType('rb'))
+    parser.add_argument('--all', help='Report every run of the stream, not only the last one', action='store_true')
+    args = parser.parse_args()
+
+    stream = Stream()
+    pending = b''
+    while True:
+        chunk = args.input.read(4096)
+        if not chunk:
+            break
+        pending = stream.parse(pending + chunk)
+    out = sys.stdout.buffer
+    if pending:
+        out.write(b'(NB: the stream ends with a truncated record.)\n')
+    if stream.dropped:
+        out.write(b'(NB: %d records were dropped because the buffer was full, so the reports are incomplete.)\n'
+                  % stream.dropped)
+    if not stream.run_starts:
+        out.write(b'(NB: the stream has no start record, it may not begin at heap_trace_start().)\n')
+
+    symbols = ElfSymbols(args.elf) if args.elf else None
+    runs = stream.runs()
+    first = 0 if args.all else len(runs) - 1
+    for number in range(first, len(runs)):
+        report_run(stream, symbols, number + 1, runs[number], out)
+
+
+if __name__ == '__main__':
+    main()
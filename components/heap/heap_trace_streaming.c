@@ -0,0 +1,442 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Streaming heap tracing implementation notes.
+ *
+ * Instead of keeping a list of records, each allocation and free is encoded
+ * into a compact binary record which is written to a buffer of the calling
+ * core with interrupts masked, so there is a single writer per buffer and no
+ * lock is needed. The heap trace task is the only reader of all buffers and
+ * passes the records to the sink.
+ *
+ * Records from different cores are ordered by a global sequence number.
+ * Call stacks are not part of allocation and free records, these only hold a
+ * hash of the call stack. The call stack itself is recorded once, the first
+ * time its hash is seen by a core (as far as a small table of known hashes
+ * per core remembers).
+ *
+ * All multi-byte values are stored little endian and unaligned. The analyzer
+ * (heap_trace_analyze.py) has to be kept in sync with the encoding.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <sys/param.h>
+#include <sdkconfig.h>
+
+#define HEAP_TRACE_SRCFILE /* don't warn on inclusion here */
+#include "esp_heap_trace.h"
+#undef HEAP_TRACE_SRCFILE
+#include "esp_heap_caps.h"
+#include "esp_attr.h"
+#include "esp_cpu.h"
+#include "esp_rom_sys.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+#define STACK_DEPTH CONFIG_HEAP_TRACING_STACK_DEPTH
+
+#if CONFIG_HEAP_TRACING_STREAMING
+
+#define BUFFER_SIZE CONFIG_HEAP_TRACING_STREAMING_BUFFER_SIZE
+// Number of call stack hashes each core remembers as already recorded
+#define KNOWN_STACKS 64
+#define STREAM_VERSION 1
+
+_Static_assert((BUFFER_SIZE & (BUFFER_SIZE - 1)) == 0, "CONFIG_HEAP_TRACING_STREAMING_BUFFER_SIZE must be a power of 2");
+_Static_assert(sizeof(void *) == 4 && sizeof(size_t) == 4, "heap trace stream encoding assumes 32-bit pointers");
+
+typedef enum {
+    RECORD_START = 'H',     // tracing was started, followed by records of this run
+    RECORD_ALLOC = 'A',
+    RECORD_FREE = 'F',
+    RECORD_STACK = 'S',     // call stack belonging to a hash
+} record_type_t;
+
+typedef struct {
+    uint8_t type;
+    uint8_t size;       // size of the record, including this header
+    uint16_t dropped;   // number of records dropped on this core before this one, saturated
+} __attribute__((packed)) record_header_t;
+
+typedef struct {
+    record_header_t header;
+    uint8_t version;
+    uint8_t stack_depth;
+    uint16_t reserved;
+    uint32_t first_seq; // sequence number of the first record of this run
+} __attribute__((packed)) start_record_t;
+
+typedef struct {
+    record_header_t header;
+    uint32_t seq;
+    uint32_t ccount;
+    uint32_t address;
+    uint32_t size;
+    uint32_t caps;
+    uint32_t stack;     // hash of the call stack
+} __attribute__((packed)) alloc_record_t;
+
+typedef struct {
+    record_header_t header;
+    uint32_t seq;
+    uint32_t ccount;
+    uint32_t address;
+    uint32_t stack;
+} __attribute__((packed)) free_record_t;
+
+typedef struct {
+    record_header_t header;
+    uint32_t stack;
+    uint32_t callers[STACK_DEPTH];
+} __attribute__((packed)) stack_record_t;
+
+_Static_assert(sizeof(stack_record_t) <= UINT8_MAX, "stack record size must fit into the record header");
+
+typedef struct {
+    uint32_t head;      // bytes written, only modified by the core owning the buffer
+    uint32_t tail;      // bytes passed to the sink, only modified by the reader
+    uint32_t dropped;   // records dropped since the last record written
+    // statistics since heap_trace_start(), only modified by the core owning the buffer
+    uint32_t total_allocations;
+    uint32_t total_frees;
+    uint32_t total_dropped;
+    uint32_t known_stacks[KNOWN_STACKS];
+    uint8_t data[BUFFER_SIZE];
+} record_buffer_t;
+
+static record_buffer_t s_buffers[portNUM_PROCESSORS];
+static uint32_t s_seq;
+static bool s_tracing;
+static heap_trace_mode_t s_mode;
+static heap_trace_stream_sink_t s_sink;
+static void *s_sink_arg;
+static SemaphoreHandle_t s_flush_mutex;
+static TaskHandle_t s_task;
+// Start record which is passed to the sink before the next records, protected by s_flush_mutex
+static bool s_start_pending;
+static start_record_t s_start_record;
+static uint8_t s_chunk[512];
+
+static inline void copy_to_buffer(record_buffer_t *buffer, uint32_t pos, const void *src, size_t len)
+{
+    size_t offset = pos & (BUFFER_SIZE - 1);
+    size_t first = MIN(len, BUFFER_SIZE - offset);
+    memcpy(&buffer->data[offset], src, first);
+    memcpy(&buffer->data[0], (const uint8_t *)src + first, len - first);
+}
+
+static inline void copy_from_buffer(const record_buffer_t *buffer, uint32_t pos, void *dst, size_t len)
+{
+    size_t offset = pos & (BUFFER_SIZE - 1);
+    size_t first = MIN(len, BUFFER_SIZE - offset);
+    memcpy(dst, &buffer->data[offset], first);
+    memcpy((uint8_t *)dst + first, &buffer->data[0], len - first);
+}
+
+/* Appends a record to the buffer, must be called with interrupts masked */
+static HEAP_IRAM_ATTR bool write_record(record_buffer_t *buffer, void *record)
+{
+    record_header_t *header = record;
+    uint32_t head = buffer->head;
+    uint32_t tail = __atomic_load_n(&buffer->tail, __ATOMIC_ACQUIRE);
+    if (BUFFER_SIZE - (head - tail) < header->size) {
+        ++buffer->dropped;
+        ++buffer->total_dropped;
+        return false;
+    }
+    header->dropped = (uint16_t) MIN(buffer->dropped, UINT16_MAX);
+    buffer->dropped = 0;
+    copy_to_buffer(buffer, head, record, header->size);
+    __atomic_store_n(&buffer->head, head + header->size, __ATOMIC_RELEASE);
+    return true;
+}
+
+/* FNV-1a hash of the call stack, 0 means no call stack */
+static HEAP_IRAM_ATTR uint32_t hash_stack(void * const *callers)
+{
+    if (STACK_DEPTH == 0 || callers[0] == NULL) {
+        return 0;
+    }
+    uint32_t hash = 2166136261UL;
+    for (int i = 0; i < STACK_DEPTH && callers[i] != NULL; i++) {
+        hash = (hash ^ (uint32_t) callers[i]) * 16777619UL;
+    }
+    return (hash != 0) ? hash : 1;
+}
+
+/* Writes the call stack record if this core didn't record the stack already,
+   must be called with interrupts masked */
+static HEAP_IRAM_ATTR void write_stack(record_buffer_t *buffer, uint32_t hash, void * const *callers)
+{
+#if STACK_DEPTH > 0
+    uint32_t *known = &buffer->known_stacks[(hash ^ (hash >> 16)) % KNOWN_STACKS];
+    if (hash == 0 || *known == hash) {
+        return;
+    }
+    stack_record_t record = {
+        .header = { .type = RECORD_STACK, .size = sizeof(stack_record_t) },
+        .stack = hash,
+    };
+    memcpy(record.callers, callers, sizeof(record.callers));
+    if (write_record(buffer, &record)) {
+        *known = hash;
+    }
+#endif
+}
+
+/* Add a new allocation to the heap trace stream */
+static HEAP_IRAM_ATTR void record_allocation(const heap_trace_record_t *r_allocation)
+{
+    if (!s_tracing || r_allocation->address == NULL) {
+        return;
+    }
+    alloc_record_t record = {
+        .header = { .type = RECORD_ALLOC, .size = sizeof(alloc_record_t) },
+        .ccount = r_allocation->ccount,
+        .address = (uint32_t) r_allocation->address,
+        .size = r_allocation->size,
+        .caps = r_allocation->caps,
+        .stack = hash_stack(r_allocation->alloced_by),
+    };
+
+    // Only this core writes to its buffer, masking interrupts makes the writer unique
+    UBaseType_t int_state = portSET_INTERRUPT_MASK_FROM_ISR();
+    record_buffer_t *buffer = &s_buffers[esp_cpu_get_core_id()];
+    write_stack(buffer, record.stack, r_allocation->alloced_by);
+    // The sequence number is taken before the allocation is visible to other
+    // tasks, so it is lower than the one of the free of the same memory
+    record.seq = __atomic_fetch_add(&s_seq, 1, __ATOMIC_RELAXED);
+    write_record(buffer, &record);
+    ++buffer->total_allocations;
+    portCLEAR_INTERRUPT_MASK_FROM_ISR(int_state);
+}
+
+/* Add a free to the heap trace stream */
+static HEAP_IRAM_ATTR void record_free(void *p, void **callers)
+{
+    if (!s_tracing || p == NULL) {
+        return;
+    }
+    free_record_t record = {
+        .header = { .type = RECORD_FREE, .size = sizeof(free_record_t) },
+        .address = (uint32_t) p,
+        .stack = hash_stack(callers),
+    };
+
+    UBaseType_t int_state = portSET_INTERRUPT_MASK_FROM_ISR();
+    int core_id = esp_cpu_get_core_id();
+    record_buffer_t *buffer = &s_buffers[core_id];
+    // Same encoding as the ccount of allocations, see get_ccount()
+    record.ccount = (esp_cpu_get_cycle_count() & ~3) | core_id;
+    write_stack(buffer, record.stack, callers);
+    // The memory is only returned to the heap after this, so the sequence
+    // number is lower than the one of the next allocation of the same memory
+    record.seq = __atomic_fetch_add(&s_seq, 1, __ATOMIC_RELAXED);
+    write_record(buffer, &record);
+    ++buffer->total_frees;
+    portCLEAR_INTERRUPT_MASK_FROM_ISR(int_state);
+}
+
+static void flush_buffer(record_buffer_t *buffer)
+{
+    // Records written while flushing, by the sink for example, are left for the next flush
+    uint32_t head = __atomic_load_n(&buffer->head, __ATOMIC_ACQUIRE);
+    uint32_t tail = buffer->tail;
+    while (tail != head) {
+        // Gather as many complete records as fit into one chunk
+        size_t len = 0;
+        while (tail + len != head) {
+            record_header_t header;
+            copy_from_buffer(buffer, tail + len, &header, sizeof(header));
+            if (len + header.size > sizeof(s_chunk)) {
+                break;
+            }
+            copy_from_buffer(buffer, tail + len, &s_chunk[len], header.size);
+            len += header.size;
+        }
+        tail += len;
+        __atomic_store_n(&buffer->tail, tail, __ATOMIC_RELEASE);
+        (*s_sink)(s_chunk, len, s_sink_arg);
+    }
+}
+
+void heap_trace_stream_flush(void)
+{
+    if (s_flush_mutex == NULL) {
+        return;
+    }
+    xSemaphoreTake(s_flush_mutex, portMAX_DELAY);
+    if (s_start_pending) {
+        s_start_pending = false;
+        memcpy(s_chunk, &s_start_record, sizeof(s_start_record));
+        (*s_sink)(s_chunk, sizeof(s_start_record), s_sink_arg);
+    }
+    for (int i = 0; i < portNUM_PROCESSORS; ++i) {
+        flush_buffer(&s_buffers[i]);
+    }
+    xSemaphoreGive(s_flush_mutex);
+}
+
+void heap_trace_stream_sink_fd(const uint8_t *data, size_t size, void *arg)
+{
+    int fd = (int) (intptr_t) arg;
+    while (size > 0) {
+        ssize_t written = write(fd, data, size);
+        if (written <= 0) {
+            return;
+        }
+        data += written;
+        size -= written;
+    }
+}
+
+static void heap_trace_stream_task(void *arg)
+{
+    (void) arg;
+    while (true) {
+        vTaskDelay(pdMS_TO_TICKS(CONFIG_HEAP_TRACING_STREAMING_FLUSH_PERIOD_MS));
+        heap_trace_stream_flush();
+    }
+}
+
+esp_err_t heap_trace_init_streaming(heap_trace_stream_sink_t sink, void *arg)
+{
+    if (s_tracing) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (sink == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_flush_mutex == NULL) {
+        s_flush_mutex = xSemaphoreCreateMutex();
+        if (s_flush_mutex == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    xSemaphoreTake(s_flush_mutex, portMAX_DELAY);
+    s_sink = sink;
+    s_sink_arg = arg;
+    xSemaphoreGive(s_flush_mutex);
+    if (s_task == NULL
+        && xTaskCreate(&heap_trace_stream_task, "heap_trace", CONFIG_HEAP_TRACING_STREAMING_TASK_STACK_SIZE,
+                       NULL, CONFIG_HEAP_TRACING_STREAMING_TASK_PRIORITY, &s_task) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+esp_err_t heap_trace_init_standalone(heap_trace_record_t *record_buffer, size_t num_records)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t heap_trace_start(heap_trace_mode_t mode_param)
+{
+    if (s_task == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    xSemaphoreTake(s_flush_mutex, portMAX_DELAY);
+    s_tracing = false;
+    s_mode = mode_param;
+    for (int i = 0; i < portNUM_PROCESSORS; ++i) {
+        s_buffers[i].total_allocations = 0;
+        s_buffers[i].total_frees = 0;
+        s_buffers[i].total_dropped = 0;
+        // The call stacks are recorded again, so that each run can be analysed on its own
+        memset(s_buffers[i].known_stacks, 0, sizeof(s_buffers[i].known_stacks));
+    }
+    // Records still in the buffers have lower sequence numbers and belong to the previous run
+    s_start_record = (start_record_t) {
+        .header = { .type = RECORD_START, .size = sizeof(start_record_t) },
+        .version = STREAM_VERSION,
+        .stack_depth = STACK_DEPTH,
+        .first_seq = __atomic_load_n(&s_seq, __ATOMIC_RELAXED),
+    };
+    s_start_pending = true;
+    s_tracing = true;
+    xSemaphoreGive(s_flush_mutex);
+    return ESP_OK;
+}
+
+esp_err_t heap_trace_stop(void)
+{
+    if (!s_tracing) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_tracing = false;
+    return ESP_OK;
+}
+
+esp_err_t heap_trace_resume(void)
+{
+    if (s_task == NULL || s_tracing) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_tracing = true;
+    return ESP_OK;
+}
+
+size_t heap_trace_get_count(void)
+{
+    return 0;
+}
+
+esp_err_t heap_trace_get(size_t index, heap_trace_record_t *record)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t heap_trace_summary(heap_trace_summary_t *summary)
+{
+    if (summary == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memset(summary, 0, sizeof(*summary));
+    summary->mode = s_mode;
+    for (int i = 0; i < portNUM_PROCESSORS; ++i) {
+        summary->total_allocations += s_buffers[i].total_allocations;
+        summary->total_frees += s_buffers[i].total_frees;
+        summary->has_overflowed |= (s_buffers[i].total_dropped != 0);
+    }
+    return ESP_OK;
+}
+
+void heap_trace_dump(void)
+{
+    heap_trace_dump_caps(MALLOC_CAP_INTERNAL | MALLOC_CAP_SPIRAM);
+}
+
+void heap_trace_dump_caps(__attribute__((unused)) const uint32_t caps)
+{
+    // The records are in the stream, only the summary is printed here
+    heap_trace_stream_flush();
+    size_t total_dropped = 0;
+    heap_trace_summary_t summary;
+    heap_trace_summary(&summary);
+    for (int i = 0; i < portNUM_PROCESSORS; ++i) {
+        total_dropped += s_buffers[i].total_dropped;
+    }
+    esp_rom_printf("====== Heap Trace Summary (streaming) ======\n");
+    esp_rom_printf("total allocations: %"PRIu32"\n", (uint32_t) summary.total_allocations);
+    esp_rom_printf("total frees: %"PRIu32"\n", (uint32_t) summary.total_frees);
+    if (total_dropped != 0) {
+        esp_rom_printf("(NB: %"PRIu32" records were dropped because the buffer was full, so trace data is incomplete.)\n",
+                       (uint32_t) total_dropped);
+    }
+    esp_rom_printf("Run heap_trace_analyze.py on the stream for live allocations and leaks\n");
+    esp_rom_printf("============================================\n");
+}
+
+#include "heap_trace.inc"
+
+#endif // CONFIG_HEAP_TRACING_STREAMING
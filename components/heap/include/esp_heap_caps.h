@@ -270,6 +270,19 @@ void heap_caps_get_info( multi_heap_info_t *info, uint32_t caps );
  */
 void heap_caps_print_heap_info( uint32_t caps );
 
+/**
+ * @brief Return the blocks held by the size class caches of all heaps with the given capabilities
+ *
+ * Calls multi_heap_cache_flush on all heaps which share the given capabilities.
+ * Only has an effect with CONFIG_HEAP_SIZE_CLASS_CACHE enabled, where freed small
+ * blocks are not counted as free until they are flushed. Useful before comparing
+ * free sizes, e.g. to check for leaks.
+ *
+ * @param caps        Bitwise OR of MALLOC_CAP_* flags indicating the type
+ *                    of memory
+ */
+void heap_caps_cache_flush( uint32_t caps );
+
 /**
  * @brief Check integrity of all heap memory in the system.
  *
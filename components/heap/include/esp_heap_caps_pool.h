@@ -0,0 +1,119 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_heap_caps.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Handle of a pool of fixed-size objects
+ */
+typedef struct heap_caps_pool *heap_caps_pool_handle_t;
+
+/**
+ * @brief Give each core its own free list
+ *
+ * Objects are allocated from the free list of the calling core, and from the
+ * free lists of the other cores only if it is empty. Freed objects are put on
+ * the free list of the calling core. This avoids contention between the cores
+ * when both allocate from the same pool.
+ */
+#define HEAP_CAPS_POOL_FLAG_PER_CORE    (1 << 0)
+
+/**
+ * @brief Maximum number of objects in a pool
+ */
+#define HEAP_CAPS_POOL_MAX_OBJECTS      0xfffe
+
+/**
+ * @brief Statistics of a pool, filled by heap_caps_pool_get_info()
+ */
+typedef struct {
+    size_t object_size;             ///< Size of each object in bytes, rounded up to the alignment of a pointer
+    size_t total_objects;           ///< Number of objects in the pool
+    size_t free_objects;            ///< Number of objects which are currently free
+    size_t minimum_free_objects;    ///< Lowest number of free objects since the pool was created
+    size_t failed_allocations;      ///< Number of allocations which failed because the pool was empty
+} heap_caps_pool_info_t;
+
+/**
+ * @brief Create a pool of fixed-size objects
+ *
+ * Equivalent to heap_caps_pool_create_with_flags() with no flags.
+ *
+ * @param object_size Size of each object in bytes
+ * @param count       Number of objects in the pool, up to HEAP_CAPS_POOL_MAX_OBJECTS
+ * @param caps        Bitwise OR of MALLOC_CAP_* flags indicating the type of memory the objects are allocated from
+ *
+ * @return Handle of the pool, or NULL if the parameters are invalid or there is not enough memory
+ */
+heap_caps_pool_handle_t heap_caps_pool_create(size_t object_size, size_t count, uint32_t caps);
+
+/**
+ * @brief Create a pool of fixed-size objects
+ *
+ * Memory for all objects is allocated at once with heap_caps_malloc(). Objects
+ * are allocated from and returned to the pool in constant time, without a
+ * block header per object and without taking a lock, so the pool functions
+ * can be called from any task or ISR.
+ *
+ * Pools are listed by heap_caps_print_heap_info(). If CONFIG_HEAP_USE_HOOKS is
+ * enabled, esp_heap_trace_alloc_hook() and esp_heap_trace_free_hook() are
+ * called for the objects.
+ *
+ * @param object_size Size of each object in bytes
+ * @param count       Number of objects in the pool, up to HEAP_CAPS_POOL_MAX_OBJECTS
+ * @param caps        Bitwise OR of MALLOC_CAP_* flags indicating the type of memory the objects are allocated from
+ * @param flags       Bitwise OR of HEAP_CAPS_POOL_FLAG_* flags
+ *
+ * @return Handle of the pool, or NULL if the parameters are invalid or there is not enough memory
+ */
+heap_caps_pool_handle_t heap_caps_pool_create_with_flags(size_t object_size, size_t count, uint32_t caps, uint32_t flags);
+
+/**
+ * @brief Delete a pool and free its memory
+ *
+ * All objects allocated from the pool become invalid, whether they have been
+ * returned to the pool or not.
+ *
+ * @param pool Handle of the pool, may be NULL
+ */
+void heap_caps_pool_delete(heap_caps_pool_handle_t pool);
+
+/**
+ * @brief Allocate an object from a pool
+ *
+ * @param pool Handle of the pool
+ *
+ * @return Pointer to the object, or NULL if all objects are in use
+ */
+void *heap_caps_pool_alloc(heap_caps_pool_handle_t pool);
+
+/**
+ * @brief Return an object to the pool it has been allocated from
+ *
+ * @param pool Handle of the pool
+ * @param ptr  Pointer returned by heap_caps_pool_alloc() for this pool, may be NULL
+ */
+void heap_caps_pool_free(heap_caps_pool_handle_t pool, void *ptr);
+
+/**
+ * @brief Get the statistics of a pool
+ *
+ * @param pool Handle of the pool
+ * @param info Pointer to a structure which will be filled with the statistics
+ */
+void heap_caps_pool_get_info(heap_caps_pool_handle_t pool, heap_caps_pool_info_t *info);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,82 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "sdkconfig.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if CONFIG_HEAP_PROFILING || __DOXYGEN__
+
+#ifndef CONFIG_HEAP_PROFILING_STACK_DEPTH
+#define CONFIG_HEAP_PROFILING_STACK_DEPTH 1
+#endif
+
+/**
+ * @brief Statistics of the allocations made from one call site
+ */
+typedef struct {
+    void *callers[CONFIG_HEAP_PROFILING_STACK_DEPTH]; ///< Return addresses of the call site, the caller of the heap function first. All NULL for the allocations which didn't fit into the table of call sites.
+    size_t allocations;     ///< Number of allocations made from this call site
+    size_t frees;           ///< Number of allocations made from this call site which have been freed
+    size_t live_bytes;      ///< Number of bytes currently allocated from this call site
+    size_t peak_live_bytes; ///< Highest value of live_bytes
+    uint32_t alloc_rate;    ///< Allocations per second since the previous call of heap_caps_profile_get_sites()
+} heap_caps_profile_site_t;
+
+/**
+ * @brief Summary of the heap profile, filled by heap_caps_profile_get_sites()
+ */
+typedef struct {
+    size_t num_sites;               ///< Number of call sites recorded
+    size_t untracked_allocations;   ///< Number of allocations whose free can't be attributed because the table of live allocations was full
+} heap_caps_profile_info_t;
+
+/**
+ * @brief Get the call sites holding the most memory
+ *
+ * When CONFIG_HEAP_PROFILING is enabled, each allocation and free made through
+ * malloc(), heap_caps_malloc() and related functions is attributed to its call
+ * site, identified by CONFIG_HEAP_PROFILING_STACK_DEPTH return addresses.
+ *
+ * @note The call sites are copied one at a time, so that allocations aren't blocked
+ *       for long. The statistics of different sites may then be taken at slightly
+ *       different times.
+ *
+ * @param[out] sites     Array filled with the call sites holding the most live bytes, in decreasing order
+ * @param      max_sites Number of elements of sites
+ * @param[out] info      Summary of the profile, may be NULL
+ *
+ * @return Number of elements of sites which have been filled
+ */
+size_t heap_caps_profile_get_sites(heap_caps_profile_site_t *sites, size_t max_sites, heap_caps_profile_info_t *info);
+
+/**
+ * @brief Print the call sites holding the most memory
+ *
+ * Addresses of the callers can be decoded with ``idf.py monitor`` or addr2line.
+ *
+ * @param max_sites Maximum number of call sites to print
+ */
+void heap_caps_profile_print(size_t max_sites);
+
+/**
+ * @brief Reset the number of allocations and frees, and the peak bytes, of all call sites
+ *
+ * Live allocations stay attributed to their call sites.
+ */
+void heap_caps_profile_reset(void);
+
+#endif // CONFIG_HEAP_PROFILING || __DOXYGEN__
+
+#ifdef __cplusplus
+}
+#endif
@@ -36,6 +36,9 @@ typedef struct heap_trace_record_t {
     size_t size;     ///< Size of the allocation
     void *alloced_by[CONFIG_HEAP_TRACING_STACK_DEPTH]; ///< Call stack of the caller which allocated the memory.
     void *freed_by[CONFIG_HEAP_TRACING_STACK_DEPTH];   ///< Call stack of the caller which freed the memory (all zero if not freed.)
+#if CONFIG_HEAP_TRACING_STREAMING
+    uint32_t caps;   ///< Capabilities requested for the allocation, MALLOC_CAP_DEFAULT for malloc()
+#endif // CONFIG_HEAP_TRACING_STREAMING
 #if CONFIG_HEAP_TRACING_STANDALONE
     TAILQ_ENTRY(heap_trace_record_t) tailq_list; ///< Linked list: prev & next records
 #if CONFIG_HEAP_TRACE_HASH_MAP
@@ -89,6 +92,61 @@ esp_err_t heap_trace_init_standalone(heap_trace_record_t *record_buffer, size_t
  */
 esp_err_t heap_trace_init_tohost(void);
 
+/**
+ * @brief Function which receives the heap trace stream in streaming mode
+ *
+ * @param data  Buffer holding one or more complete heap trace records
+ * @param size  Size of the records in bytes
+ * @param arg   Argument passed to heap_trace_init_streaming()
+ */
+typedef void (*heap_trace_stream_sink_t)(const uint8_t *data, size_t size, void *arg);
+
+/**
+ * @brief Initialise heap tracing in streaming mode.
+ *
+ * This function must be called before any other heap tracing functions.
+ *
+ * In streaming mode each core writes compact binary records of allocations
+ * and frees into its own buffer, without taking a lock. A low priority task
+ * passes the records to the sink, which writes them out, for example to a
+ * file with heap_trace_stream_sink_fd() or to the host with esp_apptrace_write().
+ * The stream can be turned into reports of live allocations and leaks
+ * with components/heap/heap_trace_analyze.py.
+ *
+ * Calling this function again while tracing is stopped replaces the sink.
+ *
+ * @note The sink is called from the heap trace task or from heap_trace_stream_flush().
+ * Allocations made by the sink are traced as well.
+ *
+ * @param sink Function which receives the records
+ * @param arg  Argument passed to the sink
+ * @return
+ *  - ESP_ERR_NOT_SUPPORTED Project was compiled without streaming heap tracing enabled in menuconfig.
+ *  - ESP_ERR_INVALID_ARG sink is NULL.
+ *  - ESP_ERR_INVALID_STATE Heap tracing is currently in progress.
+ *  - ESP_ERR_NO_MEM The heap trace task could not be created.
+ *  - ESP_OK Heap tracing initialised successfully.
+ */
+esp_err_t heap_trace_init_streaming(heap_trace_stream_sink_t sink, void *arg);
+
+/**
+ * @brief Pass all heap trace records recorded so far to the sink
+ *
+ * Records are passed to the sink periodically by the heap trace task, this
+ * function can be used to do it immediately, for example before analysing
+ * the stream. Must be called from a task.
+ */
+void heap_trace_stream_flush(void);
+
+/**
+ * @brief Heap trace sink which writes the records to a file descriptor
+ *
+ * @param data  Buffer holding the records
+ * @param size  Size of the records in bytes
+ * @param arg   File descriptor, cast to a pointer: ``(void *) (intptr_t) fd``
+ */
+void heap_trace_stream_sink_fd(const uint8_t *data, size_t size, void *arg);
+
 /**
  * @brief Start heap tracing. All heap allocations & frees will be traced, until heap_trace_stop() is called.
  *
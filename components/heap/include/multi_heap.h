@@ -8,6 +8,10 @@
 #include <stdlib.h>
 #include <stdbool.h>
 
+#ifdef ESP_PLATFORM
+#include "sdkconfig.h"
+#endif
+
 /* multi_heap is a heap implementation for handling multiple
    heterogenous heaps in a single program.
 
@@ -159,6 +163,19 @@ size_t multi_heap_free_size(multi_heap_handle_t heap);
  */
 size_t multi_heap_minimum_free_size(multi_heap_handle_t heap);
 
+/** @brief Return all blocks held by the size class caches of a heap to the heap
+ *
+ * With CONFIG_HEAP_SIZE_CLASS_CACHE enabled, freed blocks of up to 256 bytes are kept in per-core caches
+ * for reuse by later allocations of a similar size. They are not counted as free until they are flushed.
+ * Allocations which fail flush the caches and are retried, so calling this function is only needed to
+ * get exact results from multi_heap_free_size(), e.g. when checking for leaks.
+ *
+ * Does nothing if CONFIG_HEAP_SIZE_CLASS_CACHE is disabled.
+ *
+ * @param heap Handle to a registered heap.
+ */
+void multi_heap_cache_flush(multi_heap_handle_t heap);
+
 /** @brief Structure to access heap metadata via multi_heap_get_info */
 typedef struct {
     size_t total_free_bytes;      ///<  Total free bytes in the heap. Equivalent to multi_free_heap_size().
@@ -168,6 +185,10 @@ typedef struct {
     size_t allocated_blocks;      ///<  Number of (variable size) blocks allocated in the heap.
     size_t free_blocks;           ///<  Number of (variable size) free blocks in the heap.
     size_t total_blocks;          ///<  Total number of (variable size) blocks in the heap.
+#if CONFIG_HEAP_SIZE_CLASS_CACHE || __DOXYGEN__
+    size_t cached_bytes;          ///<  Bytes in the blocks held by the size class caches. Neither part of total_free_bytes nor of total_allocated_bytes.
+    size_t cached_blocks;         ///<  Number of blocks held by the size class caches. Not part of allocated_blocks.
+#endif
 } multi_heap_info_t;
 
 /** @brief Return metadata about a given heap
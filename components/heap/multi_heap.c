@@ -67,12 +67,45 @@ void *multi_heap_get_block_address(multi_heap_block_handle_t block)
 #define ALIGN_UP_BY(num, align) (((num) + ((align) - 1)) & ~((align) - 1))
 
 
+#ifdef MULTI_HEAP_SIZE_CLASS_CACHE
+/* Size class cache
+ *
+ * Freed blocks of up to CACHE_MAX_SIZE bytes are kept in per-core free lists,
+ * one list per size class, instead of being returned to TLSF. Allocations of
+ * up to CACHE_MAX_SIZE bytes are served from the list of the current core,
+ * which is refilled from TLSF with a batch of blocks of the class size when
+ * it is empty. When a list reaches its limit, half of it is returned to TLSF.
+ * Refills and flushes take the heap lock once per batch, so most small
+ * allocations only take the lock of the current core's cache, which is not
+ * contended by the other cores.
+ *
+ * Cached blocks are allocated from the TLSF point of view. They are neither
+ * counted as free nor as allocated by multi_heap_get_info(). If an allocation
+ * fails, all caches of the heap are flushed and the allocation is retried.
+ *
+ * Locking order: cache lock, then heap lock.
+ */
+#define CACHE_GRANULARITY 16
+#define CACHE_MAX_SIZE 256
+#define CACHE_CLASSES (CACHE_MAX_SIZE / CACHE_GRANULARITY)
+
+typedef struct {
+    multi_heap_lock_t lock;
+    void *blocks[CACHE_CLASSES];       // Lists linked through the first word of each block
+    uint16_t count[CACHE_CLASSES];
+    size_t bytes;                      // Sum of the block sizes of all cached blocks
+} heap_cache_t;
+#endif // MULTI_HEAP_SIZE_CLASS_CACHE
+
 typedef struct multi_heap_info {
     void *lock;
     size_t free_bytes;
     size_t minimum_free_bytes;
     size_t pool_size;
     void* heap_data;
+#ifdef MULTI_HEAP_SIZE_CLASS_CACHE
+    heap_cache_t cache[MULTI_HEAP_NUM_CORES];
+#endif
 } heap_t;
 
 #if CONFIG_HEAP_TLSF_USE_ROM_IMPL
@@ -97,6 +130,11 @@ void multi_heap_in_rom_init(void)
     multi_heap_os_funcs_init(&multi_heap_os_funcs);
 }
 
+void multi_heap_cache_flush(multi_heap_handle_t heap)
+{
+    (void) heap;
+}
+
 #else // CONFIG_HEAP_TLSF_USE_ROM_IMPL
 
 /* Check a block is valid for this heap. Used to verify parameters. */
@@ -143,6 +181,12 @@ multi_heap_handle_t multi_heap_register_impl(void *start_ptr, size_t size)
     result->free_bytes = size - tlsf_size(result->heap_data);
     result->pool_size = size;
     result->minimum_free_bytes = result->free_bytes;
+#ifdef MULTI_HEAP_SIZE_CLASS_CACHE
+    memset(result->cache, 0, sizeof(result->cache));
+    for (int core = 0; core < MULTI_HEAP_NUM_CORES; core++) {
+        MULTI_HEAP_LOCK_INIT(&result->cache[core].lock);
+    }
+#endif
     return result;
 }
 
@@ -190,13 +234,134 @@ bool multi_heap_is_free(multi_heap_block_handle_t block)
     return block_is_free(block);
 }
 
-void *multi_heap_malloc_impl(multi_heap_handle_t heap, size_t size)
+#ifdef MULTI_HEAP_SIZE_CLASS_CACHE
+/* Number of blocks of a size class a core's cache holds at most */
+static inline size_t cache_limit(size_t class)
 {
-    if (size == 0 || heap == NULL) {
-        return NULL;
+    size_t limit = MULTI_HEAP_CACHE_CLASS_BYTES / ((class + 1) * CACHE_GRANULARITY);
+    return (limit < 2) ? 2 : limit;
+}
+
+/* Allocate a batch of blocks of the class size from TLSF into the cache.
+   Called with the cache lock held. */
+static void cache_refill(heap_t *heap, heap_cache_t *cache, size_t class)
+{
+    const size_t size = (class + 1) * CACHE_GRANULARITY;
+    const size_t batch = cache_limit(class) / 2;
+
+    multi_heap_internal_lock(heap);
+    for (size_t i = 0; i < batch; i++) {
+        void *block = tlsf_malloc(heap->heap_data, size);
+        if (block == NULL) {
+            break;
+        }
+        heap->free_bytes -= tlsf_block_size(block);
+        heap->free_bytes -= tlsf_alloc_overhead();
+        *(void **)block = cache->blocks[class];
+        cache->blocks[class] = block;
+        cache->count[class]++;
+        cache->bytes += tlsf_block_size(block);
+    }
+    if (heap->free_bytes < heap->minimum_free_bytes) {
+        heap->minimum_free_bytes = heap->free_bytes;
+    }
+    multi_heap_internal_unlock(heap);
+}
+
+/* Return up to count blocks of a size class from the cache to TLSF.
+   Called with the cache lock held. */
+static void cache_flush_class(heap_t *heap, heap_cache_t *cache, size_t class, size_t count)
+{
+    multi_heap_internal_lock(heap);
+    for (size_t i = 0; i < count && cache->blocks[class] != NULL; i++) {
+        void *block = cache->blocks[class];
+        cache->blocks[class] = *(void **)block;
+        cache->count[class]--;
+        cache->bytes -= tlsf_block_size(block);
+        heap->free_bytes += tlsf_block_size(block);
+        heap->free_bytes += tlsf_alloc_overhead();
+        tlsf_free(heap->heap_data, block);
     }
+    multi_heap_internal_unlock(heap);
+}
+
+static void *cache_malloc(heap_t *heap, size_t size)
+{
+    const size_t class = (size - 1) / CACHE_GRANULARITY;
+    heap_cache_t *cache = &heap->cache[MULTI_HEAP_CORE_ID()];
+
+    MULTI_HEAP_LOCK(&cache->lock);
+    if (cache->blocks[class] == NULL) {
+        cache_refill(heap, cache, class);
+    }
+    void *result = cache->blocks[class];
+    if (result) {
+        cache->blocks[class] = *(void **)result;
+        cache->count[class]--;
+        cache->bytes -= tlsf_block_size(result);
+    }
+    MULTI_HEAP_UNLOCK(&cache->lock);
+
+    return result;
+}
+
+/* Returns false if the block is too small or too large for the cache */
+static bool cache_free(heap_t *heap, void *p)
+{
+    const size_t block_size = tlsf_block_size(p);
+    if (block_size < CACHE_GRANULARITY || block_size >= CACHE_MAX_SIZE + CACHE_GRANULARITY) {
+        return false;
+    }
+    /* Round down, so that every block in a list is at least as large as its class size */
+    const size_t class = block_size / CACHE_GRANULARITY - 1;
+    heap_cache_t *cache = &heap->cache[MULTI_HEAP_CORE_ID()];
+
+    MULTI_HEAP_LOCK(&cache->lock);
+    *(void **)p = cache->blocks[class];
+    cache->blocks[class] = p;
+    cache->count[class]++;
+    cache->bytes += block_size;
+    if (cache->count[class] >= cache_limit(class)) {
+        cache_flush_class(heap, cache, class, cache_limit(class) / 2);
+    }
+    MULTI_HEAP_UNLOCK(&cache->lock);
 
+    return true;
+}
+
+static bool cache_is_empty(heap_t *heap)
+{
+    for (int core = 0; core < MULTI_HEAP_NUM_CORES; core++) {
+        if (heap->cache[core].bytes != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+#endif // MULTI_HEAP_SIZE_CLASS_CACHE
+
+void multi_heap_cache_flush(multi_heap_handle_t heap)
+{
+#ifdef MULTI_HEAP_SIZE_CLASS_CACHE
+    if (heap == NULL) {
+        return;
+    }
+
+    for (int core = 0; core < MULTI_HEAP_NUM_CORES; core++) {
+        heap_cache_t *cache = &heap->cache[core];
+        MULTI_HEAP_LOCK(&cache->lock);
+        for (size_t class = 0; class < CACHE_CLASSES; class++) {
+            cache_flush_class(heap, cache, class, cache->count[class]);
+        }
+        MULTI_HEAP_UNLOCK(&cache->lock);
+    }
+#else
+    (void) heap;
+#endif
+}
 
+static void *malloc_from_tlsf(heap_t *heap, size_t size)
+{
     multi_heap_internal_lock(heap);
     void *result = tlsf_malloc(heap->heap_data, size);
     if(result) {
@@ -211,6 +376,33 @@ void *multi_heap_malloc_impl(multi_heap_handle_t heap, size_t size)
     return result;
 }
 
+void *multi_heap_malloc_impl(multi_heap_handle_t heap, size_t size)
+{
+    if (size == 0 || heap == NULL) {
+        return NULL;
+    }
+
+#ifdef MULTI_HEAP_SIZE_CLASS_CACHE
+    if (size <= CACHE_MAX_SIZE) {
+        void *result = cache_malloc(heap, size);
+        if (result) {
+            return result;
+        }
+    }
+#endif
+
+    void *result = malloc_from_tlsf(heap, size);
+
+#ifdef MULTI_HEAP_SIZE_CLASS_CACHE
+    if (result == NULL && !cache_is_empty(heap)) {
+        multi_heap_cache_flush(heap);
+        result = malloc_from_tlsf(heap, size);
+    }
+#endif
+
+    return result;
+}
+
 void multi_heap_free_impl(multi_heap_handle_t heap, void *p)
 {
     if (heap == NULL || p == NULL) {
@@ -219,6 +411,12 @@ void multi_heap_free_impl(multi_heap_handle_t heap, void *p)
 
     assert_valid_block(heap, block_from_ptr(p));
 
+#ifdef MULTI_HEAP_SIZE_CLASS_CACHE
+    if (cache_free(heap, p)) {
+        return;
+    }
+#endif
+
     multi_heap_internal_lock(heap);
     heap->free_bytes += tlsf_block_size(p);
     heap->free_bytes += tlsf_alloc_overhead();
@@ -258,6 +456,22 @@ void *multi_heap_realloc_impl(multi_heap_handle_t heap, void *p, size_t size)
     return result;
 }
 
+static void *memalign_from_tlsf(heap_t *heap, size_t size, size_t alignment, size_t offset)
+{
+    multi_heap_internal_lock(heap);
+    void *result = tlsf_memalign_offs(heap->heap_data, alignment, size, offset);
+    if(result) {
+        heap->free_bytes -= tlsf_block_size(result);
+        heap->free_bytes -= tlsf_alloc_overhead();
+        if(heap->free_bytes < heap->minimum_free_bytes) {
+            heap->minimum_free_bytes = heap->free_bytes;
+        }
+    }
+    multi_heap_internal_unlock(heap);
+
+    return result;
+}
+
 void *multi_heap_aligned_alloc_impl_offs(multi_heap_handle_t heap, size_t size, size_t alignment, size_t offset)
 {
     if(heap == NULL) {
@@ -273,16 +487,14 @@ void *multi_heap_aligned_alloc_impl_offs(multi_heap_handle_t heap, size_t size,
         return NULL;
     }
 
-    multi_heap_internal_lock(heap);
-    void *result = tlsf_memalign_offs(heap->heap_data, alignment, size, offset);
-    if(result) {
-        heap->free_bytes -= tlsf_block_size(result);
-        heap->free_bytes -= tlsf_alloc_overhead();
-        if(heap->free_bytes < heap->minimum_free_bytes) {
-            heap->minimum_free_bytes = heap->free_bytes;
-        }
+    void *result = memalign_from_tlsf(heap, size, alignment, offset);
+
+#ifdef MULTI_HEAP_SIZE_CLASS_CACHE
+    if (result == NULL && !cache_is_empty(heap)) {
+        multi_heap_cache_flush(heap);
+        result = memalign_from_tlsf(heap, size, alignment, offset);
     }
-    multi_heap_internal_unlock(heap);
+#endif
 
     return result;
 }
@@ -409,6 +621,12 @@ void multi_heap_get_info_impl(multi_heap_handle_t heap, multi_heap_info_t *info)
         return;
     }
 
+#ifdef MULTI_HEAP_SIZE_CLASS_CACHE
+    /* Hold all cache locks, so that no block moves between the caches and TLSF while walking the pool */
+    for (int core = 0; core < MULTI_HEAP_NUM_CORES; core++) {
+        MULTI_HEAP_LOCK(&heap->cache[core].lock);
+    }
+#endif
     multi_heap_internal_lock(heap);
     tlsf_walk_pool(tlsf_get_pool(heap->heap_data), multi_heap_get_info_tlsf, info);
     /* TLSF has an overhead per block. Calculate the total amount of overhead, it shall not be
@@ -419,5 +637,18 @@ void multi_heap_get_info_impl(multi_heap_handle_t heap, multi_heap_info_t *info)
     info->total_free_bytes = heap->free_bytes;
     info->largest_free_block = tlsf_fit_size(heap->heap_data, info->largest_free_block);
     multi_heap_internal_unlock(heap);
+#ifdef MULTI_HEAP_SIZE_CLASS_CACHE
+    for (int core = MULTI_HEAP_NUM_CORES - 1; core >= 0; core--) {
+        heap_cache_t *cache = &heap->cache[core];
+        for (size_t class = 0; class < CACHE_CLASSES; class++) {
+            info->cached_blocks += cache->count[class];
+        }
+        info->cached_bytes += cache->bytes;
+        MULTI_HEAP_UNLOCK(&cache->lock);
+    }
+    /* TLSF counts the cached blocks as allocated */
+    info->allocated_blocks -= info->cached_blocks;
+    info->total_allocated_bytes -= info->cached_bytes;
+#endif
 }
 #endif
@@ -21,3 +21,14 @@
 #define MULTI_HEAP_POISONING
 #define MULTI_HEAP_POISONING_SLOW
 #endif
+
+/* The size class cache relies on the heap lock not being held around the
+   multi_heap_*_impl() functions, which heap poisoning does */
+#if defined(CONFIG_HEAP_SIZE_CLASS_CACHE) && !defined(MULTI_HEAP_POISONING)
+#define MULTI_HEAP_SIZE_CLASS_CACHE
+#ifdef CONFIG_HEAP_SIZE_CLASS_CACHE_BYTES
+#define MULTI_HEAP_CACHE_CLASS_BYTES CONFIG_HEAP_SIZE_CLASS_CACHE_BYTES
+#else
+#define MULTI_HEAP_CACHE_CLASS_BYTES 512
+#endif
+#endif
@@ -36,6 +36,9 @@ typedef portMUX_TYPE multi_heap_lock_t;
 
 #define MULTI_HEAP_LOCK_STATIC_INITIALIZER     portMUX_INITIALIZER_UNLOCKED
 
+#define MULTI_HEAP_NUM_CORES portNUM_PROCESSORS
+#define MULTI_HEAP_CORE_ID() xPortGetCoreID()
+
 /* Not safe to use std i/o while in a portmux critical section,
    can deadlock, so we use the ROM equivalent functions. */
 
@@ -84,13 +87,38 @@ inline static void multi_heap_assert(bool condition, const char *format, int lin
 #else // MULTI_HEAP_FREERTOS
 
 #include <assert.h>
+#include <pthread.h>
+
+typedef pthread_mutex_t multi_heap_lock_t;
 
 #define MULTI_HEAP_PRINTF printf
 #define MULTI_HEAP_STDERR_PRINTF(MSG, ...) fprintf(stderr, MSG, __VA_ARGS__)
-#define MULTI_HEAP_LOCK(PLOCK)  (void) (PLOCK)
-#define MULTI_HEAP_UNLOCK(PLOCK)  (void) (PLOCK)
-#define MULTI_HEAP_LOCK_INIT(PLOCK)  (void) (PLOCK)
-#define MULTI_HEAP_LOCK_STATIC_INITIALIZER  0
+#define MULTI_HEAP_LOCK(PLOCK) do {                         \
+        if ((PLOCK) != NULL) {                              \
+            pthread_mutex_lock((PLOCK));                    \
+        }                                                   \
+    } while(0)
+#define MULTI_HEAP_UNLOCK(PLOCK) do {                       \
+        if ((PLOCK) != NULL) {                              \
+            pthread_mutex_unlock((PLOCK));                  \
+        }                                                   \
+    } while(0)
+#define MULTI_HEAP_LOCK_INIT(PLOCK)  pthread_mutex_init((PLOCK), NULL)
+#define MULTI_HEAP_LOCK_STATIC_INITIALIZER  PTHREAD_MUTEX_INITIALIZER
+
+/* There are no cores on the host, threads are assigned to the per-core
+   parts of the heap in the order in which they first use them */
+#define MULTI_HEAP_NUM_CORES 2
+inline static int multi_heap_core_id(void)
+{
+    static int s_next_core;
+    static __thread int s_core = -1;
+    if (s_core < 0) {
+        s_core = __atomic_fetch_add(&s_next_core, 1, __ATOMIC_RELAXED) % MULTI_HEAP_NUM_CORES;
+    }
+    return s_core;
+}
+#define MULTI_HEAP_CORE_ID() multi_heap_core_id()
 
 #define MULTI_HEAP_ASSERT(CONDITION, ADDRESS) assert((CONDITION) && "Heap corrupt")
 
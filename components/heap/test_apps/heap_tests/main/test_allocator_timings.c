@@ -6,9 +6,13 @@
 #include "freertos/FreeRTOS.h"
 #include <esp_types.h>
 #include <stdio.h>
+#include <inttypes.h>
 #include "unity.h"
 #include "esp_attr.h"
 #include "esp_heap_caps.h"
+#include "esp_heap_caps_init.h"
+#include "esp_heap_caps_pool.h"
+#include "heap_memory_layout.h"
 #include "esp_log.h"
 #include "esp_cpu.h"
 #include <stdlib.h>
@@ -23,6 +27,8 @@
 
 static const char *TAG = "test_heap";
 
+extern void set_leak_threshold(int threshold);
+
 TEST_CASE("Heap many random allocations timings", "[heap]")
 {
     void *p[NUM_POINTERS] = { 0 };
@@ -113,4 +119,84 @@ TEST_CASE("Heap many random allocations timings", "[heap]")
 
     TEST_ASSERT(heap_caps_check_integrity(MALLOC_CAP_DEFAULT, true));
 }
+
+#define NUM_EXTRA_HEAPS 8
+#define EXTRA_HEAP_SIZE 3500
+#define LOOKUP_ITERATIONS 1000
+
+static uint32_t time_malloc_free(size_t size, uint32_t caps)
+{
+    uint32_t cycles = 0;
+    for (int i = 0; i < LOOKUP_ITERATIONS; i++) {
+        uint32_t cycles_before = esp_cpu_get_cycle_count();
+        void *p = heap_caps_malloc(size, caps);
+        heap_caps_free(p);
+        cycles += esp_cpu_get_cycle_count() - cycles_before;
+        TEST_ASSERT_NOT_NULL(p);
+    }
+    return cycles / LOOKUP_ITERATIONS;
+}
+
+/* NOTE: This is not a well-formed unit test, it leaks memory and
+   may fail if run twice in a row without a reset.
+*/
+TEST_CASE("Heap lookup timings with many registered heaps", "[heap]")
+{
+    static uint8_t s_buffers[NUM_EXTRA_HEAPS][EXTRA_HEAP_SIZE];
+    const uint32_t MALLOC_CAP_INVENTED = (1 << 29); /* this must be unused in esp_heap_caps.h */
+    uint32_t caps[SOC_MEMORY_TYPE_NO_PRIOS] = { MALLOC_CAP_INVENTED };
+
+    for (int i = 0; i < NUM_EXTRA_HEAPS; i++) {
+        TEST_ESP_OK( heap_caps_add_region_with_caps(caps, (intptr_t)s_buffers[i], (intptr_t)s_buffers[i] + EXTRA_HEAP_SIZE) );
+    }
+
+    /* MALLOC_CAP_DEFAULT | MALLOC_CAP_INTERNAL is in the lookup table. Adding MALLOC_CAP_8BIT
+       selects the same heaps, but the allocation has to walk the list of registered heaps. */
+    uint32_t lookup_cycles = time_malloc_free(32, MALLOC_CAP_DEFAULT | MALLOC_CAP_INTERNAL);
+    uint32_t walk_cycles = time_malloc_free(32, MALLOC_CAP_DEFAULT | MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    uint32_t invented_cycles = time_malloc_free(32, MALLOC_CAP_INVENTED);
+    printf("malloc+free with %d extra heaps: %"PRIu32" cycles with lookup table, %"PRIu32" cycles walking the heaps, "
+           "%"PRIu32" cycles from an extra heap\n", NUM_EXTRA_HEAPS, lookup_cycles, walk_cycles, invented_cycles);
+
+    // set the leak threshold to a bigger value as this test leaks memory
+    set_leak_threshold(-6000);
+}
+
+#define POOL_OBJECT_SIZE 40
+#define POOL_OBJECTS 64
+
+TEST_CASE("Heap pool timings compared to heap_caps_malloc", "[heap]")
+{
+    void *p[POOL_OBJECTS];
+    heap_caps_pool_handle_t pool = heap_caps_pool_create(POOL_OBJECT_SIZE, POOL_OBJECTS, MALLOC_CAP_DEFAULT);
+    TEST_ASSERT_NOT_NULL(pool);
+
+    uint32_t pool_cycles = 0;
+    uint32_t malloc_cycles = 0;
+    for (int i = 0; i < 100; i++) {
+        uint32_t cycles_before = esp_cpu_get_cycle_count();
+        for (int n = 0; n < POOL_OBJECTS; n++) {
+            p[n] = heap_caps_pool_alloc(pool);
+        }
+        for (int n = 0; n < POOL_OBJECTS; n++) {
+            heap_caps_pool_free(pool, p[n]);
+        }
+        pool_cycles += esp_cpu_get_cycle_count() - cycles_before;
+        TEST_ASSERT_NOT_NULL(p[POOL_OBJECTS - 1]);
+
+        cycles_before = esp_cpu_get_cycle_count();
+        for (int n = 0; n < POOL_OBJECTS; n++) {
+            p[n] = heap_caps_malloc(POOL_OBJECT_SIZE, MALLOC_CAP_DEFAULT);
+        }
+        for (int n = 0; n < POOL_OBJECTS; n++) {
+            heap_caps_free(p[n]);
+        }
+        malloc_cycles += esp_cpu_get_cycle_count() - cycles_before;
+    }
+    printf("alloc+free of %d byte objects: pool %"PRIu32" cycles, heap_caps_malloc %"PRIu32" cycles\n",
+           POOL_OBJECT_SIZE, pool_cycles / (100 * POOL_OBJECTS), malloc_cycles / (100 * POOL_OBJECTS));
+    TEST_ASSERT_LESS_THAN(malloc_cycles, pool_cycles);
+
+    heap_caps_pool_delete(pool);
+}
 #endif
@@ -21,8 +21,8 @@
 
 #include "esp_heap_caps.h"
 
-#ifdef CONFIG_HEAP_TRACING
-// only compile in heap tracing tests if tracing is enabled
+#ifdef CONFIG_HEAP_TRACING_STANDALONE
+// only compile in heap tracing tests if standalone tracing is enabled
 
 #include "esp_heap_trace.h"
 
@@ -275,4 +275,122 @@ TEST_CASE("can dump both external and internal allocations", "[trace-dump][all]"
 }
 #endif // CONFIG_SPIRAM
 
-#endif
+#endif // CONFIG_HEAP_TRACING_STANDALONE
+
+#ifdef CONFIG_HEAP_TRACING_STREAMING
+
+#include "esp_heap_trace.h"
+
+/* Records in the stream, see heap_trace_streaming.c */
+typedef struct {
+    uint8_t type;
+    uint8_t size;
+    uint16_t dropped;
+    uint32_t seq;
+    uint32_t ccount;
+    uint32_t address;
+} __attribute__((packed)) stream_record_t;
+
+static uint8_t s_stream[4096];
+static size_t s_stream_len;
+
+static void memory_sink(const uint8_t *data, size_t size, void *arg)
+{
+    size_t *dropped_bytes = arg;
+    if (s_stream_len + size > sizeof(s_stream)) {
+        *dropped_bytes += size;
+        return;
+    }
+    memcpy(&s_stream[s_stream_len], data, size);
+    s_stream_len += size;
+}
+
+/* Returns the sequence number of the first record of the given type and address
+   following the record with sequence number after, or -1 */
+static int64_t find_record(char type, const void *address, int64_t after)
+{
+    for (size_t offset = 0; offset < s_stream_len; offset += s_stream[offset + 1]) {
+        stream_record_t record;
+        memcpy(&record, &s_stream[offset], sizeof(record));
+        TEST_ASSERT_GREATER_OR_EQUAL(4, record.size);
+        if (record.type == type && record.address == (uint32_t) address && (int64_t) record.seq > after) {
+            return record.seq;
+        }
+    }
+    return -1;
+}
+
+static size_t s_dropped_bytes;
+
+static void start_streaming(void)
+{
+    TEST_ASSERT_EQUAL(ESP_OK, heap_trace_init_streaming(memory_sink, &s_dropped_bytes));
+    // Drop records left over from previous tests, their addresses may be reused
+    heap_trace_stream_flush();
+    s_stream_len = 0;
+    TEST_ASSERT_EQUAL(ESP_OK, heap_trace_start(HEAP_TRACE_LEAKS));
+}
+
+TEST_CASE("heap trace streaming records allocations and frees", "[heap-trace-streaming]")
+{
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, heap_trace_init_streaming(NULL, NULL));
+    start_streaming();
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, heap_trace_init_streaming(memory_sink, &s_dropped_bytes));
+
+    void *a = heap_caps_malloc(64, MALLOC_CAP_INTERNAL);
+    void *old_b = malloc(32);
+    void *b = realloc(old_b, 128);
+    free(a);
+    heap_trace_stop();
+    heap_trace_stream_flush();
+    free(b);
+
+    TEST_ASSERT_EQUAL('H', s_stream[0]);
+    int64_t alloc_a = find_record('A', a, -1);
+    TEST_ASSERT_NOT_EQUAL(-1, alloc_a);
+    TEST_ASSERT_NOT_EQUAL(-1, find_record('F', a, alloc_a));
+    // realloc is recorded as a free of old_b, which may be equal to b, then an allocation of b
+    int64_t alloc_old_b = find_record('A', old_b, -1);
+    TEST_ASSERT_NOT_EQUAL(-1, alloc_old_b);
+    int64_t free_old_b = find_record('F', old_b, alloc_old_b);
+    TEST_ASSERT_NOT_EQUAL(-1, free_old_b);
+    int64_t alloc_b = find_record('A', b, free_old_b);
+    TEST_ASSERT_NOT_EQUAL(-1, alloc_b);
+    // b was freed after tracing stopped
+    TEST_ASSERT_EQUAL(-1, find_record('F', b, alloc_b));
+
+    heap_trace_summary_t summary;
+    TEST_ASSERT_EQUAL(ESP_OK, heap_trace_summary(&summary));
+    TEST_ASSERT_GREATER_OR_EQUAL(3, summary.total_allocations);
+    TEST_ASSERT_GREATER_OR_EQUAL(2, summary.total_frees);
+    TEST_ASSERT_FALSE(summary.has_overflowed);
+    TEST_ASSERT_EQUAL(0, s_dropped_bytes);
+    TEST_ASSERT_EQUAL(0, heap_trace_get_count());
+}
+
+#if !CONFIG_FREERTOS_UNICORE
+static void *s_other_core_ptr;
+
+static void alloc_on_other_core(void *arg)
+{
+    s_other_core_ptr = malloc(48);
+    xTaskNotifyGive((TaskHandle_t) arg);
+    vTaskDelete(NULL);
+}
+
+TEST_CASE("heap trace streaming orders records of both cores", "[heap-trace-streaming]")
+{
+    start_streaming();
+    xTaskCreatePinnedToCore(alloc_on_other_core, "alloc", 2048, xTaskGetCurrentTaskHandle(), 5, NULL, !xPortGetCoreID());
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    free(s_other_core_ptr);
+    heap_trace_stop();
+    heap_trace_stream_flush();
+
+    int64_t alloc_seq = find_record('A', s_other_core_ptr, -1);
+    TEST_ASSERT_NOT_EQUAL(-1, alloc_seq);
+    TEST_ASSERT_GREATER_THAN(alloc_seq, find_record('F', s_other_core_ptr, -1));
+}
+#endif // !CONFIG_FREERTOS_UNICORE
+
+#endif // CONFIG_HEAP_TRACING_STREAMING
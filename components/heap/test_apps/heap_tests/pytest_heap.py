@@ -122,6 +122,18 @@ def test_heap_trace_dump(dut: Dut) -> None:
     dut.expect_unity_test_output(timeout=100)
 
 
+@pytest.mark.generic
+@pytest.mark.esp32
+@pytest.mark.parametrize(
+    'config',
+    [
+        'heap_trace_streaming'
+    ]
+)
+def test_heap_trace_streaming(dut: Dut) -> None:
+    dut.run_all_single_board_cases(group='heap-trace-streaming')
+
+
 @pytest.mark.generic
 @pytest.mark.supported_targets
 @pytest.mark.parametrize(
@@ -0,0 +1,179 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "esp_heap_caps.h"
+#include "esp_heap_caps_pool.h"
+#include "unity.h"
+
+#define OBJECT_SIZE 21
+#define NUM_OBJECTS 10
+
+TEST_CASE("Pool alloc and free", "[heap][pool]")
+{
+    TEST_ASSERT_NULL(heap_caps_pool_create(0, NUM_OBJECTS, MALLOC_CAP_DEFAULT));
+    TEST_ASSERT_NULL(heap_caps_pool_create(OBJECT_SIZE, 0, MALLOC_CAP_DEFAULT));
+    TEST_ASSERT_NULL(heap_caps_pool_create(OBJECT_SIZE, HEAP_CAPS_POOL_MAX_OBJECTS + 1, MALLOC_CAP_DEFAULT));
+
+    heap_caps_pool_handle_t pool = heap_caps_pool_create(OBJECT_SIZE, NUM_OBJECTS, MALLOC_CAP_DEFAULT);
+    TEST_ASSERT_NOT_NULL(pool);
+
+    heap_caps_pool_info_t info;
+    heap_caps_pool_get_info(pool, &info);
+    TEST_ASSERT_GREATER_OR_EQUAL(OBJECT_SIZE, info.object_size);
+    TEST_ASSERT_EQUAL(0, info.object_size % sizeof(void *));
+    TEST_ASSERT_EQUAL(NUM_OBJECTS, info.total_objects);
+    TEST_ASSERT_EQUAL(NUM_OBJECTS, info.free_objects);
+
+    uint8_t *p[NUM_OBJECTS];
+    for (int i = 0; i < NUM_OBJECTS; i++) {
+        p[i] = heap_caps_pool_alloc(pool);
+        TEST_ASSERT_NOT_NULL(p[i]);
+        TEST_ASSERT_EQUAL(0, (intptr_t)p[i] % sizeof(void *));
+        memset(p[i], i, OBJECT_SIZE);
+    }
+    TEST_ASSERT_NULL(heap_caps_pool_alloc(pool));
+
+    for (int i = 0; i < NUM_OBJECTS; i++) {
+        TEST_ASSERT_EACH_EQUAL_HEX8(i, p[i], OBJECT_SIZE);
+    }
+    heap_caps_pool_get_info(pool, &info);
+    TEST_ASSERT_EQUAL(0, info.free_objects);
+    TEST_ASSERT_EQUAL(0, info.minimum_free_objects);
+    TEST_ASSERT_EQUAL(1, info.failed_allocations);
+
+    heap_caps_pool_free(pool, p[3]);
+    heap_caps_pool_free(pool, NULL);
+    TEST_ASSERT_EQUAL_PTR(p[3], heap_caps_pool_alloc(pool));
+    for (int i = 0; i < NUM_OBJECTS; i++) {
+        heap_caps_pool_free(pool, p[i]);
+    }
+    heap_caps_pool_get_info(pool, &info);
+    TEST_ASSERT_EQUAL(NUM_OBJECTS, info.free_objects);
+    TEST_ASSERT_EQUAL(0, info.minimum_free_objects);
+
+    heap_caps_pool_delete(pool);
+    heap_caps_pool_delete(NULL);
+}
+
+#define NUM_THREADS 4
+#define THREAD_OBJECTS 64
+#define THREAD_ITERATIONS 20000
+
+static void *pool_thread(void *arg)
+{
+    heap_caps_pool_handle_t pool = arg;
+    uint32_t *p[THREAD_OBJECTS] = { 0 };
+    uint32_t seed = (uint32_t)(intptr_t)pthread_self();
+    for (int i = 0; i < THREAD_ITERATIONS; i++) {
+        seed = seed * 1103515245 + 12345;
+        int n = (seed >> 16) % THREAD_OBJECTS;
+        if (p[n] != NULL) {
+            // Nobody else wrote to the object while this thread owned it
+            if (*p[n] != (uint32_t)(intptr_t)&p[n]) {
+                return (void *)1;
+            }
+            heap_caps_pool_free(pool, p[n]);
+            p[n] = NULL;
+        } else {
+            p[n] = heap_caps_pool_alloc(pool);
+            if (p[n] != NULL) {
+                *p[n] = (uint32_t)(intptr_t)&p[n];
+            }
+        }
+    }
+    for (int n = 0; n < THREAD_OBJECTS; n++) {
+        heap_caps_pool_free(pool, p[n]);
+    }
+    return NULL;
+}
+
+static void test_pool_threads(uint32_t flags)
+{
+    // Fewer objects than the threads want, so that the pool runs empty
+    const size_t num_objects = NUM_THREADS * THREAD_OBJECTS / 2;
+    heap_caps_pool_handle_t pool = heap_caps_pool_create_with_flags(sizeof(uint32_t), num_objects, MALLOC_CAP_DEFAULT, flags);
+    TEST_ASSERT_NOT_NULL(pool);
+
+    pthread_t threads[NUM_THREADS];
+    for (int i = 0; i < NUM_THREADS; i++) {
+        TEST_ASSERT_EQUAL(0, pthread_create(&threads[i], NULL, pool_thread, pool));
+    }
+    for (int i = 0; i < NUM_THREADS; i++) {
+        void *result;
+        TEST_ASSERT_EQUAL(0, pthread_join(threads[i], &result));
+        TEST_ASSERT_NULL(result);
+    }
+
+    heap_caps_pool_info_t info;
+    heap_caps_pool_get_info(pool, &info);
+    TEST_ASSERT_EQUAL(num_objects, info.free_objects);
+    printf("%zu failed allocations\n", info.failed_allocations);
+
+    // All objects are on the free lists exactly once
+    for (size_t i = 0; i < num_objects; i++) {
+        TEST_ASSERT_NOT_NULL(heap_caps_pool_alloc(pool));
+    }
+    TEST_ASSERT_NULL(heap_caps_pool_alloc(pool));
+    heap_caps_pool_delete(pool);
+}
+
+TEST_CASE("Pool used by several threads", "[heap][pool]")
+{
+    test_pool_threads(0);
+}
+
+TEST_CASE("Pool with per-core free lists used by several threads", "[heap][pool]")
+{
+    test_pool_threads(HEAP_CAPS_POOL_FLAG_PER_CORE);
+}
+
+#define BENCHMARK_OBJECTS 256
+#define BENCHMARK_ITERATIONS 1000
+
+static double now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+TEST_CASE("Pool timings compared to heap_caps_malloc", "[heap][pool]")
+{
+    static void *p[BENCHMARK_OBJECTS];
+    heap_caps_pool_handle_t pool = heap_caps_pool_create(OBJECT_SIZE, BENCHMARK_OBJECTS, MALLOC_CAP_DEFAULT);
+    TEST_ASSERT_NOT_NULL(pool);
+
+    double start = now_us();
+    for (int i = 0; i < BENCHMARK_ITERATIONS; i++) {
+        for (int n = 0; n < BENCHMARK_OBJECTS; n++) {
+            p[n] = heap_caps_pool_alloc(pool);
+        }
+        for (int n = 0; n < BENCHMARK_OBJECTS; n++) {
+            heap_caps_pool_free(pool, p[n]);
+        }
+    }
+    double pool_us = now_us() - start;
+
+    start = now_us();
+    for (int i = 0; i < BENCHMARK_ITERATIONS; i++) {
+        for (int n = 0; n < BENCHMARK_OBJECTS; n++) {
+            p[n] = heap_caps_malloc(OBJECT_SIZE, MALLOC_CAP_DEFAULT);
+        }
+        for (int n = 0; n < BENCHMARK_OBJECTS; n++) {
+            heap_caps_free(p[n]);
+        }
+    }
+    double malloc_us = now_us() - start;
+
+    const double pairs = (double)BENCHMARK_ITERATIONS * BENCHMARK_OBJECTS;
+    printf("alloc+free of %d byte objects: pool %.1f ns, heap_caps_malloc %.1f ns\n",
+           OBJECT_SIZE, pool_us * 1e3 / pairs, malloc_us * 1e3 / pairs);
+    heap_caps_pool_delete(pool);
+}
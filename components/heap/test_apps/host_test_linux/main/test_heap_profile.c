@@ -0,0 +1,165 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "esp_heap_caps.h"
+#include "esp_heap_caps_profile.h"
+#include "unity.h"
+
+/* Sizes which no other allocation of the test app uses, so that the call sites
+   of this test can be found by their live bytes */
+#define SIZE_A 10007
+#define SIZE_B 20011
+#define MAX_SITES 32
+
+/* The call sites return the pointer through an argument, so that the heap functions
+   are not tail-called: each call site would then be in the caller of the function */
+static __attribute__((noinline)) void alloc_from_site_a(void **ptr)
+{
+    *ptr = heap_caps_malloc(SIZE_A, MALLOC_CAP_DEFAULT);
+}
+
+static __attribute__((noinline)) void alloc_from_site_b(void **ptr)
+{
+    *ptr = heap_caps_calloc(1, SIZE_B, MALLOC_CAP_DEFAULT);
+}
+
+static __attribute__((noinline)) void realloc_from_site_b(void **ptr, size_t size)
+{
+    *ptr = heap_caps_realloc(*ptr, size, MALLOC_CAP_DEFAULT);
+}
+
+static heap_caps_profile_site_t s_sites[MAX_SITES];
+
+static const heap_caps_profile_site_t *find_site(size_t live_bytes)
+{
+    size_t count = heap_caps_profile_get_sites(s_sites, MAX_SITES, NULL);
+    for (size_t i = 0; i < count; i++) {
+        if (s_sites[i].live_bytes == live_bytes) {
+            return &s_sites[i];
+        }
+    }
+    return NULL;
+}
+
+TEST_CASE("Profile aggregates allocations per call site", "[heap][profile]")
+{
+    heap_caps_profile_reset();
+
+    void *a[3];
+    void *b[2];
+    for (int i = 0; i < 3; i++) {
+        alloc_from_site_a(&a[i]);
+        TEST_ASSERT_NOT_NULL(a[i]);
+    }
+    for (int i = 0; i < 2; i++) {
+        alloc_from_site_b(&b[i]);
+        TEST_ASSERT_NOT_NULL(b[i]);
+    }
+
+    const heap_caps_profile_site_t *site_a = find_site(3 * SIZE_A);
+    TEST_ASSERT_NOT_NULL(site_a);
+    TEST_ASSERT_NOT_NULL(site_a->callers[0]);
+    TEST_ASSERT_EQUAL(3, site_a->allocations);
+    TEST_ASSERT_EQUAL(0, site_a->frees);
+    TEST_ASSERT_EQUAL(3 * SIZE_A, site_a->peak_live_bytes);
+    void *caller_a = site_a->callers[0];
+
+    const heap_caps_profile_site_t *site_b = find_site(2 * SIZE_B);
+    TEST_ASSERT_NOT_NULL(site_b);
+    TEST_ASSERT_EQUAL(2, site_b->allocations);
+    TEST_ASSERT(caller_a != site_b->callers[0]);
+
+    heap_caps_free(a[0]);
+    heap_caps_free(a[1]);
+    site_a = find_site(SIZE_A);
+    TEST_ASSERT_NOT_NULL(site_a);
+    TEST_ASSERT_EQUAL_PTR(caller_a, site_a->callers[0]);
+    TEST_ASSERT_EQUAL(3, site_a->allocations);
+    TEST_ASSERT_EQUAL(2, site_a->frees);
+    TEST_ASSERT_EQUAL(3 * SIZE_A, site_a->peak_live_bytes);
+
+    // A reallocation moves the bytes to the call site of the realloc
+    realloc_from_site_b(&b[0], 2 * SIZE_B);
+    TEST_ASSERT_NOT_NULL(b[0]);
+    const heap_caps_profile_site_t *site_realloc = find_site(2 * SIZE_B);
+    TEST_ASSERT_NOT_NULL(site_realloc);
+    TEST_ASSERT_EQUAL(1, site_realloc->allocations);
+    site_b = find_site(SIZE_B);
+    TEST_ASSERT_NOT_NULL(site_b);
+    TEST_ASSERT_EQUAL(1, site_b->frees);
+
+    // Reallocating to 0 bytes frees
+    realloc_from_site_b(&b[0], 0);
+    TEST_ASSERT_NULL(b[0]);
+    heap_caps_free(b[1]);
+    heap_caps_free(a[2]);
+    TEST_ASSERT_NULL(find_site(SIZE_A));
+    TEST_ASSERT_NULL(find_site(SIZE_B));
+
+    // Resetting keeps the call sites, and sets the peak to the live bytes
+    heap_caps_profile_reset();
+    alloc_from_site_a(&a[0]);
+    TEST_ASSERT_NOT_NULL(a[0]);
+    site_a = find_site(SIZE_A);
+    TEST_ASSERT_NOT_NULL(site_a);
+    TEST_ASSERT_EQUAL_PTR(caller_a, site_a->callers[0]);
+    TEST_ASSERT_EQUAL(1, site_a->allocations);
+    TEST_ASSERT_EQUAL(0, site_a->frees);
+    TEST_ASSERT_EQUAL(SIZE_A, site_a->peak_live_bytes);
+    heap_caps_free(a[0]);
+}
+
+TEST_CASE("Profile reports the allocation rate", "[heap][profile]")
+{
+    void *a;
+    alloc_from_site_a(&a);
+    TEST_ASSERT_NOT_NULL(a);
+    heap_caps_profile_get_sites(s_sites, MAX_SITES, NULL);
+
+    // The rate counts the allocations made since the previous query
+    for (int i = 0; i < 10; i++) {
+        heap_caps_free(a);
+        alloc_from_site_a(&a);
+        TEST_ASSERT_NOT_NULL(a);
+    }
+    const heap_caps_profile_site_t *site = find_site(SIZE_A);
+    TEST_ASSERT_NOT_NULL(site);
+    TEST_ASSERT(site->alloc_rate > 0);
+
+    site = find_site(SIZE_A);
+    TEST_ASSERT_NOT_NULL(site);
+    TEST_ASSERT_EQUAL(0, site->alloc_rate);
+    heap_caps_free(a);
+}
+
+TEST_CASE("Profile sorts the call sites by live bytes", "[heap][profile]")
+{
+    void *a;
+    void *b;
+    alloc_from_site_a(&a);
+    alloc_from_site_b(&b);
+    TEST_ASSERT_NOT_NULL(a);
+    TEST_ASSERT_NOT_NULL(b);
+
+    heap_caps_profile_info_t info;
+    size_t count = heap_caps_profile_get_sites(s_sites, MAX_SITES, &info);
+    TEST_ASSERT(count >= 2);
+    TEST_ASSERT(info.num_sites >= 2);
+    TEST_ASSERT_EQUAL(0, info.untracked_allocations);
+    for (size_t i = 1; i < count; i++) {
+        TEST_ASSERT(s_sites[i - 1].live_bytes >= s_sites[i].live_bytes);
+    }
+
+    // Only the sites holding the most bytes are returned
+    TEST_ASSERT_EQUAL(1, heap_caps_profile_get_sites(s_sites, 1, NULL));
+    TEST_ASSERT(s_sites[0].live_bytes >= SIZE_B);
+
+    heap_caps_profile_print(MAX_SITES);
+    heap_caps_free(a);
+    heap_caps_free(b);
+}
@@ -6,6 +6,10 @@ from pytest_embedded import Dut
 
 @pytest.mark.linux
 @pytest.mark.host_test
+@pytest.mark.parametrize('config', [
+    'default',
+    'profiling',
+], indirect=True)
 def test_heap_linux(dut: Dut) -> None:
     dut.expect_exact('Press ENTER to see the list of tests.')
     dut.write('*')
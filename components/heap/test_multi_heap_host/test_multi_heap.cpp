@@ -8,6 +8,11 @@
 
 #include <string.h>
 #include <assert.h>
+#include <pthread.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
 
 /* The functions __malloc__ and __free__ are used to call the libc
  * malloc and free and allocate memory from the host heap. Since the test
@@ -126,7 +131,10 @@ TEST_CASE("multi_heap fragmentation", "[multi_heap]")
     multi_heap_free(heap, big);
 }
 
-/* Test that malloc/free does not leave free space fragmented */
+/* Test that malloc/free does not leave free space fragmented
+   Note: With the size class cache, small blocks aren't returned to TLSF when freed and this test does not apply.
+ */
+#ifndef MULTI_HEAP_SIZE_CLASS_CACHE
 TEST_CASE("multi_heap defrag", "[multi_heap]")
 {
     void *p[4];
@@ -172,11 +180,13 @@ TEST_CASE("multi_heap defrag", "[multi_heap]")
     REQUIRE( 1 == info2.free_blocks );
     REQUIRE( info.total_free_bytes == info2.total_free_bytes );
 }
+#endif
 
 /* Test that malloc/free does not leave free space fragmented
    Note: With fancy poisoning, realloc is implemented as malloc-copy-free and this test does not apply.
+   Neither does it with the size class cache.
  */
-#ifndef MULTI_HEAP_POISONING_SLOW
+#if !defined(MULTI_HEAP_POISONING_SLOW) && !defined(MULTI_HEAP_SIZE_CLASS_CACHE)
 TEST_CASE("multi_heap defrag realloc", "[multi_heap]")
 {
     void *p[4];
@@ -312,6 +322,8 @@ void multi_heap_allocation_impl(int heap_size)
         }
     }
 
+    /* Return the small blocks kept by the size class cache, if enabled */
+    multi_heap_cache_flush(heap);
     REQUIRE( initial_free == multi_heap_free_size(heap) );
     __free__(big_heap);
 }
@@ -361,6 +373,7 @@ TEST_CASE("multi_heap_get_info() function", "[multi_heap]")
     REQUIRE( after.minimum_free_bytes > 0 );
 
     multi_heap_free(heap, x);
+    multi_heap_cache_flush(heap);
     multi_heap_get_info(heap, &freed);
     printf("freed: total_free_bytes %zu\ntotal_allocated_bytes %zu\nlargest_free_block %zu\nminimum_free_bytes %zu\nallocated_blocks %zu\nfree_blocks %zu\ntotal_blocks %zu\n",
            freed.total_free_bytes,
@@ -416,9 +429,13 @@ TEST_CASE("multi_heap minimum-size allocations", "[multi_heap]")
     }
 
     /* all freed! */
+    multi_heap_cache_flush(heap);
     REQUIRE( before_free == multi_heap_free_size(heap) );
 }
 
+/* The blocks of the size class cache are allocated in batches, so the placement
+   of the blocks checked by this test does not apply */
+#ifndef MULTI_HEAP_SIZE_CLASS_CACHE
 TEST_CASE("multi_heap_realloc()", "[multi_heap]")
 {
     const size_t HEAP_SIZE = 4 * 1024;
@@ -469,6 +486,7 @@ TEST_CASE("multi_heap_realloc()", "[multi_heap]")
 
 #endif // MULTI_HEAP_POISONING_SLOW
 }
+#endif // MULTI_HEAP_SIZE_CLASS_CACHE
 
 // TLSF only accepts heaps aligned to 4-byte boundary so
 // only aligned allocation tests make sense.
@@ -525,7 +543,7 @@ TEST_CASE("multi_heap aligned allocations", "[multi_heap]")
     buf1 = (uint8_t *)multi_heap_aligned_alloc(heap, buf2 - buf1, 4);
     multi_heap_free(heap, buf2);
 
-
+    multi_heap_cache_flush(heap);
     printf("[ALIGNED_ALLOC] heap_size after: %d \n", multi_heap_free_size(heap));
     REQUIRE((old_size - multi_heap_free_size(heap)) <= leakage);
 }
@@ -555,6 +573,7 @@ TEST_CASE("multi_heap allocation overhead", "[multi_heap]")
  * by multi_heap_check(). For light poisoning and no poisoning, the test will
  * check that multi_heap_check() does not report the corruption.
  */
+#ifndef MULTI_HEAP_SIZE_CLASS_CACHE // the size class cache makes heap_t larger than heap_t_size below
 TEST_CASE("multi_heap poisoning detection", "[multi_heap]")
 {
     const size_t HEAP_SIZE = 4 * 1024;
@@ -615,3 +634,150 @@ TEST_CASE("multi_heap poisoning detection", "[multi_heap]")
         REQUIRE(is_heap_ok == true);
     }
 }
+#endif
+
+#ifdef MULTI_HEAP_SIZE_CLASS_CACHE
+TEST_CASE("multi_heap size class cache", "[multi_heap][cache]")
+{
+    uint8_t heapdata[16 * 1024];
+    multi_heap_handle_t heap = multi_heap_register(heapdata, sizeof(heapdata));
+    multi_heap_info_t info;
+
+    multi_heap_get_info(heap, &info);
+    const size_t initial_free = info.total_free_bytes;
+
+    void *p = multi_heap_malloc(heap, 40);
+    REQUIRE( p != NULL );
+    REQUIRE( multi_heap_get_allocated_size(heap, p) >= 40 );
+
+    /* The cache has been refilled with a batch of blocks */
+    multi_heap_get_info(heap, &info);
+    REQUIRE( info.allocated_blocks == 1 );
+    REQUIRE( info.cached_blocks > 0 );
+    REQUIRE( info.total_free_bytes < initial_free );
+
+    /* Freed blocks are reused by allocations of the same size class */
+    multi_heap_free(heap, p);
+    REQUIRE( multi_heap_malloc(heap, 33) == p );
+    multi_heap_free(heap, p);
+
+    multi_heap_get_info(heap, &info);
+    REQUIRE( info.allocated_blocks == 0 );
+    REQUIRE( info.total_allocated_bytes == 0 );
+    REQUIRE( info.cached_bytes >= info.cached_blocks * 48 );
+    REQUIRE( multi_heap_check(heap, true) );
+
+    multi_heap_cache_flush(heap);
+    multi_heap_get_info(heap, &info);
+    REQUIRE( info.cached_blocks == 0 );
+    REQUIRE( info.cached_bytes == 0 );
+    REQUIRE( info.free_blocks == 1 );
+    REQUIRE( info.total_free_bytes == initial_free );
+}
+
+TEST_CASE("multi_heap size class cache is flushed when an allocation fails", "[multi_heap][cache]")
+{
+    uint8_t heapdata[16 * 1024];
+    multi_heap_handle_t heap = multi_heap_register(heapdata, sizeof(heapdata));
+    multi_heap_info_t info;
+    void *p[512];
+    size_t count = 0;
+
+    multi_heap_get_info(heap, &info);
+    const size_t initial_free = info.total_free_bytes;
+    const size_t largest_free_block = info.largest_free_block;
+
+    /* Exhaust the heap with blocks of different size classes */
+    while (count < 512 && (p[count] = multi_heap_malloc(heap, 16 + (count % 8) * 32)) != NULL) {
+        count++;
+    }
+    REQUIRE( count < 512 );
+    for (size_t i = 0; i < count; i++) {
+        multi_heap_free(heap, p[i]);
+    }
+
+    /* The cached blocks are spread over the heap */
+    multi_heap_get_info(heap, &info);
+    REQUIRE( info.cached_blocks > 0 );
+    REQUIRE( info.largest_free_block < largest_free_block );
+
+    void *big = multi_heap_malloc(heap, largest_free_block);
+    REQUIRE( big != NULL );
+    multi_heap_free(heap, big);
+
+    multi_heap_cache_flush(heap);
+    REQUIRE( multi_heap_free_size(heap) == initial_free );
+    REQUIRE( multi_heap_check(heap, true) );
+}
+#endif // MULTI_HEAP_SIZE_CLASS_CACHE
+
+/* Benchmark of small allocations from several threads, compare the results of the
+   configurations with and without CONFIG_HEAP_SIZE_CLASS_CACHE */
+TEST_CASE("multi_heap multithreaded small allocations", "[multi_heap][cache]")
+{
+    const size_t HEAP_SIZE = 128 * 1024;
+    const int THREADS = 2;
+    const int OPERATIONS = 500000;
+    const int SLOTS = 64;
+    uint8_t *heapdata = (uint8_t *)__malloc__(HEAP_SIZE);
+    multi_heap_handle_t heap = multi_heap_register(heapdata, HEAP_SIZE);
+
+    /* Recursive, as heap poisoning calls the implementation functions with the lock held */
+    pthread_mutexattr_t attr;
+    pthread_mutex_t lock;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&lock, &attr);
+    multi_heap_set_lock(heap, &lock);
+    const size_t initial_free = multi_heap_free_size(heap);
+
+    std::atomic<int> errors(0);
+    auto worker = [&](uint32_t seed) {
+        uint8_t *p[SLOTS] = { };
+        size_t s[SLOTS] = { };
+        for (int i = 0; i < OPERATIONS; i++) {
+            seed = seed * 1103515245 + 12345;
+            int n = (seed >> 16) % SLOTS;
+            if (p[n] != NULL) {
+                if (p[n][0] != n || p[n][s[n] - 1] != n) {
+                    errors++;
+                }
+                multi_heap_free(heap, p[n]);
+                p[n] = NULL;
+            } else {
+                s[n] = (seed >> 8) % 256 + 1;
+                p[n] = (uint8_t *)multi_heap_malloc(heap, s[n]);
+                if (p[n] == NULL) {
+                    errors++;
+                } else {
+                    memset(p[n], n, s[n]);
+                }
+            }
+        }
+        for (int n = 0; n < SLOTS; n++) {
+            multi_heap_free(heap, p[n]);
+        }
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < THREADS; t++) {
+        threads.emplace_back(worker, t + 1);
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    printf("%d threads: %.0f small allocations and frees per second\n",
+           THREADS, THREADS * OPERATIONS / elapsed.count());
+
+    REQUIRE( errors == 0 );
+    REQUIRE( multi_heap_check(heap, true) );
+    multi_heap_cache_flush(heap);
+    REQUIRE( multi_heap_free_size(heap) == initial_free );
+
+    multi_heap_set_lock(heap, NULL);
+    pthread_mutex_destroy(&lock);
+    pthread_mutexattr_destroy(&attr);
+    __free__(heapdata);
+}
@@ -1,6 +1,33 @@
 #pragma once
 #include <stdbool.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include "sdkconfig.h"
+#include "esp_err.h"
 
 void esp_log_impl_lock(void);
 bool esp_log_impl_lock_timeout(void);
 void esp_log_impl_unlock(void);
+
+/* Prints a message using the function set by esp_log_set_vprintf(),
+   without checking the log level or recording it in binary form. */
+void esp_log_print_direct(const char *format, ...);
+
+#if CONFIG_LOG_BINARY && !BOOTLOADER_BUILD
+/* Records the message in binary form, returns false if it has to be formatted instead. */
+bool esp_log_binary_write(const char *format, va_list args);
+#endif
+
+#if CONFIG_LOG_ASYNC && !BOOTLOADER_BUILD
+/* Starts the asynchronous log task, called by the OS specific code at startup. */
+esp_err_t esp_log_async_init(void);
+/* Formats the message into the asynchronous log buffer, returns false if it has to be written synchronously. */
+bool esp_log_async_writev(const char *format, va_list args);
+
+/* OS specific part of asynchronous log output, see log_async.c */
+bool esp_log_impl_async_start(void (*task_func)(void *));
+void esp_log_impl_async_notify(void);
+void esp_log_impl_async_wait(uint32_t timeout_ms);
+void esp_log_impl_async_consumer_lock(void);
+void esp_log_impl_async_consumer_unlock(void);
+#endif
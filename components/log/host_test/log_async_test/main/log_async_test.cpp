@@ -0,0 +1,282 @@
+/* Asynchronous LOG unit tests
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+#define CATCH_CONFIG_MAIN
+#include <cstdio>
+#include <string>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include <vector>
+#include "esp_log.h"
+#include "esp_log_async.h"
+
+#include "catch.hpp"
+
+using namespace std;
+
+static const char *TEST_TAG = "test";
+
+/* Replaces the default vprintf sink, collects all output in a string */
+struct SinkFixture {
+    SinkFixture()
+    {
+        esp_log_async_flush();
+        REQUIRE(esp_log_async_remove_sink(esp_log_async_sink_vprintf, nullptr) == ESP_OK);
+        REQUIRE(esp_log_async_add_sink(sink, this) == ESP_OK);
+    }
+
+    virtual ~SinkFixture()
+    {
+        esp_log_async_flush();
+        esp_log_async_remove_sink(sink, this);
+        esp_log_async_add_sink(esp_log_async_sink_vprintf, nullptr);
+    }
+
+    string get_output()
+    {
+        lock_guard<mutex> guard(output_lock);
+        return output;
+    }
+
+    size_t sink_calls = 0;
+
+protected:
+    virtual void write(const char *data, size_t size)
+    {
+        lock_guard<mutex> guard(output_lock);
+        output.append(data, size);
+        sink_calls++;
+    }
+
+private:
+    static void sink(const char *data, size_t size, void *arg)
+    {
+        static_cast<SinkFixture *>(arg)->write(data, size);
+    }
+
+    mutex output_lock;
+    string output;
+};
+
+/* Sink which blocks until it is released, to fill up the buffer */
+struct BlockingSinkFixture : SinkFixture {
+    atomic<bool> entered {false};
+    atomic<bool> released {false};
+
+protected:
+    void write(const char *data, size_t size) override
+    {
+        entered = true;
+        while (!released) {
+            this_thread::sleep_for(chrono::milliseconds(1));
+        }
+        SinkFixture::write(data, size);
+    }
+};
+
+/* Takes as long as a 115200 baud UART needs to send the data */
+static void uart_delay(size_t size)
+{
+    this_thread::sleep_for(chrono::microseconds(size * 87));
+}
+
+/* Sink which is as slow as a UART */
+struct SlowSinkFixture : SinkFixture {
+protected:
+    void write(const char *data, size_t size) override
+    {
+        uart_delay(size);
+        SinkFixture::write(data, size);
+    }
+};
+
+TEST_CASE("sink management")
+{
+    auto sink = [](const char *, size_t, void *) { };
+    CHECK(esp_log_async_add_sink(nullptr, nullptr) == ESP_ERR_INVALID_ARG);
+    CHECK(esp_log_async_add_sink(esp_log_async_sink_vprintf, nullptr) == ESP_ERR_INVALID_STATE);
+    CHECK(esp_log_async_remove_sink(sink, nullptr) == ESP_ERR_NOT_FOUND);
+    CHECK(esp_log_async_add_sink(sink, nullptr) == ESP_OK);
+    CHECK(esp_log_async_add_sink(sink, (void *) 1) == ESP_OK);
+    CHECK(esp_log_async_add_sink(sink, (void *) 2) == ESP_OK);
+    CHECK(esp_log_async_add_sink(sink, (void *) 3) == ESP_ERR_NO_MEM);
+    CHECK(esp_log_async_remove_sink(sink, nullptr) == ESP_OK);
+    CHECK(esp_log_async_remove_sink(sink, (void *) 1) == ESP_OK);
+    CHECK(esp_log_async_remove_sink(sink, (void *) 2) == ESP_OK);
+}
+
+TEST_CASE_METHOD(SinkFixture, "messages are written to the sink in order")
+{
+    string expected;
+    for (int i = 0; i < 100; i++) {
+        ESP_LOGI(TEST_TAG, "message %d", i);
+        expected += "message " + to_string(i) + "\n";
+    }
+    esp_log_async_flush();
+
+    string output = get_output();
+    string stripped;
+    size_t pos = 0;
+    // Strip the "I (timestamp) test: " prefixes
+    while ((pos = output.find("test: ", pos)) != string::npos) {
+        size_t end = output.find('\n', pos);
+        stripped += output.substr(pos + 6, end + 1 - pos - 6);
+        pos = end;
+    }
+    CHECK(stripped == expected);
+}
+
+TEST_CASE_METHOD(BlockingSinkFixture, "messages are dropped and counted when the buffer is full")
+{
+    uint32_t dropped_before = esp_log_async_get_dropped();
+    ESP_LOGI(TEST_TAG, "first");
+    while (!entered) {
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+    // The sink is blocked, nothing is taken out of the 4096 byte buffer
+    for (int i = 0; i < 200; i++) {
+        ESP_LOGI(TEST_TAG, "filling up the buffer with message number %d", i);
+    }
+    uint32_t dropped = esp_log_async_get_dropped() - dropped_before;
+    CHECK(dropped > 0);
+    CHECK(dropped < 200);
+    released = true;
+    esp_log_async_flush();
+
+    string output = get_output();
+    CHECK(output.find("first") != string::npos);
+    CHECK(output.find("[" + to_string(dropped) + " log messages dropped]") != string::npos);
+    CHECK(output.find("message number " + to_string(199 - dropped) + "\n") != string::npos);
+    CHECK(output.find("message number " + to_string(200 - dropped) + "\n") == string::npos);
+}
+
+TEST_CASE_METHOD(SlowSinkFixture, "logging task isn't blocked by a slow sink")
+{
+    const int MESSAGES = 2000;
+#define SLOW_SINK_MESSAGE "slow sink test message with a few arguments: %d %s %x"
+
+    chrono::steady_clock::duration logging_time {};
+    for (int i = 0; i < MESSAGES; i += 20) {
+        auto start = chrono::steady_clock::now();
+        for (int j = i; j < i + 20; j++) {
+            ESP_LOGI(TEST_TAG, SLOW_SINK_MESSAGE, j, "abc", j);
+        }
+        logging_time += chrono::steady_clock::now() - start;
+        // Leave the sink some time, so that not all messages are dropped
+        this_thread::sleep_for(chrono::milliseconds(2));
+    }
+
+    // What a synchronous write of the same messages to the sink would take
+    char buffer[128];
+    int len = snprintf(buffer, sizeof(buffer), "I (123456) %s: " SLOW_SINK_MESSAGE "\n", TEST_TAG, 1234, "abc", 1234);
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < 20; i++) {
+        uart_delay(len);
+    }
+    auto sync_time = (chrono::steady_clock::now() - start) * (MESSAGES / 20);
+    esp_log_async_flush();
+
+    // Messages which piled up while the sink was busy are written in batches
+    string output = get_output();
+    size_t lines = count(output.begin(), output.end(), '\n');
+    CHECK(sink_calls < lines);
+
+    double logging_us = chrono::duration<double, micro>(logging_time).count() / MESSAGES;
+    double sync_us = chrono::duration<double, micro>(sync_time).count() / MESSAGES;
+    // Wall-clock times depend on the load of the host, so they are only reported
+    printf("slow sink: %d messages, %.2f us per message in the logging task, %.2f us per synchronous write\n",
+           MESSAGES, logging_us, sync_us);
+}
+
+TEST_CASE_METHOD(SinkFixture, "long messages and messages from concurrent tasks are written completely")
+{
+    const int THREADS = 4;
+    const int MESSAGES = 500;
+
+    // Longer messages are truncated to CONFIG_LOG_ASYNC_MAX_MESSAGE_SIZE - 1 characters
+    string long_arg(2 * CONFIG_LOG_ASYNC_MAX_MESSAGE_SIZE, 'x');
+    esp_log_write(ESP_LOG_INFO, TEST_TAG, "%s", long_arg.c_str());
+    esp_log_async_flush();
+    CHECK(get_output() == long_arg.substr(0, CONFIG_LOG_ASYNC_MAX_MESSAGE_SIZE - 1));
+
+    uint32_t dropped_before = esp_log_async_get_dropped();
+    // Varying lengths make the messages wrap around the end of the buffer at different positions, and
+    // messages reserved concurrently can't give back their unused space
+    vector<thread> threads;
+    for (int t = 0; t < THREADS; t++) {
+        threads.emplace_back([t]() {
+            for (int i = 0; i < MESSAGES; i++) {
+                esp_log_write(ESP_LOG_INFO, TEST_TAG, "%d %d %s\n", t, i, string(i % 97, 'a' + t).c_str());
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    esp_log_async_flush();
+
+    string output = get_output().substr(CONFIG_LOG_ASYNC_MAX_MESSAGE_SIZE - 1);
+    int next[THREADS] = {};
+    size_t lines = 0;
+    size_t pos = 0;
+    while (pos < output.size()) {
+        size_t end = output.find('\n', pos);
+        REQUIRE(end != string::npos);
+        if (output.compare(pos, 1, "[") == 0) {
+            // Dropped messages are reported as a line of its own
+            pos = end + 1;
+            continue;
+        }
+        int t, i;
+        char text[128] = "";
+        REQUIRE(sscanf(output.substr(pos, end - pos).c_str(), "%d %d %127s", &t, &i, text) >= 2);
+        REQUIRE(t >= 0);
+        REQUIRE(t < THREADS);
+        // Messages of one task are written in order, although some may have been dropped
+        CHECK(i >= next[t]);
+        next[t] = i + 1;
+        CHECK(string(text) == string(i % 97, 'a' + t));
+        lines++;
+        pos = end + 1;
+    }
+    CHECK(lines > 0);
+    CHECK(lines + esp_log_async_get_dropped() - dropped_before == THREADS * MESSAGES);
+}
+
+static string s_panic_output;
+
+static void panic_putc(char c)
+{
+    s_panic_output += c;
+}
+
+TEST_CASE_METHOD(BlockingSinkFixture, "buffered messages are written by the panic flush")
+{
+    ESP_LOGI(TEST_TAG, "first");
+    while (!entered) {
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+    // The sink is blocked, as if the system had stopped while it was writing
+    ESP_LOGI(TEST_TAG, "buffered message %d", 1);
+    ESP_LOGI(TEST_TAG, "buffered message %d", 2);
+    s_panic_output.clear();
+    esp_log_async_panic_flush(panic_putc);
+    CHECK(s_panic_output.find("buffered message 1\n") != string::npos);
+    CHECK(s_panic_output.find("buffered message 2\n") != string::npos);
+    CHECK(s_panic_output.find("first") == string::npos);
+
+    released = true;
+    esp_log_async_flush();
+    // The messages written by the panic flush are not written again
+    string output = get_output();
+    CHECK(output.find("first") != string::npos);
+    CHECK(output.find("buffered message") == string::npos);
+}
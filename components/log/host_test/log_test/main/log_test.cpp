@@ -10,6 +10,7 @@
 #include <cstdio>
 #include <regex>
 #include <iostream>
+#include <chrono>
 #include "esp_log.h"
 
 #include "catch.hpp"
@@ -85,6 +86,30 @@ private:
     vprintf_like_t old_vprintf;
 };
 
+struct CountFixture : BasicLogFixture {
+    CountFixture(esp_log_level_t log_level = ESP_LOG_VERBOSE) : BasicLogFixture(log_level)
+    {
+        counter = 0;
+        old_vprintf = esp_log_set_vprintf(count_callback);
+    }
+
+    virtual ~CountFixture()
+    {
+        esp_log_set_vprintf(old_vprintf);
+    }
+
+    static size_t counter;
+
+private:
+    static int count_callback(const char *format, va_list args)
+    {
+        counter++;
+        return 0;
+    }
+
+    vprintf_like_t old_vprintf;
+};
+
 struct PutcFixture : BasicLogFixture {
     PutcFixture(esp_log_level_t log_level = ESP_LOG_VERBOSE) : BasicLogFixture(log_level), counter(0)
     {
@@ -125,6 +150,7 @@ private:
 };
 
 PrintFixture *PrintFixture::instance = nullptr;
+size_t CountFixture::counter = 0;
 PutcFixture *PutcFixture::instance = nullptr;
 
 TEST_CASE("verbose log level")
@@ -193,6 +219,26 @@ TEST_CASE("changing log level")
     CHECK(regex_search(fix.get_print_buffer_string(), test_print) == true);
 }
 
+TEST_CASE("changing log level of tag at different addresses")
+{
+    PrintFixture fix(ESP_LOG_INFO);
+    // The same tag string might be stored more than once if the linker doesn't merge string literals
+    char tag_copy[sizeof("test")];
+    strcpy(tag_copy, TEST_TAG);
+
+    ESP_LOGI(TEST_TAG, "must indeed be printed");
+    ESP_LOGI(tag_copy, "must indeed be printed");
+
+    fix.reset_buffer();
+    esp_log_level_set(tag_copy, ESP_LOG_WARN);
+
+    ESP_LOGI(TEST_TAG, "must not be printed");
+    ESP_LOGI(tag_copy, "must not be printed");
+    CHECK(fix.get_print_buffer_string().size() == 0);
+    CHECK(esp_log_level_get(TEST_TAG) == ESP_LOG_WARN);
+    CHECK(esp_log_level_get(tag_copy) == ESP_LOG_WARN);
+}
+
 TEST_CASE("log buffer")
 {
     PrintFixture fix(ESP_LOG_INFO);
@@ -279,3 +325,89 @@ TEST_CASE("changing early log level")
     ESP_EARLY_LOGI(TEST_TAG, "must indeed be printed");
     CHECK(regex_search(fix.get_print_buffer_string(), test_print) == true);
 }
+
+TEST_CASE("tag levels are correct when cached tags are replaced")
+{
+    // More tags than fit into the cache, so that entries are replaced
+    const size_t NUM_TAGS = 2 * CONFIG_LOG_TAG_LEVEL_CACHE_SIZE;
+    static char tags[NUM_TAGS][16];
+    CountFixture fix(ESP_LOG_INFO);
+    for (size_t i = 0; i < NUM_TAGS; i++) {
+        snprintf(tags[i], sizeof(tags[i]), "tag_%zu", i);
+        if (i % 2 == 0) {
+            esp_log_level_set(tags[i], ESP_LOG_WARN);
+        }
+    }
+
+    for (int round = 0; round < 3; round++) {
+        CountFixture::counter = 0;
+        for (size_t i = 0; i < NUM_TAGS; i++) {
+            ESP_LOGI(tags[i], "printed for odd tags");
+            // a few tags which stay in use
+            ESP_LOGI(tags[1], "printed");
+            ESP_LOGI(tags[2], "not printed");
+        }
+        CHECK(CountFixture::counter == NUM_TAGS / 2 + NUM_TAGS);
+        for (size_t i = 0; i < NUM_TAGS; i++) {
+            CHECK(esp_log_level_get(tags[i]) == (i % 2 == 0 ? ESP_LOG_WARN : ESP_LOG_INFO));
+        }
+    }
+
+    // levels set for tags which have been replaced in the cache meanwhile
+    for (size_t i = 0; i < NUM_TAGS; i++) {
+        esp_log_level_set(tags[i], i % 2 == 0 ? ESP_LOG_INFO : ESP_LOG_WARN);
+    }
+    CountFixture::counter = 0;
+    for (size_t i = 0; i < NUM_TAGS; i++) {
+        ESP_LOGI(tags[i], "printed for even tags");
+    }
+    CHECK(CountFixture::counter == NUM_TAGS / 2);
+}
+
+TEST_CASE("tag level lookup performance")
+{
+    // A larger application logs with many different tags, some of which have their own log level
+    const size_t NUM_TAGS = 150;
+    const size_t ITERATIONS = 300000;
+    static char tags[NUM_TAGS][16];
+    CountFixture fix(ESP_LOG_INFO);
+    for (size_t i = 0; i < NUM_TAGS; i++) {
+        snprintf(tags[i], sizeof(tags[i]), "tag_%zu", i);
+        if (i % 3 == 0) {
+            esp_log_level_set(tags[i], ESP_LOG_WARN);
+        }
+    }
+
+    // Messages filtered out at runtime only cost the tag level lookup
+    auto start = chrono::steady_clock::now();
+    for (size_t i = 0; i < ITERATIONS; i++) {
+        ESP_LOGD(tags[i % NUM_TAGS], "filtered %d", (int) i);
+    }
+    auto filtered_ns = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+    CHECK(CountFixture::counter == 0);
+
+    // Output is discarded, so this measures the overhead of the log call up to the vprintf function
+    start = chrono::steady_clock::now();
+    for (size_t i = 0; i < ITERATIONS; i++) {
+        ESP_LOGW(tags[i % NUM_TAGS], "unfiltered %d", (int) i);
+    }
+    auto unfiltered_ns = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+    CHECK(CountFixture::counter == ITERATIONS);
+
+    printf("%zu tags: %.1f ns per filtered message, %.1f ns per unfiltered message\n", NUM_TAGS,
+           (double) filtered_ns / ITERATIONS, (double) unfiltered_ns / ITERATIONS);
+
+    // Most messages come from a few tags which start logging after the cache has been filled,
+    // these replace tags which aren't used as often
+    const size_t HOT_TAGS = 8;
+    start = chrono::steady_clock::now();
+    for (size_t i = 0; i < ITERATIONS; i++) {
+        const char *tag = (i % 8 == 0) ? tags[(i / 8) % (NUM_TAGS - HOT_TAGS)] : tags[NUM_TAGS - HOT_TAGS + i % HOT_TAGS];
+        ESP_LOGD(tag, "filtered %d", (int) i);
+    }
+    auto skewed_ns = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+    CHECK(CountFixture::counter == ITERATIONS);
+
+    printf("%zu tags, %zu of which log 7/8 of the messages: %.1f ns per filtered message\n", NUM_TAGS, HOT_TAGS,
+           (double) skewed_ns / ITERATIONS);
+}
@@ -6,5 +6,9 @@ from pytest_embedded import Dut
 
 @pytest.mark.linux
 @pytest.mark.host_test
+@pytest.mark.parametrize('config', [
+    'default',
+    'cache_256',
+], indirect=True)
 def test_log_linux(dut: Dut) -> None:
     dut.expect_exact('All tests passed', timeout=5)
@@ -0,0 +1,123 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "sdkconfig.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if CONFIG_LOG_ASYNC || __DOXYGEN__
+
+/**
+ * @brief Function which writes log output to some destination
+ *
+ * @param data  Formatted log messages, not zero-terminated
+ * @param size  Length of the messages in bytes
+ * @param arg   Argument passed to esp_log_async_add_sink()
+ */
+typedef void (*esp_log_async_sink_t)(const char *data, size_t size, void *arg);
+
+/**
+ * @brief Add a sink for asynchronous log output
+ *
+ * When CONFIG_LOG_ASYNC is enabled, log messages are formatted into a buffer
+ * by the logging task and written to all sinks by a separate task. Each sink
+ * is called once for as many messages as are available.
+ *
+ * The sink esp_log_async_sink_vprintf() is added by default.
+ *
+ * @note Sinks are called from the asynchronous log task or from esp_log_async_flush(),
+ * they must not log messages themselves.
+ *
+ * @param sink  Function which writes the output
+ * @param arg   Argument passed to the function
+ *
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if sink is NULL
+ *      - ESP_ERR_INVALID_STATE if the sink has already been added with the same argument
+ *      - ESP_ERR_NO_MEM if the maximum number of sinks has been reached
+ */
+esp_err_t esp_log_async_add_sink(esp_log_async_sink_t sink, void *arg);
+
+/**
+ * @brief Remove a sink added with esp_log_async_add_sink()
+ *
+ * @param sink  Function passed to esp_log_async_add_sink()
+ * @param arg   Argument passed to esp_log_async_add_sink()
+ *
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_NOT_FOUND if the sink has not been added with this argument
+ */
+esp_err_t esp_log_async_remove_sink(esp_log_async_sink_t sink, void *arg);
+
+/**
+ * @brief Sink which writes the output with the function set with esp_log_set_vprintf()
+ *
+ * @param data  Formatted log messages
+ * @param size  Length of the messages in bytes
+ * @param arg   Unused
+ */
+void esp_log_async_sink_vprintf(const char *data, size_t size, void *arg);
+
+/**
+ * @brief Sink which writes the output to a file descriptor
+ *
+ * Can be used to write log output to a file, a socket, or a UART opened
+ * through VFS, without a custom sink function.
+ *
+ * @param data  Formatted log messages
+ * @param size  Length of the messages in bytes
+ * @param arg   File descriptor, cast to a pointer: ``(void *) (intptr_t) fd``
+ */
+void esp_log_async_sink_fd(const char *data, size_t size, void *arg);
+
+/**
+ * @brief Write all buffered log messages to the sinks
+ *
+ * Can be used before a restart or a shutdown, or when all output has to be
+ * visible at some point. Messages are written to the sinks by the calling task.
+ * Also called from the shutdown handlers of esp_restart().
+ */
+void esp_log_async_flush(void);
+
+/**
+ * @brief Write the buffered log messages with a character output function, without locking
+ *
+ * Called by the panic handler, where the asynchronous log task doesn't run anymore
+ * and locks can't be taken, so that the messages logged just before a crash or a
+ * watchdog timeout are printed before the panic output. The messages are written
+ * with putc_fn only, not to the sinks.
+ *
+ * @note The output may still be incomplete: the messages which the asynchronous
+ *       log task had taken from the buffer but not written yet, and the messages
+ *       following one which was being logged when the system stopped, are lost.
+ *       So are all buffered messages on a reset which doesn't go through the
+ *       panic handler, such as a brownout or an RTC watchdog reset.
+ *
+ * @param putc_fn  Function writing one character
+ */
+void esp_log_async_panic_flush(void (*putc_fn)(char c));
+
+/**
+ * @brief Get the number of log messages dropped because the buffer was full
+ *
+ * @return Number of messages dropped since startup
+ */
+uint32_t esp_log_async_get_dropped(void);
+
+#endif // CONFIG_LOG_ASYNC || __DOXYGEN__
+
+#ifdef __cplusplus
+}
+#endif
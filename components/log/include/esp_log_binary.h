@@ -0,0 +1,66 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "sdkconfig.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if CONFIG_LOG_BINARY || __DOXYGEN__
+
+/**
+ * @brief Prefix of the lines printed by the default binary log sink
+ */
+#define ESP_LOG_BINARY_LINE_PREFIX "ESPLOGB:"
+
+/**
+ * @brief Function which receives binary log records
+ *
+ * @param data  Buffer holding one or more complete binary log records
+ * @param size  Size of the records in bytes
+ */
+typedef void (*esp_log_binary_sink_t)(const uint8_t *data, size_t size);
+
+/**
+ * @brief Set function which receives binary log records
+ *
+ * When CONFIG_LOG_BINARY is enabled, log messages are recorded in binary form
+ * and passed to the sink by a low priority task. Each record starts with
+ * a header holding the size of the record, the number of records dropped
+ * before it because the buffer was full, and the address of the format string.
+ * The header is followed by the values of the arguments. Records can be turned
+ * into text with components/log/log_binary_decode.py.
+ *
+ * The default sink prints each chunk of records as a base64 encoded line
+ * starting with ESP_LOG_BINARY_LINE_PREFIX, using the function set with
+ * esp_log_set_vprintf().
+ *
+ * @note The sink is called from the binary log task or from esp_log_binary_flush(),
+ * it must not log messages itself.
+ *
+ * @param sink  New sink, or NULL to restore the default sink.
+ */
+void esp_log_binary_set_sink(esp_log_binary_sink_t sink);
+
+/**
+ * @brief Pass all recorded binary log records to the sink
+ *
+ * Records are passed to the sink periodically by the binary log task, this
+ * function can be used to do it immediately, for example before a restart.
+ * Must be called from a task.
+ */
+void esp_log_binary_flush(void);
+
+#endif // CONFIG_LOG_BINARY || __DOXYGEN__
+
+#ifdef __cplusplus
+}
+#endif
@@ -7,30 +7,37 @@
 /*
  * Log library implementation notes.
  *
- * Log library stores all tags provided to esp_log_level_set as a linked
- * list. See uncached_tag_entry_t structure.
+ * Log library stores all tags provided to esp_log_level_set in a hash
+ * table with TAG_HASH_BUCKETS buckets, each bucket is a linked list of
+ * tags with the same string hash. See uncached_tag_entry_t structure.
  *
  * To avoid looking up log level for given tag each time message is
  * printed, this library caches pointers to tags. Because the suggested
  * way of creating tags uses one 'TAG' constant per file, this caching
- * should be effective. Cache is a binary min-heap of cached_tag_entry_t
- * items, ordering is done on 'generation' member. In this context,
- * generation is an integer which is incremented each time an operation
- * with cache is performed. When cache is full, new item is inserted in
- * place of an oldest item (that is, with smallest 'generation' value).
- * After that, bubble-down operation is performed to fix ordering in the
- * min-heap.
+ * should be effective. Cache is an open addressing hash table of
+ * cached_tag_entry_t items, keyed on the tag pointer. A tag is stored in
+ * one of the TAG_CACHE_PROBES entries following its hash. Tags which are
+ * not in the cache are looked up by string and then added to the cache.
+ * If all entries for the tag are in use, one of them is replaced, using
+ * the "second chance" algorithm: lookups mark the entries they hit as
+ * referenced, and an entry which hasn't been referenced since the last
+ * replacement is chosen. Entries never become unused again, so a lookup
+ * may stop at the first unused entry. The whole cache is cleared when
+ * the default level is changed with esp_log_level_set("*", level).
  *
- * The potential problem with wrap-around of cache generation counter is
- * ignored for now. This will happen if someone happens to output more
- * than 4 billion log entries, at which point wrap-around will not be
- * the biggest problem.
+ * Looking up the cache doesn't take the log mutex, only adding, updating
+ * and clearing entries does. To make sure that a reader never combines
+ * the tag of one entry with the level of another, writers follow the
+ * sequence used by seqlocks: an entry's tag is set to NULL before its
+ * level is overwritten, and readers check that the tag has not changed
+ * after reading the level.
  *
  */
 
 #include <stdbool.h>
 #include <stdarg.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
@@ -47,13 +54,20 @@
 
 #include "sys/queue.h"
 
-// Number of tags to be cached. Must be 2**n - 1, n >= 2.
-#define TAG_CACHE_SIZE 31
+// Number of tags to be cached. Must be 2**n.
+#define TAG_CACHE_SIZE CONFIG_LOG_TAG_LEVEL_CACHE_SIZE
+// Number of entries in which a tag may be stored, starting at its hash
+#define TAG_CACHE_PROBES 8
+// Number of buckets of the table of tags set with esp_log_level_set. Must be 2**n.
+#define TAG_HASH_BUCKETS 32
+
+_Static_assert((TAG_CACHE_SIZE & (TAG_CACHE_SIZE - 1)) == 0, "CONFIG_LOG_TAG_LEVEL_CACHE_SIZE must be a power of 2");
+_Static_assert(TAG_CACHE_PROBES <= TAG_CACHE_SIZE, "CONFIG_LOG_TAG_LEVEL_CACHE_SIZE is too small");
 
 typedef struct {
-    const char *tag;
-    uint32_t level : 3;
-    uint32_t generation : 29;
+    const char *tag;    // NULL for unused entries, accessed atomically
+    uint8_t level;      // esp_log_level_t as uint8_t, accessed atomically
+    uint8_t referenced; // set by lookups, cleared by replacements, accessed atomically
 } cached_tag_entry_t;
 
 typedef struct uncached_tag_entry_ {
@@ -66,10 +80,8 @@ typedef struct uncached_tag_entry_ {
 esp_log_level_t g_master_log_level = CONFIG_LOG_DEFAULT_LEVEL;
 #endif
 esp_log_level_t esp_log_default_level = CONFIG_LOG_DEFAULT_LEVEL;
-static SLIST_HEAD(log_tags_head, uncached_tag_entry_) s_log_tags = SLIST_HEAD_INITIALIZER(s_log_tags);
+static SLIST_HEAD(log_tags_head, uncached_tag_entry_) s_log_tags[TAG_HASH_BUCKETS];
 static cached_tag_entry_t s_log_cache[TAG_CACHE_SIZE];
-static uint32_t s_log_cache_max_generation = 0;
-static uint32_t s_log_cache_entry_count = 0;
 static vprintf_like_t s_log_print_func = &vprintf;
 
 #ifdef LOG_BUILTIN_CHECKS
@@ -77,11 +89,11 @@ static uint32_t s_log_cache_misses = 0;
 #endif
 
 
+static inline uint32_t tag_ptr_hash(const char *tag);
+static inline uint32_t tag_str_hash(const char *tag);
 static inline bool get_cached_log_level(const char *tag, esp_log_level_t *level);
 static inline bool get_uncached_log_level(const char *tag, esp_log_level_t *level);
 static inline void add_to_cache(const char *tag, esp_log_level_t level);
-static void heap_bubble_down(int index);
-static inline void heap_swap(int i, int j);
 static inline bool should_output(esp_log_level_t level_for_message, esp_log_level_t level_for_tag);
 static inline void clear_log_level_list(void);
 
@@ -119,8 +131,9 @@ void esp_log_level_set(const char *tag, esp_log_level_t level)
     }
 
     // search for existing tag
+    struct log_tags_head *bucket = &s_log_tags[tag_str_hash(tag) & (TAG_HASH_BUCKETS - 1)];
     uncached_tag_entry_t *it = NULL;
-    SLIST_FOREACH(it, &s_log_tags, entries) {
+    SLIST_FOREACH(it, bucket, entries) {
         if (strcmp(it->tag, tag) == 0) {
             // one tag in the linked list matched, update the level
             it->level = level;
@@ -140,31 +153,30 @@ void esp_log_level_set(const char *tag, esp_log_level_t level)
         }
         new_entry->level = (uint8_t) level;
         memcpy(new_entry->tag, tag, tag_len); // we know the size and strncpy would trigger a compiler warning here
-        SLIST_INSERT_HEAD(&s_log_tags, new_entry, entries);
+        SLIST_INSERT_HEAD(bucket, new_entry, entries);
     }
 
-    // search in the cache and update the entry it if exists
-    for (uint32_t i = 0; i < s_log_cache_entry_count; ++i) {
-#ifdef LOG_BUILTIN_CHECKS
-        assert(i == 0 || s_log_cache[(i - 1) / 2].generation < s_log_cache[i].generation);
-#endif
-        if (strcmp(s_log_cache[i].tag, tag) == 0) {
-            s_log_cache[i].level = level;
-            break;
+    // update the cache entries of all pointers to this tag, tag strings
+    // might not be merged by the linker
+    for (uint32_t i = 0; i < TAG_CACHE_SIZE; ++i) {
+        const char *cached_tag = s_log_cache[i].tag;
+        if (cached_tag != NULL && strcmp(cached_tag, tag) == 0) {
+            __atomic_store_n(&s_log_cache[i].level, (uint8_t) level, __ATOMIC_RELAXED);
         }
     }
     esp_log_impl_unlock();
 }
 
 
-/* Common code for getting the log level from cache, esp_log_impl_lock()
-   should be called before calling this function. The function unlocks,
-   as indicated in the name.
+/* Common code for getting the log level if the tag is not in the cache,
+   esp_log_impl_lock() should be called before calling this function.
+   The function unlocks, as indicated in the name.
 */
 static esp_log_level_t s_log_level_get_and_unlock(const char *tag)
 {
     esp_log_level_t level_for_tag;
-    // Look for the tag in cache first, then in the linked list of all tags
+    // Look for the tag in cache again, it might have been added since the
+    // lock-free lookup. Then look in the hash table of all tags.
     if (!get_cached_log_level(tag, &level_for_tag)) {
         if (!get_uncached_log_level(tag, &level_for_tag)) {
             level_for_tag = esp_log_default_level;
@@ -181,6 +193,10 @@ static esp_log_level_t s_log_level_get_and_unlock(const char *tag)
 
 esp_log_level_t esp_log_level_get(const char *tag)
 {
+    esp_log_level_t level_for_tag;
+    if (get_cached_log_level(tag, &level_for_tag)) {
+        return level_for_tag;
+    }
     esp_log_impl_lock();
     return s_log_level_get_and_unlock(tag);
 }
@@ -188,12 +204,15 @@ esp_log_level_t esp_log_level_get(const char *tag)
 void clear_log_level_list(void)
 {
     uncached_tag_entry_t *it;
-    while ((it = SLIST_FIRST(&s_log_tags)) != NULL) {
-        SLIST_REMOVE_HEAD(&s_log_tags, entries);
-        free(it);
+    for (uint32_t i = 0; i < TAG_HASH_BUCKETS; ++i) {
+        while ((it = SLIST_FIRST(&s_log_tags[i])) != NULL) {
+            SLIST_REMOVE_HEAD(&s_log_tags[i], entries);
+            free(it);
+        }
+    }
+    for (uint32_t i = 0; i < TAG_CACHE_SIZE; ++i) {
+        __atomic_store_n(&s_log_cache[i].tag, NULL, __ATOMIC_RELAXED);
     }
-    s_log_cache_entry_count = 0;
-    s_log_cache_max_generation = 0;
 #ifdef LOG_BUILTIN_CHECKS
     s_log_cache_misses = 0;
 #endif
@@ -204,14 +223,27 @@ void esp_log_writev(esp_log_level_t level,
                    const char *format,
                    va_list args)
 {
-    if (!esp_log_impl_lock_timeout()) {
-        return;
+    esp_log_level_t level_for_tag;
+    if (!get_cached_log_level(tag, &level_for_tag)) {
+        if (!esp_log_impl_lock_timeout()) {
+            return;
+        }
+        level_for_tag = s_log_level_get_and_unlock(tag);
     }
-    esp_log_level_t level_for_tag = s_log_level_get_and_unlock(tag);
     if (!should_output(level, level_for_tag)) {
         return;
     }
 
+#if CONFIG_LOG_BINARY && !BOOTLOADER_BUILD
+    if (esp_log_binary_write(format, args)) {
+        return;
+    }
+#endif
+#if CONFIG_LOG_ASYNC && !BOOTLOADER_BUILD
+    if (esp_log_async_writev(format, args)) {
+        return;
+    }
+#endif
     (*s_log_print_func)(format, args);
 
 }
@@ -226,70 +258,102 @@ void esp_log_write(esp_log_level_t level,
     va_end(list);
 }
 
+void esp_log_print_direct(const char *format, ...)
+{
+    va_list list;
+    va_start(list, format);
+    (*s_log_print_func)(format, list);
+    va_end(list);
+}
+
+static inline uint32_t tag_ptr_hash(const char *tag)
+{
+    // Mix all bits of the pointer, including the upper half on 64-bit hosts
+    uint64_t ptr = (uintptr_t) tag;
+    uint32_t hash = (uint32_t) (ptr ^ (ptr >> 32));
+    hash ^= hash >> 16;
+    hash *= 0x45d9f3bu;
+    hash ^= hash >> 16;
+    return hash;
+}
+
+static inline uint32_t tag_str_hash(const char *tag)
+{
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for (; *tag != '\0'; ++tag) {
+        hash ^= (uint8_t) *tag;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
 static inline bool get_cached_log_level(const char *tag, esp_log_level_t *level)
 {
-    // Look for `tag` in cache
-    uint32_t i;
-    for (i = 0; i < s_log_cache_entry_count; ++i) {
-#ifdef LOG_BUILTIN_CHECKS
-        assert(i == 0 || s_log_cache[(i - 1) / 2].generation < s_log_cache[i].generation);
-#endif
-        if (s_log_cache[i].tag == tag) {
-            break;
+    // Look for `tag` in cache. Entries are never cleared individually, so `tag`
+    // isn't stored after an unused entry.
+    const uint32_t hash = tag_ptr_hash(tag);
+    for (uint32_t i = 0; i < TAG_CACHE_PROBES; ++i) {
+        cached_tag_entry_t *entry = &s_log_cache[(hash + i) & (TAG_CACHE_SIZE - 1)];
+        const char *cached_tag = __atomic_load_n(&entry->tag, __ATOMIC_ACQUIRE);
+        if (cached_tag == NULL) { // Not found in cache
+            return false;
+        }
+        if (cached_tag == tag) {
+            uint8_t cached_level = __atomic_load_n(&entry->level, __ATOMIC_RELAXED);
+            // The entry might have been cleared and reused for a different tag
+            // while reading the level
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            if (__atomic_load_n(&entry->tag, __ATOMIC_RELAXED) != tag) {
+                return false;
+            }
+            // Only written if not set yet, to avoid writing to a shared cache line on each call
+            if (!__atomic_load_n(&entry->referenced, __ATOMIC_RELAXED)) {
+                __atomic_store_n(&entry->referenced, 1, __ATOMIC_RELAXED);
+            }
+            *level = (esp_log_level_t) cached_level;
+            return true;
         }
     }
-    if (i == s_log_cache_entry_count) { // Not found in cache
-        return false;
-    }
-    // Return level from cache
-    *level = (esp_log_level_t) s_log_cache[i].level;
-    // If cache has been filled, start taking ordering into account
-    // (other options are: dynamically resize cache, add "dummy" entries
-    //  to the cache; this option was chosen because code is much simpler,
-    //  and the unfair behavior of cache will show it self at most once, when
-    //  it has just been filled)
-    if (s_log_cache_entry_count == TAG_CACHE_SIZE) {
-        // Update item generation
-        s_log_cache[i].generation = s_log_cache_max_generation++;
-        // Restore heap ordering
-        heap_bubble_down(i);
-    }
-    return true;
+    return false;
 }
 
 static inline void add_to_cache(const char *tag, esp_log_level_t level)
 {
-    uint32_t generation = s_log_cache_max_generation++;
-    // First consider the case when cache is not filled yet.
-    // In this case, just add new entry at the end.
-    // This happens to satisfy binary min-heap ordering.
-    if (s_log_cache_entry_count < TAG_CACHE_SIZE) {
-        s_log_cache[s_log_cache_entry_count] = (cached_tag_entry_t) {
-            .generation = generation,
-            .level = level,
-            .tag = tag
-        };
-        ++s_log_cache_entry_count;
-        return;
+    const uint32_t hash = tag_ptr_hash(tag);
+    cached_tag_entry_t *entry = NULL;
+    for (uint32_t i = 0; i < TAG_CACHE_PROBES && entry == NULL; ++i) {
+        if (s_log_cache[(hash + i) & (TAG_CACHE_SIZE - 1)].tag == NULL) {
+            entry = &s_log_cache[(hash + i) & (TAG_CACHE_SIZE - 1)];
+        }
     }
-
-    // Cache is full, so we replace the oldest entry (which is at index 0
-    // because this is a min-heap) with the new one, and do bubble-down
-    // operation to restore min-heap ordering.
-    s_log_cache[0] = (cached_tag_entry_t) {
-        .tag = tag,
-        .level = level,
-        .generation = generation
-    };
-    heap_bubble_down(0);
+    // All entries are in use, replace the first one which hasn't been referenced since
+    // the last replacement. If all of them have been, this is the first entry.
+    for (uint32_t i = 0; i < TAG_CACHE_PROBES && entry == NULL; ++i) {
+        cached_tag_entry_t *candidate = &s_log_cache[(hash + i) & (TAG_CACHE_SIZE - 1)];
+        if (!__atomic_load_n(&candidate->referenced, __ATOMIC_RELAXED)) {
+            entry = candidate;
+        }
+        __atomic_store_n(&candidate->referenced, 0, __ATOMIC_RELAXED);
+    }
+    if (entry == NULL) {
+        entry = &s_log_cache[hash & (TAG_CACHE_SIZE - 1)];
+    }
+    // Unpublish the old tag before overwriting the level, see get_cached_log_level().
+    // Lookups of other tags which find the entry unused meanwhile take the slow path.
+    __atomic_store_n(&entry->tag, NULL, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    __atomic_store_n(&entry->level, (uint8_t) level, __ATOMIC_RELAXED);
+    __atomic_store_n(&entry->referenced, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&entry->tag, tag, __ATOMIC_RELEASE);
 }
 
 static inline bool get_uncached_log_level(const char *tag, esp_log_level_t *level)
 {
-    // Walk the linked list of all tags and see if given tag is present in the list.
-    // This is slow because tags are compared as strings.
+    // Walk the linked list of tags with the same hash and see if given tag is present in the list.
+    // This is slower because tags are compared as strings.
     uncached_tag_entry_t *it;
-    SLIST_FOREACH(it, &s_log_tags, entries) {
+    SLIST_FOREACH(it, &s_log_tags[tag_str_hash(tag) & (TAG_HASH_BUCKETS - 1)], entries) {
         if (strcmp(tag, it->tag) == 0) {
             *level = it->level;
             return true;
@@ -302,21 +366,3 @@ static inline bool should_output(esp_log_level_t level_for_message, esp_log_leve
 {
     return level_for_message <= level_for_tag;
 }
-
-static void heap_bubble_down(int index)
-{
-    while (index < TAG_CACHE_SIZE / 2) {
-        int left_index = index * 2 + 1;
-        int right_index = left_index + 1;
-        int next = (s_log_cache[left_index].generation < s_log_cache[right_index].generation) ? left_index : right_index;
-        heap_swap(index, next);
-        index = next;
-    }
-}
-
-static inline void heap_swap(int i, int j)
-{
-    cached_tag_entry_t tmp = s_log_cache[i];
-    s_log_cache[i] = s_log_cache[j];
-    s_log_cache[j] = tmp;
-}
@@ -0,0 +1,328 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Asynchronous log output implementation notes.
+ *
+ * Messages are formatted by the logging task directly into a ring buffer,
+ * from which the asynchronous log task writes them to the sinks. Each
+ * message is stored as a record: a 32-bit header word holding the length of
+ * the message, the number of padding words following it and a "committed"
+ * bit, followed by the message. Records start at 4-byte aligned positions
+ * and don't wrap around the end of the buffer. If a record doesn't fit
+ * before the end, the rest of the buffer is skipped with an empty record.
+ *
+ * Producers don't take a lock. A producer reserves space for the longest
+ * message by advancing the head counter with a compare-and-swap, formats
+ * the message into it and then gives back the unused space by moving the
+ * head counter back, unless another producer has reserved space after it in
+ * the meantime, in which case the unused space is kept as padding. Finally
+ * it sets the header word with the committed bit. The consumer stops
+ * at the first record which isn't committed yet, so a producer which is
+ * preempted between reserving and committing only delays the output of the
+ * records which follow its own. The consumer zeroes consumed records before
+ * advancing the tail counter, so that a header word of a record which has
+ * been reserved but not yet written never appears to be committed.
+ *
+ * The OS specific parts (creating the task, waking it up and serializing
+ * consumers) are implemented in log_freertos.c and log_linux.c.
+ */
+
+#include <stdbool.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <sys/param.h>
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_log_async.h"
+#include "esp_log_private.h"
+
+#define BUFFER_SIZE CONFIG_LOG_ASYNC_BUFFER_SIZE
+#define MAX_MESSAGE_SIZE CONFIG_LOG_ASYNC_MAX_MESSAGE_SIZE
+// Sinks are called with up to this many bytes of messages
+#define BATCH_SIZE (2 * MAX_MESSAGE_SIZE)
+#define MAX_SINKS 4
+// The task is woken up by the first message logged into an empty buffer,
+// messages committed while it is writing are picked up after this timeout at the latest
+#define WAIT_TIMEOUT_MS 100
+
+#define HEADER_SIZE sizeof(uint32_t)
+#define HEADER_COMMITTED 0x80000000u
+#define HEADER_PADDING_SHIFT 16
+#define HEADER_PADDING_MASK 0x7fffu
+#define HEADER_LENGTH_MASK 0xffffu
+#define MAX_RECORD_SIZE ((HEADER_SIZE + MAX_MESSAGE_SIZE + 3) & ~3u)
+
+_Static_assert((BUFFER_SIZE & (BUFFER_SIZE - 1)) == 0, "CONFIG_LOG_ASYNC_BUFFER_SIZE must be a power of 2");
+_Static_assert(MAX_MESSAGE_SIZE <= HEADER_LENGTH_MASK, "message length must fit into the record header");
+_Static_assert(MAX_RECORD_SIZE / 4 <= HEADER_PADDING_MASK, "padding must fit into the record header");
+// A reservation skipping the end of the buffer takes up to 2 * MAX_RECORD_SIZE - 4 bytes
+_Static_assert(2 * MAX_RECORD_SIZE - 4 <= BUFFER_SIZE, "CONFIG_LOG_ASYNC_BUFFER_SIZE must be more than twice CONFIG_LOG_ASYNC_MAX_MESSAGE_SIZE");
+
+typedef struct {
+    esp_log_async_sink_t sink;
+    void *arg;
+} sink_entry_t;
+
+static uint32_t s_buffer[BUFFER_SIZE / sizeof(uint32_t)];
+static uint32_t s_head;             // bytes reserved by producers, accessed atomically
+static uint32_t s_tail;             // bytes consumed, accessed atomically
+static uint32_t s_dropped;          // messages dropped since startup, accessed atomically
+static uint32_t s_dropped_reported; // dropped messages reported to the sinks
+static bool s_started;              // accessed atomically
+
+// Accessed only while holding the consumer lock
+static sink_entry_t s_sinks[MAX_SINKS] = {
+    { .sink = &esp_log_async_sink_vprintf, .arg = NULL },
+};
+static size_t s_sink_count = 1;
+static char s_batch[BATCH_SIZE];
+
+static inline uint32_t record_size(uint32_t length)
+{
+    return (HEADER_SIZE + length + 3) & ~3u;
+}
+
+// Size of a committed record including its padding
+static inline uint32_t header_record_size(uint32_t header)
+{
+    return record_size(header & HEADER_LENGTH_MASK) + ((header >> HEADER_PADDING_SHIFT) & HEADER_PADDING_MASK) * 4;
+}
+
+static inline uint32_t make_header(uint32_t length, uint32_t size)
+{
+    return HEADER_COMMITTED | ((size - record_size(length)) / 4) << HEADER_PADDING_SHIFT | length;
+}
+
+static inline uint32_t *header_word(uint32_t pos)
+{
+    return &s_buffer[(pos & (BUFFER_SIZE - 1)) / sizeof(uint32_t)];
+}
+
+static inline void copy_from_buffer(uint32_t pos, char *dst, size_t len)
+{
+    const uint8_t *data = (const uint8_t *) s_buffer;
+    size_t offset = pos & (BUFFER_SIZE - 1);
+    size_t first = MIN(len, BUFFER_SIZE - offset);
+    memcpy(dst, &data[offset], first);
+    memcpy(dst + first, &data[0], len - first);
+}
+
+static inline void zero_buffer(uint32_t pos, size_t len)
+{
+    uint8_t *data = (uint8_t *) s_buffer;
+    size_t offset = pos & (BUFFER_SIZE - 1);
+    size_t first = MIN(len, BUFFER_SIZE - offset);
+    memset(&data[offset], 0, first);
+    memset(&data[0], 0, len - first);
+}
+
+bool esp_log_async_writev(const char *format, va_list args)
+{
+    // Until the task has been started, messages are written synchronously
+    if (!__atomic_load_n(&s_started, __ATOMIC_ACQUIRE)) {
+        return false;
+    }
+    uint32_t head = __atomic_load_n(&s_head, __ATOMIC_RELAXED);
+    uint32_t tail;
+    uint32_t skip;
+    do {
+        // The space up to the end of the buffer is skipped if the longest message doesn't fit into it
+        skip = BUFFER_SIZE - (head & (BUFFER_SIZE - 1));
+        if (skip >= MAX_RECORD_SIZE) {
+            skip = 0;
+        }
+        // Acquire: the consumer has finished with the space before it advanced the tail
+        tail = __atomic_load_n(&s_tail, __ATOMIC_ACQUIRE);
+        if (BUFFER_SIZE - (head - tail) < skip + MAX_RECORD_SIZE) {
+            __atomic_fetch_add(&s_dropped, 1, __ATOMIC_RELAXED);
+            return true;
+        }
+    } while (!__atomic_compare_exchange_n(&s_head, &head, head + skip + MAX_RECORD_SIZE, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+    if (skip != 0) {
+        __atomic_store_n(header_word(head), make_header(0, skip), __ATOMIC_RELEASE);
+    }
+    uint32_t pos = head + skip;
+    char *message = (char *) header_word(pos) + HEADER_SIZE;
+    int ret = vsnprintf(message, MAX_MESSAGE_SIZE, format, args);
+    if (ret < 0) {
+        memset(message, 0, MAX_MESSAGE_SIZE);
+        ret = 0;
+    }
+    uint32_t length = MIN((uint32_t) ret, MAX_MESSAGE_SIZE - 1);
+    uint32_t size = record_size(length);
+    // Give back the unused space. The terminating null character written to it keeps it zeroed.
+    uint32_t end = pos + MAX_RECORD_SIZE;
+    if (!__atomic_compare_exchange_n(&s_head, &end, pos + size, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        size = MAX_RECORD_SIZE;
+    }
+    __atomic_store_n(header_word(pos), make_header(length, size), __ATOMIC_RELEASE);
+    if (head == tail) {
+        esp_log_impl_async_notify();
+    }
+    return true;
+}
+
+/* Copies as many committed messages as fit into the batch buffer and frees
+   their space, returns the number of bytes copied. */
+static size_t fill_batch(void)
+{
+    size_t batch_len = 0;
+    uint32_t dropped = __atomic_load_n(&s_dropped, __ATOMIC_RELAXED);
+    if (dropped != s_dropped_reported) {
+        batch_len = snprintf(s_batch, sizeof(s_batch), "[%" PRIu32 " log messages dropped]\n", dropped - s_dropped_reported);
+        s_dropped_reported = dropped;
+    }
+
+    uint32_t tail = __atomic_load_n(&s_tail, __ATOMIC_RELAXED);
+    while (true) {
+        uint32_t header = __atomic_load_n(header_word(tail), __ATOMIC_ACQUIRE);
+        if ((header & HEADER_COMMITTED) == 0) {
+            break;
+        }
+        uint32_t length = header & HEADER_LENGTH_MASK;
+        if (batch_len + length > sizeof(s_batch)) {
+            break;
+        }
+        copy_from_buffer(tail + HEADER_SIZE, &s_batch[batch_len], length);
+        zero_buffer(tail, header_record_size(header));
+        batch_len += length;
+        tail += header_record_size(header);
+    }
+    __atomic_store_n(&s_tail, tail, __ATOMIC_RELEASE);
+    return batch_len;
+}
+
+void esp_log_async_flush(void)
+{
+    if (!__atomic_load_n(&s_started, __ATOMIC_ACQUIRE)) {
+        return;
+    }
+    esp_log_impl_async_consumer_lock();
+    size_t batch_len;
+    while ((batch_len = fill_batch()) != 0) {
+        for (size_t i = 0; i < s_sink_count; ++i) {
+            (*s_sinks[i].sink)(s_batch, batch_len, s_sinks[i].arg);
+        }
+    }
+    esp_log_impl_async_consumer_unlock();
+}
+
+void esp_log_async_panic_flush(void (*putc_fn)(char c))
+{
+    if (putc_fn == NULL || !__atomic_load_n(&s_started, __ATOMIC_ACQUIRE)) {
+        return;
+    }
+    // Placed in IRAM, so the helper functions above which may not be inlined aren't used
+    uint8_t *data = (uint8_t *) s_buffer;
+    uint32_t tail = __atomic_load_n(&s_tail, __ATOMIC_ACQUIRE);
+    const uint32_t head = __atomic_load_n(&s_head, __ATOMIC_ACQUIRE);
+    while (tail != head) {
+        uint32_t header = __atomic_load_n(&s_buffer[(tail & (BUFFER_SIZE - 1)) / sizeof(uint32_t)], __ATOMIC_ACQUIRE);
+        if ((header & HEADER_COMMITTED) == 0) {
+            break;
+        }
+        uint32_t length = header & HEADER_LENGTH_MASK;
+        for (uint32_t i = 0; i < length; ++i) {
+            putc_fn(data[(tail + HEADER_SIZE + i) & (BUFFER_SIZE - 1)]);
+        }
+        // The space is returned zeroed, as it is by the task
+        uint32_t size = ((HEADER_SIZE + length + 3) & ~3u) + ((header >> HEADER_PADDING_SHIFT) & HEADER_PADDING_MASK) * 4;
+        for (uint32_t i = 0; i < size; ++i) {
+            data[(tail + i) & (BUFFER_SIZE - 1)] = 0;
+        }
+        tail += size;
+    }
+    __atomic_store_n(&s_tail, tail, __ATOMIC_RELEASE);
+}
+
+static void log_async_task(void *arg)
+{
+    (void) arg;
+    while (true) {
+        esp_log_impl_async_wait(WAIT_TIMEOUT_MS);
+        esp_log_async_flush();
+    }
+}
+
+esp_err_t esp_log_async_init(void)
+{
+    if (!esp_log_impl_async_start(&log_async_task)) {
+        return ESP_ERR_NO_MEM;
+    }
+    __atomic_store_n(&s_started, true, __ATOMIC_RELEASE);
+    return ESP_OK;
+}
+
+esp_err_t esp_log_async_add_sink(esp_log_async_sink_t sink, void *arg)
+{
+    if (sink == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_err_t err = ESP_OK;
+    esp_log_impl_async_consumer_lock();
+    for (size_t i = 0; i < s_sink_count; ++i) {
+        if (s_sinks[i].sink == sink && s_sinks[i].arg == arg) {
+            err = ESP_ERR_INVALID_STATE;
+        }
+    }
+    if (err == ESP_OK && s_sink_count == MAX_SINKS) {
+        err = ESP_ERR_NO_MEM;
+    }
+    if (err == ESP_OK) {
+        s_sinks[s_sink_count].sink = sink;
+        s_sinks[s_sink_count].arg = arg;
+        ++s_sink_count;
+    }
+    esp_log_impl_async_consumer_unlock();
+    return err;
+}
+
+esp_err_t esp_log_async_remove_sink(esp_log_async_sink_t sink, void *arg)
+{
+    esp_err_t err = ESP_ERR_NOT_FOUND;
+    esp_log_impl_async_consumer_lock();
+    for (size_t i = 0; i < s_sink_count; ++i) {
+        if (s_sinks[i].sink == sink && s_sinks[i].arg == arg) {
+            memmove(&s_sinks[i], &s_sinks[i + 1], (s_sink_count - i - 1) * sizeof(s_sinks[0]));
+            --s_sink_count;
+            err = ESP_OK;
+            break;
+        }
+    }
+    esp_log_impl_async_consumer_unlock();
+    return err;
+}
+
+uint32_t esp_log_async_get_dropped(void)
+{
+    return __atomic_load_n(&s_dropped, __ATOMIC_RELAXED);
+}
+
+void esp_log_async_sink_vprintf(const char *data, size_t size, void *arg)
+{
+    (void) arg;
+    esp_log_print_direct("%.*s", (int) size, data);
+}
+
+void esp_log_async_sink_fd(const char *data, size_t size, void *arg)
+{
+    int fd = (int) (intptr_t) arg;
+    while (size > 0) {
+        ssize_t written = write(fd, data, size);
+        if (written <= 0) {
+            return;
+        }
+        data += written;
+        size -= written;
+    }
+}
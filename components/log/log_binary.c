@@ -0,0 +1,374 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Binary logging implementation notes.
+ *
+ * Instead of formatting a message, esp_log_binary_write() encodes the address
+ * of the format string and the values of the arguments into a record. The
+ * format string is only parsed to find out the types of the arguments.
+ * Integers and pointers take 4 bytes, 64-bit integers and doubles 8 bytes.
+ * Strings located in flash are recorded by address, other strings are copied
+ * into the record, preceded by their length. The timestamp and the tag of
+ * ESP_LOGx messages are arguments of the format string, so they don't need
+ * special treatment.
+ *
+ * Each core writes records into its own buffer with interrupts masked, so
+ * there is a single writer per buffer. The binary log task is the only reader
+ * of all buffers. Writer and reader only share the running head and tail
+ * counters, which are accessed atomically.
+ *
+ * All multi-byte values are stored little endian and unaligned. The decoder
+ * (log_binary_decode.py) has to be kept in sync with the encoding.
+ */
+
+#include <stdbool.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/param.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_cpu.h"
+#include "esp_err.h"
+#include "esp_memory_utils.h"
+#include "esp_private/startup_internal.h"
+#include "esp_log.h"
+#include "esp_log_binary.h"
+#include "esp_log_private.h"
+
+#define BUFFER_SIZE CONFIG_LOG_BINARY_BUFFER_SIZE
+// Records which don't fit are formatted as text instead
+#define MAX_RECORD_SIZE 128
+// Length byte of a string argument recorded by address
+#define STRING_IN_FLASH 0xff
+// Length byte of a NULL string argument
+#define STRING_NULL 0xfe
+
+_Static_assert((BUFFER_SIZE & (BUFFER_SIZE - 1)) == 0, "CONFIG_LOG_BINARY_BUFFER_SIZE must be a power of 2");
+_Static_assert(sizeof(long) == 4 && sizeof(void *) == 4, "binary log encoding assumes 32-bit long and pointers");
+
+typedef struct {
+    uint16_t size;      // size of the record, including this header
+    uint16_t dropped;   // number of records dropped on this core before this one, saturated
+    uint32_t format;    // address of the format string
+} __attribute__((packed)) record_header_t;
+
+typedef struct {
+    uint32_t head;      // bytes written, only modified by the core owning the buffer
+    uint32_t tail;      // bytes passed to the sink, only modified by the reader
+    uint32_t dropped;   // records dropped since the last record written
+    uint8_t data[BUFFER_SIZE];
+} record_buffer_t;
+
+static record_buffer_t s_buffers[portNUM_PROCESSORS];
+static void print_base64_sink(const uint8_t *data, size_t size);
+static esp_log_binary_sink_t s_sink = &print_base64_sink;
+static SemaphoreHandle_t s_flush_mutex;
+static uint8_t s_chunk[MAX_RECORD_SIZE];
+
+typedef struct {
+    uint8_t *pos;
+    uint8_t *end;
+} encoder_t;
+
+static inline bool put_bytes(encoder_t *enc, const void *src, size_t len)
+{
+    if ((size_t)(enc->end - enc->pos) < len) {
+        return false;
+    }
+    memcpy(enc->pos, src, len);
+    enc->pos += len;
+    return true;
+}
+
+static inline bool put_u32(encoder_t *enc, uint32_t value)
+{
+    return put_bytes(enc, &value, sizeof(value));
+}
+
+static bool put_string(encoder_t *enc, const char *str, int precision)
+{
+    if (str == NULL) {
+        uint8_t tag = STRING_NULL;
+        return put_bytes(enc, &tag, 1);
+    }
+    if (esp_ptr_in_drom(str)) {
+        uint8_t tag = STRING_IN_FLASH;
+        return put_bytes(enc, &tag, 1) && put_u32(enc, (uint32_t) str);
+    }
+    size_t len = strnlen(str, precision >= 0 ? (size_t) precision : STRING_NULL);
+    if (len >= STRING_NULL) {
+        return false;
+    }
+    uint8_t tag = (uint8_t) len;
+    return put_bytes(enc, &tag, 1) && put_bytes(enc, str, len);
+}
+
+/* Encodes the arguments of the format string, returns false if the format
+   string has conversions which aren't supported or the record is too long. */
+static bool encode_args(encoder_t *enc, const char *format, va_list args)
+{
+    for (const char *p = format; *p != '\0'; ++p) {
+        if (*p != '%') {
+            continue;
+        }
+        ++p;
+        // flags
+        while (*p == '-' || *p == '+' || *p == ' ' || *p == '#' || *p == '0') {
+            ++p;
+        }
+        // width
+        if (*p == '*') {
+            if (!put_u32(enc, (uint32_t) va_arg(args, int))) {
+                return false;
+            }
+            ++p;
+        } else {
+            while (*p >= '0' && *p <= '9') {
+                ++p;
+            }
+        }
+        // precision
+        int precision = -1;
+        if (*p == '.') {
+            ++p;
+            if (*p == '*') {
+                precision = va_arg(args, int);
+                if (!put_u32(enc, (uint32_t) precision)) {
+                    return false;
+                }
+                ++p;
+            } else {
+                precision = 0;
+                while (*p >= '0' && *p <= '9') {
+                    precision = precision * 10 + (*p - '0');
+                    ++p;
+                }
+            }
+        }
+        // length modifier, only 'll', 'j' and 'q' change the size of the argument
+        bool is_64bit = false;
+        bool is_long = false;
+        switch (*p) {
+        case 'h':
+            p += (p[1] == 'h') ? 2 : 1;
+            break;
+        case 'l':
+            is_long = true;
+            if (p[1] == 'l') {
+                is_64bit = true;
+                ++p;
+            }
+            ++p;
+            break;
+        case 'j':
+        case 'q':
+            is_64bit = true;
+            ++p;
+            break;
+        case 'z':
+        case 't':
+            ++p;
+            break;
+        default:
+            break;
+        }
+        bool ok;
+        switch (*p) {
+        case '%':
+            ok = true;
+            break;
+        case 'd':
+        case 'i':
+        case 'u':
+        case 'o':
+        case 'x':
+        case 'X':
+            if (is_64bit) {
+                uint64_t value = va_arg(args, uint64_t);
+                ok = put_bytes(enc, &value, sizeof(value));
+            } else if (is_long) {
+                ok = put_u32(enc, va_arg(args, unsigned long));
+            } else {
+                ok = put_u32(enc, va_arg(args, unsigned int));
+            }
+            break;
+        case 'c':
+            ok = !is_long && put_u32(enc, (uint32_t) va_arg(args, int));
+            break;
+        case 'p':
+            ok = put_u32(enc, (uint32_t) va_arg(args, void *));
+            break;
+        case 'e':
+        case 'E':
+        case 'f':
+        case 'F':
+        case 'g':
+        case 'G':
+        case 'a':
+        case 'A': {
+            double value = va_arg(args, double);
+            ok = put_bytes(enc, &value, sizeof(value));
+            break;
+        }
+        case 's':
+            ok = !is_long && put_string(enc, va_arg(args, const char *), precision);
+            break;
+        default:
+            // %n, long double, wide strings, or a malformed format string
+            ok = false;
+            break;
+        }
+        if (!ok) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static inline void copy_to_buffer(record_buffer_t *buffer, uint32_t pos, const uint8_t *src, size_t len)
+{
+    size_t offset = pos & (BUFFER_SIZE - 1);
+    size_t first = MIN(len, BUFFER_SIZE - offset);
+    memcpy(&buffer->data[offset], src, first);
+    memcpy(&buffer->data[0], src + first, len - first);
+}
+
+static inline void copy_from_buffer(const record_buffer_t *buffer, uint32_t pos, uint8_t *dst, size_t len)
+{
+    size_t offset = pos & (BUFFER_SIZE - 1);
+    size_t first = MIN(len, BUFFER_SIZE - offset);
+    memcpy(dst, &buffer->data[offset], first);
+    memcpy(dst + first, &buffer->data[0], len - first);
+}
+
+bool esp_log_binary_write(const char *format, va_list args)
+{
+    // The decoder reads the format string from the ELF file
+    if (!esp_ptr_in_drom(format)) {
+        return false;
+    }
+    uint8_t record[MAX_RECORD_SIZE];
+    encoder_t enc = {
+        .pos = record + sizeof(record_header_t),
+        .end = record + sizeof(record),
+    };
+    va_list args_copy;
+    va_copy(args_copy, args);
+    bool ok = encode_args(&enc, format, args_copy);
+    va_end(args_copy);
+    if (!ok) {
+        return false;
+    }
+    record_header_t header = {
+        .size = (uint16_t) (enc.pos - record),
+        .format = (uint32_t) format,
+    };
+
+    // Only this core writes to its buffer, masking interrupts makes the writer unique
+    UBaseType_t int_state = portSET_INTERRUPT_MASK_FROM_ISR();
+    record_buffer_t *buffer = &s_buffers[esp_cpu_get_core_id()];
+    uint32_t head = buffer->head;
+    uint32_t tail = __atomic_load_n(&buffer->tail, __ATOMIC_ACQUIRE);
+    if (BUFFER_SIZE - (head - tail) < header.size) {
+        ++buffer->dropped;
+    } else {
+        header.dropped = (uint16_t) MIN(buffer->dropped, UINT16_MAX);
+        buffer->dropped = 0;
+        memcpy(record, &header, sizeof(header));
+        copy_to_buffer(buffer, head, record, header.size);
+        __atomic_store_n(&buffer->head, head + header.size, __ATOMIC_RELEASE);
+    }
+    portCLEAR_INTERRUPT_MASK_FROM_ISR(int_state);
+    // A dropped record is still reported as handled, formatting it instead would
+    // make the writer slower just when the reader can't keep up
+    return true;
+}
+
+static void flush_buffer(record_buffer_t *buffer)
+{
+    uint32_t head = __atomic_load_n(&buffer->head, __ATOMIC_ACQUIRE);
+    uint32_t tail = buffer->tail;
+    while (tail != head) {
+        // Gather as many complete records as fit into one chunk
+        size_t len = 0;
+        while (tail + len != head) {
+            uint16_t size;
+            copy_from_buffer(buffer, tail + len, (uint8_t *) &size, sizeof(size));
+            if (len + size > sizeof(s_chunk)) {
+                break;
+            }
+            copy_from_buffer(buffer, tail + len, &s_chunk[len], size);
+            len += size;
+        }
+        tail += len;
+        __atomic_store_n(&buffer->tail, tail, __ATOMIC_RELEASE);
+        (*s_sink)(s_chunk, len);
+    }
+}
+
+void esp_log_binary_flush(void)
+{
+    xSemaphoreTake(s_flush_mutex, portMAX_DELAY);
+    for (int i = 0; i < portNUM_PROCESSORS; ++i) {
+        flush_buffer(&s_buffers[i]);
+    }
+    xSemaphoreGive(s_flush_mutex);
+}
+
+void esp_log_binary_set_sink(esp_log_binary_sink_t sink)
+{
+    xSemaphoreTake(s_flush_mutex, portMAX_DELAY);
+    s_sink = (sink != NULL) ? sink : &print_base64_sink;
+    xSemaphoreGive(s_flush_mutex);
+}
+
+static void print_base64_sink(const uint8_t *data, size_t size)
+{
+    static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    char line[(MAX_RECORD_SIZE + 2) / 3 * 4 + 1];
+    char *out = line;
+    for (size_t i = 0; i < size; i += 3) {
+        uint32_t bits = (uint32_t) data[i] << 16;
+        if (i + 1 < size) {
+            bits |= (uint32_t) data[i + 1] << 8;
+        }
+        if (i + 2 < size) {
+            bits |= data[i + 2];
+        }
+        *out++ = alphabet[(bits >> 18) & 0x3f];
+        *out++ = alphabet[(bits >> 12) & 0x3f];
+        *out++ = (i + 1 < size) ? alphabet[(bits >> 6) & 0x3f] : '=';
+        *out++ = (i + 2 < size) ? alphabet[bits & 0x3f] : '=';
+    }
+    *out = '\0';
+    esp_log_print_direct(ESP_LOG_BINARY_LINE_PREFIX "%s\n", line);
+}
+
+static void log_binary_task(void *arg)
+{
+    (void) arg;
+    while (true) {
+        vTaskDelay(pdMS_TO_TICKS(CONFIG_LOG_BINARY_FLUSH_PERIOD_MS));
+        esp_log_binary_flush();
+    }
+}
+
+ESP_SYSTEM_INIT_FN(esp_log_binary_init, BIT(0), 130)
+{
+    s_flush_mutex = xSemaphoreCreateMutex();
+    if (s_flush_mutex == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    if (xTaskCreate(&log_binary_task, "log_binary", CONFIG_LOG_BINARY_TASK_STACK_SIZE,
+                    NULL, CONFIG_LOG_BINARY_TASK_PRIORITY, NULL) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
@@ -0,0 +1,224 @@
+#!/usr/bin/env python
+#
+# log_binary_decode.py turns binary log records (CONFIG_LOG_BINARY) back into text.
+#
+# Format strings, and string arguments located in flash, are read from the ELF file
+# of the application. By default, the input is the text output of the application,
+# lines printed by the default binary log sink are decoded and other lines are
+# passed through. With --raw, the input is the data passed to a custom sink.
+#
+# SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+# SPDX-License-Identifier: Apache-2.0
+
+import argparse
+import base64
+import binascii
+import re
+import struct
+import sys
+from typing import BinaryIO, Dict, List, Optional, Tuple
+
+from elftools.elf.constants import SH_FLAGS
+from elftools.elf.elffile import ELFFile
+
+# Keep in sync with log_binary.c and esp_log_binary.h
+LINE_PREFIX = b'ESPLOGB:'
+HEADER = struct.Struct('<HHI')
+STRING_IN_FLASH = 0xff
+STRING_NULL = 0xfe
+
+CONVERSION_RE = re.compile(r'%(?P<flags>[-+ #0]*)(?P<width>\*|\d+)?(?:\.(?P<precision>\*|\d*))?'
+                           r'(?P<length>hh|h|ll|l|j|q|z|t)?(?P<conversion>[diouxXcpeEfFgGaAs%])')
+
+
+class ElfStrings(object):
+    """ Reads zero-terminated strings from the loadable sections of an ELF file """
+
+    def __init__(self, elf_file):  # type: (BinaryIO) -> None
+        self.sections = []  # type: List[Tuple[int, bytes]]
+        self.cache = {}  # type: Dict[int, Optional[str]]
+        for section in ELFFile(elf_file).iter_sections():
+            if section['sh_flags'] & SH_FLAGS.SHF_ALLOC and section['sh_type'] != 'SHT_NOBITS':
+                self.sections.append((section['sh_addr'], section.data()))
+
+    def get(self, address):  # type: (int) -> Optional[str]
+        if address not in self.cache:
+            self.cache[address] = self._read(address)
+        return self.cache[address]
+
+    def _read(self, address):  # type: (int) -> Optional[str]
+        for start, data in self.sections:
+            if start <= address < start + len(data):
+                offset = address - start
+                end = data.find(b'\0', offset)
+                if end < 0:
+                    return None
+                return data[offset:end].decode('utf-8', errors='replace')
+        return None
+
+
+class RecordReader(object):
+    def __init__(self, data, offset, end):  # type: (bytes, int, int) -> None
+        self.data = data
+        self.offset = offset
+        self.end = end
+
+    def take(self, fmt):  # type: (str) -> int
+        size = struct.calcsize(fmt)
+        if self.offset + size > self.end:
+            raise ValueError('record too short')
+        value = struct.unpack_from(fmt, self.data, self.offset)[0]
+        self.offset += size
+        return value  # type: ignore
+
+    def take_bytes(self, size):  # type: (int) -> bytes
+        if self.offset + size > self.end:
+            raise ValueError('record too short')
+        value = self.data[self.offset:self.offset + size]
+        self.offset += size
+        return value
+
+
+def format_record(strings, fmt, reader):  # type: (ElfStrings, str, RecordReader) -> str
+    """ Formats the arguments read from the record like vprintf would format them """
+    out = []
+    pos = 0
+    for match in CONVERSION_RE.finditer(fmt):
+        out.append(fmt[pos:match.start()])
+        pos = match.end()
+        conversion = match.group('conversion')
+        if conversion == '%':
+            out.append('%')
+            continue
+        flags = match.group('flags')
+        width = match.group('width') or ''
+        if width == '*':
+            width = str(reader.take('<i'))
+            if width.startswith('-'):
+                flags += '-'
+                width = width[1:]
+        precision = match.group('precision')
+        if precision == '*':
+            precision = str(reader.take('<i'))
+            if precision.startswith('-'):
+                precision = None
+        precision = '' if precision is None else '.' + (precision or '0')
+        length = match.group('length')
+        is_64bit = length in ('ll', 'j', 'q')
+        # Values of 'h' and 'hh' conversions are recorded as promoted to int
+        bits = {'h': 16, 'hh': 8}.get(length, 64 if is_64bit else 32)
+
+        value = None  # type: object
+        if conversion in 'di':
+            value = reader.take('<Q' if is_64bit else '<I') & ((1 << bits) - 1)
+            if value >> (bits - 1):
+                value -= 1 << bits
+            conversion = 'd'
+        elif conversion in 'ouxX':
+            value = reader.take('<Q' if is_64bit else '<I') & ((1 << bits) - 1)
+            if conversion == 'u':
+                conversion = 'd'
+            elif conversion == 'o' and '#' in flags:
+                # C prints a single leading zero, Python prints '0o'
+                flags = flags.replace('#', '')
+                precision = ''
+                value = '0%o' % value if value else '0'
+                conversion = 's'
+        elif conversion == 'c':
+            value = chr(reader.take('<I') & 0xff)
+        elif conversion == 'p':
+            value = '0x%x' % reader.take('<I')
+            conversion = 's'
+        elif conversion in 'eEfFgGaA':
+            value = reader.take('<d')
+            if conversion in 'aA':
+                value = value.hex() if conversion == 'a' else value.hex().upper()  # type: ignore
+                conversion = 's'
+                precision = ''
+        elif conversion == 's':
+            string_length = reader.take('<B')
+            if string_length == STRING_IN_FLASH:
+                address = reader.take('<I')
+                value = strings.get(address)
+                if value is None:
+                    value = '<string at 0x%08x>' % address
+            elif string_length == STRING_NULL:
+                value = '(null)'
+            else:
+                value = reader.take_bytes(string_length).decode('utf-8', errors='replace')
+        out.append(('%' + flags + width + precision + conversion) % (value,))
+    out.append(fmt[pos:])
+    return ''.join(out)
+
+
+def decode_records(strings, data):  # type: (ElfStrings, bytes) -> Tuple[str, bytes]
+    """ Decodes complete records from data, returns the text and the bytes left over """
+    out = []
+    offset = 0
+    while offset + HEADER.size <= len(data):
+        size, dropped, address = HEADER.unpack_from(data, offset)
+        if size < HEADER.size:
+            raise ValueError('invalid record size %d' % size)
+        if offset + size > len(data):
+            break
+        if dropped:
+            out.append('[%d%s log messages dropped]\n' % (dropped, '+' if dropped == 0xffff else ''))
+        fmt = strings.get(address)
+        if fmt is None:
+            out.append('[unknown format string at 0x%08x]\n' % address)
+        else:
+            try:
+                out.append(format_record(strings, fmt, RecordReader(data, offset + HEADER.size, offset + size)))
+            except (ValueError, TypeError, struct.error) as e:
+                out.append('[failed to decode message "%s": %s]\n' % (fmt.rstrip(), e))
+        offset += size
+    return ''.join(out), data[offset:]
+
+
+def decode_text(strings, infile, outfile):  # type: (ElfStrings, BinaryIO, BinaryIO) -> None
+    for line in infile:
+        start = line.find(LINE_PREFIX)
+        if start < 0:
+            outfile.write(line)
+            continue
+        payload = line[start + len(LINE_PREFIX):].strip()
+        try:
+            text, rest = decode_records(strings, base64.b64decode(payload))
+        except (binascii.Error, ValueError) as e:
+            text, rest = '[invalid binary log line: %s]\n' % e, b''
+        if rest:
+            text += '[truncated binary log record]\n'
+        outfile.write(line[:start] + text.encode('utf-8'))
+        outfile.flush()
+
+
+def decode_raw(strings, infile, outfile):  # type: (ElfStrings, BinaryIO, BinaryIO) -> None
+    pending = b''
+    while True:
+        chunk = infile.read(4096)
+        if not chunk:
+            break
+        text, pending = decode_records(strings, pending + chunk)
+        outfile.write(text.encode('utf-8'))
+    if pending:
+        outfile.write(b'[truncated binary log record]\n')
+
+
+def main():  # type: () -> None
+    parser = argparse.ArgumentParser(description='Decode binary log records of an ESP-IDF application')
+    parser.add_argument('elf', help='ELF file of the application', type=argparse.FileType('rb'))
+    parser.add_argument('input', help='Log output to decode, standard input by default', nargs='?',
+                        type=argparse.FileType('rb'), default=sys.stdin.buffer)
+    parser.add_argument('--raw', help='Input is the data passed to a custom binary log sink, '
+                        'rather than text printed by the default sink', action='store_true')
+    args = parser.parse_args()
+
+    strings = ElfStrings(args.elf)
+    if args.raw:
+        decode_raw(strings, args.input, sys.stdout.buffer)
+    else:
+        decode_text(strings, args.input, sys.stdout.buffer)
+
+
+if __name__ == '__main__':
+    main()
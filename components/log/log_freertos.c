@@ -14,6 +14,11 @@
 #include "esp_compiler.h"
 #include "esp_log.h"
 #include "esp_log_private.h"
+#if CONFIG_LOG_ASYNC
+#include "esp_log_async.h"
+#include "esp_private/startup_internal.h"
+#include "esp_system.h"
+#endif
 
 
 // Maximum time to wait for the mutex in a logging statement.
@@ -56,6 +61,65 @@ void esp_log_impl_unlock(void)
     xSemaphoreGive(s_log_mutex);
 }
 
+#if CONFIG_LOG_ASYNC
+static TaskHandle_t s_log_async_task = NULL;
+static SemaphoreHandle_t s_log_async_mutex = NULL;
+
+bool esp_log_impl_async_start(void (*task_func)(void *))
+{
+    s_log_async_mutex = xSemaphoreCreateMutex();
+    if (s_log_async_mutex == NULL) {
+        return false;
+    }
+    return xTaskCreate(task_func, "log_async", CONFIG_LOG_ASYNC_TASK_STACK_SIZE, NULL,
+                       CONFIG_LOG_ASYNC_TASK_PRIORITY, &s_log_async_task) == pdPASS;
+}
+
+void esp_log_impl_async_notify(void)
+{
+    if (xPortInIsrContext()) {
+        BaseType_t need_yield = pdFALSE;
+        vTaskNotifyGiveFromISR(s_log_async_task, &need_yield);
+        if (need_yield) {
+            portYIELD_FROM_ISR();
+        }
+    } else {
+        xTaskNotifyGive(s_log_async_task);
+    }
+}
+
+void esp_log_impl_async_wait(uint32_t timeout_ms)
+{
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(timeout_ms));
+}
+
+void esp_log_impl_async_consumer_lock(void)
+{
+    if (unlikely(xTaskGetSchedulerState() == taskSCHEDULER_NOT_STARTED)) {
+        return;
+    }
+    xSemaphoreTake(s_log_async_mutex, portMAX_DELAY);
+}
+
+void esp_log_impl_async_consumer_unlock(void)
+{
+    if (unlikely(xTaskGetSchedulerState() == taskSCHEDULER_NOT_STARTED)) {
+        return;
+    }
+    xSemaphoreGive(s_log_async_mutex);
+}
+
+ESP_SYSTEM_INIT_FN(esp_log_async_startup_init, BIT(0), 131)
+{
+    esp_err_t err = esp_log_async_init();
+    if (err != ESP_OK) {
+        return err;
+    }
+    // Write out the buffered messages before esp_restart() resets the chip
+    return esp_register_shutdown_handler(&esp_log_async_flush);
+}
+#endif // CONFIG_LOG_ASYNC
+
 char *esp_log_system_timestamp(void)
 {
     static char buffer[18] = {0};
@@ -17,6 +17,10 @@
 #include <assert.h>
 #include <stdint.h>
 #include "esp_log_private.h"
+#if CONFIG_LOG_ASYNC
+#include <stdbool.h>
+#include <errno.h>
+#endif
 
 static pthread_mutex_t mutex1 = PTHREAD_MUTEX_INITIALIZER;
 
@@ -44,3 +48,69 @@ uint32_t esp_log_timestamp(void)
     uint32_t milliseconds = current_time.tv_sec * 1000 + current_time.tv_nsec / 1000000;
     return milliseconds;
 }
+
+#if CONFIG_LOG_ASYNC
+static pthread_mutex_t s_async_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t s_async_wait_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t s_async_wait_cond = PTHREAD_COND_INITIALIZER;
+static bool s_async_notified = false;
+
+static void *async_thread_func(void *arg)
+{
+    ((void (*)(void *)) arg)(NULL);
+    return NULL;
+}
+
+bool esp_log_impl_async_start(void (*task_func)(void *))
+{
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, &async_thread_func, (void *) task_func) != 0) {
+        return false;
+    }
+    pthread_detach(thread);
+    return true;
+}
+
+void esp_log_impl_async_notify(void)
+{
+    pthread_mutex_lock(&s_async_wait_mutex);
+    s_async_notified = true;
+    pthread_cond_signal(&s_async_wait_cond);
+    pthread_mutex_unlock(&s_async_wait_mutex);
+}
+
+void esp_log_impl_async_wait(uint32_t timeout_ms)
+{
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += timeout_ms / 1000;
+    deadline.tv_nsec += (timeout_ms % 1000) * 1000000;
+    if (deadline.tv_nsec >= 1000000000) {
+        deadline.tv_sec += 1;
+        deadline.tv_nsec -= 1000000000;
+    }
+    pthread_mutex_lock(&s_async_wait_mutex);
+    while (!s_async_notified) {
+        if (pthread_cond_timedwait(&s_async_wait_cond, &s_async_wait_mutex, &deadline) == ETIMEDOUT) {
+            break;
+        }
+    }
+    s_async_notified = false;
+    pthread_mutex_unlock(&s_async_wait_mutex);
+}
+
+void esp_log_impl_async_consumer_lock(void)
+{
+    pthread_mutex_lock(&s_async_mutex);
+}
+
+void esp_log_impl_async_consumer_unlock(void)
+{
+    pthread_mutex_unlock(&s_async_mutex);
+}
+
+static void __attribute__((constructor)) esp_log_async_startup_init(void)
+{
+    (void) esp_log_async_init();
+}
+#endif // CONFIG_LOG_ASYNC
@@ -1,11 +1,55 @@
 # SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
 # SPDX-License-Identifier: Unlicense OR CC0-1.0
 
+import base64
+import os
+import re
+import sys
+
 import pytest
 from pytest_embedded import Dut
 
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), '..'))
+import log_binary_decode  # noqa: E402
+
 
 @pytest.mark.esp32
 @pytest.mark.generic
+@pytest.mark.parametrize(
+    'config',
+    [
+        'default',
+        'binary'
+    ]
+)
 def test_esp_log(dut: Dut) -> None:
     dut.run_all_single_board_cases()
+
+
+@pytest.mark.esp32
+@pytest.mark.generic
+@pytest.mark.parametrize('config', ['binary'], indirect=True)
+def test_esp_log_binary_decode(dut: Dut) -> None:
+    dut.expect_exact('Press ENTER to see the list of tests')
+    dut.write('"binary log records are decoded on the host"')
+    output = dut.expect(re.compile(rb'DECODE_BEGIN(.*?)DECODE_END', re.DOTALL)).group(1)
+    dut.expect_unity_test_output()
+
+    # The records encoded by log_binary.c, decoded with the format strings of the ELF file,
+    # must read the same as the messages formatted by vsnprintf on the target
+    with open(dut.app.elf_file, 'rb') as elf:
+        strings = log_binary_decode.ElfStrings(elf)
+    expected = []
+    decoded = []
+    pending = b''
+    for line in output.splitlines():
+        line = line.rstrip(b'\r')
+        if line.startswith(b'EXPECTED:'):
+            expected.append(line[len(b'EXPECTED:'):].decode() + '\n')
+        elif log_binary_decode.LINE_PREFIX in line:
+            payload = line[line.find(log_binary_decode.LINE_PREFIX) + len(log_binary_decode.LINE_PREFIX):]
+            text, pending = log_binary_decode.decode_records(strings, pending + base64.b64decode(payload))
+            decoded.append(text)
+    assert not pending
+    assert len(expected) == 9
+    assert ''.join(decoded).splitlines(keepends=True) == expected
@@ -17,6 +17,8 @@
 #include <string.h>
 #include <string>
 #include <random>
+#include <map>
+#include <chrono>
 #include "test_fixtures.hpp"
 
 #define TEST_ESP_ERR(rc, res) CHECK((rc) == (res))
@@ -249,9 +251,9 @@ TEST_CASE("Page validates blob size", "[nvs]")
 
 class HashListTestHelper : public nvs::HashList {
 public:
-    size_t getBlockCount()
+    size_t getCapacity()
     {
-        return mBlockList.size();
+        return mCapacity;
     }
 };
 
@@ -266,13 +268,13 @@ TEST_CASE("HashList is cleaned up as soon as items are erased", "[nvs]")
         nvs::Item item(1, nvs::ItemType::U32, 1, key);
         hashlist.insert(item, i);
     }
-    INFO("Added " << count << " items, " << hashlist.getBlockCount() << " blocks");
+    INFO("Added " << count << " items, " << hashlist.getCapacity() << " capacity");
     // Remove them in reverse order
     for (size_t i = count; i > 0; --i) {
         // Make sure that the element existed before it's erased
         CHECK(hashlist.erase(i - 1) == true);
     }
-    CHECK(hashlist.getBlockCount() == 0);
+    CHECK(hashlist.getCapacity() == 0);
     // Add again
     for (size_t i = 0; i < count; ++i) {
         char key[16];
@@ -280,12 +282,12 @@ TEST_CASE("HashList is cleaned up as soon as items are erased", "[nvs]")
         nvs::Item item(1, nvs::ItemType::U32, 1, key);
         hashlist.insert(item, i);
     }
-    INFO("Added " << count << " items, " << hashlist.getBlockCount() << " blocks");
+    INFO("Added " << count << " items, " << hashlist.getCapacity() << " capacity");
     // Remove them in the same order
     for (size_t i = 0; i < count; ++i) {
         CHECK(hashlist.erase(i) == true);
     }
-    CHECK(hashlist.getBlockCount() == 0);
+    CHECK(hashlist.getCapacity() == 0);
 }
 
 TEST_CASE("can init PageManager in empty flash", "[nvs]")
@@ -3320,6 +3322,567 @@ TEST_CASE("nvs multiple write with same key but different types", "[nvs][xxx]")
 }
 
 
+TEST_CASE("nvs transaction stages changes until commit", "[nvs]")
+{
+    PartitionEmulationFixture f(0, 5);
+    TEST_ESP_OK(nvs::NVSPartitionManager::get_instance()->init_custom(f.part(), 0, 5));
+
+    nvs_handle_t handle;
+    TEST_ESP_OK(nvs_open("test", NVS_READWRITE, &handle));
+    TEST_ESP_OK(nvs_set_u32(handle, "a", 1));
+    TEST_ESP_OK(nvs_set_str(handle, "erased", "value"));
+
+    TEST_ESP_ERR(nvs_transaction_commit(handle), ESP_ERR_NVS_INVALID_STATE);
+    TEST_ESP_ERR(nvs_transaction_abort(handle), ESP_ERR_NVS_INVALID_STATE);
+
+    TEST_ESP_OK(nvs_transaction_begin(handle));
+    TEST_ESP_ERR(nvs_transaction_begin(handle), ESP_ERR_NVS_INVALID_STATE);
+    TEST_ESP_ERR(nvs_erase_all(handle), ESP_ERR_NVS_INVALID_STATE);
+    TEST_ESP_ERR(nvs_set_u8(handle, "key_is_too_long_", 1), ESP_ERR_NVS_KEY_TOO_LONG);
+
+    esp_partition_clear_stats();
+    TEST_ESP_OK(nvs_set_u32(handle, "a", 2));
+    TEST_ESP_OK(nvs_set_u32(handle, "a", 3));
+    TEST_ESP_OK(nvs_set_i8(handle, "b", -1));
+    TEST_ESP_OK(nvs_set_str(handle, "str", "hello"));
+    uint8_t blob[nvs::Page::CHUNK_MAX_SIZE + 64];
+    memset(blob, 0xff, sizeof(blob));
+    TEST_ESP_OK(nvs_set_blob(handle, "blob", blob, sizeof(blob)));
+    TEST_ESP_OK(nvs_erase_key(handle, "erased"));
+    TEST_ESP_OK(nvs_erase_key(handle, "missing"));
+    CHECK(esp_partition_get_write_ops() == 0);
+
+    // staged changes are not visible before commit
+    uint32_t u32 = 0;
+    TEST_ESP_OK(nvs_get_u32(handle, "a", &u32));
+    CHECK(u32 == 1);
+    int8_t i8 = 0;
+    TEST_ESP_ERR(nvs_get_i8(handle, "b", &i8), ESP_ERR_NVS_NOT_FOUND);
+
+    TEST_ESP_OK(nvs_transaction_commit(handle));
+    TEST_ESP_ERR(nvs_transaction_commit(handle), ESP_ERR_NVS_INVALID_STATE);
+
+    // changes dropped by abort are not written
+    TEST_ESP_OK(nvs_transaction_begin(handle));
+    TEST_ESP_OK(nvs_set_u32(handle, "a", 4));
+    TEST_ESP_OK(nvs_set_u8(handle, "c", 1));
+    TEST_ESP_OK(nvs_transaction_abort(handle));
+    nvs_close(handle);
+    TEST_ESP_OK(nvs_flash_deinit_partition(f.part()->get_partition_name()));
+
+    TEST_ESP_OK(nvs::NVSPartitionManager::get_instance()->init_custom(f.part(), 0, 5));
+    TEST_ESP_OK(nvs_open("test", NVS_READONLY, &handle));
+    TEST_ESP_ERR(nvs_transaction_begin(handle), ESP_ERR_NVS_READ_ONLY);
+    // the name of the commit marker is reserved
+    nvs_handle_t markerHandle;
+    TEST_ESP_ERR(nvs_open("nvs.commit", NVS_READWRITE, &markerHandle), ESP_ERR_NVS_INVALID_NAME);
+    TEST_ESP_OK(nvs_get_u32(handle, "a", &u32));
+    CHECK(u32 == 3);
+    TEST_ESP_OK(nvs_get_i8(handle, "b", &i8));
+    CHECK(i8 == -1);
+    char str[16];
+    size_t len = sizeof(str);
+    TEST_ESP_OK(nvs_get_str(handle, "str", str, &len));
+    CHECK(strcmp(str, "hello") == 0);
+    uint8_t readBlob[sizeof(blob)];
+    len = sizeof(readBlob);
+    TEST_ESP_OK(nvs_get_blob(handle, "blob", readBlob, &len));
+    CHECK(memcmp(blob, readBlob, sizeof(blob)) == 0);
+    len = sizeof(str);
+    TEST_ESP_ERR(nvs_get_str(handle, "erased", str, &len), ESP_ERR_NVS_NOT_FOUND);
+    uint8_t u8;
+    TEST_ESP_ERR(nvs_get_u8(handle, "c", &u8), ESP_ERR_NVS_NOT_FOUND);
+    nvs_close(handle);
+    TEST_ESP_OK(nvs_flash_deinit_partition(f.part()->get_partition_name()));
+}
+
+TEST_CASE("nvs transactions spanning several pages keep storage consistent", "[nvs]")
+{
+    const uint32_t SECTOR_COUNT = 4;
+    const size_t KEY_COUNT = 150;
+    PartitionEmulationFixture f(0, SECTOR_COUNT);
+    TEST_ESP_OK(nvs::NVSPartitionManager::get_instance()->init_custom(f.part(), 0, SECTOR_COUNT));
+
+    nvs_handle_t handle;
+    TEST_ESP_OK(nvs_open("test", NVS_READWRITE, &handle));
+    char key[nvs::Item::MAX_KEY_LENGTH + 1];
+    char str[32];
+    for (uint32_t round = 0; round < 10; ++round) {
+        TEST_ESP_OK(nvs_transaction_begin(handle));
+        for (size_t i = 0; i < KEY_COUNT; ++i) {
+            snprintf(key, sizeof(key), "key%u", static_cast<unsigned>(i));
+            if (i % 5 == 0) {
+                snprintf(str, sizeof(str), "value of %u in %u", static_cast<unsigned>(i), round);
+                TEST_ESP_OK(nvs_set_str(handle, key, str));
+            } else {
+                TEST_ESP_OK(nvs_set_u32(handle, key, round * 1000 + i));
+            }
+        }
+        TEST_ESP_OK(nvs_transaction_commit(handle));
+
+        for (size_t i = 0; i < KEY_COUNT; ++i) {
+            snprintf(key, sizeof(key), "key%u", static_cast<unsigned>(i));
+            if (i % 5 == 0) {
+                char expected[32];
+                snprintf(expected, sizeof(expected), "value of %u in %u", static_cast<unsigned>(i), round);
+                size_t len = sizeof(str);
+                TEST_ESP_OK(nvs_get_str(handle, key, str, &len));
+                CHECK(strcmp(str, expected) == 0);
+            } else {
+                uint32_t value = 0;
+                TEST_ESP_OK(nvs_get_u32(handle, key, &value));
+                CHECK(value == round * 1000 + i);
+            }
+        }
+    }
+
+    size_t used = 0;
+    TEST_ESP_OK(nvs_get_used_entry_count(handle, &used));
+    CHECK(used == KEY_COUNT + (KEY_COUNT / 5) * 1);
+    nvs_close(handle);
+    TEST_ESP_OK(nvs_flash_deinit_partition(f.part()->get_partition_name()));
+
+    // no duplicates or lost items after reloading
+    TEST_ESP_OK(nvs::NVSPartitionManager::get_instance()->init_custom(f.part(), 0, SECTOR_COUNT));
+    TEST_ESP_OK(nvs_open("test", NVS_READONLY, &handle));
+    TEST_ESP_OK(nvs_get_used_entry_count(handle, &used));
+    CHECK(used == KEY_COUNT + (KEY_COUNT / 5) * 1);
+    uint32_t value = 0;
+    TEST_ESP_OK(nvs_get_u32(handle, "key1", &value));
+    CHECK(value == 9001);
+    nvs_close(handle);
+    TEST_ESP_OK(nvs_flash_deinit_partition(f.part()->get_partition_name()));
+}
+
+TEST_CASE("nvs transaction leaves either old or new values after power-off during commit", "[nvs]")
+{
+    const uint32_t SECTOR_COUNT = 4;
+    const size_t KEY_COUNT = 60;
+    char key[nvs::Item::MAX_KEY_LENGTH + 1];
+
+    for (size_t errDelay = 0; ; ++errDelay) {
+        INFO(errDelay);
+        PartitionEmulationFixture f(0, SECTOR_COUNT);
+        TEST_ESP_OK(nvs::NVSPartitionManager::get_instance()->init_custom(f.part(), 0, SECTOR_COUNT));
+        nvs_handle_t handle;
+        TEST_ESP_OK(nvs_open("test", NVS_READWRITE, &handle));
+        for (size_t i = 0; i < KEY_COUNT; ++i) {
+            snprintf(key, sizeof(key), "key%u", static_cast<unsigned>(i));
+            TEST_ESP_OK(nvs_set_u32(handle, key, i));
+        }
+
+        TEST_ESP_OK(nvs_transaction_begin(handle));
+        for (size_t i = 0; i < KEY_COUNT; ++i) {
+            snprintf(key, sizeof(key), "key%u", static_cast<unsigned>(i));
+            TEST_ESP_OK(nvs_set_u32(handle, key, i + 1000));
+        }
+        TEST_ESP_OK(nvs_set_str(handle, "new", "string"));
+        esp_partition_clear_stats();
+        esp_partition_fail_after(errDelay, ESP_PARTITION_FAIL_AFTER_MODE_BOTH);
+        esp_err_t commitErr = nvs_transaction_commit(handle);
+        esp_partition_fail_after(SIZE_MAX, ESP_PARTITION_FAIL_AFTER_MODE_BOTH);
+        nvs_close(handle);
+        TEST_ESP_OK(nvs_flash_deinit_partition(f.part()->get_partition_name()));
+
+        TEST_ESP_OK(nvs::NVSPartitionManager::get_instance()->init_custom(f.part(), 0, SECTOR_COUNT));
+        TEST_ESP_OK(nvs_open("test", NVS_READWRITE, &handle));
+        size_t updated = 0;
+        for (size_t i = 0; i < KEY_COUNT; ++i) {
+            snprintf(key, sizeof(key), "key%u", static_cast<unsigned>(i));
+            uint32_t value = 0;
+            TEST_ESP_OK(nvs_get_u32(handle, key, &value));
+            CHECK((value == i || value == i + 1000));
+            if (value == i + 1000) {
+                ++updated;
+            }
+        }
+        size_t used = 0;
+        TEST_ESP_OK(nvs_get_used_entry_count(handle, &used));
+        char str[16];
+        size_t len = sizeof(str);
+        esp_err_t strErr = nvs_get_str(handle, "new", str, &len);
+        CHECK(used == KEY_COUNT + (strErr == ESP_OK ? 2 : 0));
+
+        // storage remains writable
+        TEST_ESP_OK(nvs_set_u32(handle, "key0", 42));
+        nvs_close(handle);
+        TEST_ESP_OK(nvs_flash_deinit_partition(f.part()->get_partition_name()));
+
+        if (commitErr == ESP_OK) {
+            CHECK(updated == KEY_COUNT);
+            CHECK(strErr == ESP_OK);
+            break;
+        }
+    }
+}
+
+TEST_CASE("nvs transaction spanning pages leaves no duplicates after power-off at any write or erase", "[nvs]")
+{
+    const uint32_t SECTOR_COUNT = 5;
+    const size_t KEY_COUNT = 100;
+    char key[nvs::Item::MAX_KEY_LENGTH + 1];
+
+    for (size_t errDelay = 0; ; ++errDelay) {
+        INFO(errDelay);
+        PartitionEmulationFixture f(0, SECTOR_COUNT);
+        TEST_ESP_OK(nvs::NVSPartitionManager::get_instance()->init_custom(f.part(), 0, SECTOR_COUNT));
+        nvs_handle_t handle;
+        TEST_ESP_OK(nvs_open("test", NVS_READWRITE, &handle));
+        for (size_t i = 0; i < KEY_COUNT; ++i) {
+            snprintf(key, sizeof(key), "key%u", static_cast<unsigned>(i));
+            TEST_ESP_OK(nvs_set_u32(handle, key, i));
+        }
+
+        // the first page only has room for some of the new values, the old versions of the
+        // values written to the second page are erased from the first one after they are written
+        TEST_ESP_OK(nvs_transaction_begin(handle));
+        for (size_t i = 0; i < KEY_COUNT; ++i) {
+            snprintf(key, sizeof(key), "key%u", static_cast<unsigned>(i));
+            TEST_ESP_OK(nvs_set_u32(handle, key, i + 1000));
+        }
+        esp_partition_clear_stats();
+        esp_partition_fail_after(errDelay, ESP_PARTITION_FAIL_AFTER_MODE_BOTH);
+        esp_err_t commitErr = nvs_transaction_commit(handle);
+        esp_partition_fail_after(SIZE_MAX, ESP_PARTITION_FAIL_AFTER_MODE_BOTH);
+        nvs_close(handle);
+        TEST_ESP_OK(nvs_flash_deinit_partition(f.part()->get_partition_name()));
+
+        uint32_t values[KEY_COUNT];
+        for (int load = 0; load < 2; ++load) {
+            TEST_ESP_OK(nvs::NVSPartitionManager::get_instance()->init_custom(f.part(), 0, SECTOR_COUNT));
+            TEST_ESP_OK(nvs_open("test", NVS_READWRITE, &handle));
+            size_t updated = 0;
+            for (size_t i = 0; i < KEY_COUNT; ++i) {
+                snprintf(key, sizeof(key), "key%u", static_cast<unsigned>(i));
+                uint32_t value = 0;
+                TEST_ESP_OK(nvs_get_u32(handle, key, &value));
+                CHECK((value == i || value == i + 1000));
+                if (load == 0) {
+                    values[i] = value;
+                } else {
+                    // the recovery at the first load kept the values which had been read
+                    CHECK(value == values[i]);
+                }
+                if (value == i + 1000) {
+                    ++updated;
+                }
+            }
+            if (commitErr == ESP_OK) {
+                CHECK(updated == KEY_COUNT);
+            }
+
+            // no key has more than one item
+            size_t used = 0;
+            TEST_ESP_OK(nvs_get_used_entry_count(handle, &used));
+            CHECK(used == KEY_COUNT);
+            size_t found = 0;
+            nvs_iterator_t it = nullptr;
+            esp_err_t itErr = nvs_entry_find(f.part()->get_partition_name(), "test", NVS_TYPE_ANY, &it);
+            for (; itErr == ESP_OK; itErr = nvs_entry_next(&it)) {
+                ++found;
+            }
+            nvs_release_iterator(it);
+            CHECK(found == KEY_COUNT);
+            // the namespace entry, the commit marker has been erased
+            nvs_stats_t stats;
+            TEST_ESP_OK(nvs_get_stats(f.part()->get_partition_name(), &stats));
+            CHECK(stats.used_entries == KEY_COUNT + 1);
+            nvs_close(handle);
+            TEST_ESP_OK(nvs_flash_deinit_partition(f.part()->get_partition_name()));
+        }
+
+        // storage remains writable
+        TEST_ESP_OK(nvs::NVSPartitionManager::get_instance()->init_custom(f.part(), 0, SECTOR_COUNT));
+        TEST_ESP_OK(nvs_open("test", NVS_READWRITE, &handle));
+        TEST_ESP_OK(nvs_set_u32(handle, "key0", 42));
+        uint32_t value = 0;
+        TEST_ESP_OK(nvs_get_u32(handle, "key0", &value));
+        CHECK(value == 42);
+        nvs_close(handle);
+        TEST_ESP_OK(nvs_flash_deinit_partition(f.part()->get_partition_name()));
+
+        if (commitErr == ESP_OK) {
+            break;
+        }
+    }
+}
+
+TEST_CASE("nvs reads stay coherent with interleaved writes through several handles", "[nvs]")
+{
+    const uint32_t SECTOR_COUNT = 4;
+    const size_t KEY_COUNT = 48;
+    PartitionEmulationFixture f(0, SECTOR_COUNT);
+    TEST_ESP_OK(nvs::NVSPartitionManager::get_instance()->init_custom(f.part(), 0, SECTOR_COUNT));
+
+    nvs_handle_t handles[3];
+    TEST_ESP_OK(nvs_open("ns1", NVS_READWRITE, &handles[0]));
+    TEST_ESP_OK(nvs_open("ns1", NVS_READWRITE, &handles[1]));
+    TEST_ESP_OK(nvs_open("ns2", NVS_READWRITE, &handles[2]));
+
+    // expected contents of each namespace, missing if erased; even keys hold u32 values, odd keys strings
+    std::map<std::string, std::string> expected[2];
+    std::mt19937 gen(42);
+    char key[nvs::Item::MAX_KEY_LENGTH + 1];
+    char str[64];
+
+    for (size_t step = 0; step < 5000; ++step) {
+        size_t h = gen() % 3;
+        size_t ns = (h == 2) ? 1 : 0;
+        size_t k = gen() % KEY_COUNT;
+        snprintf(key, sizeof(key), "key%u", static_cast<unsigned>(k));
+        uint32_t op = gen() % 100;
+        auto found = expected[ns].find(key);
+
+        if (op < 60) {
+            // mostly reads, so that values are served from the cache
+            if (found == expected[ns].end()) {
+                uint32_t value;
+                TEST_ESP_ERR(nvs_get_u32(handles[h], key, &value), ESP_ERR_NVS_NOT_FOUND);
+                size_t len = sizeof(str);
+                TEST_ESP_ERR(nvs_get_str(handles[h], key, str, &len), ESP_ERR_NVS_NOT_FOUND);
+            } else if (k % 2) {
+                size_t len = sizeof(str);
+                TEST_ESP_OK(nvs_get_str(handles[h], key, str, &len));
+                CHECK(found->second == str);
+                CHECK(len == found->second.size() + 1);
+                uint32_t value;
+                TEST_ESP_ERR(nvs_get_u32(handles[h], key, &value), ESP_ERR_NVS_NOT_FOUND);
+            } else {
+                uint32_t value = 0;
+                TEST_ESP_OK(nvs_get_u32(handles[h], key, &value));
+                CHECK(std::to_string(value) == found->second);
+                uint16_t wrongType;
+                TEST_ESP_ERR(nvs_get_u16(handles[h], key, &wrongType), ESP_ERR_NVS_NOT_FOUND);
+            }
+        } else if (op < 90 && k % 2 == 0) {
+            uint32_t value = gen();
+            TEST_ESP_OK(nvs_set_u32(handles[h], key, value));
+            expected[ns][key] = std::to_string(value);
+        } else if (op < 90) {
+            // strings of up to 40 characters, some of them too long to be cached
+            std::string value = "s" + std::string(gen() % 40, 'a' + step % 26);
+            TEST_ESP_OK(nvs_set_str(handles[h], key, value.c_str()));
+            expected[ns][key] = value;
+        } else if (op < 97) {
+            TEST_ESP_ERR(nvs_erase_key(handles[h], key), (found == expected[ns].end()) ? ESP_ERR_NVS_NOT_FOUND : ESP_OK);
+            expected[ns].erase(key);
+        } else if (op < 99) {
+            // the next even and odd key in one transaction
+            snprintf(key, sizeof(key), "key%u", static_cast<unsigned>(k & ~1));
+            char strKey[nvs::Item::MAX_KEY_LENGTH + 1];
+            snprintf(strKey, sizeof(strKey), "key%u", static_cast<unsigned>(k | 1));
+            uint32_t value = gen();
+            std::string strValue = "s" + std::to_string(value);
+            TEST_ESP_OK(nvs_transaction_begin(handles[h]));
+            TEST_ESP_OK(nvs_set_u32(handles[h], key, value));
+            TEST_ESP_OK(nvs_set_str(handles[h], strKey, strValue.c_str()));
+            TEST_ESP_OK(nvs_transaction_commit(handles[h]));
+            expected[ns][key] = std::to_string(value);
+            expected[ns][strKey] = strValue;
+        } else {
+            TEST_ESP_OK(nvs_erase_all(handles[h]));
+            expected[ns].clear();
+        }
+    }
+
+    nvs_cache_stats_t stats;
+    TEST_ESP_ERR(nvs_get_cache_stats(NULL, NULL), ESP_ERR_INVALID_ARG);
+    TEST_ESP_OK(nvs_get_cache_stats(f.part()->get_partition_name(), &stats));
+#ifdef CONFIG_NVS_VALUE_CACHE
+    CHECK(stats.total_entries == CONFIG_NVS_VALUE_CACHE_ENTRIES);
+    CHECK(stats.used_entries <= stats.total_entries);
+    CHECK(stats.hits > 0);
+    CHECK(stats.misses > 0);
+
+    // once cached, reading a value again doesn't touch flash
+    TEST_ESP_OK(nvs_set_u32(handles[0], "hot", 123));
+    uint32_t value = 0;
+    TEST_ESP_OK(nvs_get_u32(handles[0], "hot", &value));
+    esp_partition_clear_stats();
+    for (int i = 0; i < 100; ++i) {
+        TEST_ESP_OK(nvs_get_u32(handles[1], "hot", &value));
+        CHECK(value == 123);
+    }
+    CHECK(esp_partition_get_read_ops() == 0);
+    nvs_cache_stats_t after;
+    TEST_ESP_OK(nvs_get_cache_stats(f.part()->get_partition_name(), &after));
+    CHECK(after.hits == stats.hits + 100);
+    CHECK(after.misses == stats.misses + 1);
+#else
+    CHECK(stats.total_entries == 0);
+    CHECK(stats.hits == 0);
+#endif // CONFIG_NVS_VALUE_CACHE
+
+    for (auto& handle : handles) {
+        nvs_close(handle);
+    }
+    TEST_ESP_OK(nvs_flash_deinit_partition(f.part()->get_partition_name()));
+}
+
+TEST_CASE("benchmark item lookup depending on number of keys", "[nvs]")
+{
+    const uint32_t SECTOR_COUNT = 64; // 256 KB partition
+    const size_t keyCounts[] = {64, 256, 1024, 2048};
+    char key[nvs::Item::MAX_KEY_LENGTH + 1];
+
+    for (size_t keyCount : keyCounts) {
+        PartitionEmulationFixture f(0, SECTOR_COUNT);
+        {
+            nvs::Storage storage(f.part());
+            TEST_ESP_OK(storage.init(0, SECTOR_COUNT));
+            for (size_t i = 0; i < keyCount; ++i) {
+                snprintf(key, sizeof(key), "key%u", static_cast<unsigned>(i));
+                TEST_ESP_OK(storage.writeItem(1, key, static_cast<uint32_t>(i)));
+            }
+        }
+
+        // measure on freshly loaded storage, the same way as after a reboot
+        nvs::Storage storage(f.part());
+        TEST_ESP_OK(storage.init(0, SECTOR_COUNT));
+
+        esp_partition_clear_stats();
+        size_t mismatches = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < keyCount; ++i) {
+            snprintf(key, sizeof(key), "key%u", static_cast<unsigned>(i));
+            uint32_t value = 0;
+            if (storage.readItem(1, key, value) != ESP_OK || value != i) {
+                ++mismatches;
+            }
+        }
+        auto hitTime = std::chrono::steady_clock::now() - start;
+        size_t hitReads = esp_partition_get_read_ops();
+
+        esp_partition_clear_stats();
+        start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < keyCount; ++i) {
+            snprintf(key, sizeof(key), "miss%u", static_cast<unsigned>(i));
+            uint32_t value;
+            if (storage.readItem(1, key, value) != ESP_ERR_NVS_NOT_FOUND) {
+                ++mismatches;
+            }
+        }
+        auto missTime = std::chrono::steady_clock::now() - start;
+        size_t missReads = esp_partition_get_read_ops();
+
+        CHECK(mismatches == 0);
+        s_perf << "Lookup with " << keyCount << " keys: hit "
+               << std::chrono::duration_cast<std::chrono::nanoseconds>(hitTime).count() / keyCount << " ns ("
+               << hitReads / keyCount << " reads), miss "
+               << std::chrono::duration_cast<std::chrono::nanoseconds>(missTime).count() / keyCount << " ns ("
+               << missReads / keyCount << " reads) per key" << std::endl;
+    }
+}
+
+TEST_CASE("benchmark flash operations of transactions", "[nvs]")
+{
+    const uint32_t SECTOR_COUNT = 16;
+    const size_t keyCounts[] = {50, 100, 200};
+    char key[nvs::Item::MAX_KEY_LENGTH + 1];
+
+    for (size_t keyCount : keyCounts) {
+        for (int useTransaction = 0; useTransaction < 2; ++useTransaction) {
+            PartitionEmulationFixture f(0, SECTOR_COUNT);
+            TEST_ESP_OK(nvs::NVSPartitionManager::get_instance()->init_custom(f.part(), 0, SECTOR_COUNT));
+            nvs_handle_t handle;
+            TEST_ESP_OK(nvs_open("bench", NVS_READWRITE, &handle));
+            for (size_t i = 0; i < keyCount; ++i) {
+                snprintf(key, sizeof(key), "key%u", static_cast<unsigned>(i));
+                TEST_ESP_OK(nvs_set_u32(handle, key, i));
+            }
+
+            // update all keys, so that old values have to be erased as well
+            esp_partition_clear_stats();
+            auto start = std::chrono::steady_clock::now();
+            if (useTransaction) {
+                TEST_ESP_OK(nvs_transaction_begin(handle));
+            }
+            for (size_t i = 0; i < keyCount; ++i) {
+                snprintf(key, sizeof(key), "key%u", static_cast<unsigned>(i));
+                TEST_ESP_OK(nvs_set_u32(handle, key, i + 1));
+                if (!useTransaction) {
+                    TEST_ESP_OK(nvs_commit(handle));
+                }
+            }
+            if (useTransaction) {
+                TEST_ESP_OK(nvs_transaction_commit(handle));
+            }
+            auto elapsed = std::chrono::steady_clock::now() - start;
+
+            s_perf << "Update of " << keyCount << " keys " << (useTransaction ? "in a transaction" : "one by one")
+                   << ": " << esp_partition_get_write_ops() << " writes (" << esp_partition_get_write_bytes() << " bytes), "
+                   << esp_partition_get_erase_ops() << " erases, " << esp_partition_get_read_ops() << " reads, "
+                   << std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count() << " us" << std::endl;
+
+            for (size_t i = 0; i < keyCount; ++i) {
+                snprintf(key, sizeof(key), "key%u", static_cast<unsigned>(i));
+                uint32_t value = 0;
+                TEST_ESP_OK(nvs_get_u32(handle, key, &value));
+                CHECK(value == i + 1);
+            }
+            nvs_close(handle);
+            TEST_ESP_OK(nvs_flash_deinit_partition(f.part()->get_partition_name()));
+        }
+    }
+}
+
+TEST_CASE("benchmark initialization time depending on partition size", "[nvs]")
+{
+    // 12 KB to 1 MB partitions, the first half of the pages is full of items
+    const uint32_t sectorCounts[] = {3, 16, 64, 256};
+    char key[nvs::Item::MAX_KEY_LENGTH + 1];
+
+    for (uint32_t sectorCount : sectorCounts) {
+        PartitionEmulationFixture f(0, sectorCount);
+        TEST_ESP_OK(esp_partition_erase_range(f.get_esp_partition(), 0, sectorCount * SPI_FLASH_SEC_SIZE));
+        size_t itemCount = 0;
+        for (uint32_t sector = 0; sector < std::max(sectorCount / 2, 1u); ++sector) {
+            nvs::Page p;
+            TEST_ESP_OK(p.load(f.part(), sector));
+            TEST_ESP_OK(p.setSeqNumber(sector));
+            while (true) {
+                snprintf(key, sizeof(key), "key%u", static_cast<unsigned>(itemCount));
+                esp_err_t err = p.writeItem<uint32_t>(1, key, itemCount);
+                if (err == ESP_ERR_NVS_PAGE_FULL) {
+                    break;
+                }
+                TEST_ESP_OK(err);
+                ++itemCount;
+            }
+            TEST_ESP_OK(p.markFull());
+        }
+        snprintf(key, sizeof(key), "key%u", static_cast<unsigned>(itemCount - 1));
+
+        esp_partition_clear_stats();
+        {
+            nvs::Storage storage(f.part());
+            TEST_ESP_OK(storage.init(0, sectorCount, false));
+        }
+        size_t eagerTime = esp_partition_get_total_time();
+        size_t eagerReads = esp_partition_get_read_bytes();
+
+        nvs::Storage storage(f.part());
+        esp_partition_clear_stats();
+        TEST_ESP_OK(storage.init(0, sectorCount, true));
+        size_t lazyTime = esp_partition_get_total_time();
+        size_t lazyReads = esp_partition_get_read_bytes();
+        CHECK(storage.isLoadPending());
+
+        // the first access loads the remaining pages
+        esp_partition_clear_stats();
+        uint32_t value = 0;
+        TEST_ESP_OK(storage.readItem(1, key, value));
+        CHECK(value == itemCount - 1);
+        CHECK(!storage.isLoadPending());
+        size_t firstAccessTime = esp_partition_get_total_time();
+
+        s_perf << "Initialization of " << sectorCount * 4 << " KB partition with " << itemCount << " items: "
+               << eagerTime << " us (" << eagerReads << " bytes read), lazy " << lazyTime << " us ("
+               << lazyReads << " bytes read), first access after lazy initialization " << firstAccessTime << " us"
+               << std::endl;
+    }
+}
+
 /* Add new tests above */
 /* This test has to be the final one */
 
@@ -43,3 +43,122 @@ TEST_CASE("Storage iterator recognizes blob with VerOffset::VER_1_OFFSET", "[nvs
 
     REQUIRE(nvs::NVSPartitionManager::get_instance()->deinit_partition("test") == ESP_OK);
 }
+
+TEST_CASE("Storage finds items after pages are reclaimed and namespaces erased", "[nvs_storage]")
+{
+    const uint32_t NVS_FLASH_SECTOR_COUNT = 4;
+    PartitionEmulationFixture f(0, NVS_FLASH_SECTOR_COUNT);
+    nvs::Storage storage(f.part());
+    REQUIRE(storage.init(0, NVS_FLASH_SECTOR_COUNT) == ESP_OK);
+
+    const size_t KEY_COUNT = 40;
+    char key[nvs::Item::MAX_KEY_LENGTH + 1];
+    uint8_t blob[nvs::Page::CHUNK_MAX_SIZE / 3];
+
+    // rewrite the same keys often enough to make the page manager reclaim pages several times
+    for (uint32_t round = 0; round < 20; ++round) {
+        for (size_t i = 0; i < KEY_COUNT; ++i) {
+            snprintf(key, sizeof(key), "key%u", static_cast<unsigned>(i));
+            CHECK(storage.writeItem(1 + i % 2, key, round * 1000 + static_cast<uint32_t>(i)) == ESP_OK);
+        }
+        std::fill_n(blob, sizeof(blob), static_cast<uint8_t>(round));
+        CHECK(storage.writeItem(1, nvs::ItemType::BLOB, "blob", blob, sizeof(blob)) == ESP_OK);
+    }
+
+    for (size_t i = 0; i < KEY_COUNT; ++i) {
+        snprintf(key, sizeof(key), "key%u", static_cast<unsigned>(i));
+        uint32_t value = 0;
+        CHECK(storage.readItem(1 + i % 2, key, value) == ESP_OK);
+        CHECK(value == 19 * 1000 + i);
+    }
+    uint8_t readBlob[sizeof(blob)];
+    CHECK(storage.readItem(1, nvs::ItemType::BLOB, "blob", readBlob, sizeof(readBlob)) == ESP_OK);
+    CHECK(std::all_of(readBlob, readBlob + sizeof(readBlob), [](uint8_t v) { return v == 19; }));
+
+    CHECK(storage.eraseNamespace(2) == ESP_OK);
+    for (size_t i = 0; i < KEY_COUNT; ++i) {
+        snprintf(key, sizeof(key), "key%u", static_cast<unsigned>(i));
+        uint32_t value = 0;
+        CHECK(storage.readItem(1 + i % 2, key, value) == ((i % 2) ? ESP_ERR_NVS_NOT_FOUND : ESP_OK));
+    }
+
+    // items are still found after reloading from flash
+    nvs::Storage reloaded(f.part());
+    REQUIRE(reloaded.init(0, NVS_FLASH_SECTOR_COUNT) == ESP_OK);
+    for (size_t i = 0; i < KEY_COUNT; i += 2) {
+        snprintf(key, sizeof(key), "key%u", static_cast<unsigned>(i));
+        uint32_t value = 0;
+        CHECK(reloaded.readItem(1, key, value) == ESP_OK);
+        CHECK(value == 19 * 1000 + i);
+    }
+}
+
+TEST_CASE("Storage loads pages lazily", "[nvs_storage]")
+{
+    const uint32_t NVS_FLASH_SECTOR_COUNT = 8;
+    PartitionEmulationFixture f(0, NVS_FLASH_SECTOR_COUNT);
+    const size_t KEY_COUNT = 300;
+    char key[nvs::Item::MAX_KEY_LENGTH + 1];
+    uint8_t blob[nvs::Page::CHUNK_MAX_SIZE + 100];
+    std::fill_n(blob, sizeof(blob), 0x5a);
+    uint8_t nsIndex = 0;
+    nvs_stats_t eagerStats;
+    {
+        nvs::Storage storage(f.part());
+        REQUIRE(storage.init(0, NVS_FLASH_SECTOR_COUNT, false) == ESP_OK);
+        CHECK(!storage.isLoadPending());
+        REQUIRE(storage.createOrOpenNamespace("lazy", true, nsIndex) == ESP_OK);
+        for (size_t i = 0; i < KEY_COUNT; ++i) {
+            snprintf(key, sizeof(key), "key%u", static_cast<unsigned>(i));
+            CHECK(storage.writeItem(nsIndex, key, static_cast<uint32_t>(i)) == ESP_OK);
+        }
+        CHECK(storage.writeItem(nsIndex, nvs::ItemType::BLOB, "blob", blob, sizeof(blob)) == ESP_OK);
+        CHECK(storage.fillStats(eagerStats) == ESP_OK);
+    }
+
+    // only page headers are read by init
+    nvs::Storage storage(f.part());
+    esp_partition_clear_stats();
+    REQUIRE(storage.init(0, NVS_FLASH_SECTOR_COUNT, true) == ESP_OK);
+    CHECK(esp_partition_get_read_ops() == NVS_FLASH_SECTOR_COUNT);
+    CHECK(esp_partition_get_write_ops() == 0);
+    CHECK(storage.isValid());
+
+    size_t steps = 0;
+    while (storage.isLoadPending()) {
+        REQUIRE(storage.loadPendingPages(1) == ESP_OK);
+        ++steps;
+    }
+    CHECK(steps == NVS_FLASH_SECTOR_COUNT);
+
+    uint8_t loadedNsIndex = 0;
+    CHECK(storage.createOrOpenNamespace("lazy", false, loadedNsIndex) == ESP_OK);
+    CHECK(loadedNsIndex == nsIndex);
+    for (size_t i = 0; i < KEY_COUNT; ++i) {
+        snprintf(key, sizeof(key), "key%u", static_cast<unsigned>(i));
+        uint32_t value = 0;
+        CHECK(storage.readItem(nsIndex, key, value) == ESP_OK);
+        CHECK(value == i);
+    }
+    uint8_t readBlob[sizeof(blob)];
+    CHECK(storage.readItem(nsIndex, nvs::ItemType::BLOB, "blob", readBlob, sizeof(readBlob)) == ESP_OK);
+    CHECK(memcmp(blob, readBlob, sizeof(blob)) == 0);
+    nvs_stats_t lazyStats;
+    CHECK(storage.fillStats(lazyStats) == ESP_OK);
+    CHECK(lazyStats.used_entries == eagerStats.used_entries);
+    CHECK(lazyStats.free_entries == eagerStats.free_entries);
+    CHECK(lazyStats.namespace_count == eagerStats.namespace_count);
+
+    // without loadPendingPages(), the first operation loads all pages
+    nvs::Storage other(f.part());
+    REQUIRE(other.init(0, NVS_FLASH_SECTOR_COUNT, true) == ESP_OK);
+    CHECK(other.isLoadPending());
+    CHECK(other.writeItem(nsIndex, "key0", static_cast<uint32_t>(1000)) == ESP_OK);
+    CHECK(!other.isLoadPending());
+    uint32_t value = 0;
+    CHECK(other.readItem(nsIndex, "key0", value) == ESP_OK);
+    CHECK(value == 1000);
+    size_t usedEntries = 0;
+    CHECK(other.calcEntriesInNamespace(nsIndex, usedEntries) == ESP_OK);
+    CHECK(usedEntries == eagerStats.used_entries - 1);
+}
@@ -6,6 +6,7 @@
 static const char* TAG = "nvs_page_host_test";
 
 #include <stdio.h>
+#include <chrono>
 #include "unity.h"
 #include "test_fixtures.hpp"
 #include "esp_log.h"
@@ -906,6 +907,72 @@ void test_Page_calcEntries__invalid()
     TEST_ASSERT_EQUAL(0, nvsStats.namespace_count);
 }
 
+class HashListBenchHelper : public HashList {
+public:
+    size_t capacity() const
+    {
+        return mCapacity;
+    }
+};
+
+void test_HashList_benchmark__full_page()
+{
+    const size_t ROUNDS = 2000;
+    const size_t COUNT = Page::ENTRY_COUNT;
+
+    Item items[COUNT];
+    Item missing[COUNT];
+    for (size_t i = 0; i < COUNT; ++i) {
+        char key[Item::MAX_KEY_LENGTH + 1];
+        snprintf(key, sizeof(key), "key_%d", (int) i);
+        items[i] = Item(1, ItemType::U32, 1, key);
+        snprintf(key, sizeof(key), "missing_%d", (int) i);
+        missing[i] = Item(1, ItemType::U32, 1, key);
+    }
+
+    HashListBenchHelper hashList;
+    uint64_t insertNs = 0;
+    uint64_t hitNs = 0;
+    uint64_t missNs = 0;
+    size_t errors = 0;
+    for (size_t round = 0; round < ROUNDS; ++round) {
+        hashList.clear();
+
+        auto t0 = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < COUNT; ++i) {
+            if (hashList.insert(items[i], i) != ESP_OK) {
+                ++errors;
+            }
+        }
+        auto t1 = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < COUNT; ++i) {
+            if (hashList.find(0, items[i]) != i) {
+                ++errors;
+            }
+        }
+        auto t2 = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < COUNT; ++i) {
+            if (hashList.find(0, missing[i]) != SIZE_MAX) {
+                ++errors;
+            }
+        }
+        auto t3 = std::chrono::steady_clock::now();
+
+        insertNs += std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count();
+        hitNs += std::chrono::duration_cast<std::chrono::nanoseconds>(t2 - t1).count();
+        missNs += std::chrono::duration_cast<std::chrono::nanoseconds>(t3 - t2).count();
+    }
+
+    TEST_ASSERT_EQUAL(0, errors);
+    TEST_ASSERT_TRUE(hashList.erase(COUNT - 1));
+    TEST_ASSERT_TRUE(hashList.find(0, items[COUNT - 1]) == SIZE_MAX);
+
+    const double ops = (double) ROUNDS * COUNT;
+    ESP_LOGI(TAG, "HashList with %d entries (%d bytes): insert %.1f ns, find hit %.1f ns, find miss %.1f ns",
+             (int) COUNT, (int) (hashList.capacity() * sizeof(uint32_t)),
+             insertNs / ops, hitNs / ops, missNs / ops);
+}
+
 int main(int argc, char **argv)
 {
 #define TEMPORARILY_DISABLED(x)
@@ -965,6 +1032,7 @@ int main(int argc, char **argv)
     RUN_TEST(test_Page_calcEntries__active_wo_blob);
     RUN_TEST(test_Page_calcEntries__active_with_blob);
     RUN_TEST(test_Page_calcEntries__invalid);
+    RUN_TEST(test_HashList_benchmark__full_page);
     int failures = UNITY_END();
     return failures;
 }
@@ -117,6 +117,7 @@ typedef struct nvs_opaque_iterator_t *nvs_iterator_t;
  * table.
  *
  * @param[in]  namespace_name   Namespace name. Maximum length is (NVS_KEY_NAME_MAX_SIZE-1) characters. Shouldn't be empty.
+ *                              "nvs.commit" is reserved for internal use.
  * @param[in]  open_mode        NVS_READWRITE or NVS_READONLY. If NVS_READONLY, will
  *                              open a handle for reading only. All write requests will
  *                              be rejected for this handle.
@@ -150,6 +151,7 @@ esp_err_t nvs_open(const char* namespace_name, nvs_open_mode_t open_mode, nvs_ha
  *
  * @param[in]  part_name        Label (name) of the partition of interest for object read/write/erase
  * @param[in]  namespace_name   Namespace name. Maximum length is (NVS_KEY_NAME_MAX_SIZE-1) characters. Shouldn't be empty.
+ *                              "nvs.commit" is reserved for internal use.
  * @param[in]  open_mode        NVS_READWRITE or NVS_READONLY. If NVS_READONLY, will
  *                              open a handle for reading only. All write requests will
  *                              be rejected for this handle.
@@ -537,6 +539,64 @@ esp_err_t nvs_erase_all(nvs_handle_t handle);
  */
 esp_err_t nvs_commit(nvs_handle_t handle);
 
+/**
+ * @brief      Start a transaction on the storage handle
+ *
+ * While a transaction is open, nvs_set_*, nvs_set_str, nvs_set_blob and nvs_erase_key
+ * don't write to flash. Changes are kept in RAM until nvs_transaction_commit is called,
+ * and only the last change of each key is kept. Reads return the values stored before
+ * the transaction was started. nvs_erase_all can't be used while a transaction is open.
+ *
+ * Committing many primitive values or strings at once takes much fewer flash operations
+ * than setting them one by one.
+ *
+ * @param[in]  handle  Storage handle obtained with nvs_open.
+ *                     Handles that were opened read only cannot be used.
+ *
+ * @return
+ *             - ESP_OK if the transaction was started
+ *             - ESP_ERR_NVS_INVALID_HANDLE if handle has been closed or is NULL
+ *             - ESP_ERR_NVS_READ_ONLY if handle was opened as read only
+ *             - ESP_ERR_NVS_INVALID_STATE if a transaction is already open on this handle
+ */
+esp_err_t nvs_transaction_begin(nvs_handle_t handle);
+
+/**
+ * @brief      Write all changes staged since nvs_transaction_begin and end the transaction
+ *
+ * The commit is not atomic as a whole. If power is lost while it is in progress, each key
+ * is left with either its old or its new value: new values which have been written
+ * replace the old ones when nvs is initialized again. The transaction ends even if an
+ * error is returned; in that case, some of the changes may have been written.
+ *
+ * @param[in]  handle  Storage handle obtained with nvs_open.
+ *
+ * @return
+ *             - ESP_OK if all changes have been written successfully
+ *             - ESP_ERR_NVS_INVALID_HANDLE if handle has been closed or is NULL
+ *             - ESP_ERR_NVS_INVALID_STATE if no transaction is open on this handle
+ *             - ESP_ERR_NVS_NOT_ENOUGH_SPACE if there is not enough space in the
+ *               underlying storage to save the values
+ *             - ESP_ERR_NVS_REMOVE_FAILED if old values weren't erased because a flash
+ *               write operation has failed. The new values were written however, and the
+ *               update will be finished after re-initialization of nvs.
+ *             - other error codes from nvs_set_*, nvs_set_str, nvs_set_blob and nvs_erase_key,
+ *               except ESP_ERR_NVS_NOT_FOUND for erasing a key which doesn't exist
+ */
+esp_err_t nvs_transaction_commit(nvs_handle_t handle);
+
+/**
+ * @brief      Drop all changes staged since nvs_transaction_begin and end the transaction
+ *
+ * @param[in]  handle  Storage handle obtained with nvs_open.
+ *
+ * @return
+ *             - ESP_OK if the transaction was aborted
+ *             - ESP_ERR_NVS_INVALID_HANDLE if handle has been closed or is NULL
+ *             - ESP_ERR_NVS_INVALID_STATE if no transaction is open on this handle
+ */
+esp_err_t nvs_transaction_abort(nvs_handle_t handle);
+
 /**
  * @brief      Close the storage handle and free any allocated resources
  *
@@ -596,6 +656,37 @@ typedef struct {
  */
 esp_err_t nvs_get_stats(const char *part_name, nvs_stats_t *nvs_stats);
 
+/**
+ * @note Info about the value cache of a NVS partition, see CONFIG_NVS_VALUE_CACHE.
+ */
+typedef struct {
+    size_t hits;              /**< Number of reads served from the cache. */
+    size_t misses;            /**< Number of reads of cacheable types which had to search the partition. */
+    size_t evictions;         /**< Number of values dropped to make room for more recently read ones. */
+    size_t used_entries;      /**< Number of values currently held by the cache. */
+    size_t total_entries;     /**< Number of values the cache can hold, 0 if the cache is disabled. */
+} nvs_cache_stats_t;
+
+/**
+ * @brief      Fill structure nvs_cache_stats_t with counters of the value cache.
+ *
+ * If CONFIG_NVS_VALUE_CACHE is enabled, NVS keeps the most recently read integer values and
+ * short strings of each partition in RAM. Counters are reset when the partition is initialized.
+ * If the cache is disabled, all fields are set to 0.
+ *
+ * @param[in]   part_name    Partition name NVS in the partition table.
+ *                           If pass a NULL than will use NVS_DEFAULT_PART_NAME ("nvs").
+ *
+ * @param[out]  cache_stats  Returns filled structure nvs_cache_stats_t.
+ *
+ * @return
+ *             - ESP_OK if cache_stats has been filled.
+ *             - ESP_ERR_NVS_NOT_INITIALIZED if the storage driver is not initialized.
+ *               Return param cache_stats will be filled 0.
+ *             - ESP_ERR_INVALID_ARG if cache_stats is equal to NULL.
+ */
+esp_err_t nvs_get_cache_stats(const char *part_name, nvs_cache_stats_t *cache_stats);
+
 /**
  * @brief      Calculate all entries in a namespace.
  *
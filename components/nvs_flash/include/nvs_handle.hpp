@@ -183,6 +183,44 @@ public:
      */
     virtual esp_err_t commit() = 0;
 
+    /**
+     * @brief Starts a transaction on this handle.
+     *
+     * Until \ref transaction_commit or \ref transaction_abort is called, set_item, set_string, set_blob and
+     * erase_item don't touch the storage. The changes are kept in RAM instead, and only the last change of each
+     * key is retained. Reads return the values stored before the transaction was started.
+     *
+     * @return - ESP_OK if the transaction was started
+     *         - ESP_ERR_NVS_READ_ONLY if the handle was opened as read only
+     *         - ESP_ERR_NVS_INVALID_STATE if a transaction has already been started on this handle
+     */
+    virtual esp_err_t transaction_begin() = 0;
+
+    /**
+     * @brief Writes all changes staged since \ref transaction_begin to the storage and ends the transaction.
+     *
+     * Primitive values and strings are written together, so that updating many keys takes only a few flash
+     * operations. The transaction is not atomic as a whole: if power is lost while it is being committed,
+     * each key is left with either its old or its new value. New values which have been written replace the old
+     * ones when the partition is initialized again.
+     *
+     * The transaction ends even if an error is returned. In this case, some of the changes may have been written.
+     *
+     * @return - ESP_OK if all changes have been written
+     *         - ESP_ERR_NVS_INVALID_STATE if no transaction was started on this handle
+     *         - the error codes of set_item, set_string, set_blob and erase_item, except ESP_ERR_NVS_NOT_FOUND
+     *           for erasing a key which doesn't exist
+     */
+    virtual esp_err_t transaction_commit() = 0;
+
+    /**
+     * @brief Drops all changes staged since \ref transaction_begin and ends the transaction.
+     *
+     * @return - ESP_OK if the transaction was aborted
+     *         - ESP_ERR_NVS_INVALID_STATE if no transaction was started on this handle
+     */
+    virtual esp_err_t transaction_abort() = 0;
+
     /**
      * @brief      Calculate all entries in the scope of the handle.
      *
@@ -23,6 +23,10 @@
 #include "esp_log.h"
 static const char* TAG = "nvs";
 
+#if defined(CONFIG_NVS_LAZY_PAGE_LOAD_TASK) && !defined(LINUX_TARGET)
+#include "freertos/task.h"
+#endif
+
 /**
  * @brief  Configuration structure for the active default security scheme
  *         for NVS Encryption
@@ -78,6 +82,54 @@ extern "C" void nvs_dump(const char *partName)
     pStorage->debugDump();
 }
 
+#if defined(CONFIG_NVS_LAZY_PAGE_LOAD_TASK) && !defined(LINUX_TARGET)
+static void nvs_page_load_task(void* arg)
+{
+    char* part_name = static_cast<char*>(arg);
+    bool pending = true;
+    while (pending) {
+        // one page at a time, so that API calls don't have to wait long for the lock
+        Lock lock;
+        nvs::Storage* pStorage = lookup_storage_from_name(part_name);
+        // the partition may have been deinitialized or loaded by an API call meanwhile
+        if (pStorage == nullptr || !pStorage->isLoadPending()) {
+            break;
+        }
+        esp_err_t err = pStorage->loadPendingPages(1);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to load NVS partition \"%s\": [0x%02X] (%s)", part_name, err, esp_err_to_name(err));
+        }
+        pending = pStorage->isLoadPending();
+    }
+    free(part_name);
+    vTaskDelete(nullptr);
+}
+#endif // CONFIG_NVS_LAZY_PAGE_LOAD_TASK && !LINUX_TARGET
+
+/**
+ * With CONFIG_NVS_LAZY_PAGE_LOAD_TASK, starts a task which loads pages of a lazily initialized partition
+ * in the background. Otherwise, pages are loaded by the first API call which needs them.
+ */
+static void start_page_load(const char* part_name)
+{
+#if defined(CONFIG_NVS_LAZY_PAGE_LOAD_TASK) && !defined(LINUX_TARGET)
+    // nothing to do if the partition had been initialized and loaded before
+    nvs::Storage* pStorage = lookup_storage_from_name(part_name);
+    if (pStorage == nullptr || !pStorage->isLoadPending()) {
+        return;
+    }
+    char* name = strndup(part_name, NVS_PART_NAME_MAX_SIZE);
+    if (name == nullptr) {
+        return;
+    }
+    if (xTaskCreate(nvs_page_load_task, "nvs_load", 3072, name, CONFIG_NVS_LAZY_PAGE_LOAD_TASK_PRIORITY, nullptr) != pdPASS) {
+        free(name);
+    }
+#else
+    (void) part_name;
+#endif // CONFIG_NVS_LAZY_PAGE_LOAD_TASK && !LINUX_TARGET
+}
+
 static esp_err_t close_handles_and_deinit(const char* part_name)
 {
     auto belongs_to_part = [=](NVSHandleEntry& e) -> bool {
@@ -118,6 +170,8 @@ extern "C" esp_err_t nvs_flash_init_partition_ptr(const esp_partition_t *partiti
 
     if (init_res != ESP_OK) {
         delete part;
+    } else {
+        start_page_load(partition->label);
     }
 
     return init_res;
@@ -132,7 +186,11 @@ extern "C" esp_err_t nvs_flash_init_partition(const char *part_name)
     }
     Lock lock;
 
-    return NVSPartitionManager::get_instance()->init_partition(part_name);
+    esp_err_t err = NVSPartitionManager::get_instance()->init_partition(part_name);
+    if (err == ESP_OK) {
+        start_page_load(part_name);
+    }
+    return err;
 }
 
 extern "C" esp_err_t nvs_flash_init(void)
@@ -172,7 +230,11 @@ extern "C" esp_err_t nvs_flash_secure_init_partition(const char *part_name, nvs_
     }
     Lock lock;
 
-    return NVSPartitionManager::get_instance()->secure_init_partition(part_name, cfg);
+    esp_err_t err = NVSPartitionManager::get_instance()->secure_init_partition(part_name, cfg);
+    if (err == ESP_OK) {
+        start_page_load(part_name);
+    }
+    return err;
 }
 
 extern "C" esp_err_t nvs_flash_secure_init(nvs_sec_cfg_t* cfg)
@@ -398,6 +460,42 @@ extern "C" esp_err_t nvs_commit(nvs_handle_t c_handle)
     return handle->commit();
 }
 
+extern "C" esp_err_t nvs_transaction_begin(nvs_handle_t c_handle)
+{
+    Lock lock;
+    ESP_LOGD(TAG, "%s", __func__);
+    NVSHandleSimple *handle;
+    auto err = nvs_find_ns_handle(c_handle, &handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+    return handle->transaction_begin();
+}
+
+extern "C" esp_err_t nvs_transaction_commit(nvs_handle_t c_handle)
+{
+    Lock lock;
+    ESP_LOGD(TAG, "%s", __func__);
+    NVSHandleSimple *handle;
+    auto err = nvs_find_ns_handle(c_handle, &handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+    return handle->transaction_commit();
+}
+
+extern "C" esp_err_t nvs_transaction_abort(nvs_handle_t c_handle)
+{
+    Lock lock;
+    ESP_LOGD(TAG, "%s", __func__);
+    NVSHandleSimple *handle;
+    auto err = nvs_find_ns_handle(c_handle, &handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+    return handle->transaction_abort();
+}
+
 extern "C" esp_err_t nvs_set_str(nvs_handle_t c_handle, const char* key, const char* value)
 {
     Lock lock;
@@ -542,6 +640,25 @@ extern "C" esp_err_t nvs_get_stats(const char* part_name, nvs_stats_t* nvs_stats
     return pStorage->fillStats(*nvs_stats);
 }
 
+extern "C" esp_err_t nvs_get_cache_stats(const char* part_name, nvs_cache_stats_t* cache_stats)
+{
+    Lock lock;
+    nvs::Storage* pStorage;
+
+    if (cache_stats == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *cache_stats = {};
+
+    pStorage = lookup_storage_from_name((part_name == nullptr) ? NVS_DEFAULT_PART_NAME : part_name);
+    if (pStorage == nullptr) {
+        return ESP_ERR_NVS_NOT_INITIALIZED;
+    }
+
+    pStorage->fillCacheStats(*cache_stats);
+    return ESP_OK;
+}
+
 extern "C" esp_err_t nvs_get_used_entry_count(nvs_handle_t c_handle, size_t* used_entries)
 {
     Lock lock;
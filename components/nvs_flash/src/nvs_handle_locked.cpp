@@ -62,6 +62,21 @@ esp_err_t NVSHandleLocked::commit() {
     return handle->commit();
 }
 
+esp_err_t NVSHandleLocked::transaction_begin() {
+    Lock lock;
+    return handle->transaction_begin();
+}
+
+esp_err_t NVSHandleLocked::transaction_commit() {
+    Lock lock;
+    return handle->transaction_commit();
+}
+
+esp_err_t NVSHandleLocked::transaction_abort() {
+    Lock lock;
+    return handle->transaction_abort();
+}
+
 esp_err_t NVSHandleLocked::get_used_entry_count(size_t& usedEntries) {
     Lock lock;
     return handle->get_used_entry_count(usedEntries);
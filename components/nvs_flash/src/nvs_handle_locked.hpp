@@ -55,6 +55,12 @@ public:
 
     esp_err_t commit() override;
 
+    esp_err_t transaction_begin() override;
+
+    esp_err_t transaction_commit() override;
+
+    esp_err_t transaction_abort() override;
+
     esp_err_t get_used_entry_count(size_t& usedEntries) override;
 
 protected:
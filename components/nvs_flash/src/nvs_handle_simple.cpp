@@ -4,12 +4,15 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 #include <cstdlib>
+#include <cstring>
+#include <algorithm>
 #include "nvs_handle.hpp"
 #include "nvs_partition_manager.hpp"
 
 namespace nvs {
 
 NVSHandleSimple::~NVSHandleSimple() {
+    clear_staged_items();
     NVSPartitionManager::get_instance()->close_handle(this);
 }
 
@@ -17,6 +20,7 @@ esp_err_t NVSHandleSimple::set_typed_item(ItemType datatype, const char *key, co
 {
     if (!valid) return ESP_ERR_NVS_INVALID_HANDLE;
     if (mReadOnly) return ESP_ERR_NVS_READ_ONLY;
+    if (mInTransaction) return stage_item(datatype, key, data, dataSize);
 
     return mStoragePtr->writeItem(mNsIndex, datatype, key, data, dataSize);
 }
@@ -32,6 +36,7 @@ esp_err_t NVSHandleSimple::set_string(const char *key, const char* str)
 {
     if (!valid) return ESP_ERR_NVS_INVALID_HANDLE;
     if (mReadOnly) return ESP_ERR_NVS_READ_ONLY;
+    if (mInTransaction) return stage_item(nvs::ItemType::SZ, key, str, strlen(str) + 1);
 
     return mStoragePtr->writeItem(mNsIndex, nvs::ItemType::SZ, key, str, strlen(str) + 1);
 }
@@ -40,6 +45,7 @@ esp_err_t NVSHandleSimple::set_blob(const char *key, const void* blob, size_t le
 {
     if (!valid) return ESP_ERR_NVS_INVALID_HANDLE;
     if (mReadOnly) return ESP_ERR_NVS_READ_ONLY;
+    if (mInTransaction) return stage_item(nvs::ItemType::BLOB, key, blob, len);
 
     return mStoragePtr->writeItem(mNsIndex, nvs::ItemType::BLOB, key, blob, len);
 }
@@ -69,6 +75,7 @@ esp_err_t NVSHandleSimple::erase_item(const char* key)
 {
     if (!valid) return ESP_ERR_NVS_INVALID_HANDLE;
     if (mReadOnly) return ESP_ERR_NVS_READ_ONLY;
+    if (mInTransaction) return stage_item(nvs::ItemType::ANY, key, nullptr, 0);
 
     return mStoragePtr->eraseItem(mNsIndex, key);
 }
@@ -77,6 +84,7 @@ esp_err_t NVSHandleSimple::erase_all()
 {
     if (!valid) return ESP_ERR_NVS_INVALID_HANDLE;
     if (mReadOnly) return ESP_ERR_NVS_READ_ONLY;
+    if (mInTransaction) return ESP_ERR_NVS_INVALID_STATE;
 
     return mStoragePtr->eraseNamespace(mNsIndex);
 }
@@ -88,6 +96,77 @@ esp_err_t NVSHandleSimple::commit()
     return ESP_OK;
 }
 
+esp_err_t NVSHandleSimple::transaction_begin()
+{
+    if (!valid) return ESP_ERR_NVS_INVALID_HANDLE;
+    if (mReadOnly) return ESP_ERR_NVS_READ_ONLY;
+    if (mInTransaction) return ESP_ERR_NVS_INVALID_STATE;
+
+    mInTransaction = true;
+    return ESP_OK;
+}
+
+esp_err_t NVSHandleSimple::transaction_commit()
+{
+    if (!valid) return ESP_ERR_NVS_INVALID_HANDLE;
+    if (!mInTransaction) return ESP_ERR_NVS_INVALID_STATE;
+
+    esp_err_t err = mStoragePtr->writeItems(mNsIndex, mStagedItems);
+    clear_staged_items();
+    mInTransaction = false;
+    return err;
+}
+
+esp_err_t NVSHandleSimple::transaction_abort()
+{
+    if (!valid) return ESP_ERR_NVS_INVALID_HANDLE;
+    if (!mInTransaction) return ESP_ERR_NVS_INVALID_STATE;
+
+    clear_staged_items();
+    mInTransaction = false;
+    return ESP_OK;
+}
+
+esp_err_t NVSHandleSimple::stage_item(ItemType datatype, const char *key, const void *data, size_t dataSize)
+{
+    if (strlen(key) > Item::MAX_KEY_LENGTH) return ESP_ERR_NVS_KEY_TOO_LONG;
+    if (datatype == ItemType::SZ && dataSize > Page::CHUNK_MAX_SIZE) return ESP_ERR_NVS_VALUE_TOO_LONG;
+
+    uint8_t *copy = nullptr;
+    if (dataSize > 0) {
+        copy = new (std::nothrow) uint8_t[dataSize];
+        if (!copy) return ESP_ERR_NO_MEM;
+        memcpy(copy, data, dataSize);
+    }
+
+    // only the last change of a key is kept
+    auto it = std::find_if(mStagedItems.begin(), mStagedItems.end(), [=](Storage::PendingItemNode& e) -> bool {
+        return strncmp(e.mKey, key, sizeof(e.mKey)) == 0;
+    });
+    Storage::PendingItemNode *node = it;
+    if (it == mStagedItems.end()) {
+        node = new (std::nothrow) Storage::PendingItemNode;
+        if (!node) {
+            delete[] copy;
+            return ESP_ERR_NO_MEM;
+        }
+        strncpy(node->mKey, key, sizeof(node->mKey) - 1);
+        node->mKey[sizeof(node->mKey) - 1] = 0;
+        mStagedItems.push_back(node);
+    }
+
+    delete[] node->mData;
+    node->mDatatype = datatype;
+    node->mData = copy;
+    node->mDataSize = dataSize;
+    return ESP_OK;
+}
+
+void NVSHandleSimple::clear_staged_items()
+{
+    mStagedItems.clearAndFreeNodes();
+}
+
 esp_err_t NVSHandleSimple::get_used_entry_count(size_t& used_entries)
 {
     used_entries = 0;
@@ -1,5 +1,5 @@
 /*
- * SPDX-FileCopyrightText: 2015-2022 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2015-2023 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
@@ -57,6 +57,12 @@ public:
 
     esp_err_t commit() override;
 
+    esp_err_t transaction_begin() override;
+
+    esp_err_t transaction_commit() override;
+
+    esp_err_t transaction_abort() override;
+
     esp_err_t get_used_entry_count(size_t &usedEntries) override;
 
     esp_err_t getItemDataSize(ItemType datatype, const char *key, size_t &dataSize);
@@ -78,6 +84,18 @@ public:
     Storage *get_storage() const;
 
 private:
+    /**
+     * Stages a write, or an erasure if datatype is ItemType::ANY, while a transaction is open.
+     */
+    esp_err_t stage_item(ItemType datatype, const char *key, const void *data, size_t dataSize);
+
+    void clear_staged_items();
+
+    /**
+     * Changes staged by the currently open transaction, at most one per key.
+     */
+    Storage::TPendingItemList mStagedItems;
+
     /**
      * The underlying storage's object.
      */
@@ -99,6 +117,11 @@ private:
      * Upon opening, a handle is valid. It becomes invalid if the underlying storage is de-initialized.
      */
     uint8_t valid;
+
+    /**
+     * Whether a transaction has been started by transaction_begin() and not committed or aborted yet.
+     */
+    bool mInTransaction = false;
 };
 
 } // nvs
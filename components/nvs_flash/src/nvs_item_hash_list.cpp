@@ -13,6 +13,7 @@
 // limitations under the License.
 
 #include "nvs_item_hash_list.hpp"
+#include <cstring>
 
 namespace nvs
 {
@@ -23,12 +24,10 @@ HashList::HashList()
 
 void HashList::clear()
 {
-    for (auto it = mBlockList.begin(); it != mBlockList.end();) {
-        auto tmp = it;
-        ++it;
-        mBlockList.erase(tmp);
-        delete static_cast<HashListBlock*>(tmp);
-    }
+    delete[] mNodes;
+    mNodes = nullptr;
+    mCount = 0;
+    mCapacity = 0;
 }
 
 HashList::~HashList()
@@ -36,88 +35,90 @@ HashList::~HashList()
     clear();
 }
 
-HashList::HashListBlock::HashListBlock()
+esp_err_t HashList::resize(size_t capacity)
 {
-    static_assert(sizeof(HashListBlock) == HashListBlock::BYTE_SIZE,
-                  "cache block size calculation incorrect");
+    uint32_t* nodes = new (std::nothrow) uint32_t[capacity];
+    if (!nodes) {
+        return ESP_ERR_NO_MEM;
+    }
+    if (mCount) {
+        memcpy(nodes, mNodes, mCount * sizeof(uint32_t));
+    }
+    delete[] mNodes;
+    mNodes = nodes;
+    mCapacity = capacity;
+    return ESP_OK;
 }
 
-esp_err_t HashList::insert(const Item& item, size_t index)
+size_t HashList::lowerBound(uint32_t node) const
 {
-    const uint32_t hash_24 = item.calculateCrc32WithoutValue() & 0xffffff;
-    // add entry to the end of last block if possible
-    if (mBlockList.size()) {
-        auto& block = mBlockList.back();
-        if (block.mCount < HashListBlock::ENTRY_COUNT) {
-            block.mNodes[block.mCount++] = HashListNode(hash_24, index);
-            return ESP_OK;
+    size_t lo = 0;
+    size_t hi = mCount;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (mNodes[mid] < node) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
         }
     }
-    // if the above failed, create a new block and add entry to it
-    HashListBlock* newBlock = new (std::nothrow) HashListBlock;
+    return lo;
+}
 
-    if (!newBlock) return ESP_ERR_NO_MEM;
+esp_err_t HashList::insert(const Item& item, size_t index)
+{
+    if (index > INDEX_MASK) {
+        return ESP_ERR_INVALID_ARG;
+    }
 
-    mBlockList.push_back(newBlock);
-    newBlock->mNodes[0] = HashListNode(hash_24, index);
-    newBlock->mCount++;
+    if (mCount == mCapacity) {
+        esp_err_t err = resize(mCapacity ? mCapacity * 2 : MIN_CAPACITY);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
 
+    const uint32_t hash_24 = item.calculateCrc32WithoutValue() & 0xffffff;
+    const uint32_t node = makeNode(hash_24, index);
+    size_t pos = lowerBound(node);
+    memmove(&mNodes[pos + 1], &mNodes[pos], (mCount - pos) * sizeof(uint32_t));
+    mNodes[pos] = node;
+    ++mCount;
     return ESP_OK;
 }
 
 bool HashList::erase(size_t index)
 {
-    for (auto it = mBlockList.begin(); it != mBlockList.end();) {
-        bool haveEntries = false;
-        bool foundIndex = false;
-        for (size_t i = 0; i < it->mCount; ++i) {
-            if (it->mNodes[i].mIndex == index) {
-                it->mNodes[i].mIndex = 0xff;
-                foundIndex = true;
-                /* found the item and removed it */
-            }
-            if (it->mNodes[i].mIndex != 0xff) {
-                haveEntries = true;
-            }
-            if (haveEntries && foundIndex) {
-                /* item was found, and HashListBlock still has some items */
-                return true;
-            }
+    for (size_t i = 0; i < mCount; ++i) {
+        if ((mNodes[i] & INDEX_MASK) != index) {
+            continue;
         }
-        /* no items left in HashListBlock, can remove */
-        if (!haveEntries) {
-            auto tmp = it;
-            ++it;
-            mBlockList.erase(tmp);
-            delete static_cast<HashListBlock*>(tmp);
-        } else {
-            ++it;
-        }
-        if (foundIndex) {
-            /* item was found and empty HashListBlock was removed */
-            return true;
+        --mCount;
+        memmove(&mNodes[i], &mNodes[i + 1], (mCount - i) * sizeof(uint32_t));
+        if (mCount == 0) {
+            clear();
+        } else if (mCapacity > MIN_CAPACITY && mCount <= mCapacity / 4) {
+            // shrinking is best effort, keep the larger array if allocation fails
+            resize(mCapacity / 2);
         }
+        return true;
     }
 
-    // item hasn't been present in cache");
+    // item hasn't been present in cache
     return false;
 }
 
 size_t HashList::find(size_t start, const Item& item)
 {
+    if (start > INDEX_MASK) {
+        return SIZE_MAX;
+    }
     const uint32_t hash_24 = item.calculateCrc32WithoutValue() & 0xffffff;
-    for (auto it = mBlockList.begin(); it != mBlockList.end(); ++it) {
-        for (size_t index = 0; index < it->mCount; ++index) {
-            HashListNode& e = it->mNodes[index];
-            if (e.mIndex >= start &&
-                    e.mHash == hash_24 &&
-                    e.mIndex != 0xff) {
-                return e.mIndex;
-            }
-        }
+    size_t pos = lowerBound(makeNode(hash_24, start));
+    if (pos < mCount && (mNodes[pos] >> INDEX_BITS) == hash_24) {
+        return mNodes[pos] & INDEX_MASK;
     }
     return SIZE_MAX;
 }
 
-
 } // namespace nvs
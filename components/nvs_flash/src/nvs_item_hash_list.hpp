@@ -1,5 +1,5 @@
 /*
- * SPDX-FileCopyrightText: 2015-2022 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2015-2023 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
@@ -10,11 +10,17 @@
 #include "nvs.h"
 #include "nvs_types.hpp"
 #include "nvs_memory_management.hpp"
-#include "intrusive_list.h"
 
 namespace nvs
 {
 
+/**
+ * Per-page cache of item hashes.
+ *
+ * Entries are kept in a single array, sorted by the 24-bit hash of <ns,key,chunkIdx> and then by
+ * entry index, so that find() is a binary search. The array grows and shrinks by doubling/halving,
+ * which keeps the memory used by a full page below what the items themselves take in the entry table.
+ */
 class HashList
 {
 public:
@@ -26,39 +32,40 @@ public:
     size_t find(size_t start, const Item& item);
     void clear();
 
+    /**
+     * Calls func(hash, index) for every entry in the list, ordered by hash and then by index.
+     * The hash is the same 24-bit value which is used for matching in find().
+     */
+    template<typename F>
+    void forEach(F func)
+    {
+        for (size_t i = 0; i < mCount; ++i) {
+            func(static_cast<uint32_t>(mNodes[i] >> INDEX_BITS), static_cast<size_t>(mNodes[i] & INDEX_MASK));
+        }
+    }
+
 private:
     HashList(const HashList& other);
     const HashList& operator= (const HashList& rhs);
 
 protected:
+    static const size_t INDEX_BITS = 8;
+    static const uint32_t INDEX_MASK = (1 << INDEX_BITS) - 1;
+    static const size_t MIN_CAPACITY = 16;
 
-    struct HashListNode {
-        HashListNode() :
-            mIndex(0xff), mHash(0)
-        {
-        }
-
-        HashListNode(uint32_t hash, size_t index) :
-            mIndex((uint32_t) index), mHash(hash)
-        {
-        }
-
-        uint32_t mIndex : 8;
-        uint32_t mHash  : 24;
-    };
-
-    struct HashListBlock : public intrusive_list_node<HashList::HashListBlock>, public ExceptionlessAllocatable {
-        HashListBlock();
+    /* Each node is (hash << INDEX_BITS) | index, so ordering nodes as integers orders them by hash, then by index */
+    static uint32_t makeNode(uint32_t hash, size_t index)
+    {
+        return (hash << INDEX_BITS) | static_cast<uint32_t>(index);
+    }
 
-        static const size_t BYTE_SIZE = 128;
-        static const size_t ENTRY_COUNT = (BYTE_SIZE - sizeof(intrusive_list_node<HashListBlock>) - sizeof(size_t)) / 4;
+    size_t lowerBound(uint32_t node) const;
 
-        size_t mCount = 0;
-        HashListNode mNodes[ENTRY_COUNT];
-    };
+    esp_err_t resize(size_t capacity);
 
-    typedef intrusive_list<HashListBlock> TBlockList;
-    TBlockList mBlockList;
+    uint32_t* mNodes = nullptr;
+    size_t mCount = 0;
+    size_t mCapacity = 0;
 }; // class HashList
 
 } // namespace nvs
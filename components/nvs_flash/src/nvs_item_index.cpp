@@ -0,0 +1,209 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "nvs_item_index.hpp"
+#include <algorithm>
+#include "nvs_internal.h"
+
+namespace nvs
+{
+
+ItemIndex::ItemIndex()
+{
+}
+
+ItemIndex::~ItemIndex()
+{
+    clear();
+}
+
+esp_err_t ItemIndex::init(size_t maxItems)
+{
+    clear();
+
+    // keep load factor below 80% so that probe sequences stay short
+    size_t slotCount = 16;
+    while (slotCount < maxItems + maxItems / 4) {
+        slotCount <<= 1;
+    }
+
+    mNodes = new (std::nothrow) IndexNode[slotCount];
+    if (!mNodes) {
+        return ESP_ERR_NO_MEM;
+    }
+    for (size_t i = 0; i < slotCount; ++i) {
+        mNodes[i].mPage = nullptr;
+    }
+    mMask = slotCount - 1;
+    mMaxItems = maxItems;
+    return ESP_OK;
+}
+
+void ItemIndex::clear()
+{
+    delete[] mNodes;
+    mNodes = nullptr;
+    mMask = 0;
+    mCount = 0;
+    mMaxItems = 0;
+}
+
+uint32_t ItemIndex::calculateHash(uint8_t nsIndex, const char* key, uint8_t chunkIdx)
+{
+    // datatype is not a part of the hash, so the value passed here doesn't matter
+    return Item(nsIndex, ItemType::ANY, 0, key, chunkIdx).calculateCrc32WithoutValue() & 0xffffff;
+}
+
+esp_err_t ItemIndex::insert(uint32_t hash, Page* page, size_t index)
+{
+    NVS_ASSERT_OR_RETURN(isValid(), ESP_ERR_NVS_INVALID_STATE);
+
+    size_t slot = slotFor(hash);
+    while (mNodes[slot].mPage != nullptr) {
+        const IndexNode& node = mNodes[slot];
+        if (node.mHash == hash && node.mPage == page && node.mIndex == index) {
+            return ESP_OK;
+        }
+        slot = (slot + 1) & mMask;
+    }
+
+    if (mCount >= mMaxItems) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    mNodes[slot].mHash = hash;
+    mNodes[slot].mIndex = index;
+    mNodes[slot].mPage = page;
+    ++mCount;
+    return ESP_OK;
+}
+
+void ItemIndex::eraseSlot(size_t slot)
+{
+    // backward shift deletion: move following entries of the probe sequence into the hole,
+    // unless they are already placed between their home slot and the hole
+    size_t next = slot;
+    while (true) {
+        next = (next + 1) & mMask;
+        if (mNodes[next].mPage == nullptr) {
+            break;
+        }
+        size_t home = slotFor(mNodes[next].mHash);
+        bool inPlace = (slot <= next) ? (slot < home && home <= next) : (slot < home || home <= next);
+        if (inPlace) {
+            continue;
+        }
+        mNodes[slot] = mNodes[next];
+        slot = next;
+    }
+    mNodes[slot].mPage = nullptr;
+    --mCount;
+}
+
+template<typename F>
+void ItemIndex::eraseIf(F pred)
+{
+    if (!isValid()) {
+        return;
+    }
+    for (size_t slot = 0; slot <= mMask;) {
+        if (mNodes[slot].mPage != nullptr && pred(mNodes[slot])) {
+            // another entry may have been shifted into this slot, check it again
+            eraseSlot(slot);
+        } else {
+            ++slot;
+        }
+    }
+}
+
+esp_err_t ItemIndex::addPage(Page& page)
+{
+    esp_err_t err = ESP_OK;
+    page.forEachItemHash([&](uint32_t hash, size_t index) {
+        if (err == ESP_OK) {
+            err = insert(hash, &page, index);
+        }
+    });
+    return err;
+}
+
+void ItemIndex::removePage(const Page& page)
+{
+    eraseIf([&](const IndexNode& node) -> bool {
+        return node.mPage == &page;
+    });
+}
+
+void ItemIndex::removeErasedPages()
+{
+    eraseIf([](const IndexNode& node) -> bool {
+        return node.mPage->state() == Page::PageState::UNINITIALIZED;
+    });
+}
+
+esp_err_t ItemIndex::updateItem(Page& page, uint8_t nsIndex, const char* key, uint8_t chunkIdx)
+{
+    if (!isValid()) {
+        return ESP_ERR_NVS_INVALID_STATE;
+    }
+
+    const uint32_t hash = calculateHash(nsIndex, key, chunkIdx);
+
+    // drop what we know about this hash on this page...
+    size_t slot = slotFor(hash);
+    while (mNodes[slot].mPage != nullptr) {
+        if (mNodes[slot].mHash == hash && mNodes[slot].mPage == &page) {
+            eraseSlot(slot);
+        } else {
+            slot = (slot + 1) & mMask;
+        }
+    }
+
+    // ...and add it back as the page sees it now
+    esp_err_t err = ESP_OK;
+    page.forEachItemHash([&](uint32_t itemHash, size_t index) {
+        if (err == ESP_OK && itemHash == hash) {
+            err = insert(hash, &page, index);
+        }
+    });
+    return err;
+}
+
+size_t ItemIndex::find(uint8_t nsIndex, const char* key, uint8_t chunkIdx, Location* dst, size_t maxCount)
+{
+    if (!isValid()) {
+        return 0;
+    }
+
+    const uint32_t hash = calculateHash(nsIndex, key, chunkIdx);
+    size_t count = 0;
+    for (size_t slot = slotFor(hash); mNodes[slot].mPage != nullptr; slot = (slot + 1) & mMask) {
+        if (mNodes[slot].mHash != hash) {
+            continue;
+        }
+        if (count < maxCount) {
+            dst[count].page = mNodes[slot].mPage;
+            dst[count].index = mNodes[slot].mIndex;
+        }
+        ++count;
+    }
+
+    if (count > 1 && count <= maxCount) {
+        // pages are kept in the order of their sequence numbers, search them the same way
+        std::sort(dst, dst + count, [](const Location& a, const Location& b) -> bool {
+            uint32_t seqA = UINT32_MAX;
+            uint32_t seqB = UINT32_MAX;
+            a.page->getSeqNumber(seqA);
+            b.page->getSeqNumber(seqB);
+            if (seqA != seqB) {
+                return seqA < seqB;
+            }
+            return a.index < b.index;
+        });
+    }
+    return count;
+}
+
+} // namespace nvs
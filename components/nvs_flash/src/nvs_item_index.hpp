@@ -0,0 +1,130 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef nvs_item_index_hpp
+#define nvs_item_index_hpp
+
+#include "nvs.h"
+#include "nvs_types.hpp"
+#include "nvs_page.hpp"
+
+namespace nvs
+{
+
+/**
+ * Storage-wide index of items.
+ *
+ * Maps the 24-bit hash of namespace index, key and chunk index (the same hash which HashList
+ * keeps per page) to the pages and entries holding an item with this hash. This allows
+ * Storage::findItem to probe only the pages which may hold an item instead of all of them.
+ *
+ * Index entries are only hints, the page is always asked to confirm a match. The index must however
+ * contain an entry for every item which is present in the storage, so each write, erase and page
+ * relocation done through Storage has to be reflected here.
+ *
+ * The index is an open-addressing hash table with linear probing. Its capacity is fixed when it is
+ * initialized. If it runs full, the index is dropped and isValid() returns false.
+ */
+class ItemIndex
+{
+public:
+    /**
+     * Location of an item as stored in the index.
+     */
+    struct Location {
+        Page* page;
+        size_t index;
+    };
+
+    ItemIndex();
+    ~ItemIndex();
+
+    /**
+     * Allocates a table with room for at least maxItems entries. Previous contents are dropped.
+     */
+    esp_err_t init(size_t maxItems);
+
+    /**
+     * Frees the table, after that the index is invalid until init() is called again.
+     */
+    void clear();
+
+    bool isValid() const
+    {
+        return mNodes != nullptr;
+    }
+
+    size_t size() const
+    {
+        return mCount;
+    }
+
+    /**
+     * Adds all items of the given page.
+     */
+    esp_err_t addPage(Page& page);
+
+    /**
+     * Removes all entries which refer to the given page.
+     */
+    void removePage(const Page& page);
+
+    /**
+     * Removes all entries which refer to pages in UNINITIALIZED state, i.e. pages which have
+     * been erased after their items were copied elsewhere.
+     */
+    void removeErasedPages();
+
+    /**
+     * Re-synchronizes entries for one <ns,key,chunkIdx> on the given page with the contents of
+     * the page's hash list. To be called after an item was written to or erased from the page.
+     */
+    esp_err_t updateItem(Page& page, uint8_t nsIndex, const char* key, uint8_t chunkIdx = Page::CHUNK_ANY);
+
+    /**
+     * Looks up locations which may hold <ns,key,chunkIdx>.
+     *
+     * At most maxCount locations are written to dst, sorted in the order in which
+     * Storage searches pages (oldest page first, lowest entry index first).
+     *
+     * @return number of candidate locations found. If it is larger than maxCount, the caller
+     *         can't rely on dst and has to fall back to scanning all pages.
+     */
+    size_t find(uint8_t nsIndex, const char* key, uint8_t chunkIdx, Location* dst, size_t maxCount);
+
+protected:
+    static uint32_t calculateHash(uint8_t nsIndex, const char* key, uint8_t chunkIdx);
+
+    esp_err_t insert(uint32_t hash, Page* page, size_t index);
+
+    void eraseSlot(size_t slot);
+
+    template<typename F>
+    void eraseIf(F pred);
+
+    size_t slotFor(uint32_t hash) const
+    {
+        return hash & mMask;
+    }
+
+    struct IndexNode {
+        uint32_t mHash  : 24;
+        uint32_t mIndex : 8;
+        Page* mPage;
+    };
+
+    IndexNode* mNodes = nullptr;
+    size_t mMask = 0;
+    size_t mCount = 0;
+    size_t mMaxItems = 0;
+
+private:
+    ItemIndex(const ItemIndex& other);
+    const ItemIndex& operator= (const ItemIndex& rhs);
+}; // class ItemIndex
+
+} // namespace nvs
+
+#endif /* nvs_item_index_hpp */
@@ -1,5 +1,5 @@
 /*
- * SPDX-FileCopyrightText: 2015-2022 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2015-2023 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
@@ -14,6 +14,11 @@ namespace nvs
 
 Page::Page() : mPartition(nullptr) { }
 
+Page::~Page()
+{
+    delete[] mBatchEntries;
+}
+
 uint32_t Page::Header::calculateCrc32()
 {
     return esp_rom_crc32_le(0xffffffff,
@@ -22,6 +27,15 @@ uint32_t Page::Header::calculateCrc32()
 }
 
 esp_err_t Page::load(Partition *partition, uint32_t sectorNumber)
+{
+    auto err = loadHeader(partition, sectorNumber);
+    if (err != ESP_OK) {
+        return err;
+    }
+    return loadEntries();
+}
+
+esp_err_t Page::loadHeader(Partition *partition, uint32_t sectorNumber)
 {
     if (partition == nullptr) {
         return ESP_ERR_INVALID_ARG;
@@ -40,6 +54,37 @@ esp_err_t Page::load(Partition *partition, uint32_t sectorNumber)
     }
     if (header.mState == PageState::UNINITIALIZED) {
         mState = header.mState;
+    } else if (header.mCrc32 != header.calculateCrc32()) {
+        header.mState = PageState::CORRUPT;
+    } else {
+        mState = header.mState;
+        mSeqNumber = header.mSeqNumber;
+        if(header.mVersion < NVS_VERSION) {
+            return ESP_ERR_NVS_NEW_VERSION_FOUND;
+        } else {
+            mVersion = header.mVersion;
+        }
+    }
+
+    switch (mState) {
+    case PageState::UNINITIALIZED:
+    case PageState::FULL:
+    case PageState::ACTIVE:
+    case PageState::FREEING:
+        break;
+
+    default:
+        mState = PageState::CORRUPT;
+        break;
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t Page::loadEntries()
+{
+    switch (mState) {
+    case PageState::UNINITIALIZED: {
         // check if the whole page is really empty
         // reading the whole page takes ~40 times less than erasing it
         const int BLOCK_SIZE = 128;
@@ -48,7 +93,7 @@ esp_err_t Page::load(Partition *partition, uint32_t sectorNumber)
         if (!block) return ESP_ERR_NO_MEM;
 
         for (uint32_t i = 0; i < SPI_FLASH_SEC_SIZE; i += 4 * BLOCK_SIZE) {
-            rc = mPartition->read_raw(mBaseAddress + i, block, 4 * BLOCK_SIZE);
+            auto rc = mPartition->read_raw(mBaseAddress + i, block, 4 * BLOCK_SIZE);
             if (rc != ESP_OK) {
                 mState = PageState::INVALID;
                 delete[] block;
@@ -61,30 +106,15 @@ esp_err_t Page::load(Partition *partition, uint32_t sectorNumber)
             }
         }
         delete[] block;
-    } else if (header.mCrc32 != header.calculateCrc32()) {
-        header.mState = PageState::CORRUPT;
-    } else {
-        mState = header.mState;
-        mSeqNumber = header.mSeqNumber;
-        if(header.mVersion < NVS_VERSION) {
-            return ESP_ERR_NVS_NEW_VERSION_FOUND;
-        } else {
-            mVersion = header.mVersion;
-        }
-    }
-
-    switch (mState) {
-    case PageState::UNINITIALIZED:
         break;
+    }
 
     case PageState::FULL:
     case PageState::ACTIVE:
     case PageState::FREEING:
         return mLoadEntryTable();
-        break;
 
     default:
-        mState = PageState::CORRUPT;
         break;
     }
 
@@ -93,13 +123,17 @@ esp_err_t Page::load(Partition *partition, uint32_t sectorNumber)
 
 esp_err_t Page::writeEntry(const Item& item)
 {
-    uint32_t phyAddr;
-    esp_err_t err = getEntryAddress(mNextFreeEntry, &phyAddr);
-    if (err != ESP_OK) {
-        return err;
+    esp_err_t err;
+    if (mBatching) {
+        err = bufferEntries(reinterpret_cast<const uint8_t*>(&item), 1);
+    } else {
+        uint32_t phyAddr;
+        err = getEntryAddress(mNextFreeEntry, &phyAddr);
+        if (err != ESP_OK) {
+            return err;
+        }
+        err = mPartition->write(phyAddr, &item, sizeof(item));
     }
-    err = mPartition->write(phyAddr, &item, sizeof(item));
-
 
     if (err != ESP_OK) {
         mState = PageState::INVALID;
@@ -128,10 +162,15 @@ esp_err_t Page::writeEntryData(const uint8_t* data, size_t size)
     NVS_ASSERT_OR_RETURN(mFirstUsedEntry != INVALID_ENTRY, ESP_FAIL);
     const uint16_t count = size / ENTRY_SIZE;
 
-    uint32_t phyAddr;
-    esp_err_t rc = getEntryAddress(mNextFreeEntry, &phyAddr);
-    if (rc == ESP_OK) {
-        rc = mPartition->write(phyAddr, data, size);
+    esp_err_t rc;
+    if (mBatching) {
+        rc = bufferEntries(data, count);
+    } else {
+        uint32_t phyAddr;
+        rc = getEntryAddress(mNextFreeEntry, &phyAddr);
+        if (rc == ESP_OK) {
+            rc = mPartition->write(phyAddr, data, size);
+        }
     }
     if (rc != ESP_OK) {
         mState = PageState::INVALID;
@@ -367,6 +406,119 @@ esp_err_t Page::findItem(uint8_t nsIndex, ItemType datatype, const char* key, ui
     return findItem(nsIndex, datatype, key, index, item, chunkIdx, chunkStart);
 }
 
+esp_err_t Page::bufferEntries(const uint8_t* data, size_t count)
+{
+    NVS_ASSERT_OR_RETURN(mNextFreeEntry + count <= ENTRY_COUNT, ESP_FAIL);
+
+    if (mBatchEntries == nullptr) {
+        mBatchEntries = new (std::nothrow) Item[BATCH_ENTRY_COUNT];
+        if (mBatchEntries == nullptr) {
+            // without a buffer, only entry state writes are deferred
+            uint32_t phyAddr;
+            esp_err_t rc = getEntryAddress(mNextFreeEntry, &phyAddr);
+            if (rc != ESP_OK) {
+                return rc;
+            }
+            return mPartition->write(phyAddr, data, count * ENTRY_SIZE);
+        }
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        const size_t index = mNextFreeEntry + i;
+        if (mBatchCount == BATCH_ENTRY_COUNT || (mBatchCount > 0 && mBatchFirst + mBatchCount != index)) {
+            auto err = flushBatchEntries();
+            if (err != ESP_OK) {
+                return err;
+            }
+        }
+        if (mBatchCount == 0) {
+            mBatchFirst = index;
+        }
+        memcpy(static_cast<void*>(&mBatchEntries[mBatchCount++]), data + i * ENTRY_SIZE, ENTRY_SIZE);
+    }
+    return ESP_OK;
+}
+
+esp_err_t Page::flushBatchEntries()
+{
+    if (mBatchCount == 0) {
+        return ESP_OK;
+    }
+    uint32_t phyAddr;
+    esp_err_t rc = getEntryAddress(mBatchFirst, &phyAddr);
+    if (rc == ESP_OK) {
+        rc = mPartition->write(phyAddr, mBatchEntries, mBatchCount * ENTRY_SIZE);
+    }
+    mBatchCount = 0;
+    if (rc != ESP_OK) {
+        mState = PageState::INVALID;
+        return rc;
+    }
+    return ESP_OK;
+}
+
+esp_err_t Page::writeEntryStateWords(size_t begin, size_t end)
+{
+    auto rc = mPartition->write_raw(mBaseAddress + ENTRY_TABLE_OFFSET + static_cast<uint32_t>(begin) * 4,
+            mEntryTable.data() + begin, (end - begin) * 4);
+    if (rc != ESP_OK) {
+        mState = PageState::INVALID;
+        return rc;
+    }
+    return ESP_OK;
+}
+
+void Page::beginBatch()
+{
+    mBatching = true;
+}
+
+esp_err_t Page::flushBatch()
+{
+    if (!mBatching) {
+        return ESP_OK;
+    }
+    mBatching = false;
+
+    // after a failed write, entries must not be marked as written
+    esp_err_t err = (mState == PageState::INVALID) ? ESP_ERR_NVS_INVALID_STATE : flushBatchEntries();
+    delete[] mBatchEntries;
+    mBatchEntries = nullptr;
+    mBatchCount = 0;
+    uint32_t dirty = mDirtyStateWords;
+    mDirtyStateWords = 0;
+    if (err != ESP_OK || dirty == 0) {
+        return err;
+    }
+
+    const size_t wordCount = mEntryTable.byteSize() / sizeof(uint32_t);
+    static_assert(TEntryTable::byteSize() / sizeof(uint32_t) <= 32, "dirty word mask is too small");
+
+    size_t lowest = 0;
+    while ((dirty & (1u << lowest)) == 0) {
+        ++lowest;
+    }
+    dirty &= ~(1u << lowest);
+
+    // write all other modified words first, adjacent ones with a single write
+    for (size_t end = wordCount; end > lowest;) {
+        if ((dirty & (1u << (end - 1))) == 0) {
+            --end;
+            continue;
+        }
+        size_t begin = end - 1;
+        while (begin > lowest && (dirty & (1u << (begin - 1))) != 0) {
+            --begin;
+        }
+        err = writeEntryStateWords(begin, end);
+        if (err != ESP_OK) {
+            return err;
+        }
+        end = begin;
+    }
+    return writeEntryStateWords(lowest, lowest + 1);
+}
+
 esp_err_t Page::eraseEntryAndSpan(size_t index)
 {
     uint32_t seq_num;
@@ -791,6 +943,10 @@ esp_err_t Page::alterEntryState(size_t index, EntryState state)
         return err;
     }
     size_t wordToWrite = mEntryTable.getWordIndex(index);
+    if (mBatching) {
+        mDirtyStateWords |= 1u << wordToWrite;
+        return ESP_OK;
+    }
     uint32_t word = mEntryTable.data()[wordToWrite];
     err = mPartition->write_raw(mBaseAddress + ENTRY_TABLE_OFFSET + static_cast<uint32_t>(wordToWrite) * 4,
             &word, sizeof(word));
@@ -818,7 +974,9 @@ esp_err_t Page::alterEntryRangeState(size_t begin, size_t end, EntryState state)
         } else {
             nextWordIndex = mEntryTable.getWordIndex(i - 1);
         }
-        if (nextWordIndex != wordIndex) {
+        if (nextWordIndex != wordIndex && mBatching) {
+            mDirtyStateWords |= 1u << wordIndex;
+        } else if (nextWordIndex != wordIndex) {
             uint32_t word = mEntryTable.data()[wordIndex];
             auto rc = mPartition->write_raw(mBaseAddress + ENTRY_TABLE_OFFSET + static_cast<uint32_t>(wordIndex) * 4,
                     &word, 4);
@@ -845,6 +1003,10 @@ esp_err_t Page::alterPageState(PageState state)
 
 esp_err_t Page::readEntry(size_t index, Item& dst) const
 {
+    if (mBatchCount > 0 && index >= mBatchFirst && index < mBatchFirst + mBatchCount) {
+        dst = mBatchEntries[index - mBatchFirst];
+        return ESP_OK;
+    }
     uint32_t phyAddr;
     esp_err_t rc = getEntryAddress(index, &phyAddr);
     if (rc != ESP_OK) {
@@ -1004,6 +1166,11 @@ esp_err_t Page::erase()
     mNextFreeEntry = INVALID_ENTRY;
     mState = PageState::UNINITIALIZED;
     mHashList.clear();
+    mBatching = false;
+    mBatchCount = 0;
+    mDirtyStateWords = 0;
+    delete[] mBatchEntries;
+    mBatchEntries = nullptr;
     return ESP_OK;
 }
 
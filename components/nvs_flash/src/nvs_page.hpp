@@ -45,6 +45,10 @@ public:
     static const uint8_t NS_INDEX = 0;
     static const uint8_t NS_ANY = 255;
 
+    // Namespace table item which is present while a transaction is being committed.
+    // Its name can't be used for a namespace.
+    static constexpr char COMMIT_MARKER_KEY[] = "nvs.commit";
+
     static const uint8_t CHUNK_ANY = Item::CHUNK_ANY;
 
     static const uint8_t NVS_VERSION = 0xfe; // Decrement to upgrade
@@ -73,6 +77,8 @@ public:
 
     Page();
 
+    ~Page();
+
     PageState state() const
     {
         return mState;
@@ -80,6 +86,18 @@ public:
 
     esp_err_t load(Partition *partition, uint32_t sectorNumber);
 
+    /**
+     * First part of load(): reads the page header, which is enough to know the state and the
+     * sequence number of the page. The page must not be used before loadEntries() is called.
+     */
+    esp_err_t loadHeader(Partition *partition, uint32_t sectorNumber);
+
+    /**
+     * Second part of load(): reads the entry state table and the item headers of a used page,
+     * or checks that an uninitialized page is really empty.
+     */
+    esp_err_t loadEntries();
+
     esp_err_t getSeqNumber(uint32_t& seqNumber) const;
 
     esp_err_t setSeqNumber(uint32_t seqNumber);
@@ -94,6 +112,11 @@ public:
 
     esp_err_t eraseItem(uint8_t nsIndex, ItemType datatype, const char* key, uint8_t chunkIdx = CHUNK_ANY, VerOffset chunkStart = VerOffset::VER_ANY);
 
+    /**
+     * Erases the item which starts at the given index, as returned by findItem().
+     */
+    esp_err_t eraseEntryAndSpan(size_t index);
+
     esp_err_t findItem(uint8_t nsIndex, ItemType datatype, const char* key, uint8_t chunkIdx = CHUNK_ANY, VerOffset chunkStart = VerOffset::VER_ANY);
 
     esp_err_t findItem(uint8_t nsIndex, ItemType datatype, const char* key, size_t &itemIndex, Item& item, uint8_t chunkIdx = CHUNK_ANY, VerOffset chunkStart = VerOffset::VER_ANY);
@@ -145,6 +168,40 @@ public:
 
     esp_err_t calcEntries(nvs_stats_t &nvsStats);
 
+    /**
+     * Calls func(hash, index) for every item cached in the hash list of this page.
+     * Used by ItemIndex to mirror the page contents without reading flash.
+     */
+    template<typename F>
+    void forEachItemHash(F func)
+    {
+        mHashList.forEach(func);
+    }
+
+    /**
+     * Starts deferring flash writes of this page.
+     *
+     * Until flushBatch() is called, entries written by writeItem are collected in RAM and written
+     * to flash in larger chunks, and changes of the entry state table are only applied to its
+     * in-memory copy. Reads of the page are served from the pending data.
+     */
+    void beginBatch();
+
+    /**
+     * Writes out all pending entries, then all modified words of the entry state table.
+     *
+     * The lowest modified word of the entry state table is written last. When the batch appended
+     * entries to the page, this is the word which marks the first of them as written. If power is
+     * lost before that, Page::load() finds unmarked data at mNextFreeEntry and erases all the
+     * entries of the batch.
+     */
+    esp_err_t flushBatch();
+
+    bool isBatching() const
+    {
+        return mBatching;
+    }
+
 protected:
 
     class Header
@@ -188,7 +245,11 @@ protected:
 
     esp_err_t writeEntryData(const uint8_t* data, size_t size);
 
-    esp_err_t eraseEntryAndSpan(size_t index);
+    esp_err_t bufferEntries(const uint8_t* data, size_t count);
+
+    esp_err_t flushBatchEntries();
+
+    esp_err_t writeEntryStateWords(size_t begin, size_t end);
 
     esp_err_t updateFirstUsedEntry(size_t index, size_t span);
 
@@ -226,6 +287,17 @@ protected:
 
     Partition *mPartition;
 
+    /**
+     * State of a batch started by beginBatch(). Entries appended to the page are kept in mBatchEntries,
+     * starting at index mBatchFirst. Each bit in mDirtyStateWords marks a modified word of mEntryTable.
+     */
+    static const size_t BATCH_ENTRY_COUNT = 16;
+    bool mBatching = false;
+    Item* mBatchEntries = nullptr;
+    size_t mBatchFirst = 0;
+    size_t mBatchCount = 0;
+    uint32_t mDirtyStateWords = 0;
+
     static const uint32_t HEADER_OFFSET = 0;
     static const uint32_t ENTRY_TABLE_OFFSET = HEADER_OFFSET + 32;
     static const uint32_t ENTRY_DATA_OFFSET = ENTRY_TABLE_OFFSET + 32;
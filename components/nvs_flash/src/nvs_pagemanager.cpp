@@ -7,7 +7,7 @@
 
 namespace nvs
 {
-esp_err_t PageManager::load(Partition *partition, uint32_t baseSector, uint32_t sectorCount)
+esp_err_t PageManager::load(Partition *partition, uint32_t baseSector, uint32_t sectorCount, bool lazyLoad)
 {
     if (partition == nullptr) {
         return ESP_ERR_INVALID_ARG;
@@ -17,15 +17,21 @@ esp_err_t PageManager::load(Partition *partition, uint32_t baseSector, uint32_t
     mPageCount = sectorCount;
     mPageList.clear();
     mFreePageList.clear();
+    mLoadPending = false;
+    mNextPageToLoad = 0;
     mPages.reset(new (nothrow) Page[sectorCount]);
 
     if (!mPages) return ESP_ERR_NO_MEM;
 
+    bool freeingPageFound = false;
     for (uint32_t i = 0; i < sectorCount; ++i) {
-        auto err = mPages[i].load(partition, baseSector + i);
+        auto err = lazyLoad ? mPages[i].loadHeader(partition, baseSector + i) : mPages[i].load(partition, baseSector + i);
         if (err != ESP_OK) {
             return err;
         }
+        if (mPages[i].state() == Page::PageState::FREEING) {
+            freeingPageFound = true;
+        }
         uint32_t seqNumber;
         if (mPages[i].getSeqNumber(seqNumber) != ESP_OK) {
             mFreePageList.push_back(&mPages[i]);
@@ -42,6 +48,40 @@ esp_err_t PageManager::load(Partition *partition, uint32_t baseSector, uint32_t
         }
     }
 
+    if (lazyLoad) {
+        // report a full partition right away, unless a free page may be recovered from an interrupted reclaim
+        if (mFreePageList.empty() && !freeingPageFound) {
+            return ESP_ERR_NVS_NO_FREE_PAGES;
+        }
+        mLoadPending = true;
+        return ESP_OK;
+    }
+
+    return finishLoad();
+}
+
+esp_err_t PageManager::loadPendingPages(size_t maxCount)
+{
+    if (!mLoadPending) {
+        return ESP_OK;
+    }
+
+    for (; maxCount > 0 && mNextPageToLoad < mPageCount; --maxCount, ++mNextPageToLoad) {
+        auto err = mPages[mNextPageToLoad].loadEntries();
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+
+    if (mNextPageToLoad < mPageCount) {
+        return ESP_OK;
+    }
+    mLoadPending = false;
+    return finishLoad();
+}
+
+esp_err_t PageManager::finishLoad()
+{
     if (mPageList.empty()) {
         mSeqNumber = 0;
         return activatePage();
@@ -57,36 +97,46 @@ esp_err_t PageManager::load(Partition *partition, uint32_t baseSector, uint32_t
     // if power went out after a new item for the given key was written,
     // but before the old one was erased, we end up with a duplicate item
     Page& lastPage = back();
-    size_t lastItemIndex = SIZE_MAX;
     Item item;
     size_t itemIndex = 0;
+    size_t lastItemIndex = SIZE_MAX;
+    Item lastItem;
     while (lastPage.findItem(Page::NS_ANY, ItemType::ANY, nullptr, itemIndex, item) == ESP_OK) {
-        itemIndex += item.span;
         lastItemIndex = itemIndex;
+        lastItem = item;
+        itemIndex += item.span;
     }
 
-    if (lastItemIndex != SIZE_MAX) {
-        auto last = PageManager::TPageListIterator(&lastPage);
-        TPageListIterator it;
-
-        for (it = begin(); it != last; ++it) {
+    // A transaction commit writes many items to the last page before it erases their old versions,
+    // so if it was interrupted, any item of the last page may have one. The commit marker is erased
+    // after all of them, so that this is only checked after an interrupted commit.
+    bool commitInterrupted = false;
+    for (auto it = begin(); it != end() && !commitInterrupted; ++it) {
+        if (it->findItem(Page::NS_INDEX, ItemType::U8, Page::COMMIT_MARKER_KEY) == ESP_OK) {
+            commitInterrupted = true;
+        }
+    }
 
-            if ((it->state() != Page::PageState::FREEING) &&
-                    (it->eraseItem(item.nsIndex, item.datatype, item.key, item.chunkIndex) == ESP_OK)) {
-                break;
+    if (commitInterrupted) {
+        itemIndex = 0;
+        while (lastPage.findItem(Page::NS_ANY, ItemType::ANY, nullptr, itemIndex, item) == ESP_OK) {
+            auto err = eraseOlderVersions(item, itemIndex);
+            if (err != ESP_OK) {
+                return err;
             }
+            itemIndex += item.span;
         }
-        if ((it == last) && (item.datatype == ItemType::BLOB_IDX)) {
-            /* Rare case in which the blob was stored using old format, but power went just after writing
-             * blob index during modification. Loop again and delete the old version blob*/
-            for (it = begin(); it != last; ++it) {
-
-                if ((it->state() != Page::PageState::FREEING) &&
-                        (it->eraseItem(item.nsIndex, ItemType::BLOB, item.key, item.chunkIndex) == ESP_OK)) {
-                    break;
-                }
+        for (auto it = begin(); it != end(); ++it) {
+            auto err = it->eraseItem(Page::NS_INDEX, ItemType::U8, Page::COMMIT_MARKER_KEY);
+            if (err != ESP_OK && err != ESP_ERR_NVS_NOT_FOUND) {
+                return err;
             }
         }
+    } else if (lastItemIndex != SIZE_MAX) {
+        auto err = eraseOlderVersions(lastItem, lastItemIndex);
+        if (err != ESP_OK) {
+            return err;
+        }
     }
 
     // check if power went out while page was being freed
@@ -132,6 +182,53 @@ esp_err_t PageManager::load(Partition *partition, uint32_t baseSector, uint32_t
     return ESP_OK;
 }
 
+esp_err_t PageManager::eraseOlderVersions(const Item& item, size_t itemIndex)
+{
+    Page* lastPage = &back();
+    bool found = false;
+    for (auto it = begin(); it != end(); ++it) {
+        if (it->state() == Page::PageState::FREEING) {
+            continue;
+        }
+        size_t index = 0;
+        Item old;
+        // the hash list of a page matches on namespace, key and chunk index, but not on the type
+        while (it->findItem(item.nsIndex, ItemType::ANY, item.key, index, old, item.chunkIndex) == ESP_OK) {
+            if (static_cast<Page*>(it) == lastPage && index >= itemIndex) {
+                break;
+            }
+            bool sameItem = old.chunkIndex == item.chunkIndex;
+#ifdef CONFIG_NVS_LEGACY_DUP_KEYS_COMPATIBILITY
+            sameItem = sameItem && old.datatype == item.datatype;
+#else
+            // other than the data chunks of a blob, a key only has one item of any type
+            sameItem = sameItem && (old.datatype == item.datatype ||
+                                    (old.datatype != ItemType::BLOB_DATA && item.datatype != ItemType::BLOB_DATA));
+#endif
+            if (sameItem) {
+                auto err = it->eraseEntryAndSpan(index);
+                if (err != ESP_OK) {
+                    return err;
+                }
+                found = true;
+            }
+            index += old.span;
+        }
+    }
+
+    if (!found && item.datatype == ItemType::BLOB_IDX) {
+        /* Rare case in which the blob was stored using old format, but power went just after writing
+         * blob index during modification. Loop again and delete the old version blob*/
+        for (auto it = begin(); static_cast<Page*>(it) != lastPage; ++it) {
+            if ((it->state() != Page::PageState::FREEING) &&
+                    (it->eraseItem(item.nsIndex, ItemType::BLOB, item.key, item.chunkIndex) == ESP_OK)) {
+                break;
+            }
+        }
+    }
+    return ESP_OK;
+}
+
 esp_err_t PageManager::requestNewPage()
 {
     if (mFreePageList.empty()) {
@@ -31,7 +31,22 @@ public:
 
     PageManager() {}
 
-    esp_err_t load(Partition *partition, uint32_t baseSector, uint32_t sectorCount);
+    /**
+     * Loads all pages of the partition. With lazyLoad set, only page headers are read,
+     * loadPendingPages() has to be called before the pages can be used.
+     */
+    esp_err_t load(Partition *partition, uint32_t baseSector, uint32_t sectorCount, bool lazyLoad = false);
+
+    /**
+     * Loads entry tables of up to maxCount pages which were left out by a lazy load(). Once all pages
+     * are loaded, completes the load (recovery from interrupted operations).
+     */
+    esp_err_t loadPendingPages(size_t maxCount);
+
+    bool isLoadPending() const
+    {
+        return mLoadPending;
+    }
 
     TPageListIterator begin()
     {
@@ -66,12 +81,22 @@ protected:
 
     esp_err_t activatePage();
 
+    esp_err_t finishLoad();
+
+    /**
+     * Erases the versions of an item of the last page which were written before it,
+     * that is the ones on other pages and at lower indices of the last page.
+     */
+    esp_err_t eraseOlderVersions(const Item& item, size_t itemIndex);
+
     TPageList mPageList;
     TPageList mFreePageList;
     std::unique_ptr<Page[]> mPages;
     uint32_t mBaseSector;
     uint32_t mPageCount;
     uint32_t mSeqNumber;
+    bool mLoadPending = false;
+    uint32_t mNextPageToLoad = 0;
 }; // class PageManager
 
 
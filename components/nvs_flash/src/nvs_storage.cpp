@@ -92,12 +92,64 @@ void Storage::eraseOrphanDataBlobs(TBlobIndexList& blobIdxList)
 
 esp_err_t Storage::init(uint32_t baseSector, uint32_t sectorCount)
 {
-    auto err = mPageManager.load(mPartition, baseSector, sectorCount);
+#ifdef CONFIG_NVS_LAZY_PAGE_LOAD
+    return init(baseSector, sectorCount, true);
+#else
+    return init(baseSector, sectorCount, false);
+#endif // CONFIG_NVS_LAZY_PAGE_LOAD
+}
+
+esp_err_t Storage::init(uint32_t baseSector, uint32_t sectorCount, bool lazyLoad)
+{
+#ifdef CONFIG_NVS_VALUE_CACHE
+    // if the allocation fails, values are always read from flash
+    mValueCache.init(CONFIG_NVS_VALUE_CACHE_ENTRIES);
+#endif // CONFIG_NVS_VALUE_CACHE
+
+    auto err = mPageManager.load(mPartition, baseSector, sectorCount, lazyLoad);
     if (err != ESP_OK) {
         mState = StorageState::INVALID;
         return err;
     }
 
+    if (lazyLoad) {
+        mState = StorageState::LOADING;
+        return ESP_OK;
+    }
+    return loadContents();
+}
+
+esp_err_t Storage::loadPendingPages(size_t maxCount)
+{
+    if (mState != StorageState::LOADING) {
+        return ESP_OK;
+    }
+
+    auto err = mPageManager.loadPendingPages(maxCount);
+    if (err == ESP_OK && !mPageManager.isLoadPending()) {
+        err = loadContents();
+    }
+    if (err != ESP_OK) {
+        mState = StorageState::INVALID;
+    }
+    return err;
+}
+
+esp_err_t Storage::checkState()
+{
+    if (mState == StorageState::LOADING) {
+        auto err = loadPendingPages(SIZE_MAX);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+    return (mState == StorageState::ACTIVE) ? ESP_OK : ESP_ERR_NVS_NOT_INITIALIZED;
+}
+
+esp_err_t Storage::loadContents()
+{
+    esp_err_t err;
+
     // load namespaces list
     clearNamespaces();
     std::fill_n(mNamespaceUsage.data(), mNamespaceUsage.byteSize() / 4, 0);
@@ -149,6 +201,8 @@ esp_err_t Storage::init(uint32_t baseSector, uint32_t sectorCount)
     // Purge the blob index list
     blobIdxList.clearAndFreeNodes();
 
+    buildItemIndex();
+
 #ifdef DEBUG_STORAGE
     debugCheck();
 #endif
@@ -157,11 +211,31 @@ esp_err_t Storage::init(uint32_t baseSector, uint32_t sectorCount)
 
 bool Storage::isValid() const
 {
-    return mState == StorageState::ACTIVE;
+    return mState == StorageState::ACTIVE || mState == StorageState::LOADING;
 }
 
 esp_err_t Storage::findItem(uint8_t nsIndex, ItemType datatype, const char* key, Page* &page, Item& item, uint8_t chunkIdx, VerOffset chunkStart)
 {
+#ifdef CONFIG_NVS_ITEM_INDEX
+    if (mItemIndex.isValid() && nsIndex != Page::NS_ANY && key != nullptr) {
+        const size_t MAX_CANDIDATES = 8;
+        ItemIndex::Location candidates[MAX_CANDIDATES];
+        size_t count = mItemIndex.find(nsIndex, key, chunkIdx, candidates, MAX_CANDIDATES);
+        // with too many hash collisions, fall back to searching all pages
+        if (count <= MAX_CANDIDATES) {
+            for (size_t i = 0; i < count; ++i) {
+                size_t itemIndex = candidates[i].index;
+                auto err = candidates[i].page->findItem(nsIndex, datatype, key, itemIndex, item, chunkIdx, chunkStart);
+                if (err == ESP_OK) {
+                    page = candidates[i].page;
+                    return ESP_OK;
+                }
+            }
+            return ESP_ERR_NVS_NOT_FOUND;
+        }
+    }
+#endif // CONFIG_NVS_ITEM_INDEX
+
     for (auto it = std::begin(mPageManager); it != std::end(mPageManager); ++it) {
         size_t itemIndex = 0;
         auto err = it->findItem(nsIndex, datatype, key, itemIndex, item, chunkIdx, chunkStart);
@@ -173,6 +247,70 @@ esp_err_t Storage::findItem(uint8_t nsIndex, ItemType datatype, const char* key,
     return ESP_ERR_NVS_NOT_FOUND;
 }
 
+esp_err_t Storage::requestNewPage()
+{
+    auto err = mPageManager.requestNewPage();
+    if (err != ESP_OK) {
+        return err;
+    }
+#ifdef CONFIG_NVS_ITEM_INDEX
+    if (mItemIndex.isValid()) {
+        // if a page was reclaimed, its items now live on the new page
+        mItemIndex.removeErasedPages();
+        if (mItemIndex.addPage(getCurrentPage()) != ESP_OK) {
+            mItemIndex.clear();
+        }
+    }
+#endif // CONFIG_NVS_ITEM_INDEX
+    return ESP_OK;
+}
+
+void Storage::buildItemIndex()
+{
+#ifdef CONFIG_NVS_ITEM_INDEX
+    size_t maxItems = std::min(static_cast<size_t>(CONFIG_NVS_ITEM_INDEX_MAX_ITEMS),
+            static_cast<size_t>(mPageManager.getPageCount() * Page::ENTRY_COUNT));
+    // the index is optional, if it can't be built, lookups will search all pages
+    if (mItemIndex.init(maxItems) != ESP_OK) {
+        return;
+    }
+    for (auto it = mPageManager.begin(); it != mPageManager.end(); ++it) {
+        if (mItemIndex.addPage(*it) != ESP_OK) {
+            mItemIndex.clear();
+            return;
+        }
+    }
+#endif // CONFIG_NVS_ITEM_INDEX
+}
+
+void Storage::updateItemIndex(Page& page, uint8_t nsIndex, const char* key, uint8_t chunkIdx)
+{
+#ifdef CONFIG_NVS_ITEM_INDEX
+    if (mItemIndex.isValid() && mItemIndex.updateItem(page, nsIndex, key, chunkIdx) != ESP_OK) {
+        mItemIndex.clear();
+    }
+#endif // CONFIG_NVS_ITEM_INDEX
+}
+
+void Storage::refreshItemIndex(Page& page)
+{
+#ifdef CONFIG_NVS_ITEM_INDEX
+    if (mItemIndex.isValid()) {
+        mItemIndex.removePage(page);
+        if (mItemIndex.addPage(page) != ESP_OK) {
+            mItemIndex.clear();
+        }
+    }
+#endif // CONFIG_NVS_ITEM_INDEX
+}
+
+void Storage::invalidateCachedValue(uint8_t nsIndex, const char* key)
+{
+#ifdef CONFIG_NVS_VALUE_CACHE
+    mValueCache.invalidate(nsIndex, key);
+#endif // CONFIG_NVS_VALUE_CACHE
+}
+
 esp_err_t Storage::writeMultiPageBlob(uint8_t nsIndex, const char* key, const void* data, size_t dataSize, VerOffset chunkStart)
 {
     uint8_t chunkCount = 0;
@@ -204,7 +342,7 @@ esp_err_t Storage::writeMultiPageBlob(uint8_t nsIndex, const char* key, const vo
                     return err;
                 }
             }
-            err = mPageManager.requestNewPage();
+            err = requestNewPage();
             if (err != ESP_OK) {
                 return err;
             } else if(getCurrentPage().getVarDataTailroom() == tailroom) {
@@ -224,9 +362,11 @@ esp_err_t Storage::writeMultiPageBlob(uint8_t nsIndex, const char* key, const vo
         chunkSize = (remainingSize > tailroom)? tailroom : remainingSize;
         remainingSize -= chunkSize;
 
+        const uint8_t chunkIdx = static_cast<uint8_t> (chunkStart) + chunkCount;
         err = page.writeItem(nsIndex, ItemType::BLOB_DATA, key,
-                static_cast<const uint8_t*> (data) + offset, chunkSize, static_cast<uint8_t> (chunkStart) + chunkCount);
+                static_cast<const uint8_t*> (data) + offset, chunkSize, chunkIdx);
         chunkCount++;
+        updateItemIndex(page, nsIndex, key, chunkIdx);
 
         if (err != ESP_OK) {
             NVS_ASSERT_OR_RETURN(err != ESP_ERR_NVS_PAGE_FULL, err);
@@ -246,7 +386,7 @@ esp_err_t Storage::writeMultiPageBlob(uint8_t nsIndex, const char* key, const vo
                         break;
                     }
                 }
-                err = mPageManager.requestNewPage();
+                err = requestNewPage();
                 if (err != ESP_OK) {
                     break;
                 }
@@ -263,6 +403,7 @@ esp_err_t Storage::writeMultiPageBlob(uint8_t nsIndex, const char* key, const vo
 
             err = getCurrentPage().writeItem(nsIndex, ItemType::BLOB_IDX, key, item.data, sizeof(item.data));
             NVS_ASSERT_OR_RETURN(err != ESP_ERR_NVS_PAGE_FULL, err);
+            updateItemIndex(getCurrentPage(), nsIndex, key);
             break;
         }
     } while (1);
@@ -271,7 +412,9 @@ esp_err_t Storage::writeMultiPageBlob(uint8_t nsIndex, const char* key, const vo
         /* Anything failed, then we should erase all the written chunks*/
         int ii=0;
         for (auto it = std::begin(usedPages); it != std::end(usedPages); it++) {
-            it->mPage->eraseItem(nsIndex, ItemType::BLOB_DATA, key, ii++);
+            it->mPage->eraseItem(nsIndex, ItemType::BLOB_DATA, key, ii);
+            updateItemIndex(*it->mPage, nsIndex, key, ii);
+            ii++;
         }
     }
     usedPages.clearAndFreeNodes();
@@ -280,15 +423,17 @@ esp_err_t Storage::writeMultiPageBlob(uint8_t nsIndex, const char* key, const vo
 
 esp_err_t Storage::writeItem(uint8_t nsIndex, ItemType datatype, const char* key, const void* data, size_t dataSize)
 {
-    if (mState != StorageState::ACTIVE) {
-        return ESP_ERR_NVS_NOT_INITIALIZED;
+    auto err = checkState();
+    if (err != ESP_OK) {
+        return err;
     }
 
+    invalidateCachedValue(nsIndex, key);
+
     Page* findPage = nullptr;
     bool matchedTypePageFound = false;
     Item item;
 
-    esp_err_t err;
     if (datatype == ItemType::BLOB) {
         err = findItem(nsIndex, ItemType::BLOB_IDX, key, findPage, item);
         if(err == ESP_OK) {
@@ -386,7 +531,7 @@ esp_err_t Storage::writeItem(uint8_t nsIndex, ItemType datatype, const char* key
                     return err;
                 }
             }
-            err = mPageManager.requestNewPage();
+            err = requestNewPage();
             if (err != ESP_OK) {
                 return err;
             }
@@ -398,8 +543,11 @@ esp_err_t Storage::writeItem(uint8_t nsIndex, ItemType datatype, const char* key
             if (err != ESP_OK) {
                 return err;
             }
+            updateItemIndex(getCurrentPage(), nsIndex, key);
         } else if (err != ESP_OK) {
             return err;
+        } else {
+            updateItemIndex(page, nsIndex, key);
         }
     }
 
@@ -420,6 +568,7 @@ esp_err_t Storage::writeItem(uint8_t nsIndex, ItemType datatype, const char* key
 #else
         err = findPage->eraseItem(nsIndex, ItemType::ANY, key);
 #endif
+        updateItemIndex(*findPage, nsIndex, key);
         if (err == ESP_ERR_FLASH_OP_FAIL) {
             return ESP_ERR_NVS_REMOVE_FAILED;
         }
@@ -433,10 +582,216 @@ esp_err_t Storage::writeItem(uint8_t nsIndex, ItemType datatype, const char* key
     return ESP_OK;
 }
 
+/**
+ * Only primitive values and strings are written in a batch. Page::load() tells data which wasn't marked
+ * as written apart from free space by the first word of each entry, so string data entries
+ * starting with 0xffffffff would not be rolled back if power is lost while a batch is written.
+ */
+static bool canWriteInBatch(ItemType datatype, const uint8_t* data, size_t dataSize)
+{
+    if (datatype == ItemType::ANY || datatype == ItemType::BLOB) {
+        return false;
+    }
+    if (datatype != ItemType::SZ) {
+        return true;
+    }
+    for (size_t offset = 0; offset < dataSize; offset += Page::ENTRY_SIZE) {
+        uint32_t header = UINT32_MAX;
+        memcpy(&header, data + offset, std::min(sizeof(header), dataSize - offset));
+        if (header == UINT32_MAX) {
+            return false;
+        }
+    }
+    return true;
+}
+
+esp_err_t Storage::writeItems(uint8_t nsIndex, TPendingItemList& items)
+{
+    auto err = checkState();
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    // Keys are unique, so the order in which items are applied doesn't matter.
+    // Erasures and items which can't be batched are done first, the usual way.
+    for (auto it = std::begin(items); it != std::end(items); ++it) {
+        esp_err_t err = ESP_OK;
+        if (it->mDatatype == ItemType::ANY) {
+            err = eraseItem(nsIndex, ItemType::ANY, it->mKey);
+            if (err == ESP_ERR_NVS_NOT_FOUND) {
+                err = ESP_OK;
+            }
+        } else if (!canWriteInBatch(it->mDatatype, it->mData, it->mDataSize)) {
+            err = writeItem(nsIndex, it->mDatatype, it->mKey, it->mData, it->mDataSize);
+        }
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+
+    auto batched = std::find_if(std::begin(items), std::end(items), [](const PendingItemNode& node) -> bool {
+        return canWriteInBatch(node.mDatatype, node.mData, node.mDataSize);
+    });
+    if (batched == std::end(items)) {
+        return ESP_OK;
+    }
+
+    // While the marker is present, PageManager::finishLoad() checks all items of the last page
+    // for old versions which weren't erased yet
+    uint8_t marker = Page::NS_ANY;
+    err = writeItem(Page::NS_INDEX, ItemType::U8, Page::COMMIT_MARKER_KEY, &marker, sizeof(marker));
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    for (auto it = batched; it != std::end(items) && err == ESP_OK; ++it) {
+        if (canWriteInBatch(it->mDatatype, it->mData, it->mDataSize)) {
+            err = writeBatchItem(nsIndex, items, *it);
+        }
+    }
+
+    // always called, so that no page is left with deferred writes
+    esp_err_t finishErr = finishBatch(nsIndex, items);
+    if (err == ESP_OK) {
+        err = finishErr;
+    }
+    // after a failure, old versions may be left, which the next load erases
+    if (err == ESP_OK) {
+        err = eraseItem(Page::NS_INDEX, ItemType::U8, Page::COMMIT_MARKER_KEY);
+    }
+#ifdef DEBUG_STORAGE
+    debugCheck();
+#endif
+    return err;
+}
+
+esp_err_t Storage::writeBatchItem(uint8_t nsIndex, TPendingItemList& items, PendingItemNode& node)
+{
+    invalidateCachedValue(nsIndex, node.mKey);
+
+    Page* findPage = nullptr;
+    bool matchedTypePageFound = false;
+    Item item;
+
+#ifdef CONFIG_NVS_LEGACY_DUP_KEYS_COMPATIBILITY
+    esp_err_t err = findItem(nsIndex, node.mDatatype, node.mKey, findPage, item);
+    if (err == ESP_OK && findPage != nullptr) {
+        matchedTypePageFound = true;
+    }
+#else
+    esp_err_t err = findItem(nsIndex, ItemType::ANY, node.mKey, findPage, item);
+    if (err == ESP_OK && node.mDatatype == item.datatype) {
+        matchedTypePageFound = true;
+    }
+#endif
+    if (err != ESP_OK && err != ESP_ERR_NVS_NOT_FOUND) {
+        return err;
+    }
+
+    if (matchedTypePageFound &&
+            findPage->cmpItem(nsIndex, node.mDatatype, node.mKey, node.mData, node.mDataSize) == ESP_OK) {
+        return ESP_OK;
+    }
+
+    Page* page = &getCurrentPage();
+    page->beginBatch();
+    err = page->writeItem(nsIndex, node.mDatatype, node.mKey, node.mData, node.mDataSize);
+    if (err == ESP_ERR_NVS_PAGE_FULL) {
+        // complete the batch on this page before requestNewPage() moves items around
+        err = finishBatch(nsIndex, items);
+        if (err != ESP_OK) {
+            return err;
+        }
+        if (page->state() != Page::PageState::FULL) {
+            err = page->markFull();
+            if (err != ESP_OK) {
+                return err;
+            }
+        }
+        err = requestNewPage();
+        if (err != ESP_OK) {
+            return err;
+        }
+
+        page = &getCurrentPage();
+        page->beginBatch();
+        err = page->writeItem(nsIndex, node.mDatatype, node.mKey, node.mData, node.mDataSize);
+        if (err == ESP_ERR_NVS_PAGE_FULL) {
+            return ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+        }
+    }
+    if (err != ESP_OK) {
+        return err;
+    }
+    updateItemIndex(*page, nsIndex, node.mKey);
+
+    node.mOldPage = findPage;
+    node.mInBatch = true;
+    return ESP_OK;
+}
+
+esp_err_t Storage::finishBatch(uint8_t nsIndex, TPendingItemList& items)
+{
+    // new versions have to be on flash before old versions are erased
+    esp_err_t writeErr = getCurrentPage().flushBatch();
+    esp_err_t err = writeErr;
+
+    for (auto it = std::begin(items); it != std::end(items); ++it) {
+        if (!it->mInBatch) {
+            continue;
+        }
+        Page* findPage = it->mOldPage;
+        it->mInBatch = false;
+        it->mOldPage = nullptr;
+        if (findPage == nullptr || err != ESP_OK) {
+            continue;
+        }
+
+        Item item;
+        if (findPage->state() == Page::PageState::UNINITIALIZED ||
+                findPage->state() == Page::PageState::INVALID) {
+#ifdef CONFIG_NVS_LEGACY_DUP_KEYS_COMPATIBILITY
+            err = findItem(nsIndex, it->mDatatype, it->mKey, findPage, item);
+#else
+            err = findItem(nsIndex, ItemType::ANY, it->mKey, findPage, item);
+#endif
+            if (err != ESP_OK) {
+                continue;
+            }
+        }
+        findPage->beginBatch();
+#ifdef CONFIG_NVS_LEGACY_DUP_KEYS_COMPATIBILITY
+        err = findPage->eraseItem(nsIndex, it->mDatatype, it->mKey);
+#else
+        err = findPage->eraseItem(nsIndex, ItemType::ANY, it->mKey);
+#endif
+        updateItemIndex(*findPage, nsIndex, it->mKey);
+    }
+
+    for (auto it = std::begin(mPageManager); it != std::end(mPageManager); ++it) {
+        esp_err_t flushErr = it->flushBatch();
+        if (err == ESP_OK) {
+            err = flushErr;
+        }
+    }
+
+    if (writeErr != ESP_OK) {
+        return writeErr;
+    }
+    if (err == ESP_ERR_FLASH_OP_FAIL) {
+        return ESP_ERR_NVS_REMOVE_FAILED;
+    }
+    return err;
+}
+
 esp_err_t Storage::createOrOpenNamespace(const char* nsName, bool canCreate, uint8_t& nsIndex)
 {
-    if (mState != StorageState::ACTIVE) {
-        return ESP_ERR_NVS_NOT_INITIALIZED;
+    auto err = checkState();
+    if (err != ESP_OK) {
+        return err;
+    }
+    if (strncmp(nsName, Page::COMMIT_MARKER_KEY, Item::MAX_KEY_LENGTH) == 0) {
+        return ESP_ERR_NVS_INVALID_NAME;
     }
     auto it = std::find_if(mNamespaces.begin(), mNamespaces.end(), [=] (const NamespaceEntry& e) -> bool {
         return strncmp(nsName, e.mName, sizeof(e.mName) - 1) == 0;
@@ -488,11 +843,16 @@ esp_err_t Storage::createOrOpenNamespace(const char* nsName, bool canCreate, uin
 
 esp_err_t Storage::readMultiPageBlob(uint8_t nsIndex, const char* key, void* data, size_t dataSize)
 {
+    auto err = checkState();
+    if (err != ESP_OK) {
+        return err;
+    }
+
     Item item;
     Page* findPage = nullptr;
 
     /* First read the blob index */
-    auto err = findItem(nsIndex, ItemType::BLOB_IDX, key, findPage, item);
+    err = findItem(nsIndex, ItemType::BLOB_IDX, key, findPage, item);
     if (err != ESP_OK) {
         return err;
     }
@@ -530,11 +890,16 @@ esp_err_t Storage::readMultiPageBlob(uint8_t nsIndex, const char* key, void* dat
 
 esp_err_t Storage::cmpMultiPageBlob(uint8_t nsIndex, const char* key, const void* data, size_t dataSize)
 {
+    auto err = checkState();
+    if (err != ESP_OK) {
+        return err;
+    }
+
     Item item;
     Page* findPage = nullptr;
 
     /* First read the blob index */
-    auto err = findItem(nsIndex, ItemType::BLOB_IDX, key, findPage, item);
+    err = findItem(nsIndex, ItemType::BLOB_IDX, key, findPage, item);
     if (err != ESP_OK) {
         return err;
     }
@@ -572,8 +937,9 @@ esp_err_t Storage::cmpMultiPageBlob(uint8_t nsIndex, const char* key, const void
 
 esp_err_t Storage::readItem(uint8_t nsIndex, ItemType datatype, const char* key, void* data, size_t dataSize)
 {
-    if (mState != StorageState::ACTIVE) {
-        return ESP_ERR_NVS_NOT_INITIALIZED;
+    auto err = checkState();
+    if (err != ESP_OK) {
+        return err;
     }
 
     Item item;
@@ -585,28 +951,51 @@ esp_err_t Storage::readItem(uint8_t nsIndex, ItemType datatype, const char* key,
         } // else check if the blob is stored with earlier version format without index
     }
 
-    auto err = findItem(nsIndex, datatype, key, findPage, item);
+#ifdef CONFIG_NVS_VALUE_CACHE
+    const uint8_t* cachedData;
+    size_t cachedSize;
+    if (ValueCache::isCacheable(datatype, 0) && mValueCache.find(nsIndex, datatype, key, cachedData, cachedSize)) {
+        // same checks as in Page::readItem
+        if (!isVariableLengthType(datatype) && dataSize != cachedSize) {
+            return ESP_ERR_NVS_TYPE_MISMATCH;
+        }
+        if (dataSize < cachedSize) {
+            return ESP_ERR_NVS_INVALID_LENGTH;
+        }
+        memcpy(data, cachedData, cachedSize);
+        return ESP_OK;
+    }
+#endif // CONFIG_NVS_VALUE_CACHE
+
+    err = findItem(nsIndex, datatype, key, findPage, item);
     if (err != ESP_OK) {
         return err;
     }
-    return findPage->readItem(nsIndex, datatype, key, data, dataSize);
-
+    err = findPage->readItem(nsIndex, datatype, key, data, dataSize);
+#ifdef CONFIG_NVS_VALUE_CACHE
+    if (err == ESP_OK) {
+        mValueCache.put(nsIndex, datatype, key, data, isVariableLengthType(datatype) ? item.varLength.dataSize : dataSize);
+    }
+#endif // CONFIG_NVS_VALUE_CACHE
+    return err;
 }
 
 esp_err_t Storage::eraseMultiPageBlob(uint8_t nsIndex, const char* key, VerOffset chunkStart)
 {
-    if (mState != StorageState::ACTIVE) {
-        return ESP_ERR_NVS_NOT_INITIALIZED;
+    auto err = checkState();
+    if (err != ESP_OK) {
+        return err;
     }
     Item item;
     Page* findPage = nullptr;
 
-    auto err = findItem(nsIndex, ItemType::BLOB_IDX, key, findPage, item, Page::CHUNK_ANY, chunkStart);
+    err = findItem(nsIndex, ItemType::BLOB_IDX, key, findPage, item, Page::CHUNK_ANY, chunkStart);
     if (err != ESP_OK) {
         return err;
     }
     /* Erase the index first and make children blobs orphan*/
     err = findPage->eraseItem(nsIndex, ItemType::BLOB_IDX, key, Page::CHUNK_ANY, chunkStart);
+    updateItemIndex(*findPage, nsIndex, key);
     if (err != ESP_OK) {
         return err;
     }
@@ -629,6 +1018,7 @@ esp_err_t Storage::eraseMultiPageBlob(uint8_t nsIndex, const char* key, VerOffse
             continue; // Keep erasing other chunks
         }
         err = findPage->eraseItem(nsIndex, ItemType::BLOB_DATA, key, static_cast<uint8_t> (chunkStart) + chunkNum);
+        updateItemIndex(*findPage, nsIndex, key, static_cast<uint8_t> (chunkStart) + chunkNum);
         if (err != ESP_OK) {
             return err;
         }
@@ -640,17 +1030,20 @@ esp_err_t Storage::eraseMultiPageBlob(uint8_t nsIndex, const char* key, VerOffse
 
 esp_err_t Storage::eraseItem(uint8_t nsIndex, ItemType datatype, const char* key)
 {
-    if (mState != StorageState::ACTIVE) {
-        return ESP_ERR_NVS_NOT_INITIALIZED;
+    auto err = checkState();
+    if (err != ESP_OK) {
+        return err;
     }
 
+    invalidateCachedValue(nsIndex, key);
+
     if (datatype == ItemType::BLOB) {
         return eraseMultiPageBlob(nsIndex, key);
     }
 
     Item item;
     Page* findPage = nullptr;
-    auto err = findItem(nsIndex, datatype, key, findPage, item);
+    err = findItem(nsIndex, datatype, key, findPage, item);
     if (err != ESP_OK) {
         return err;
     }
@@ -659,24 +1052,37 @@ esp_err_t Storage::eraseItem(uint8_t nsIndex, ItemType datatype, const char* key
         return eraseMultiPageBlob(nsIndex, key);
     }
 
-    return findPage->eraseItem(nsIndex, datatype, key);
+    err = findPage->eraseItem(nsIndex, datatype, key);
+    updateItemIndex(*findPage, nsIndex, key);
+    return err;
 }
 
 esp_err_t Storage::eraseNamespace(uint8_t nsIndex)
 {
-    if (mState != StorageState::ACTIVE) {
-        return ESP_ERR_NVS_NOT_INITIALIZED;
+    auto err = checkState();
+    if (err != ESP_OK) {
+        return err;
     }
 
+#ifdef CONFIG_NVS_VALUE_CACHE
+    mValueCache.invalidateNamespace(nsIndex);
+#endif // CONFIG_NVS_VALUE_CACHE
+
     for (auto it = std::begin(mPageManager); it != std::end(mPageManager); ++it) {
+        bool erased = false;
         while (true) {
             auto err = it->eraseItem(nsIndex, ItemType::ANY, nullptr);
             if (err == ESP_ERR_NVS_NOT_FOUND) {
                 break;
             }
             else if (err != ESP_OK) {
+                refreshItemIndex(*it);
                 return err;
             }
+            erased = true;
+        }
+        if (erased) {
+            refreshItemIndex(*it);
         }
     }
     return ESP_OK;
@@ -685,13 +1091,23 @@ esp_err_t Storage::eraseNamespace(uint8_t nsIndex)
 
 esp_err_t Storage::getItemDataSize(uint8_t nsIndex, ItemType datatype, const char* key, size_t& dataSize)
 {
-    if (mState != StorageState::ACTIVE) {
-        return ESP_ERR_NVS_NOT_INITIALIZED;
+    auto err = checkState();
+    if (err != ESP_OK) {
+        return err;
     }
 
+#ifdef CONFIG_NVS_VALUE_CACHE
+    const uint8_t* cachedData;
+    size_t cachedSize;
+    if (datatype == ItemType::SZ && mValueCache.find(nsIndex, datatype, key, cachedData, cachedSize, false)) {
+        dataSize = cachedSize;
+        return ESP_OK;
+    }
+#endif // CONFIG_NVS_VALUE_CACHE
+
     Item item;
     Page* findPage = nullptr;
-    auto err = findItem(nsIndex, datatype, key, findPage, item);
+    err = findItem(nsIndex, datatype, key, findPage, item);
     if (err != ESP_OK) {
         if (datatype != ItemType::BLOB) {
             return err;
@@ -710,6 +1126,9 @@ esp_err_t Storage::getItemDataSize(uint8_t nsIndex, ItemType datatype, const cha
 
 void Storage::debugDump()
 {
+    if (checkState() != ESP_OK) {
+        return;
+    }
     for (auto p = mPageManager.begin(); p != mPageManager.end(); ++p) {
         p->debugDump();
     }
@@ -744,16 +1163,31 @@ void Storage::debugCheck()
 
 esp_err_t Storage::fillStats(nvs_stats_t& nvsStats)
 {
+    auto err = checkState();
+    if (err != ESP_OK) {
+        return err;
+    }
+
     nvsStats.namespace_count = mNamespaces.size();
     return mPageManager.fillStats(nvsStats);
 }
 
+void Storage::fillCacheStats(nvs_cache_stats_t& cacheStats)
+{
+#ifdef CONFIG_NVS_VALUE_CACHE
+    mValueCache.fillStats(cacheStats);
+#else
+    cacheStats = {};
+#endif // CONFIG_NVS_VALUE_CACHE
+}
+
 esp_err_t Storage::calcEntriesInNamespace(uint8_t nsIndex, size_t& usedEntries)
 {
     usedEntries = 0;
 
-    if (mState != StorageState::ACTIVE) {
-        return ESP_ERR_NVS_NOT_INITIALIZED;
+    auto err = checkState();
+    if (err != ESP_OK) {
+        return err;
     }
 
     for (auto it = std::begin(mPageManager); it != std::end(mPageManager); ++it) {
@@ -791,6 +1225,10 @@ void Storage::fillEntryInfo(Item &item, nvs_entry_info_t &info)
 
 bool Storage::findEntry(nvs_opaque_iterator_t* it, const char* namespace_name)
 {
+    if (checkState() != ESP_OK) {
+        return false;
+    }
+
     it->entryIndex = 0;
     it->nsIndex = Page::NS_ANY;
     it->page = mPageManager.begin();
@@ -806,6 +1244,10 @@ bool Storage::findEntry(nvs_opaque_iterator_t* it, const char* namespace_name)
 
 bool Storage::findEntryNs(nvs_opaque_iterator_t* it, uint8_t nsIndex)
 {
+    if (checkState() != ESP_OK) {
+        return false;
+    }
+
     it->entryIndex = 0;
     it->nsIndex = nsIndex;
     it->page = mPageManager.begin();
@@ -1,5 +1,5 @@
 /*
- * SPDX-FileCopyrightText: 2015-2022 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2015-2023 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
@@ -13,6 +13,8 @@
 #include "nvs_types.hpp"
 #include "nvs_page.hpp"
 #include "nvs_pagemanager.hpp"
+#include "nvs_item_index.hpp"
+#include "nvs_value_cache.hpp"
 #include "nvs_memory_management.hpp"
 #include "partition.hpp"
 
@@ -26,6 +28,7 @@ class Storage : public intrusive_list_node<Storage>, public ExceptionlessAllocat
     enum class StorageState : uint32_t {
         INVALID,
         ACTIVE,
+        LOADING,
     };
 
     struct NamespaceEntry : public intrusive_list_node<NamespaceEntry>, public ExceptionlessAllocatable {
@@ -53,6 +56,29 @@ class Storage : public intrusive_list_node<Storage>, public ExceptionlessAllocat
     typedef intrusive_list<BlobIndexNode> TBlobIndexList;
 
 public:
+    /**
+     * A write staged by a transaction, see NVSHandle::transaction_begin().
+     * An item with datatype ItemType::ANY stands for erasing the key.
+     */
+    struct PendingItemNode: public intrusive_list_node<PendingItemNode>, public ExceptionlessAllocatable {
+        public:
+            ~PendingItemNode()
+            {
+                delete[] mData;
+            }
+
+            char mKey[Item::MAX_KEY_LENGTH + 1];
+            ItemType mDatatype;
+            uint8_t* mData = nullptr;
+            size_t mDataSize = 0;
+
+            // used by Storage::writeItems to track the version to be erased
+            Page* mOldPage = nullptr;
+            bool mInBatch = false;
+    };
+
+    typedef intrusive_list<PendingItemNode> TPendingItemList;
+
     ~Storage();
 
     Storage(Partition *partition) : mPartition(partition) {
@@ -63,6 +89,24 @@ public:
 
     esp_err_t init(uint32_t baseSector, uint32_t sectorCount);
 
+    /**
+     * With lazyLoad set, only page headers are read here. Entry tables, namespaces and blob indices are
+     * loaded either step by step through loadPendingPages(), or all at once by the first operation
+     * which needs them.
+     */
+    esp_err_t init(uint32_t baseSector, uint32_t sectorCount, bool lazyLoad);
+
+    /**
+     * Loads entry tables of up to maxCount pages left out by a lazy init(). After the last page,
+     * the rest of the initialization is done as well.
+     */
+    esp_err_t loadPendingPages(size_t maxCount);
+
+    bool isLoadPending() const
+    {
+        return mState == StorageState::LOADING;
+    }
+
     bool isValid() const;
 
     esp_err_t createOrOpenNamespace(const char* nsName, bool canCreate, uint8_t& nsIndex);
@@ -75,6 +119,15 @@ public:
 
     esp_err_t eraseItem(uint8_t nsIndex, ItemType datatype, const char* key);
 
+    /**
+     * Applies a list of writes and erasures with unique keys, e.g. the ones staged by a transaction.
+     *
+     * Primitive values and strings are appended to the current page in a batch: their entries
+     * and the entry state table words are written with as few flash operations as possible,
+     * and old versions are erased afterwards, page by page. Other items are written one by one.
+     */
+    esp_err_t writeItems(uint8_t nsIndex, TPendingItemList& items);
+
     template<typename T>
     esp_err_t writeItem(uint8_t nsIndex, const char* key, const T& value)
     {
@@ -123,6 +176,8 @@ public:
 
     esp_err_t fillStats(nvs_stats_t& nvsStats);
 
+    void fillCacheStats(nvs_cache_stats_t& cacheStats);
+
     esp_err_t calcEntriesInNamespace(uint8_t nsIndex, size_t& usedEntries);
 
     bool findEntry(nvs_opaque_iterator_t* it, const char* name);
@@ -138,6 +193,10 @@ protected:
         return mPageManager.back();
     }
 
+    esp_err_t checkState();
+
+    esp_err_t loadContents();
+
     void clearNamespaces();
 
     esp_err_t populateBlobIndices(TBlobIndexList&);
@@ -148,6 +207,20 @@ protected:
 
     esp_err_t findItem(uint8_t nsIndex, ItemType datatype, const char* key, Page* &page, Item& item, uint8_t chunkIdx = Page::CHUNK_ANY, VerOffset chunkStart = VerOffset::VER_ANY);
 
+    esp_err_t requestNewPage();
+
+    esp_err_t writeBatchItem(uint8_t nsIndex, TPendingItemList& items, PendingItemNode& node);
+
+    esp_err_t finishBatch(uint8_t nsIndex, TPendingItemList& items);
+
+    void buildItemIndex();
+
+    void updateItemIndex(Page& page, uint8_t nsIndex, const char* key, uint8_t chunkIdx = Page::CHUNK_ANY);
+
+    void refreshItemIndex(Page& page);
+
+    void invalidateCachedValue(uint8_t nsIndex, const char* key);
+
 protected:
     Partition *mPartition;
     size_t mPageCount;
@@ -155,6 +228,12 @@ protected:
     TNamespaces mNamespaces;
     CompressedEnumTable<bool, 1, 256> mNamespaceUsage;
     StorageState mState = StorageState::INVALID;
+#ifdef CONFIG_NVS_ITEM_INDEX
+    ItemIndex mItemIndex;
+#endif
+#ifdef CONFIG_NVS_VALUE_CACHE
+    ValueCache mValueCache;
+#endif
 };
 
 } // namespace nvs
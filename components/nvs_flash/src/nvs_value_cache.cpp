@@ -0,0 +1,166 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "nvs_value_cache.hpp"
+#include <cstring>
+#include <new>
+
+namespace nvs
+{
+
+ValueCache::ValueCache()
+{
+}
+
+ValueCache::~ValueCache()
+{
+    clear();
+}
+
+esp_err_t ValueCache::init(size_t capacity)
+{
+    clear();
+
+    mNodes = new (std::nothrow) CacheNode[capacity];
+    if (!mNodes) {
+        return ESP_ERR_NO_MEM;
+    }
+    for (size_t i = 0; i < capacity; ++i) {
+        mFree.push_back(&mNodes[i]);
+    }
+    mCapacity = capacity;
+    return ESP_OK;
+}
+
+void ValueCache::clear()
+{
+    mUsed.clear();
+    mFree.clear();
+    delete[] mNodes;
+    mNodes = nullptr;
+    mCapacity = 0;
+    mHits = 0;
+    mMisses = 0;
+    mEvictions = 0;
+}
+
+uint32_t ValueCache::calculateHash(uint8_t nsIndex, const char* key)
+{
+    // FNV-1a, only used to skip most key comparisons
+    uint32_t hash = 2166136261u ^ nsIndex;
+    hash *= 16777619u;
+    for (size_t i = 0; i < Item::MAX_KEY_LENGTH && key[i] != '\0'; ++i) {
+        hash ^= static_cast<uint8_t>(key[i]);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+bool ValueCache::find(uint8_t nsIndex, ItemType datatype, const char* key, const uint8_t*& data, size_t& dataSize, bool countLookup)
+{
+    if (!isValid()) {
+        return false;
+    }
+
+    const uint32_t hash = calculateHash(nsIndex, key);
+    for (auto it = mUsed.begin(); it != mUsed.end(); ++it) {
+        if (it->mHash != hash || it->mNsIndex != nsIndex || it->mDatatype != datatype ||
+                strncmp(it->mKey, key, sizeof(it->mKey)) != 0) {
+            continue;
+        }
+        CacheNode* node = it;
+        if (node != &mUsed.front()) {
+            mUsed.erase(node);
+            mUsed.push_front(node);
+        }
+        data = node->mData;
+        dataSize = node->mDataSize;
+        if (countLookup) {
+            ++mHits;
+        }
+        return true;
+    }
+    if (countLookup) {
+        ++mMisses;
+    }
+    return false;
+}
+
+void ValueCache::put(uint8_t nsIndex, ItemType datatype, const char* key, const void* data, size_t dataSize)
+{
+    if (!isValid() || !isCacheable(datatype, dataSize) || strnlen(key, sizeof(CacheNode::mKey)) == sizeof(CacheNode::mKey)) {
+        return;
+    }
+
+    const uint8_t* cachedData;
+    size_t cachedSize;
+    CacheNode* node;
+    if (find(nsIndex, datatype, key, cachedData, cachedSize, false)) {
+        // find() has moved the node to the front
+        node = &mUsed.front();
+    } else {
+        if (mFree.empty()) {
+            node = &mUsed.back();
+            mUsed.pop_back();
+            ++mEvictions;
+        } else {
+            node = &mFree.front();
+            mFree.pop_front();
+        }
+        node->mHash = calculateHash(nsIndex, key);
+        node->mNsIndex = nsIndex;
+        node->mDatatype = datatype;
+        strncpy(node->mKey, key, sizeof(node->mKey));
+        mUsed.push_front(node);
+    }
+    node->mDataSize = static_cast<uint8_t>(dataSize);
+    memcpy(node->mData, data, dataSize);
+}
+
+void ValueCache::release(CacheNode* node)
+{
+    mUsed.erase(node);
+    mFree.push_back(node);
+}
+
+template<typename F>
+void ValueCache::releaseIf(F pred)
+{
+    if (!isValid()) {
+        return;
+    }
+    for (auto it = mUsed.begin(); it != mUsed.end();) {
+        CacheNode* node = it++;
+        if (pred(*node)) {
+            release(node);
+        }
+    }
+}
+
+void ValueCache::invalidate(uint8_t nsIndex, const char* key)
+{
+    const uint32_t hash = calculateHash(nsIndex, key);
+    releaseIf([&](const CacheNode& node) -> bool {
+        return node.mHash == hash && node.mNsIndex == nsIndex && strncmp(node.mKey, key, sizeof(node.mKey)) == 0;
+    });
+}
+
+void ValueCache::invalidateNamespace(uint8_t nsIndex)
+{
+    releaseIf([&](const CacheNode& node) -> bool {
+        return node.mNsIndex == nsIndex;
+    });
+}
+
+void ValueCache::fillStats(nvs_cache_stats_t& stats) const
+{
+    stats.hits = mHits;
+    stats.misses = mMisses;
+    stats.evictions = mEvictions;
+    stats.used_entries = mUsed.size();
+    stats.total_entries = mCapacity;
+}
+
+} // namespace nvs
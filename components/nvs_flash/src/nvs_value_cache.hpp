@@ -0,0 +1,131 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef nvs_value_cache_hpp
+#define nvs_value_cache_hpp
+
+#include "nvs.h"
+#include "nvs_types.hpp"
+#include "intrusive_list.h"
+
+namespace nvs
+{
+
+/**
+ * Read-through cache of recently read values.
+ *
+ * Holds decoded primitive values and strings of up to MAX_DATA_SIZE bytes (including the
+ * terminating null character), keyed by namespace index, datatype and key, so that repeated
+ * reads of the same keys don't need to search pages and read entries from flash.
+ *
+ * The cache only ever contains values which have been read from flash, it is filled by
+ * Storage::readItem. Storage has to invalidate a key before it writes or erases it.
+ *
+ * All nodes are allocated in one array when the cache is initialized. Nodes in use are kept
+ * in a list ordered from the most to the least recently used one, the last node is evicted
+ * when a new value has to be stored and no free node is left. Lookups walk the list, so the
+ * capacity is meant to stay small (tens of values).
+ */
+class ValueCache
+{
+public:
+    static const size_t MAX_DATA_SIZE = 32;
+
+    ValueCache();
+    ~ValueCache();
+
+    /**
+     * Allocates room for the given number of values. Previous contents and counters are dropped.
+     */
+    esp_err_t init(size_t capacity);
+
+    /**
+     * Frees all nodes, after that the cache is invalid until init() is called again.
+     */
+    void clear();
+
+    bool isValid() const
+    {
+        return mNodes != nullptr;
+    }
+
+    static bool isCacheable(ItemType datatype, size_t dataSize)
+    {
+        switch (datatype) {
+        case ItemType::U8:
+        case ItemType::I8:
+        case ItemType::U16:
+        case ItemType::I16:
+        case ItemType::U32:
+        case ItemType::I32:
+        case ItemType::U64:
+        case ItemType::I64:
+        case ItemType::SZ:
+            return dataSize <= MAX_DATA_SIZE;
+        default:
+            return false;
+        }
+    }
+
+    /**
+     * Looks up a value. On success, data points to the cached copy of the value, which stays
+     * valid until the cache is modified.
+     *
+     * @param countLookup  whether the lookup is reflected in the hit and miss counters
+     */
+    bool find(uint8_t nsIndex, ItemType datatype, const char* key, const uint8_t*& data, size_t& dataSize, bool countLookup = true);
+
+    /**
+     * Stores a value which has just been read from flash, evicting the least recently used value if needed.
+     */
+    void put(uint8_t nsIndex, ItemType datatype, const char* key, const void* data, size_t dataSize);
+
+    /**
+     * Drops values of all datatypes stored for the given key.
+     */
+    void invalidate(uint8_t nsIndex, const char* key);
+
+    /**
+     * Drops all values of the given namespace.
+     */
+    void invalidateNamespace(uint8_t nsIndex);
+
+    void fillStats(nvs_cache_stats_t& stats) const;
+
+protected:
+    struct CacheNode : public intrusive_list_node<CacheNode> {
+        uint32_t mHash;
+        uint8_t mNsIndex;
+        ItemType mDatatype;
+        uint8_t mDataSize;
+        char mKey[Item::MAX_KEY_LENGTH + 1];
+        uint8_t mData[MAX_DATA_SIZE];
+    };
+
+    typedef intrusive_list<CacheNode> TNodeList;
+
+    static uint32_t calculateHash(uint8_t nsIndex, const char* key);
+
+    void release(CacheNode* node);
+
+    template<typename F>
+    void releaseIf(F pred);
+
+    CacheNode* mNodes = nullptr;
+    size_t mCapacity = 0;
+    TNodeList mUsed;
+    TNodeList mFree;
+    size_t mHits = 0;
+    size_t mMisses = 0;
+    size_t mEvictions = 0;
+
+private:
+    ValueCache(const ValueCache& other);
+    const ValueCache& operator= (const ValueCache& rhs);
+}; // class ValueCache
+
+} // namespace nvs
+
+#endif /* nvs_value_cache_hpp */
@@ -14,6 +14,8 @@
 #include "esp_vfs.h"
 #include "unity.h"
 #include "esp_log.h"
+#include "test_utils.h"
+#include "ccomp_timer.h"
 
 /* Dummy VFS implementation to check if VFS is called or not with expected path
  */
@@ -273,3 +275,40 @@ TEST_CASE("vfs checks mount point path", "[vfs]")
     test_register_ok("/23456789012345");
     test_register_fail("/234567890123456");
 }
+
+TEST_CASE("vfs path resolution performance with many mount points", "[vfs]")
+{
+    /* Mount points named like typical ones, the lookup time doesn't depend on their number.
+     * A few of the CONFIG_VFS_MAX_COUNT entries are left for the VFSes registered by the
+     * system, such as the console. */
+    static const char* prefixes[] = {
+        "/tst_spiffs", "/tst_fat", "/tst_littlefs", "/tst_host", "/tst_data",
+    };
+    const size_t prefix_count = sizeof(prefixes) / sizeof(prefixes[0]);
+    static dummy_vfs_t inst = {
+        .match_path = "/logs/today.txt",
+    };
+    inst.called = false;
+    esp_vfs_t desc = DUMMY_VFS();
+    for (size_t i = 0; i < prefix_count; ++i) {
+        TEST_ESP_OK( esp_vfs_register(prefixes[i], &desc, &inst) );
+    }
+    const char* last_prefix = prefixes[prefix_count - 1];
+    char path[ESP_VFS_PATH_MAX + 32];
+    snprintf(path, sizeof(path), "%s/logs/today.txt", last_prefix);
+    test_opened(&inst, path);
+
+    const int iter_count = 10000;
+    ccomp_timer_start();
+    for (int i = 0; i < iter_count; ++i) {
+        int fd = esp_vfs_open(__getreent(), path, O_RDONLY, 0);
+        esp_vfs_close(__getreent(), fd);
+    }
+    const int64_t time_diff_us = ccomp_timer_stop();
+    IDF_LOG_PERFORMANCE("vfs_open_close_path_lookup", "%d ns with %d mount points",
+                        (int) (time_diff_us * 1000 / iter_count), (int) prefix_count);
+
+    for (size_t i = 0; i < prefix_count; ++i) {
+        TEST_ESP_OK( esp_vfs_unregister(prefixes[i]) );
+    }
+}
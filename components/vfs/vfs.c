@@ -69,12 +69,80 @@ typedef struct {
     fd_set errorfds;
 } fds_triple_t;
 
+/* Table of the VFSes registered with a path prefix, used to find the VFS of a path without
+ * comparing the path with every prefix. It is an open addressing hash table of indices into
+ * s_vfs, keyed by the prefix. For a given path, only the prefixes of the path ending before
+ * a separator or at the end of the path can match, and only if a prefix of that length is
+ * registered: these are looked up from the longest to the shortest.
+ */
+#define VFS_PREFIX_TABLE_SIZE   64  /* power of 2, at least twice the maximum of VFS_MAX_COUNT */
+_Static_assert(VFS_PREFIX_TABLE_SIZE >= 2 * VFS_MAX_COUNT, "VFS prefix table too small");
+_Static_assert(ESP_VFS_PATH_MAX < 32, "prefix lengths must fit into the prefix_lens bit mask");
+
+typedef struct {
+    vfs_index_t slots[VFS_PREFIX_TABLE_SIZE];   // index into s_vfs, or -1 if unused
+    uint32_t prefix_lens;                       // bit N is set if a prefix of length N is registered
+    vfs_index_t default_vfs;                    // first VFS registered with an empty prefix, or -1
+} vfs_prefix_table_t;
+
+#define VFS_PREFIX_TABLE_EMPTY  { .slots = { [0 ... VFS_PREFIX_TABLE_SIZE-1] = -1 }, .prefix_lens = 0, .default_vfs = -1 }
+
 static vfs_entry_t* s_vfs[VFS_MAX_COUNT] = { 0 };
 static size_t s_vfs_count = 0;
 
+/* The table is rebuilt into the copy which is not in use, and then swapped, so that paths
+ * can be looked up while a VFS is registered or unregistered. A lookup may still be reading
+ * a copy when a second rebuild starts to overwrite it: s_prefix_table_seq is incremented on
+ * each swap, and a lookup which sees it change is retried with the current copy.
+ */
+static vfs_prefix_table_t s_prefix_tables[2] = { VFS_PREFIX_TABLE_EMPTY, VFS_PREFIX_TABLE_EMPTY };
+static vfs_prefix_table_t *s_prefix_table = &s_prefix_tables[0];
+static uint32_t s_prefix_table_seq;
+
 static fd_table_t s_fd_table[MAX_FDS] = { [0 ... MAX_FDS-1] = FD_TABLE_ENTRY_UNUSED };
 static _lock_t s_fd_table_lock;
 
+#define PREFIX_HASH_INIT    2166136261u /* FNV-1a */
+#define PREFIX_HASH_PRIME   16777619u
+
+static inline uint32_t prefix_hash_update(uint32_t hash, char c)
+{
+    return (hash ^ (uint8_t) c) * PREFIX_HASH_PRIME;
+}
+
+static void rebuild_prefix_table(void)
+{
+    vfs_prefix_table_t *table = (s_prefix_table == &s_prefix_tables[0]) ? &s_prefix_tables[1] : &s_prefix_tables[0];
+    *table = (vfs_prefix_table_t) VFS_PREFIX_TABLE_EMPTY;
+    for (size_t index = 0; index < s_vfs_count; ++index) {
+        const vfs_entry_t *vfs = s_vfs[index];
+        if (vfs == NULL || vfs->path_prefix_len == LEN_PATH_PREFIX_IGNORED) {
+            continue;
+        }
+        if (vfs->path_prefix_len == 0) {
+            if (table->default_vfs == -1) {
+                table->default_vfs = index;
+            }
+            continue;
+        }
+        uint32_t hash = PREFIX_HASH_INIT;
+        for (size_t i = 0; i < vfs->path_prefix_len; ++i) {
+            hash = prefix_hash_update(hash, vfs->path_prefix[i]);
+        }
+        // VFSes with the same prefix are inserted in the order of their indices, the first one is found
+        size_t slot = hash & (VFS_PREFIX_TABLE_SIZE - 1);
+        while (table->slots[slot] != -1) {
+            slot = (slot + 1) & (VFS_PREFIX_TABLE_SIZE - 1);
+        }
+        table->slots[slot] = index;
+        table->prefix_lens |= 1u << vfs->path_prefix_len;
+    }
+    __atomic_store_n(&s_prefix_table, table, __ATOMIC_RELEASE);
+    __atomic_fetch_add(&s_prefix_table_seq, 1, __ATOMIC_RELEASE);
+    // The next rebuild overwrites the previous copy only once the increment is visible
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
 esp_err_t esp_vfs_register_common(const char* base_path, size_t len, const esp_vfs_t* vfs, void* ctx, int *vfs_index)
 {
     if (len != LEN_PATH_PREFIX_IGNORED) {
@@ -114,6 +182,7 @@ esp_err_t esp_vfs_register_common(const char* base_path, size_t len, const esp_v
     entry->path_prefix_len = len;
     entry->ctx = ctx;
     entry->offset = index;
+    rebuild_prefix_table();
 
     if (vfs_index) {
         *vfs_index = index;
@@ -180,8 +249,9 @@ esp_err_t esp_vfs_unregister_with_id(esp_vfs_id_t vfs_id)
         return ESP_ERR_INVALID_ARG;
     }
     vfs_entry_t* vfs = s_vfs[vfs_id];
-    free(vfs);
     s_vfs[vfs_id] = NULL;
+    rebuild_prefix_table();
+    free(vfs);
 
     _lock_acquire(&s_fd_table_lock);
     // Delete all references from the FD lookup-table
@@ -338,44 +408,60 @@ static const char* translate_path(const vfs_entry_t* vfs, const char* src_path)
     return src_path + vfs->path_prefix_len;
 }
 
-const vfs_entry_t* get_vfs_for_path(const char* path)
+/* The copy of the table may be overwritten during the lookup, the probing then still ends,
+ * as a copy holds at most the entries of two tables, i.e. 2 * VFS_MAX_COUNT slots in use. */
+static const vfs_entry_t* find_vfs_in_table(const vfs_prefix_table_t *table, const char* path)
 {
-    const vfs_entry_t* best_match = NULL;
-    ssize_t best_match_prefix_len = -1;
-    size_t len = strlen(path);
-    for (size_t i = 0; i < s_vfs_count; ++i) {
-        const vfs_entry_t* vfs = s_vfs[i];
-        if (!vfs || vfs->path_prefix_len == LEN_PATH_PREFIX_IGNORED) {
-            continue;
-        }
-        // match path prefix
-        if (len < vfs->path_prefix_len ||
-            memcmp(path, vfs->path_prefix, vfs->path_prefix_len) != 0) {
-            continue;
-        }
-        // this is the default VFS and we don't have a better match yet.
-        if (vfs->path_prefix_len == 0 && !best_match) {
-            best_match = vfs;
-            continue;
-        }
+    // Hashes of the prefixes of path which may match a registered prefix, from the shortest
+    uint32_t hashes[ESP_VFS_PATH_MAX + 1];
+    uint8_t lens[ESP_VFS_PATH_MAX + 1];
+    size_t count = 0;
+    uint32_t hash = PREFIX_HASH_INIT;
+    size_t len;
+    for (len = 0; path[len] != '\0' && len <= ESP_VFS_PATH_MAX; ++len) {
         // if path is not equal to the prefix, expect to see a path separator
         // i.e. don't match "/data" prefix for "/data1/foo.txt" path
-        if (len > vfs->path_prefix_len &&
-                path[vfs->path_prefix_len] != '/') {
-            continue;
+        if (path[len] == '/' && (table->prefix_lens & (1u << len))) {
+            hashes[count] = hash;
+            lens[count] = len;
+            ++count;
         }
-        // Out of all matching path prefixes, select the longest one;
-        // i.e. if "/dev" and "/dev/uart" both match, for "/dev/uart/1" path,
-        // choose "/dev/uart",
-        // This causes all s_vfs_count VFS entries to be scanned when opening
-        // a file by name. This can be optimized by introducing a table for
-        // FS search order, sorted so that longer prefixes are checked first.
-        if (best_match_prefix_len < (ssize_t) vfs->path_prefix_len) {
-            best_match_prefix_len = (ssize_t) vfs->path_prefix_len;
-            best_match = vfs;
+        hash = prefix_hash_update(hash, path[len]);
+    }
+    if (path[len] == '\0' && (table->prefix_lens & (1u << len))) {
+        hashes[count] = hash;
+        lens[count] = len;
+        ++count;
+    }
+    // Out of all matching path prefixes, select the longest one;
+    // i.e. if "/dev" and "/dev/uart" both match, for "/dev/uart/1" path,
+    // choose "/dev/uart"
+    while (count > 0) {
+        --count;
+        for (size_t slot = hashes[count] & (VFS_PREFIX_TABLE_SIZE - 1);
+                table->slots[slot] != -1;
+                slot = (slot + 1) & (VFS_PREFIX_TABLE_SIZE - 1)) {
+            const vfs_entry_t* vfs = s_vfs[table->slots[slot]];
+            if (vfs != NULL && vfs->path_prefix_len == lens[count] &&
+                    memcmp(path, vfs->path_prefix, lens[count]) == 0) {
+                return vfs;
+            }
         }
     }
-    return best_match;
+    // the default VFS, if any, handles all other paths
+    return (table->default_vfs != -1) ? s_vfs[table->default_vfs] : NULL;
+}
+
+const vfs_entry_t* get_vfs_for_path(const char* path)
+{
+    const vfs_entry_t *vfs;
+    uint32_t seq;
+    do {
+        seq = __atomic_load_n(&s_prefix_table_seq, __ATOMIC_ACQUIRE);
+        vfs = find_vfs_in_table(__atomic_load_n(&s_prefix_table, __ATOMIC_ACQUIRE), path);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while (seq != __atomic_load_n(&s_prefix_table_seq, __ATOMIC_RELAXED));
+    return vfs;
 }
 
 /*
@@ -25,6 +25,9 @@
 #include "freertos/task.h"
 #include "cmd_system.h"
 #include "sdkconfig.h"
+#if CONFIG_HEAP_PROFILING
+#include "esp_heap_caps_profile.h"
+#endif
 
 #ifdef CONFIG_FREERTOS_USE_STATS_FORMATTING_FUNCTIONS
 #define WITH_TASKS_INFO 1
@@ -40,6 +43,9 @@ static void register_restart(void);
 static void register_tasks(void);
 #endif
 static void register_log_level(void);
+#if CONFIG_HEAP_PROFILING
+static void register_heap_profile(void);
+#endif
 
 void register_system_common(void)
 {
@@ -51,6 +57,9 @@ void register_system_common(void)
     register_tasks();
 #endif
     register_log_level();
+#if CONFIG_HEAP_PROFILING
+    register_heap_profile();
+#endif
 }
 
 
@@ -272,3 +281,53 @@ static void register_log_level(void)
     };
     ESP_ERROR_CHECK( esp_console_cmd_register(&cmd) );
 }
+
+#if CONFIG_HEAP_PROFILING
+
+/** 'heap_profile' command prints the call sites holding the most heap memory */
+
+static struct {
+    struct arg_int *count;
+    struct arg_lit *reset;
+    struct arg_end *end;
+} heap_profile_args;
+
+static int heap_profile(int argc, char **argv)
+{
+    int nerrors = arg_parse(argc, argv, (void **) &heap_profile_args);
+    if (nerrors != 0) {
+        arg_print_errors(stderr, heap_profile_args.end, argv[0]);
+        return 1;
+    }
+    int count = 10;
+    if (heap_profile_args.count->count) {
+        count = heap_profile_args.count->ival[0];
+        if (count <= 0) {
+            printf("Invalid number of call sites %d\n", count);
+            return 1;
+        }
+    }
+    heap_caps_profile_print(count);
+    if (heap_profile_args.reset->count) {
+        heap_caps_profile_reset();
+    }
+    return 0;
+}
+
+static void register_heap_profile(void)
+{
+    heap_profile_args.count = arg_int0(NULL, NULL, "<count>", "Number of call sites to print, 10 by default");
+    heap_profile_args.reset = arg_lit0("r", "reset", "Reset the counters of allocations, frees and peak bytes after printing");
+    heap_profile_args.end = arg_end(2);
+
+    const esp_console_cmd_t cmd = {
+        .command = "heap_profile",
+        .help = "Print the call sites holding the most heap memory.",
+        .hint = NULL,
+        .func = &heap_profile,
+        .argtable = &heap_profile_args
+    };
+    ESP_ERROR_CHECK( esp_console_cmd_register(&cmd) );
+}
+
+#endif // CONFIG_HEAP_PROFILING